@@ -925,9 +925,9 @@ static void * dsap_scanner(void* dummy)
 	timeout_sec = 0;
 
 	if (dsap_publish) {
-		if (op_ppath_version() != 3) {
+		if (op_ppath_version() != OPA_SA_DB_PATH_TABLE_VERSION) {
 			acm_log(0, "opasadb mis-match %u. Cannot Publish.\n",
-				OPA_SA_DB_PATH_TABLE_VERSION);
+				op_ppath_version());
 			return NULL;
 		}
 		err = op_ppath_create_writer(&shared_memory_writer);
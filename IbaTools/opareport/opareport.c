@@ -72,6 +72,9 @@ int				g_hard			= 0;	// omit software configured items
 int				g_noname		= 0;	// omit names
 char*			g_snapshot_in_file	= NULL;	// input file being parsed
 char*			g_topology_in_file	= NULL;	// input file being parsed
+int				g_refresh		= 0;	// update snapshot input from fabric
+int				g_stream		= 0;	// stream snapshot input
+uint32			g_streamLinks = 0;	// links in streamed snapshot
 int				g_interval		= 0;	// interval for port stats in seconds
 int				g_clearstats	= 0;	// clear port stats
 int				g_clearallstats	= 0;	// clear all port stats
@@ -7011,6 +7014,7 @@ void ShowLinkErrorReport(Point *focus, Format_t format, int indent, int detail)
 	LIST_ITEM *p;
 	uint32 count = 0;
 	uint32 checked = 0;
+	uint32 totalLinks = g_Fabric.LinkCount;
 
 	switch (format) {
 	case FORMAT_TEXT:
@@ -7117,14 +7121,18 @@ void ShowLinkErrorReport(Point *focus, Format_t format, int indent, int detail)
 			count++;
 		}
 	}
+	// when streaming only links with errors were kept in g_Fabric, but every
+	// link in the snapshot was checked as it was streamed
+	if (g_stream)
+		checked = totalLinks = g_streamLinks;
 	switch (format) {
 	case FORMAT_TEXT:
 		printf("%*s%u of %u Links Checked, %u Errors found\n", indent, "",
-					checked, g_Fabric.LinkCount, count);
+					checked, totalLinks, count);
 		break;
 	case FORMAT_XML:
 		XmlPrintDec("LinksChecked", checked, indent);
-		XmlPrintDec("TotalLinks", g_Fabric.LinkCount, indent);
+		XmlPrintDec("TotalLinks", totalLinks, indent);
 		XmlPrintDec("LinksWithErrors", count, indent);
 		break;
 	default:
@@ -7145,6 +7153,20 @@ done:
 	}
 }
 
+/* --stream support for the link error report, only links with a port over
+ * threshold are kept in g_Fabric
+ */
+static boolean StreamErrPortExceedsThreshold(PortData *portp, void *context)
+{
+	return PortCountersExceedThreshold(portp);
+}
+
+static FSTATUS StreamLinkErrorFabric(const char *input_file)
+{
+	return Xml2ParseSnapshotLinks(input_file, g_quiet, &g_Fabric, FF_NONE,
+						StreamErrPortExceedsThreshold, NULL, &g_streamLinks);
+}
+
 /* clear all PortCounters on all ports in fabric
  */
 FSTATUS ClearAllPortCountersAndShow(EUI64 portGuid, Point *focus, boolean clearall, Format_t format, boolean quiet)
@@ -12141,6 +12163,8 @@ struct option options[] = {
 		{ "dest", required_argument, NULL, 'D' },
 		{ "xml", no_argument, NULL, 'x' },
 		{ "infile", required_argument, NULL, 'X' },
+		{ "refresh", no_argument, NULL, '^' },	// use an invalid option character
+		{ "stream", no_argument, NULL, '&' },	// use an invalid option character
 		{ "topology", required_argument, NULL, 'T' },
 		{ "quietfocus", no_argument, NULL, 'Q' },
 		{ "vltables", no_argument, NULL, 'V' },
@@ -12157,7 +12181,8 @@ struct option options[] = {
 void Usage_full(void)
 {
 	fprintf(stderr, "Usage: opareport [-v][-q] [-h hfi] [-p port] [-o report] [-d detail]\n"
-	                "                    [-P|-H] [-N] [-x] [-X snapshot_input] [-T topology_input]\n"
+	                "                    [-P|-H] [-N] [-x] [-X snapshot_input [--refresh|--stream]]\n"
+	                "                    [-T topology_input]\n"
 	                "                    [-s] [-r] [-V] [-i seconds] [-b date_time] [-e date_time]\n"
 	                "                    [-C] [-a] [-m] [-M] [-A] [-c file] [-L] [-F point]\n"
 	                "                    [-S point] [-D point] [-Q]\n");
@@ -12183,6 +12208,15 @@ void Usage_full(void)
 	fprintf(stderr, "                                previous -o snapshot run.\n");
 	fprintf(stderr, "                                When used, -s, -i, -C and -a options are ignored\n");
 	fprintf(stderr, "                                '-' may be used to specify stdin\n");
+	fprintf(stderr, "    --refresh                 - update snapshot_input to match the fabric,\n");
+	fprintf(stderr, "                                only nodes which are new or changed are\n");
+	fprintf(stderr, "                                queried. Node and link changes are applied,\n");
+	fprintf(stderr, "                                other snapshot data is reported as is.\n");
+	fprintf(stderr, "                                Not permitted for snapshots taken with -m or -A\n");
+	fprintf(stderr, "    --stream                  - read snapshot_input one node at a time, keeping\n");
+	fprintf(stderr, "                                only the nodes the report needs. snapshot_input\n");
+	fprintf(stderr, "                                is read twice, so stdin is not permitted.\n");
+	fprintf(stderr, "                                Only supported for -o errors without -F or -T\n");
 	fprintf(stderr, "    -T/--topology topology_input\n");
 	fprintf(stderr, "                              - use topology_input file to augment and\n");
 	fprintf(stderr, "                                verify fabric information.  When used various\n");
@@ -12988,6 +13022,12 @@ int main(int argc, char ** argv)
 			case 'X':	// snapshot_input in xml
 				g_snapshot_in_file = optarg;
 				break;
+			case '^':	// refresh snapshot_input from fabric
+				g_refresh = 1;
+				break;
+			case '&':	// stream snapshot_input
+				g_stream = 1;
+				break;
 			case 'T':	// topology_input in xml
 				g_topology_in_file = optarg;
 				break;
@@ -13138,6 +13178,19 @@ int main(int argc, char ** argv)
 	if (!g_snapshot_in_file && (sweepFlags & FF_SMADIRECT)&& ((report & REPORT_ROUTE ) || ( focus_arg && NULL != ComparePrefix(focus_arg, "route:"))))  
 		routes = 1;
 	
+	if (g_refresh && ! g_snapshot_in_file) {
+		fprintf(stderr, "opareport: --refresh requires -X\n");
+		Usage();
+		// NOTREACHED
+	}
+
+	if (g_stream && (! g_snapshot_in_file || strcmp(g_snapshot_in_file, "-") == 0
+				|| report != REPORT_ERRORS || focus_arg || g_topology_in_file || g_refresh)) {
+		fprintf(stderr, "opareport: --stream requires -X file and -o errors without -F, -T or --refresh\n");
+		Usage();
+		// NOTREACHED
+	}
+
 	if ((report & REPORT_DGMEMBER) && g_snapshot_in_file) {
 		fprintf(stderr, "opareport: -o dgmember option is not permitted against a snapshot.\n");
 		Usage();
@@ -13225,7 +13278,7 @@ int main(int argc, char ** argv)
 	}
 
 	// figure out which local port we will use to gather data
-	if (g_snapshot_in_file) {
+	if (g_snapshot_in_file && ! g_refresh) {
 		if (gotport || gothfi)
 			fprintf(stderr, "opareport: -p and -h ignored for -X\n");
 	} else {
@@ -13270,11 +13323,26 @@ int main(int argc, char ** argv)
 	}
 
 	// get the fabric data
-	if (g_snapshot_in_file) {
-		if (FSUCCESS != Xml2ParseSnapshot(g_snapshot_in_file, g_quiet, &g_Fabric, FF_NONE, 0)) {
+	if (g_stream) {
+		if (FSUCCESS != StreamLinkErrorFabric(g_snapshot_in_file)) {
 			g_exitstatus = 1;
 			goto done;
 		}
+	} else if (g_snapshot_in_file) {
+		if (FSUCCESS != Xml2ParseSnapshot(g_snapshot_in_file, g_quiet, &g_Fabric, FF_ARENA, 0)) {
+			g_exitstatus = 1;
+			goto done;
+		}
+		if (g_refresh) {
+			if (FSUCCESS != InitMad(g_portGuid, g_verbose?stderr:NULL)) {
+				g_exitstatus = 1;
+				goto done_fabric;
+			}
+			if (FSUCCESS != SweepRefresh(g_portGuid, &g_Fabric, SWEEP_ALL, g_quiet, g_ms_timeout)) {
+				g_exitstatus = 1;
+				goto done_fabric;
+			}
+		}
 	} else {
 		if (FSUCCESS != InitMad(g_portGuid, g_verbose?stderr:NULL)) {
 			g_exitstatus = 1;
@@ -72,7 +72,6 @@ static uint32 present_routes = 0, missing_routes = 0;
 static uint32 hops_histogram_entries = 0, hops_histogram_length = 0; 
 static uint32 *hops_histogram = NULL; 
 static cl_qmap_t hopsHistogramLstMap; 
-static cl_qmap_t *routesLstMap; 
 
 #endif
 
@@ -132,7 +131,7 @@ static int CompareIOC(IN const uint64 key1, IN const uint64 key2)
 #endif
 
 // only FF_LIDARRAY,FF_PMADIRECT,FF_SMADIRECT,FF_DOWNPORTINFO,FF_CABLELOWPAGE
-// flags are used, others ignored
+// and FF_ARENA flags are used, others ignored
 FSTATUS InitFabricData(FabricData_t *fabricp, FabricFlags_t flags)
 {
 	MemoryClear(fabricp, sizeof(*fabricp));
@@ -141,7 +140,7 @@ FSTATUS InitFabricData(FabricData_t *fabricp, FabricFlags_t flags)
 		cl_qmap_init(&fabricp->u.AllLids, NULL);
 	}
 	fabricp->ms_timeout = RESP_WAIT_TIME;
-	fabricp->flags = flags & (FF_LIDARRAY|FF_PMADIRECT|FF_SMADIRECT|FF_DOWNPORTINFO|FF_CABLELOWPAGE);
+	fabricp->flags = flags & (FF_LIDARRAY|FF_PMADIRECT|FF_SMADIRECT|FF_DOWNPORTINFO|FF_CABLELOWPAGE|FF_ARENA);
 	cl_qmap_init(&fabricp->AllSystems, NULL);
 	cl_qmap_init(&fabricp->ExpectedNodeGuidMap, NULL);
 	QListInitState(&fabricp->AllPorts);
@@ -519,11 +518,11 @@ void PortDataFreeQOSData(FabricData_t *fabricp, PortData *portp)
 		}
 
 		if (pQOS->SL2SCMap)
-			MemoryDeallocate(pQOS->SL2SCMap);
+			FabricDataDeallocate(fabricp, pQOS->SL2SCMap);
 		if (pQOS->SC2SLMap)
-			MemoryDeallocate(pQOS->SC2SLMap);
+			FabricDataDeallocate(fabricp, pQOS->SC2SLMap);
 
-		MemoryDeallocate(pQOS);
+		FabricDataDeallocate(fabricp, pQOS);
 	}
 	portp->pQOS = NULL;
 }
@@ -540,16 +539,161 @@ void PortDataFreeBufCtrlTable(FabricData_t *fabricp, PortData *portp)
 void PortDataFreePartitionTable(FabricData_t *fabricp, PortData *portp)
 {
 	if (portp->pPartitionTable) {
-		MemoryDeallocate(portp->pPartitionTable);
+		FabricDataDeallocate(fabricp, portp->pPartitionTable);
 	}
 	portp->pPartitionTable = NULL;
 }
 
 
+void PortDataFreePortCounters(FabricData_t *fabricp, PortData *portp)
+{
+	if (portp->pPortCounters) {
+		// entries in PortCountersSlab are freed with the slab
+		if (! fabricp || ! fabricp->PortCountersSlab
+			|| portp->pPortCounters < fabricp->PortCountersSlab
+			|| portp->pPortCounters >= fabricp->PortCountersSlab + fabricp->PortCountersSlabCount)
+			FabricDataDeallocate(fabricp, portp->pPortCounters);
+	}
+	portp->pPortCounters = NULL;
+}
+
+// a fabric has at most one slab, any previous slab is released after
+// clearing all references to it
+FSTATUS FabricDataAllocatePortCountersSlab(FabricData_t *fabricp, uint32 count)
+{
+	LIST_ITEM *p;
+
+	if (fabricp->PortCountersSlab) {
+		for (p=QListHead(&fabricp->AllPorts); p != NULL; p = QListNext(&fabricp->AllPorts, p))
+			PortDataFreePortCounters(fabricp, (PortData *)QListObj(p));
+		MemoryDeallocate(fabricp->PortCountersSlab);
+		fabricp->PortCountersSlab = NULL;
+		fabricp->PortCountersSlabCount = 0;
+	}
+	if (! count)
+		return FSUCCESS;
+	fabricp->PortCountersSlab = (STL_PORT_COUNTERS_DATA *)MemoryAllocate2AndClear(
+				sizeof(STL_PORT_COUNTERS_DATA)*count, IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! fabricp->PortCountersSlab) {
+		fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
+		return FINSUFFICIENT_MEMORY;
+	}
+	fabricp->PortCountersSlabCount = count;
+	return FSUCCESS;
+}
+
+// size of a FabricArena_t slab, larger requests get a slab of their own
+#define FABRIC_ARENA_SLAB_SIZE (4*1024*1024)
+#define FABRIC_ARENA_ALIGN 8
+
+// precedes each FabricDataAllocate object unless FF_ARENA
+typedef struct FabricPoolHeader_s {
+	uint32 sizeClass;		// 0 if individually allocated
+	uint32 reserved;
+} FabricPoolHeader_t;
+
+static void *FabricArenaAllocate(FabricArena_t *arenap, uint32 size)
+{
+	FabricArenaSlab_t *slab;
+	void *p;
+
+	size = ROUNDUP(size, FABRIC_ARENA_ALIGN);
+	if (size > arenap->remaining) {
+		uint64 slabSize = MAX(size, FABRIC_ARENA_SLAB_SIZE);
+
+		// slabs are cleared once, freed pool objects are cleared on reuse
+		slab = (FabricArenaSlab_t *)MemoryAllocate2AndClear(
+					sizeof(FabricArenaSlab_t) + slabSize,
+					IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+		if (! slab)
+			return NULL;
+		slab->size = slabSize;
+		if (size > FABRIC_ARENA_SLAB_SIZE/4 && arenap->slabs) {
+			// keep using the current slab for small requests
+			slab->next = arenap->slabs->next;
+			arenap->slabs->next = slab;
+			return (void *)(slab+1);
+		}
+		slab->next = arenap->slabs;
+		arenap->slabs = slab;
+		arenap->next = (uint8 *)(slab+1);
+		arenap->remaining = slabSize;
+	}
+	p = arenap->next;
+	arenap->next += size;
+	arenap->remaining -= size;
+	return p;
+}
+
+void *FabricDataAllocate(FabricData_t *fabricp, uint32 size)
+{
+	FabricPoolHeader_t *hdr;
+	uint32 sizeClass;
+
+	if (fabricp && (fabricp->flags & FF_ARENA))
+		return FabricArenaAllocate(&fabricp->Arena, size);
+
+	sizeClass = (size + sizeof(FabricPoolHeader_t) + FABRIC_POOL_CLASS_SIZE-1)
+					/ FABRIC_POOL_CLASS_SIZE;
+	if (! fabricp || sizeClass > FABRIC_POOL_CLASSES) {
+		hdr = (FabricPoolHeader_t *)MemoryAllocate2AndClear(
+					sizeof(FabricPoolHeader_t) + size,
+					IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+		if (! hdr)
+			return NULL;
+		hdr->sizeClass = 0;
+		return (void *)(hdr+1);
+	}
+	hdr = (FabricPoolHeader_t *)fabricp->Arena.freeList[sizeClass-1];
+	if (hdr) {
+		// free list link is kept in the first word of the object
+		fabricp->Arena.freeList[sizeClass-1] = *(void **)(hdr+1);
+		MemoryClear(hdr+1, sizeClass*FABRIC_POOL_CLASS_SIZE - sizeof(FabricPoolHeader_t));
+	} else {
+		hdr = (FabricPoolHeader_t *)FabricArenaAllocate(&fabricp->Arena,
+					sizeClass*FABRIC_POOL_CLASS_SIZE);
+		if (! hdr)
+			return NULL;
+	}
+	hdr->sizeClass = sizeClass;
+	return (void *)(hdr+1);
+}
+
+void FabricDataDeallocate(FabricData_t *fabricp, void *p)
+{
+	FabricPoolHeader_t *hdr;
+
+	// arena memory is released as a whole by DestroyFabricData
+	if (fabricp && (fabricp->flags & FF_ARENA))
+		return;
+	hdr = (FabricPoolHeader_t *)p - 1;
+	if (! hdr->sizeClass) {
+		MemoryDeallocate(hdr);
+		return;
+	}
+	if (! fabricp)
+		return;	// stays in its slab until DestroyFabricData
+	*(void **)p = fabricp->Arena.freeList[hdr->sizeClass-1];
+	fabricp->Arena.freeList[hdr->sizeClass-1] = hdr;
+}
+
+static void FabricDataFreeArena(FabricData_t *fabricp)
+{
+	FabricArenaSlab_t *slab;
+
+	while ((slab = fabricp->Arena.slabs) != NULL) {
+		fabricp->Arena.slabs = slab->next;
+		MemoryDeallocate(slab);
+	}
+	fabricp->Arena.next = NULL;
+	fabricp->Arena.remaining = 0;
+	MemoryClear(fabricp->Arena.freeList, sizeof(fabricp->Arena.freeList));
+}
+
 void PortDataFreeCableInfoData(FabricData_t *fabricp, PortData *portp)
 {
 	if (portp->pCableInfoData) {
-		MemoryDeallocate(portp->pCableInfoData);
+		FabricDataDeallocate(fabricp, portp->pCableInfoData);
 	}
 	portp->pCableInfoData = NULL;
 }
@@ -807,8 +951,8 @@ void PortDataFree(FabricData_t *fabricp, PortData *portp)
 	if (portp->PortGUID)
 		AllLidsRemove(fabricp, portp);
 	cl_qmap_remove_item(&nodep->Ports, &portp->NodePortsEntry);
-	if (portp->pPortCounters)
-		MemoryDeallocate(portp->pPortCounters);
+	NodeDataFreeRouteTable(nodep);
+	PortDataFreePortCounters(fabricp, portp);
 	PortDataFreeQOSData(fabricp, portp);
 	PortDataFreeBufCtrlTable(fabricp, portp);
 	PortDataFreePartitionTable(fabricp, portp);
@@ -816,7 +960,7 @@ void PortDataFree(FabricData_t *fabricp, PortData *portp)
 
 	PortDataFreeCableInfoData(fabricp, portp);
 	PortDataFreeCongestionControlTableEntries(fabricp, portp);
-	MemoryDeallocate(portp);
+	FabricDataDeallocate(fabricp, portp);
 }
 
 FSTATUS PortDataAllocateQOSData(FabricData_t *fabricp, PortData *portp)
@@ -825,7 +969,7 @@ FSTATUS PortDataAllocateQOSData(FabricData_t *fabricp, PortData *portp)
 	int i;
 
 	ASSERT(! portp->pQOS);	// or could free if present
-	portp->pQOS = (QOSData *)MemoryAllocate2AndClear(sizeof(QOSData), IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	portp->pQOS = (QOSData *)FabricDataAllocate(fabricp, sizeof(QOSData));
 	if (! portp->pQOS) {
 		fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
 		goto fail;
@@ -842,13 +986,13 @@ FSTATUS PortDataAllocateQOSData(FabricData_t *fabricp, PortData *portp)
 		}
 	} else {
 		// HFI and Switch Port 0 get SL2SC and SC2SL
-		pQOS->SL2SCMap = (STL_SLSCMAP *)MemoryAllocate2AndClear(sizeof(STL_SLSCMAP), IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+		pQOS->SL2SCMap = (STL_SLSCMAP *)FabricDataAllocate(fabricp, sizeof(STL_SLSCMAP));
 		if (! pQOS->SL2SCMap) {
 			fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
 			goto fail;
 		}
 
-		pQOS->SC2SLMap = (STL_SCSLMAP *)MemoryAllocate2AndClear(sizeof(STL_SCSLMAP), IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+		pQOS->SC2SLMap = (STL_SCSLMAP *)FabricDataAllocate(fabricp, sizeof(STL_SCSLMAP));
 		if (!pQOS->SC2SLMap) {
 			goto fail;
 		}
@@ -930,7 +1074,7 @@ FSTATUS PortDataAllocatePartitionTable(FabricData_t *fabricp, PortData *portp)
 
 	ASSERT(! portp->pPartitionTable);	// or could free if present
 	size = PortPartitionTableSize(portp);
-	portp->pPartitionTable = (STL_PKEY_ELEMENT *)MemoryAllocate2AndClear(sizeof(STL_PKEY_ELEMENT)*size, IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	portp->pPartitionTable = (STL_PKEY_ELEMENT *)FabricDataAllocate(fabricp, sizeof(STL_PKEY_ELEMENT)*size);
 	if (! portp->pPartitionTable) {
 		fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
 		goto fail;
@@ -969,7 +1113,7 @@ FSTATUS PortDataAllocateCableInfoData(FabricData_t *fabricp, PortData *portp)
 			size = STL_CABLE_INFO_DATA_SIZE * 4;    // 2 blocks of lower page 0 and 2 blocks of upper page 0
 	}
 
-	portp->pCableInfoData = MemoryAllocate2AndClear(size, IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	portp->pCableInfoData = FabricDataAllocate(fabricp, size);
 	if (! portp->pCableInfoData) {
 		fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
 		goto fail;
@@ -1047,7 +1191,7 @@ PortData* NodeDataAddPort(FabricData_t *fabricp, NodeData *nodep, EUI64 guid, ST
 {
 	PortData *portp;
 
-	portp = (PortData*)MemoryAllocate2AndClear(sizeof(PortData), IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	portp = (PortData*)FabricDataAllocate(fabricp, sizeof(PortData));
 	if (! portp) {
 		fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
 		goto fail;
@@ -1075,6 +1219,7 @@ PortData* NodeDataAddPort(FabricData_t *fabricp, NodeData *nodep, EUI64 guid, ST
 	//DisplayPortInfoRecord(&pPortInfoRecords[i], 0);
 	//printf("process PortNumber: %u\n", portp->PortNum);
 
+	NodeDataFreeRouteTable(nodep);
 	if (cl_qmap_insert(&nodep->Ports, portp->PortNum, &portp->NodePortsEntry) != &portp->NodePortsEntry)
 	{
 		fprintf(stderr, "%s: Duplicate PortNums found in portRecords: LID 0x%x Port %u Node: %.*s\n",
@@ -1082,7 +1227,7 @@ PortData* NodeDataAddPort(FabricData_t *fabricp, NodeData *nodep, EUI64 guid, ST
 					   	portp->EndPortLID,
 					   	portp->PortNum, STL_NODE_DESCRIPTION_ARRAY_SIZE,
 						(char*)nodep->NodeDesc.NodeString);
-		MemoryDeallocate(portp);
+		FabricDataDeallocate(fabricp, portp);
 		goto fail;
 	}
 	if (FSUCCESS != AllLidsAdd(fabricp, portp, FALSE))
@@ -1093,7 +1238,7 @@ PortData* NodeDataAddPort(FabricData_t *fabricp, NodeData *nodep, EUI64 guid, ST
 			   	portp->PortNum, STL_NODE_DESCRIPTION_ARRAY_SIZE,
 				(char*)nodep->NodeDesc.NodeString);
 		cl_qmap_remove_item(&nodep->Ports, &portp->NodePortsEntry);
-		MemoryDeallocate(portp);
+		FabricDataDeallocate(fabricp, portp);
 		goto fail;
 	}
 	//DisplayPortInfoRecord(pPortInfo, 0);
@@ -1120,9 +1265,344 @@ FSTATUS NodeDataSetSwitchInfo(NodeData *nodep, STL_SWITCHINFO_RECORD *pSwitchInf
 
 // TBD - routines to add/set IOC and IOU information
 
+#define NODE_NAME_INDEX_MIN_SIZE 1024
+
+// hash of the portion of name strncmp would compare against a NodeDesc
+static uint32 NodeNameHash(const char *name)
+{
+	uint32 hash = 2166136261U;	// FNV-1a
+	unsigned i;
+
+	for (i=0; i < STL_NODE_DESCRIPTION_ARRAY_SIZE && name[i]; i++) {
+		hash ^= (uint8)name[i];
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+// insert into bucket chain, keeping chain in NodeGUID order
+static void NodeNameIndexInsert(NodeData **buckets, uint32 size, NodeData *nodep)
+{
+	NodeData **pp = &buckets[NodeNameHash((char*)nodep->NodeDesc.NodeString) & (size-1)];
+
+	while (*pp && (*pp)->NodeInfo.NodeGUID < nodep->NodeInfo.NodeGUID)
+		pp = &(*pp)->NodeNameNext;
+	nodep->NodeNameNext = *pp;
+	*pp = nodep;
+}
+
+static FSTATUS NodeNameIndexResize(FabricData_t *fabricp, uint32 size)
+{
+	NodeNameIndex_t *indexp = &fabricp->NodeNameIndex;
+	NodeData **buckets;
+	uint32 i;
+
+	buckets = (NodeData **)MemoryAllocate2AndClear(sizeof(NodeData *)*size, IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! buckets) {
+		fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
+		return FINSUFFICIENT_MEMORY;
+	}
+	for (i=0; i < indexp->Size; i++) {
+		NodeData *nodep = indexp->Buckets[i];
+		while (nodep) {
+			NodeData *next = nodep->NodeNameNext;
+			NodeNameIndexInsert(buckets, size, nodep);
+			nodep = next;
+		}
+	}
+	if (indexp->Buckets)
+		MemoryDeallocate(indexp->Buckets);
+	indexp->Buckets = buckets;
+	indexp->Size = size;
+	return FSUCCESS;
+}
+
+void FabricDataFreeNodeNameIndex(FabricData_t *fabricp)
+{
+	if (fabricp->NodeNameIndex.Buckets)
+		MemoryDeallocate(fabricp->NodeNameIndex.Buckets);
+	fabricp->NodeNameIndex.Buckets = NULL;
+	fabricp->NodeNameIndex.Size = 0;
+	fabricp->NodeNameIndex.Count = 0;
+}
+
+FSTATUS FabricDataBuildNodeNameIndex(FabricData_t *fabricp)
+{
+	uint32 size = NODE_NAME_INDEX_MIN_SIZE;
+	cl_map_item_t *p;
+	FSTATUS status;
+
+	FabricDataFreeNodeNameIndex(fabricp);
+	while (size < cl_qmap_count(&fabricp->AllNodes))
+		size *= 2;
+	status = NodeNameIndexResize(fabricp, size);
+	if (status != FSUCCESS)
+		return status;
+	for (p=cl_qmap_head(&fabricp->AllNodes); p != cl_qmap_end(&fabricp->AllNodes); p = cl_qmap_next(p)) {
+		NodeData *nodep = PARENT_STRUCT(p, NodeData, AllNodesEntry);
+		NodeNameIndexInsert(fabricp->NodeNameIndex.Buckets, size, nodep);
+		fabricp->NodeNameIndex.Count++;
+	}
+	return FSUCCESS;
+}
+
+void NodeNameIndexAdd(FabricData_t *fabricp, NodeData *nodep)
+{
+	NodeNameIndex_t *indexp = &fabricp->NodeNameIndex;
+
+	if (! indexp->Buckets)
+		return;
+	if (indexp->Count >= indexp->Size
+		&& FSUCCESS != NodeNameIndexResize(fabricp, indexp->Size * 2)) {
+		// searches fall back to scanning AllNodes
+		FabricDataFreeNodeNameIndex(fabricp);
+		return;
+	}
+	NodeNameIndexInsert(indexp->Buckets, indexp->Size, nodep);
+	indexp->Count++;
+}
+
+void NodeNameIndexRemove(FabricData_t *fabricp, NodeData *nodep)
+{
+	NodeNameIndex_t *indexp = &fabricp->NodeNameIndex;
+	NodeData **pp;
+
+	if (! indexp->Buckets)
+		return;
+	pp = &indexp->Buckets[NodeNameHash((char*)nodep->NodeDesc.NodeString) & (indexp->Size-1)];
+	for (; *pp; pp = &(*pp)->NodeNameNext) {
+		if (*pp == nodep) {
+			*pp = nodep->NodeNameNext;
+			nodep->NodeNameNext = NULL;
+			indexp->Count--;
+			return;
+		}
+	}
+}
+
+NodeData *NodeNameIndexChain(FabricData_t *fabricp, const char *name)
+{
+	NodeNameIndex_t *indexp = &fabricp->NodeNameIndex;
+
+	if (! indexp->Buckets)
+		return NULL;
+	return indexp->Buckets[NodeNameHash(name) & (indexp->Size-1)];
+}
+
+#define GUID_INDEX_MIN_SIZE 1024
+
+// GUIDs from one vendor share their upper bits, so multiply to spread them
+static uint32 GuidIndexHash(EUI64 guid, uint32 size)
+{
+	return (uint32)((guid * 0x9E3779B97F4A7C15ULL) >> 32) & (size-1);
+}
+
+// returns FALSE if guid was already in the index, first object added is kept
+static boolean GuidIndexInsert(GuidIndexEntry_t *entries, uint32 size, EUI64 guid, void *objp)
+{
+	uint32 i = GuidIndexHash(guid, size);
+
+	for (; entries[i].guid; i = (i+1) & (size-1)) {
+		if (entries[i].guid == guid)
+			return FALSE;
+	}
+	entries[i].guid = guid;
+	entries[i].objp = objp;
+	return TRUE;
+}
+
+static FSTATUS GuidIndexResize(GuidIndex_t *indexp, uint32 size)
+{
+	GuidIndexEntry_t *entries;
+	uint32 i;
+
+	entries = (GuidIndexEntry_t *)MemoryAllocate2AndClear(sizeof(GuidIndexEntry_t)*size, IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! entries) {
+		fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
+		return FINSUFFICIENT_MEMORY;
+	}
+	for (i=0; i < indexp->Size; i++) {
+		if (indexp->Entries[i].guid)
+			(void)GuidIndexInsert(entries, size, indexp->Entries[i].guid, indexp->Entries[i].objp);
+	}
+	if (indexp->Entries)
+		MemoryDeallocate(indexp->Entries);
+	indexp->Entries = entries;
+	indexp->Size = size;
+	return FSUCCESS;
+}
+
+static void GuidIndexFree(GuidIndex_t *indexp)
+{
+	if (indexp->Entries)
+		MemoryDeallocate(indexp->Entries);
+	MemoryClear(indexp, sizeof(*indexp));
+}
+
+// guid of 0 is not indexed
+static FSTATUS GuidIndexAdd(GuidIndex_t *indexp, EUI64 guid, void *objp)
+{
+	FSTATUS status;
+
+	if (! guid)
+		return FSUCCESS;
+	// keep at least half the slots empty so probe sequences stay short
+	if ((indexp->Count+1)*2 > indexp->Size) {
+		status = GuidIndexResize(indexp, indexp->Size*2);
+		if (status != FSUCCESS)
+			return status;
+	}
+	if (GuidIndexInsert(indexp->Entries, indexp->Size, guid, objp))
+		indexp->Count++;
+	else
+		indexp->Duplicates++;
+	return FSUCCESS;
+}
+
+// remove guid if it is indexed for objp.  Later entries in the probe
+// sequence are shifted back so no tombstones are needed.
+// returns TRUE if guid was removed
+static boolean GuidIndexRemove(GuidIndex_t *indexp, EUI64 guid, void *objp)
+{
+	GuidIndexEntry_t *entries = indexp->Entries;
+	uint32 mask = indexp->Size-1;
+	uint32 i, j, k;
+
+	if (! guid)
+		return FALSE;
+	for (i = GuidIndexHash(guid, indexp->Size); entries[i].guid != guid; i = (i+1) & mask) {
+		if (! entries[i].guid)
+			return FALSE;
+	}
+	if (entries[i].objp != objp)
+		return FALSE;
+	for (j = (i+1) & mask; entries[j].guid; j = (j+1) & mask) {
+		k = GuidIndexHash(entries[j].guid, indexp->Size);
+		// entry can move to i only if its home slot k is not within (i, j]
+		if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+		entries[i] = entries[j];
+		i = j;
+	}
+	entries[i].guid = 0;
+	entries[i].objp = NULL;
+	indexp->Count--;
+	return TRUE;
+}
+
+void *GuidIndexFind(const GuidIndex_t *indexp, EUI64 guid)
+{
+	const GuidIndexEntry_t *entries = indexp->Entries;
+	uint32 i;
+
+	for (i = GuidIndexHash(guid, indexp->Size); entries[i].guid; i = (i+1) & (indexp->Size-1)) {
+		if (entries[i].guid == guid)
+			return entries[i].objp;
+	}
+	return NULL;
+}
+
+void FabricDataFreeGuidIndexes(FabricData_t *fabricp)
+{
+	GuidIndexFree(&fabricp->NodeGuidIndex);
+	GuidIndexFree(&fabricp->PortGuidIndex);
+}
+
+FSTATUS FabricDataBuildNodeGuidIndex(FabricData_t *fabricp)
+{
+	GuidIndex_t *indexp = &fabricp->NodeGuidIndex;
+	uint32 size = GUID_INDEX_MIN_SIZE;
+	cl_map_item_t *p;
+	FSTATUS status;
+
+	GuidIndexFree(indexp);
+	while (size < cl_qmap_count(&fabricp->AllNodes)*2)
+		size *= 2;
+	status = GuidIndexResize(indexp, size);
+	if (status != FSUCCESS)
+		return status;
+	for (p=cl_qmap_head(&fabricp->AllNodes); p != cl_qmap_end(&fabricp->AllNodes); p = cl_qmap_next(p)) {
+		NodeData *nodep = PARENT_STRUCT(p, NodeData, AllNodesEntry);
+		status = GuidIndexAdd(indexp, nodep->NodeInfo.NodeGUID, nodep);
+		if (status != FSUCCESS) {
+			GuidIndexFree(indexp);
+			return status;
+		}
+	}
+	return FSUCCESS;
+}
+
+void NodeGuidIndexAdd(FabricData_t *fabricp, NodeData *nodep)
+{
+	GuidIndex_t *indexp = &fabricp->NodeGuidIndex;
+
+	if (! indexp->Entries)
+		return;
+	if (FSUCCESS != GuidIndexAdd(indexp, nodep->NodeInfo.NodeGUID, nodep)) {
+		// searches fall back to AllNodes
+		GuidIndexFree(indexp);
+	}
+}
+
+void NodeGuidIndexRemove(FabricData_t *fabricp, NodeData *nodep)
+{
+	GuidIndex_t *indexp = &fabricp->NodeGuidIndex;
+
+	if (! indexp->Entries)
+		return;
+	(void)GuidIndexRemove(indexp, nodep->NodeInfo.NodeGUID, nodep);
+}
+
+FSTATUS PortGuidIndexUpdate(FabricData_t *fabricp)
+{
+	GuidIndex_t *indexp = &fabricp->PortGuidIndex;
+	LIST_ITEM *p;
+	FSTATUS status;
+
+	if (! indexp->Entries) {
+		uint32 size = GUID_INDEX_MIN_SIZE;
+
+		while (size < QListCount(&fabricp->AllPorts)*2)
+			size *= 2;
+		status = GuidIndexResize(indexp, size);
+		if (status != FSUCCESS)
+			return status;
+		indexp->Last = NULL;
+	}
+	p = indexp->Last ? QListNext(&fabricp->AllPorts, indexp->Last)
+					: QListHead(&fabricp->AllPorts);
+	for (; p != NULL; p = QListNext(&fabricp->AllPorts, p)) {
+		PortData *portp = (PortData *)QListObj(p);
+
+		// AllPorts order decides which port is found for a duplicate guid
+		status = GuidIndexAdd(indexp, portp->PortGUID, portp);
+		if (status != FSUCCESS) {
+			GuidIndexFree(indexp);
+			return status;
+		}
+		indexp->Last = p;
+	}
+	return FSUCCESS;
+}
+
+void PortGuidIndexRemove(FabricData_t *fabricp, PortData *portp)
+{
+	GuidIndex_t *indexp = &fabricp->PortGuidIndex;
+
+	if (! indexp->Entries)
+		return;
+	if (indexp->Last == &portp->AllPortsEntry)
+		indexp->Last = QListPrev(&fabricp->AllPorts, indexp->Last);
+	if (GuidIndexRemove(indexp, portp->PortGUID, portp) && indexp->Duplicates) {
+		// another port may have the same guid, rebuild the index when
+		// next needed so it is found in AllPorts order
+		GuidIndexFree(indexp);
+	}
+}
+
 NodeData *FabricDataAddNode(FabricData_t *fabricp, STL_NODE_RECORD *pNodeRecord, boolean *new_nodep)
 {
-	NodeData *nodep = (NodeData*)MemoryAllocate2AndClear(sizeof(NodeData), IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	NodeData *nodep = (NodeData*)FabricDataAllocate(fabricp, sizeof(NodeData));
 	cl_map_item_t *mi;
 	boolean new_node = TRUE;
 
@@ -1150,7 +1630,7 @@ NodeData *FabricDataAddNode(FabricData_t *fabricp, STL_NODE_RECORD *pNodeRecord,
 	mi = cl_qmap_insert(&fabricp->AllNodes, nodep->NodeInfo.NodeGUID, &nodep->AllNodesEntry);
 	if (mi != &nodep->AllNodesEntry)
 	{
-		MemoryDeallocate(nodep);
+		FabricDataDeallocate(fabricp, nodep);
 		nodep = PARENT_STRUCT(mi, NodeData, AllNodesEntry);
 		new_node = FALSE;
 	}
@@ -1158,9 +1638,17 @@ NodeData *FabricDataAddNode(FabricData_t *fabricp, STL_NODE_RECORD *pNodeRecord,
 	if (new_node) {
 		if (FSUCCESS != AddSystemNode(fabricp, nodep)) {
 			cl_qmap_remove_item(&fabricp->AllNodes, &nodep->AllNodesEntry);
-			MemoryDeallocate(nodep);
+			FabricDataDeallocate(fabricp, nodep);
 			goto fail;
 		}
+		// index is started with the first node added
+		if (cl_qmap_count(&fabricp->AllNodes) == 1) {
+			(void)FabricDataBuildNodeNameIndex(fabricp);
+			(void)FabricDataBuildNodeGuidIndex(fabricp);
+		} else {
+			NodeNameIndexAdd(fabricp, nodep);
+			NodeGuidIndexAdd(fabricp, nodep);
+		}
 	}
 
 	if (new_nodep)
@@ -1500,6 +1988,8 @@ void NodeDataFreeSwitchData(FabricData_t *fabricp, NodeData *nodep)
 		for (i = 0; i < STL_NUM_MFT_POSITIONS_MASK; ++i)
 			if (switchp->MulticastFDB[i])
 				MemoryDeallocate(switchp->MulticastFDB[i]);
+		if (switchp->PortsByNum)
+			MemoryDeallocate(switchp->PortsByNum);
 
 
 		MemoryDeallocate(switchp);
@@ -1508,6 +1998,53 @@ void NodeDataFreeSwitchData(FabricData_t *fabricp, NodeData *nodep)
 }
 
 
+// discard compiled route table, must be called whenever nodep->Ports changes
+void NodeDataFreeRouteTable(NodeData *nodep)
+{
+	SwitchData *switchp = nodep->switchp;
+
+	if (switchp && switchp->PortsByNum) {
+		MemoryDeallocate(switchp->PortsByNum);
+		switchp->PortsByNum = NULL;
+		switchp->PortsByNumSize = 0;
+	}
+}
+
+// build a dense PortNum indexed PortData table for every switch which
+// does not already have one, so route walks need no qmap searches.
+// Must be called before route walks are started on multiple threads.
+FSTATUS FabricDataCompileRouteTables(FabricData_t *fabricp)
+{
+	LIST_ITEM *n;
+	cl_map_item_t *p;
+	FSTATUS status = FSUCCESS;
+
+	for (n=QListHead(&fabricp->AllSWs); n != NULL; n = QListNext(&fabricp->AllSWs, n)) {
+		NodeData *nodep = (NodeData *)QListObj(n);
+		SwitchData *switchp = nodep->switchp;
+		uint32 size;
+
+		if (! switchp || switchp->PortsByNum)
+			continue;
+		if (cl_qmap_head(&nodep->Ports) == cl_qmap_end(&nodep->Ports))
+			continue; /* no ports */
+		size = (uint32)cl_qmap_key(cl_qmap_tail(&nodep->Ports)) + 1;
+		switchp->PortsByNum = (PortData **)MemoryAllocate2AndClear(
+							sizeof(PortData *) * size, IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+		if (! switchp->PortsByNum) {
+			// route walks will fall back to FindNodePort
+			status = FINSUFFICIENT_MEMORY;
+			continue;
+		}
+		for (p=cl_qmap_head(&nodep->Ports); p != cl_qmap_end(&nodep->Ports); p = cl_qmap_next(p)) {
+			PortData *portp = PARENT_STRUCT(p, PortData, NodePortsEntry);
+			switchp->PortsByNum[portp->PortNum] = portp;
+		}
+		switchp->PortsByNumSize = size;
+	}
+	return status;
+}
+
 FSTATUS NodeDataAllocateFDB(FabricData_t *fabricp, NodeData *nodep,
 							uint32 LinearFDBSize) {
 
@@ -1733,6 +2270,8 @@ void NodeDataFree(FabricData_t *fabricp, NodeData *nodep)
 		MemoryDeallocate(nodep->systemp);
 	}
 	cl_qmap_remove_item(&fabricp->AllNodes, &nodep->AllNodesEntry);
+	NodeNameIndexRemove(fabricp, nodep);
+	NodeGuidIndexRemove(fabricp, nodep);
 	NodeDataFreePorts(fabricp, nodep);
 #if !defined(VXWORKS) || defined(BUILD_DMC)
 	if (nodep->ioup)
@@ -1741,7 +2280,7 @@ void NodeDataFree(FabricData_t *fabricp, NodeData *nodep)
 	if (nodep->pSwitchInfo)
 		MemoryDeallocate(nodep->pSwitchInfo);
 	NodeDataFreeSwitchData(fabricp, nodep);
-	MemoryDeallocate(nodep);
+	FabricDataDeallocate(fabricp, nodep);
 }
 
 // remove all Nodes from lists and free them
@@ -1948,9 +2487,14 @@ void DestroyFabricData(FabricData_t *fabricp)
 	SMDataFreeAll(fabricp); // SMs
 	NodeDataFreeAll(fabricp);	// Nodes, Ports, IOUs, Systems
 	VFDataFreeAll(fabricp);
+	if (fabricp->PortCountersSlab)
+		MemoryDeallocate(fabricp->PortCountersSlab);
 
 	if (fabricp->flags & FF_LIDARRAY)
 		FreeLidMap(fabricp);
+	FabricDataFreeNodeNameIndex(fabricp);
+	FabricDataFreeGuidIndexes(fabricp);
+	FabricDataFreeArena(fabricp);
 
 	// make sure no stale pointers in lists, etc
 	// also clear counters and flags
@@ -1971,18 +2515,6 @@ static uint8 CLListUint32Find(cl_qmap_t *arrayMap, uint32 entry)
    return found;
 }
 
-static uint8 CLListIntFind(cl_qmap_t *arrayMap, int entry) 
-{ 
-   uint8 found = 0; 
-   cl_map_item_t *mi; 
-   
-   mi = cl_qmap_get(arrayMap, entry); 
-   if (mi != cl_qmap_end(arrayMap)) {
-      found = 1;;
-   }
-   return found;
-}
-
 static FSTATUS CLListUint32Add(cl_qmap_t *arrayMap, uint32 entry) 
 { 
    FSTATUS status = FSUCCESS; 
@@ -2008,31 +2540,6 @@ static FSTATUS CLListUint32Add(cl_qmap_t *arrayMap, uint32 entry)
    return status;
 }
 
-static FSTATUS CLListIntAdd(cl_qmap_t *arrayMap, int entry) 
-{ 
-   FSTATUS status = FSUCCESS; 
-   cl_map_item_t *mi; 
-   clListSearchData_t *clListp; 
-   
-   if (CLListIntFind(arrayMap, entry)) 
-      return status; 
-   
-   clListp = (clListSearchData_t *)MemoryAllocate2AndClear(sizeof(clListSearchData_t), IBA_MEM_FLAG_PREMPTABLE, MYTAG);        
-   if (!clListp) {
-      status = FINSUFFICIENT_MEMORY; 
-      fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname); 
-   } else {
-      mi = cl_qmap_insert(arrayMap, entry, &clListp->AllListEntry); 
-      if (mi != &clListp->AllListEntry) {
-         fprintf(stderr, "%s: Duplicate entry found in numeric list map: %d\n", g_Top_cmdname, entry); 
-         MemoryDeallocate(clListp); 
-         clListp = PARENT_STRUCT(mi, clListSearchData_t, AllListEntry);
-      }
-   }
-   
-   return status;
-}
-
 //PYTHON: def ib_connection_source_to_str (conn) :
 //NOTA BENE: NOTE THAT THIS FUNCTION IS NOT THREAD SAFE!
 static char* ib_connection_source_to_str(FabricData_t *fabricp, clConnData_t *connp) 
@@ -2851,164 +3358,193 @@ static FSTATUS CLGraphDataSplitOutVertex(clGraphData_t *graphp, clGraphData_t *n
    return status;
 }
 
-static void CLDijkstraFreeArray(void **array, uint32 nRows) 
+#define CL_SCC_NONE                 0xffffffff
+
+// All arcs in the dependency graph have a weight of 1, so a breadth first
+// search pops vertices in nondecreasing distance order, exactly as a heap
+// based Dijkstra would, but in O(1) per vertex.
+
+// build compressed sparse adjacency of all in-use arcs between in-use vertices
+static FSTATUS CLDijkstraBuildAdjacency(clGraphData_t *graphp, clDijkstraDistancesAndRoutes_t *drp) 
 { 
-   int i; 
+   uint32 ii, jj, count = 0; 
+   clVertixData_t *i; 
+   clArcData_t *arcp; 
    
-   if (array) {
-      for (i = 0; i < nRows; i++) {
-         if (array[i]) 
-            MemoryDeallocate(array[i]);
-      }
-      MemoryDeallocate(array);
+   drp->adjStart = MemoryAllocate2AndClear((drp->nVertices + 1) * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG); 
+   if (!drp->adjStart) 
+      return FINSUFFICIENT_MEMORY; 
+   for (ii = 0; ii < drp->nVertices; ii++) {
+      if ((i = graphp->Vertices[ii]) && i->RefCount) 
+         count += i->OutboundInuseCount;
    }
-}
-
-static void** CLDijkstraAllocArray(uint32 nRows, uint32 nCols, uint32 entryLenth) 
-{ 
-   int i; 
-   void **array; 
+   drp->adj = MemoryAllocate2AndClear((count + 1) * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG); 
+   if (!drp->adj) 
+      return FINSUFFICIENT_MEMORY; 
    
-   array = MemoryAllocate2AndClear(nRows * sizeof(void *), IBA_MEM_FLAG_PREMPTABLE, MYTAG); 
-   if (!array) 
-      fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname); 
-   else {
-      for (i = 0; i < nRows; i++) {
-         array[i] = MemoryAllocate2AndClear(nCols * entryLenth, IBA_MEM_FLAG_PREMPTABLE, MYTAG); 
-         if (!array[i]) {
-            fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname); 
-            (void)CLDijkstraFreeArray(array, i); 
-            return NULL;
-         }
+   count = 0; 
+   for (ii = 0; ii < drp->nVertices; ii++) {
+      drp->adjStart[ii] = count; 
+      if (!(i = graphp->Vertices[ii]) || !i->RefCount) 
+         continue; 
+      for (jj = 0; jj < i->OutboundCount && count < drp->adjStart[ii] + i->OutboundInuseCount; jj++) {
+         if (i->Outbound[jj] >= 0 && (arcp = CLGraphFindIdArc(graphp, i->Outbound[jj])) 
+             && arcp->Sink < drp->nVertices 
+             && graphp->Vertices[arcp->Sink] && graphp->Vertices[arcp->Sink]->RefCount) 
+            drp->adj[count++] = arcp->Sink;
       }
    }
+   drp->adjStart[drp->nVertices] = count; 
    
-   return array;
+   return FSUCCESS;
 }
 
-static clVertixDataDistance_t* CLDijkstraAddVertexDistance(cl_qmap_t *mapp, clVertixData_t *vertixp, int verbose) 
+// Tarjan's algorithm, iterative so very large components can't overflow
+// the stack.  Any cycle lies entirely within one SCC, so cycle searches
+// need not leave the SCC of their source vertex.
+static FSTATUS CLDijkstraFindComponents(clDijkstraDistancesAndRoutes_t *drp, int verbose) 
 { 
-   cl_map_item_t *mi; 
-   clVertixDataDistance_t *entryp = NULL; 
+   FSTATUS status = FSUCCESS; 
+   uint32 s, v, w, u, counter = 0, top = 0, ctop = 0, numScc = 0; 
+   uint32 *index = NULL, *low = NULL, *stack = NULL, *cstack = NULL, *epos = NULL; 
    
-   if (mapp && vertixp) {
-      entryp = (clVertixDataDistance_t *)MemoryAllocate2AndClear(sizeof(clVertixDataDistance_t), IBA_MEM_FLAG_PREMPTABLE, MYTAG); 
-      if (!entryp) 
-         fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname); 
-      else {
-         entryp->vertixp = vertixp; 
-         mi = cl_qmap_insert(mapp, vertixp->Id, &entryp->AllVerticesEntry); 
-         if (verbose >= 4) 
-            printf("Add distance vertix Id %d\n", vertixp->Id); 
-         if (mi != &entryp->AllVerticesEntry) {
-            MemoryDeallocate(entryp); 
-            entryp = NULL; 
-            fprintf(stderr, "Error, failed to add vertix Id %d\n", vertixp->Id);
-         }
-      }
+   if (!(index  = MemoryAllocate2AndClear(drp->nVertices * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG)) || 
+       !(low    = MemoryAllocate2AndClear(drp->nVertices * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG)) || 
+       !(stack  = MemoryAllocate2AndClear(drp->nVertices * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG)) || 
+       !(cstack = MemoryAllocate2AndClear(drp->nVertices * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG)) || 
+       !(epos   = MemoryAllocate2AndClear(drp->nVertices * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG))) {
+      status = FINSUFFICIENT_MEMORY; 
+      goto done;
    }
    
-   return entryp;
-}
-
-static int CLDijkstraVertexPopDistance(cl_qmap_t *mapp) 
-{ 
-   uint32 id = -1; 
-   cl_map_item_t *mi; 
-   clVertixDataDistance_t *entryp; 
-   
-   mi = cl_qmap_head(mapp); 
-   if (mi != cl_qmap_end(mapp)) {
-      if (NULL != (entryp = PARENT_STRUCT(mi, clVertixDataDistance_t, AllVerticesEntry))) {
-         id = entryp->vertixp->Id; 
-         cl_qmap_remove_item(mapp, &entryp->AllVerticesEntry); 
-         MemoryDeallocate(entryp);
+   for (v = 0; v < drp->nVertices; v++) 
+      drp->scc[v] = CL_SCC_NONE; 
+   drp->numScc = 0; 
+   
+   for (s = 0; s < drp->nVertices; s++) {
+      // vertices with no arcs can't be part of a cycle
+      if (index[s] || drp->adjStart[s] == drp->adjStart[s + 1]) 
+         continue; 
+      index[s] = low[s] = ++counter; 
+      stack[top++] = s; 
+      epos[s] = drp->adjStart[s]; 
+      cstack[ctop++] = s; 
+      
+      while (ctop) {
+         v = cstack[ctop - 1]; 
+         if (epos[v] < drp->adjStart[v + 1]) {
+            w = drp->adj[epos[v]++]; 
+            if (!index[w]) {
+               index[w] = low[w] = ++counter; 
+               stack[top++] = w; 
+               epos[w] = drp->adjStart[w]; 
+               cstack[ctop++] = w;
+            } else if (drp->scc[w] == CL_SCC_NONE) {
+               // w is still on stack, so in the SCC being built
+               low[v] = MIN(low[v], index[w]);
+            }
+         } else {
+            ctop--; 
+            if (ctop) {
+               u = cstack[ctop - 1]; 
+               low[u] = MIN(low[u], low[v]);
+            }
+            if (low[v] == index[v]) {
+               uint32 size = 0; 
+               
+               do {
+                  w = stack[--top]; 
+                  drp->scc[w] = numScc; 
+                  size++;
+               } while (w != v); 
+               // a single vertex SCC only has a cycle if it has a self arc
+               if (size > 1) 
+                  drp->numScc++; 
+               else {
+                  for (u = drp->adjStart[v]; u < drp->adjStart[v + 1]; u++) {
+                     if (drp->adj[u] == v) {
+                        drp->numScc++; 
+                        break;
+                     }
+                  }
+               }
+               numScc++;
+            }
+         }
       }
    }
    
-   return id;
-}
-
-//PYTHON: def get_distance (distances, src, dst) :
-static FSTATUS CLDijkstraGetDistance(uint32 **distances, uint32 nRows, uint32 nCols, uint32 src, uint32 dst, uint32 *value) 
-{ 
-   FSTATUS status = FSUCCESS; 
+   if (verbose >= 4) 
+      printf("Found %d strongly connected components with cycles out of %d\n", drp->numScc, numScc); 
    
-   //PYTHON: if distances.get(src) == None :
-   //PYTHON:    return infinity
-   *value = DIJKSTRA_INFINITY; 
-   if (distances == NULL) 
-      status = FERROR; 
-   else if (src >= nRows || dst >= nCols) {
-      status = FINVALID_PARAMETER; 
-      fprintf(stderr, "Warning, invalid distance parameters: src %d, dst %d\n", src, dst);
-   } else {
-      //PYTHON: return distances.get(src).get(dst)
-      *value = distances[src][dst];
-   }
+done:
+   if (index) 
+      MemoryDeallocate(index); 
+   if (low) 
+      MemoryDeallocate(low); 
+   if (stack) 
+      MemoryDeallocate(stack); 
+   if (cstack) 
+      MemoryDeallocate(cstack); 
+   if (epos) 
+      MemoryDeallocate(epos); 
    
    return status;
 }
 
-//PYTHON: def check_distances_and_routes (graph, distances, routes) :
-static int CLDijkstraCheckDistancesAndRoutes(clGraphData_t *graphp, uint32 **distances, uint32 **routes, uint32 nRows, uint32 nCols, uint32 verbose) 
+// find the shortest cycle through src, searching only within its SCC.
+// returns the length of the cycle and its vertices in drp->path, starting
+// with src, or DIJKSTRA_INFINITY if src is not on any cycle.
+// When several shortest cycles pass through src the one reported is the
+// first closed in breadth first order of the outbound arcs.  The dense all
+// pairs search used before broke such ties differently, so it could list
+// other vertices for a cycle of the same length, and since vertices already
+// reported are not searched again, go on to report other cycles after it.
+uint32 CLDijkstraFindShortestCycle(clDijkstraDistancesAndRoutes_t *drp, uint32 src) 
 { 
-   uint32 ii, jj, errors = 0;      //PYTHON: errors = 0
-   clVertixData_t * i,*j; 
+   uint32 head = 0, tail = 0, u, v, k, len; 
+   uint32 scc = drp->scc[src]; 
    
-   //PYTHON: for i in graph.vertices :
-   for (ii = 0; ii < graphp->VerticesLength; ii++) {
-      //PYTHON: if i.refcount :
-      if ((i = graphp->Vertices[ii]) && i->RefCount) {
-         //PYTHON: for j in graph.vertices :
-         for (jj = 0; jj < graphp->VerticesLength; jj++) {
-            uint32 d, distance; 
-            
-            //PYTHON: if j.refcount :
-            if ((j = graphp->Vertices[jj]) && j->RefCount) {
-               uint32 k, found; 
-               
-               d = 0;      //PYTHON: d = 0                    
-               k = i->Id;  //PYTHON: k = i.id
-               
-               //PYTHON: while j.id in routes[k] :
-               //CJKING: while ((found = CLListUint32Find(j->Id, routes[k], nCols, verbose))) {
-               while ((found = CLListUint32Find(routesLstMap, j->Id))) {
-                  uint32 l; 
-                  
-                  l = routes[k][j->Id];   //PYTHON: l = routes[k][j.id]
-                  d++;                    //PYTHON: d += 1
-                                          //PYTHON: if l == j.id :
-                  if (l == j->Id) 
-                     break; 
-                  k = l;                  //PYTHON: k = l
-               }
-               //PYTHON: else :
-               //PYTHON: d = infinity
-               if (!found) 
-                  d = DIJKSTRA_INFINITY; 
-               
-               //PYTHON: distance = get_distance(distances, i.id, j.id)
-               if (FERROR == CLDijkstraGetDistance(distances, nRows, nCols, i->Id, j->Id, &distance)) 
-                  return -1; 
-               if (distance == d) {        //if distance == d :
-                  if (verbose >= 4) 
-                     printf("Check route from %d to %d of %d hops: OK\n", i->Id, j->Id, distance);
-               } else {
-                  errors++;        //PYTHON: errors += 1
-                  if (verbose >= 4) 
-                     fprintf(stderr, "Warning, check route from %d to %d of %d hops: failed, got %d hops\n", 
-                             i->Id, j->Id, distance, d);
-               }
+   if (scc == CL_SCC_NONE) 
+      return DIJKSTRA_INFINITY; 
+   
+   // advance generation instead of clearing dist/pred for every search
+   if (++drp->generation == 0) {
+      memset(drp->mark, 0, drp->nVertices * sizeof(uint32)); 
+      drp->generation = 1;
+   }
+   drp->mark[src] = drp->generation; 
+   drp->dist[src] = 0; 
+   drp->queue[tail++] = src; 
+   
+   while (head < tail) {
+      u = drp->queue[head++]; 
+      for (k = drp->adjStart[u]; k < drp->adjStart[u + 1]; k++) {
+         v = drp->adj[k]; 
+         if (drp->scc[v] != scc) 
+            continue; 
+         if (v == src) {
+            // first arc back to src in search order closes a shortest cycle
+            len = drp->dist[u] + 1; 
+            if (len >= DIJKSTRA_INFINITY) 
+               return DIJKSTRA_INFINITY; 
+            drp->path[0] = src; 
+            for (k = len - 1; k > 0; k--) {
+               drp->path[k] = u; 
+               u = drp->pred[u];
             }
+            return len;
+         }
+         if (drp->mark[v] != drp->generation) {
+            drp->mark[v] = drp->generation; 
+            drp->dist[v] = drp->dist[u] + 1; 
+            drp->pred[v] = u; 
+            drp->queue[tail++] = v;
          }
       }
    }
    
-   if (verbose >= 4) 
-      printf("Check route summary : %d dependency graph routes have errors\n", errors); 
-   
-   return errors;
+   return DIJKSTRA_INFINITY;
 }
 
 FSTATUS CLFabricDataDestroy(FabricData_t *fabricp, void *context) 
@@ -3474,304 +4010,63 @@ void CLGraphDataPrune(clGraphData_t *graphp, ValidateCLTimeGetCallback_t timeGet
 
 void CLDijkstraFreeDistancesAndRoutes(clDijkstraDistancesAndRoutes_t *drp) 
 { 
-   if (drp->distances) 
-      (void)CLDijkstraFreeArray((void **)drp->distances, drp->nRows); 
-   if (drp->routes) 
-      (void)CLDijkstraFreeArray((void **)drp->routes, drp->nRows); 
+   if (drp->adjStart) 
+      MemoryDeallocate(drp->adjStart); 
+   if (drp->adj) 
+      MemoryDeallocate(drp->adj); 
+   if (drp->scc) 
+      MemoryDeallocate(drp->scc); 
+   if (drp->dist) 
+      MemoryDeallocate(drp->dist); 
+   if (drp->pred) 
+      MemoryDeallocate(drp->pred); 
+   if (drp->mark) 
+      MemoryDeallocate(drp->mark); 
+   if (drp->queue) 
+      MemoryDeallocate(drp->queue); 
+   if (drp->path) 
+      MemoryDeallocate(drp->path); 
    memset(drp, 0, sizeof(clDijkstraDistancesAndRoutes_t));
 }
 
-//PYTHON: def find_distances_and_routes_dijkstra (graph) :
+// prepare the graph for shortest cycle searches: sparse adjacency of in-use
+// arcs plus the strongly connected components of the graph.  Distances are
+// computed per cycle search by CLDijkstraFindCycles rather than for all
+// vertex pairs up front.
 FSTATUS CLDijkstraFindDistancesAndRoutes(clGraphData_t *graphp, clDijkstraDistancesAndRoutes_t *respData, int verbose) 
 { 
-   FSTATUS status = FERROR; 
-   int c; 
-   uint32 nRows, nCols;
-   uint32 ii, jj, d, current = 0; 
-   uint32 next, numVertices, maxDistance; 
-   uint32 **distances = NULL,**routes = NULL; 
-   clVertixData_t *i = NULL,*j = NULL; 
-   uint32 *dist = NULL,*route = NULL,*previous = NULL; 
-   cl_qmap_t previousLstMap; 
+   FSTATUS status; 
+   uint32 nVertices; 
    
-   
-   // allocate persistant multidimensional arrays and temporary buffers
    if (!graphp || !respData) 
       return FINVALID_PARAMETER;
-   nRows = graphp->VerticesLength;
-   nCols = graphp->VerticesLength; 
-   if (!(distances    = (uint32 **)CLDijkstraAllocArray(nRows, nCols, sizeof(uint32))) ||  //PYTHON: distances = {}
-            !(routes       = (uint32 **)CLDijkstraAllocArray(nRows, nCols, sizeof(uint32))) ||  //PYTHON: routes = {}
-            !(dist         = MemoryAllocate2AndClear(nCols * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG)) || 
-            !(route        = MemoryAllocate2AndClear(nCols * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG)) || 
-            !(previous     = MemoryAllocate2AndClear(nCols * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG)) || 
-            !(routesLstMap = MemoryAllocate2AndClear(nRows * sizeof(cl_qmap_t), IBA_MEM_FLAG_PREMPTABLE, MYTAG))) {
-      status = FINSUFFICIENT_MEMORY; 
-      fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname); 
-      goto fail;
-   }
    
-   //PYTHON: num_vertices = graph.num_vertices
-   numVertices = graphp->NumVertices; 
+   memset(respData, 0, sizeof(clDijkstraDistancesAndRoutes_t)); 
+   nVertices = MIN(graphp->NumVertices, graphp->VerticesLength); 
+   respData->nVertices = nVertices; 
    if (verbose >= 4) 
-      printf("Calculating distances for %d vertices in graph\n", numVertices); 
-   
-   //PYTHON: for i in graph.vertices :
-   for (ii = 0; ii < graphp->VerticesLength; ii++) {
-      cl_qmap_t todo; 
-      
-      //PYTHON: if i.refcount :
-      if ((i = graphp->Vertices[ii]) && i->RefCount) {
-         //PYTHON: dist = {}
-         memset(dist, 0, sizeof(nCols * sizeof(uint32))); 
-         //PYTHON: previous = {}
-         memset(previous, 0, sizeof(nCols * sizeof(uint32))); 
-         //PYTHON: todo = []
-         cl_qmap_init(&todo, NULL); 
-         cl_qmap_init(&routesLstMap[i->Id], NULL); 
-         // CJKING: Note, in order to save time, purposely not deallocating memory
-         // allocated for each list entry.  May need to visit this later for extremely
-         // large fabrics.
-         cl_qmap_init(&previousLstMap, NULL); 
-         
-         //PYTHON: for j in graph.vertices :
-         for (jj = 0; jj < graphp->VerticesLength; jj++) {
-            if ((j = graphp->Vertices[jj]) && j->RefCount) {
-               dist[j->Id] = DIJKSTRA_INFINITY; 
-               //PYTHON: todo.append(j.id)
-               if (!CLDijkstraAddVertexDistance(&todo, j, verbose)) 
-                  goto fail; 
-               //PYTHON: previous[j.id] = None
-               previous[j->Id] = 0;
-            }
-         }
-         
-         //PYTHON: dist[i.id] = 0
-         dist[i->Id] = 0; 
-         //PYTHON: previous[i.id] = i.id
-         previous[i->Id] = i->Id; 
-         //CJKING: Add entry to search list for previous array 
-         if (CLListUint32Add(&previousLstMap, i->Id)) 
-            goto fail; 
-         
-         //current = i
-         current = ii; 
-         
-         //while todo :
-         while (cl_qmap_count(&todo)) {
-            /*CJKING: Not certain of the purpose of this code in the script.
-
-              PYTHON: global vertex_dist
-              PYTHON: vertex_dist = dist
-              PYTHON: todo.sort(vertex_distance_compare)
-              PYTHON: vertex_dist = {}
-            */
-            
-            //PYTHON: current = todo.pop(0)
-            if (-1 == (current = CLDijkstraVertexPopDistance(&todo))) {
-               if (verbose >= 3) 
-                  fprintf(stderr, "Warning, pop of vertices list failed\n"); 
-               break;
-            }
-            
-            //PYTHON: if dist[current] == infinity :
-            if (verbose >= 4 && dist[current] == DIJKSTRA_INFINITY) {
-               fprintf(stderr, "Warning, distance of current id %d should not be infinite for fully connected graph\n", current);
-            }
-            
-            //PYTHON: for c in graph.vertices[current].outbound :
-            for (c = 0; c < graphp->Vertices[current]->OutboundCount; c++) {
-               clVertixData_t *j; 
-               clArcData_t *arcp; 
-               
-               if (graphp->Vertices[current]->Outbound[c] >= 0 && (arcp = CLGraphFindIdArc(graphp, graphp->Vertices[current]->Outbound[c]))) {
-                  //PYTHON: j = graph.vertices[graph.arcs[c].sink]
-                  j = graphp->Vertices[arcp->Sink]; 
-                  
-                  //PYTHON: if not j :
-                  if (!j) 
-                     fprintf(stderr, "Warning, cannot follow connection for vertex %d\n", current); 
-                  else {  //PYTHON: elif j.id in todo :   /* CJKING: Unclear about this elif.  Might use the following */
-                     /* else if (CLDijkstraIsVertexDistance(&todo, j->Id))          */
-                     //PYTHON: d = dist[current] + 1
-                     d = dist[current] + 1; 
-                     //PYTHON: if d < dist[j.id] :
-                     if (d < dist[j->Id]) {
-                        if (verbose >= 4) 
-                           printf("Distance from %d to %d reduces from %d to %d (via %d)\n", 
-                                  i->Id, j->Id, dist[j->Id], d, current); 
-                        //PYTHON: dist[j.id] = d
-                        dist[j->Id] = d; 
-                        //PYTHON: previous[j.id] = current
-                        previous[j->Id] = current; 
-                        //CJKING: Add entry to search list for previous array 
-                        if (CLListUint32Add(&previousLstMap, current)) 
-                           goto fail;
-                     }
-                  }
-               }
-            }
-         }
-         
-         //PYTHON: route = {}
-         memset(route, 0, sizeof(nCols * sizeof(uint32))); 
-         //PYTHON: for j in graph.vertices :
-         for (jj = 0; jj < graphp->VerticesLength; jj++) {
-            //PYTHON: if j.refcount and dist[j.id] != infinity :
-            if ((j = graphp->Vertices[jj]) && j->RefCount && (dist[j->Id] != DIJKSTRA_INFINITY)) {
-               if (verbose >= 4) 
-                  printf("Route backwards from vertex %d\n", j->Id); 
-               
-               //PYTHON: current = j.id
-               current = j->Id; 
-               //PYTHON: next = current
-               next = current; 
-               
-               //PYTHON: while current != i.id :
-               while (current != i->Id) {
-                  //next = current
-                  next = current; 
-                  //PYTHON: if not current in previous :
-                  //CJKING: if (!CLListUint32Find(current, previous, nCols, verbose)) {
-                  if (!CLListUint32Find(&previousLstMap, current)) {
-                     if (verbose >= 5) 
-                        fprintf(stderr, "Warning, cannot route backwards from vertex %d to %d at %d\n", 
-                                j->Id, i->Id, current);
-                  }
-                  
-                  //PYTHON: current = previous[current]
-                  current = previous[current]; 
-                  if (verbose >= 4 && next != j->Id) 
-                     printf("\tvia %d\n", next);
-               }
-               
-               if (verbose >= 4) 
-                  printf("\tto %d (next is %d)\n", i->Id, next); 
-               //PYTHON: route[j.id] = next
-               route[j->Id] = next; 
-               //CJKING: Add entry to search list for route array 
-               if (CLListUint32Add(&routesLstMap[i->Id], next)) 
-                  goto fail;
-            }
-         }
-         
-         //PYTHON: routes[i.id] = route
-         //PYTHON: distances[i.id] = dist
-         memcpy(routes[i->Id], route, nCols); 
-         memcpy(distances[i->Id], dist, nCols);
-      }
-   }
-   
-   // recompute distance to self for shortest loop (instead of 0)
-   //PYTHON: for i in graph.vertices :
-   for (ii = 0; ii < graphp->VerticesLength; ii++) {
-      //PYTHON: if i.refcount :
-      if ((i = graphp->Vertices[ii]) && i->RefCount) {
-         uint32 route = 0;       //PYTHON: route = None
-         
-         //PYTHON: d = infinity
-         d = DIJKSTRA_INFINITY; 
-         
-         //PYTHON: for c in graph.vertices[i.id].outbound :
-         for (c = 0; c < graphp->Vertices[i->Id]->OutboundCount; c++) {
-            clVertixData_t *j; 
-            clArcData_t *arcp; 
-            
-            if (graphp->Vertices[i->Id]->Outbound[c] >= 0 && (arcp = CLGraphFindIdArc(graphp, graphp->Vertices[i->Id]->Outbound[c]))) {
-               //PYTHON: j = graph.vertices[graph.arcs[c].sink]
-               j = graphp->Vertices[arcp->Sink]; 
-               //PYTHON: if not j :
-               if (!j) 
-                  fprintf(stderr, "Warning, cannot follow connection for vertex %d\n", i->Id); 
-               else if (distances[j->Id][i->Id] < d) { //PYTHON: elif distances[j.id][i.id] < d :
-                                                       //PYTHON: d = distances[j.id][i.id] + 1
-                  d = distances[j->Id][i->Id] + 1; 
-                  //PYTHON: route = j.id
-                  route = j->Id;
-               }
-            }
-         }
-         
-         //PYTHON: if d == infinity :
-         if (d == DIJKSTRA_INFINITY) {
-            if (verbose >= 5) 
-               printf("Self-distance for %d is infinite (no routes to self)\n", i->Id);
-         } else {
-            //PYTHON: distances[i.id][i.id] = d
-            distances[i->Id][i->Id] = d; 
-            //PYTHON: routes[i.id][i.id] = route
-            routes[i->Id][i->Id] = route; 
-            if (verbose >= 4) 
-               printf("Self-distance for %d is %d via %d\n", i->Id, d, route);
-         }
-      }
-   }
+      printf("Calculating distances for %d vertices in graph\n", graphp->NumVertices); 
    
-   //PYTHON: max_distance = 0
-   maxDistance = 0; 
-   //PYTHON: for i in graph.vertices :
-   for (ii = 0; ii <  graphp->VerticesLength; ii++) {
-      if ((i = graphp->Vertices[ii])) {
-         //PYTHON: for j in graph.vertices :
-         for (jj = 0; jj < graphp->VerticesLength; jj++) {
-            //PYTHON: if i.refcount and j.refcount :
-            if (i->RefCount && ((j = graphp->Vertices[jj]) && j->RefCount)) {
-               //PYTHON: d = get_distance(distances, i.id, j.id)
-               if (FERROR == (status = CLDijkstraGetDistance(distances, nRows, nCols, i->Id, j->Id, &d))) {
-                  fprintf(stderr, "Error, unable to get distance from vertex %d to vertex %d\n", i->Id, j->Id); 
-                  goto fail;
-               }
-               
-               if (verbose >= 5 && d == DIJKSTRA_INFINITY) 
-                  fprintf(stderr, "Warning, no path from %d to %d\n", i->Id, j->Id); 
-               else if (verbose >= 4 && d != DIJKSTRA_INFINITY) 
-                  printf("Distance from vertex %d to vertex %d is %d arcs\n", 
-                         i->Id, j->Id, d); 
-               
-               //PYTHON: if d > max_distance and d != infinity :
-               if (d > maxDistance && d != DIJKSTRA_INFINITY) 
-                  maxDistance = d;    //PYTHON: max_distance = d
-            }
-         }
-      }
+   if (!(respData->scc   = MemoryAllocate2AndClear((nVertices + 1) * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG)) || 
+       !(respData->dist  = MemoryAllocate2AndClear((nVertices + 1) * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG)) || 
+       !(respData->pred  = MemoryAllocate2AndClear((nVertices + 1) * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG)) || 
+       !(respData->mark  = MemoryAllocate2AndClear((nVertices + 1) * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG)) || 
+       !(respData->queue = MemoryAllocate2AndClear((nVertices + 1) * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG)) || 
+       !(respData->path  = MemoryAllocate2AndClear((nVertices + 1) * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG))) {
+      status = FINSUFFICIENT_MEMORY; 
+      goto fail;
    }
    
-   if (verbose >= 4) 
-      printf("Maximum distance is %d\n", maxDistance); 
-   
-   // deallocate temporary buffers
-   if (dist) 
-      MemoryDeallocate(dist); 
-   if (route) 
-      MemoryDeallocate(route); 
-   if (previous) 
-      MemoryDeallocate(previous); 
-   
-   //PYTHON: check_distances_and_routes(graph, distances, routes)
-   CLDijkstraCheckDistancesAndRoutes(graphp, distances, routes, nRows, nCols, verbose); 
-   
-   // initialize response data
-   respData->distances = distances; 
-   respData->routes = routes; 
-   respData->nRows = nRows; 
-   respData->nCols = nCols; 
+   if (FSUCCESS != (status = CLDijkstraBuildAdjacency(graphp, respData))) 
+      goto fail; 
+   if (FSUCCESS != (status = CLDijkstraFindComponents(respData, verbose))) 
+      goto fail; 
    
    return FSUCCESS; 
    
 fail:
-   
-   // deallocate multidimensional arrays
-   (void)CLDijkstraFreeArray((void **)distances, nRows); 
-   (void)CLDijkstraFreeArray((void **)routes, nRows); 
-   
-   // deallocate temporary buffers
-   if (dist) 
-      MemoryDeallocate(dist); 
-   if (route) 
-      MemoryDeallocate(route); 
-   if (previous) 
-      MemoryDeallocate(previous); 
-   
+   fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname); 
+   CLDijkstraFreeDistancesAndRoutes(respData); 
    return status;
 }
 
@@ -3784,37 +4079,30 @@ void CLDijkstraFindCycles(FabricData_t *fabricp,
                           ValidateCLPathSummaryCallback_t pathSummaryCallback, 
                           void *context) 
 { 
-   uint32 ii, dii, next_id, cycles = 0;        //PYTHON: cycles = 0
-   int done_vertices_entries = 0, *done_vertices = NULL; 
-   uint32 cycle_histogram_entries = 0, *cycle_histogram = NULL, *distance_list = NULL; 
+   uint32 ii, dii, cycles = 0;        //PYTHON: cycles = 0
+   uint8 *done_vertices = NULL; 
+   uint32 cycle_histogram_entries = 0, *cycle_histogram = NULL; 
    clVertixData_t *i = NULL; 
    ValidateCreditLoopRoutesContext_t *cp = (ValidateCreditLoopRoutesContext_t *)context; 
    int xmlFmt = (cp->format == 1) ? 1 : 0; 
    int verbose = (xmlFmt) ? 0 : cp->detail; 
-   cl_qmap_t cycleHistogramLstMap, doneVerticesLstMap; 
    
    
-   if (!(done_vertices     = MemoryAllocate2AndClear(drp->nCols * sizeof(int), IBA_MEM_FLAG_PREMPTABLE, MYTAG)) ||  //PYTHON: done_vertices = []
-       !(cycle_histogram   = MemoryAllocate2AndClear(drp->nCols * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG)) ||  //PYTHON: cycle_histogram = {}
-       !(distance_list     = MemoryAllocate2AndClear(drp->nCols * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG))) {
+   if (!(done_vertices     = MemoryAllocate2AndClear(drp->nVertices + 1, IBA_MEM_FLAG_PREMPTABLE, MYTAG)) ||  //PYTHON: done_vertices = []
+       !(cycle_histogram   = MemoryAllocate2AndClear((drp->nVertices + 1) * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG))) {  //PYTHON: cycle_histogram = {}
       fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname); 
       goto done;
    }
    
-   cl_qmap_init(&doneVerticesLstMap, NULL); 
-   cl_qmap_init(&cycleHistogramLstMap, NULL); 
-   memset(done_vertices, -1, sizeof(*done_vertices) * drp->nCols); 
-   
    //PYTHON: for i in graph.vertices :
-   for (ii = 0; ii < graphp->VerticesLength; ii++) {
+   for (ii = 0; ii < drp->nVertices; ii++) {
       //PYTHON: if i.refcount and not i.id in done_vertices :
-      if ((i = graphp->Vertices[ii]) && 
-          (i->RefCount && !CLListIntFind(&doneVerticesLstMap, i->Id))) {   //CJKING: (i->RefCount && !ListIntFind(i->Id, done_vertices, done_vertices_entries, verbose))) {
-                                                                           //PYTHON: dii = get_distance(distances, i.id, i.id)
-         if (FERROR == CLDijkstraGetDistance(drp->distances, drp->nRows, drp->nCols, i->Id, i->Id, &dii)) {
-            fprintf(stderr, "Error, unable to find cycles: distances not specified\n"); 
-            goto done;
-         }
+      if ((i = graphp->Vertices[ii]) && i->RefCount && !done_vertices[i->Id]) {
+         // vertices outside any SCC with a cycle need no search
+         if (drp->scc[i->Id] == CL_SCC_NONE) 
+            continue; 
+         //PYTHON: dii = get_distance(distances, i.id, i.id)
+         dii = CLDijkstraFindShortestCycle(drp, i->Id); 
          
          //PYTHON: if dii != infinity :
          if (dii != DIJKSTRA_INFINITY) {
@@ -3826,112 +4114,24 @@ void CLDijkstraFindCycles(FabricData_t *fabricp,
                (void)linkSummaryCallback(i->Id, ib_connection_source_to_str(fabricp, i->Connection), dii, 1, indent, context); 
             }
             
-            j = i;      //PYTHON: j = i
             cycles++;   //PYTHON: cycles += 1
             
-            //PYTHON: if dii in cycle_histogram :
-            //CJKING: if (CLListUint32Find(dii, cycle_histogram, drp->nCols, verbose))
-            if (CLListUint32Find(&cycleHistogramLstMap, dii)) 
-               cycle_histogram[dii]++;     //PYTHON: cycle_histogram[dii] += 1
-            else {
-               //CJKING: Add entry to search list for cycle_histogram array 
-               if (CLListUint32Add(&cycleHistogramLstMap, dii)) 
-                  goto done; 
-               else 
-                  cycle_histogram[dii] = 1;   //PYTHON: cycle_histogram[dii] = 1
-            }
+            //PYTHON: cycle_histogram[dii] += 1
+            cycle_histogram[dii]++; 
             cycle_histogram_entries = MAX(cycle_histogram_entries, dii); 
             
-            //PYTHON: if routes :
-            if (drp->routes) {
-               //PYTHON: for step in range(0, dii) :
-               for (step = 0; step < dii; step++) {
-                  if (verbose >= 2)
-					  (void)linkStepSummaryCallback(j->Id, ib_connection_source_to_str(fabricp, j->Connection), step, 1, indent + 4, context);
-                  if (verbose >= 3)
-                      (void)pathSummaryCallback(fabricp, j->Connection, indent + 8, context);                   
-                  // insert XML token to indicate the end of link step summary section
-                  if (xmlFmt) 
-                     (void)linkStepSummaryCallback(0, 0, 0, 0, indent + 4, context); 
-                  
-                  done_vertices[done_vertices_entries++] = j->Id; //PYTHON: done_vertices.append(j.id)                        
-                                                                  //CJKING: Add entry to search list for done_vertices array 
-                  if (CLListIntAdd(&doneVerticesLstMap, j->Id)) 
-                     goto done; 
-                  next_id = drp->routes[j->Id][i->Id];            //PYTHON: next_id = routes[j.id][i.id]                        
-                  j = graphp->Vertices[next_id];                  //PYTHON: j = graph.vertices[next_id]
-               }
-            } else {
-               uint8 found = 0; 
+            //PYTHON: for step in range(0, dii) :
+            for (step = 0; step < dii; step++) {
+               j = graphp->Vertices[drp->path[step]]; 
+               if (verbose >= 2)
+                  (void)linkStepSummaryCallback(j->Id, ib_connection_source_to_str(fabricp, j->Connection), step, 1, indent + 4, context);
+               if (verbose >= 3)
+                  (void)pathSummaryCallback(fabricp, j->Connection, indent + 8, context);                   
+               // insert XML token to indicate the end of link step summary section
+               if (xmlFmt) 
+                  (void)linkStepSummaryCallback(0, 0, 0, 0, indent + 4, context); 
                
-               //PYTHON: for step in range(0, dii) :
-               for (step = 0; step < dii; step++) {
-                  uint32 jj; 
-                  
-                  if (verbose >= 2)
-					  (void)linkStepSummaryCallback(j->Id, ib_connection_source_to_str(fabricp, j->Connection), step, 1, indent + 4, context); 
-                  if (verbose >= 3)
-                      (void)pathSummaryCallback(fabricp, j->Connection, indent + 8, context); 
-                  // insert XML token to indicate the end of link step summary section
-                  if (xmlFmt) 
-                     (void)linkStepSummaryCallback(0, 0, 0, 0, indent + 4/*indent*/, context); 
-                  
-                  done_vertices[done_vertices_entries++] = j->Id;     //PYTHON: done_vertices.append(j.id)
-                                                                      //CJKING: Add entry to search list for done_vertices array 
-                  if (CLListIntAdd(&doneVerticesLstMap, j->Id)) 
-                     goto done; 
-                  found = 0;                        
-                  memset(distance_list, 0, sizeof(drp->nCols * sizeof(uint32)));    //PYTHON: distance_list = []
-                  
-                  //PYTHON: for arc_id in j.outbound :
-                  for (jj = 0; jj < j->OutboundCount; jj++) {
-                     clVertixData_t *k; 
-                     clArcData_t *arcp; 
-                     
-                     if (!(j->Outbound[jj] >= 0 && (arcp = CLGraphFindIdArc(graphp, j->Outbound[jj])))) {
-                        fprintf(stderr, "Warning, arc not available cannot follow connection for vertex %d\n", jj); 
-                        continue;
-                     }
-                     
-                     //PYTHON: k = graph.vertices[graph.arcs[arc_id].sink]
-                     k = graphp->Vertices[arcp->Sink]; 
-                     //PYTHON: if k.refcount :
-                     if (k->RefCount) {
-                        uint32 dki; 
-                        
-                        //PYTHON: dki = get_distance(distances, k.id, i.id)
-                        if (FERROR == CLDijkstraGetDistance(drp->distances, drp->nRows, drp->nCols, k->Id, i->Id, &dki)) {
-                           fprintf(stderr, "Error, unable to find cycles: distances not specified\n"); 
-                           goto done;
-                        }
-                        /*
-                          #print '  %d: vertex %d via arc %d to vertex %d' % \
-                          #      (step, j.id, arc_id, k.id)
-                          found = 1
-                          j = k
-                        */
-                        //PYTHON: if dki != infinity :
-                        if (dki != DIJKSTRA_INFINITY) 
-                           distance_list[dki] = dki;   //PYTHON: distance_list.append(dki)
-                        
-                        if (dki != DIJKSTRA_INFINITY &&                 //PYTHON: if dki != infinity and
-                            ((dki == dii - step - 1) ||                 //PYTHON:    ((dki == dii - step - 1) or
-                             (k->Id == i->Id && step == dii - 1))) {    //PYTHON:     (k.id == i.id and step == dii - 1))
-                                                                        //printf("  %d: vertex %d via arc %d to vertex %d\N", step, j->Id, arc_id, k->Id);
-                           found = 1;  //PYTHON: found = 1
-                           j = k;      //PYTHON: j = k
-                        }
-                        break;
-                     }
-                  }
-                  //PYTHON: if not found :
-                  if (!found) {
-                     char *s = ib_connection_source_to_str(fabricp, i->Connection);
-                     printf("  %d: could not find cycle for vertex %d (%s) on step %d of %d (warning), looking for distance %d\n", 
-                            step, i->Id, (s)?(s):"<null>", step, dii, dii - step - 1); 
-                     break;
-                  }
-               }
+               done_vertices[j->Id] = 1;  //PYTHON: done_vertices.append(j.id)
             }
             
             // insert XML token to indicate the end of link summary section
@@ -3958,9 +4158,7 @@ done:
    if (done_vertices) 
       MemoryDeallocate(done_vertices); 
    if (cycle_histogram) 
-      MemoryDeallocate(cycle_histogram); 
-   if (distance_list) 
-      MemoryDeallocate(distance_list);
+      MemoryDeallocate(cycle_histogram);
 }
 
 #endif
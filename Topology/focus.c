@@ -643,6 +643,30 @@ FSTATUS DeleteNodePatPairs(NodePairList_t *nodePatPairs)
 	return FSUCCESS;
 }
 
+typedef char NodePat_t[STL_NODE_DESCRIPTION_ARRAY_SIZE+1];
+
+/* add a pattern to the list of node patterns read from a file */
+static FSTATUS NodePatListAdd(NodePat_t **list, uint32 *count, uint32 *size, const char *pattern)
+{
+	if (*count == *size) {
+		uint32 newsize = *size ? *size * 2 : MIN_LIST_ITEMS;
+		NodePat_t *newlist = (NodePat_t *)MemoryAllocate2AndClear(
+						sizeof(NodePat_t)*newsize, IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+		if (! newlist) {
+			fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
+			return FINSUFFICIENT_MEMORY;
+		}
+		if (*list) {
+			MemoryCopy(newlist, *list, sizeof(NodePat_t)*(*count));
+			MemoryDeallocate(*list);
+		}
+		*list = newlist;
+		*size = newsize;
+	}
+	StringCopy((*list)[(*count)++], pattern, sizeof(NodePat_t));
+	return FSUCCESS;
+}
+
 /* Parse the node pairs/nodes file */
 static FSTATUS ParseNodePairPatFilePoint(FabricData_t *fabricp, char *arg, Point *pPoint, uint8 find_flag, uint8 pair_flag, char **pp)
 {
@@ -654,6 +678,8 @@ static FSTATUS ParseNodePairPatFilePoint(FabricData_t *fabricp, char *arg, Point
 	struct stat fileStat;
 	FILE *fp;
 	NodePairList_t nodePatPairs;
+	NodePat_t *nodePats = NULL;
+	uint32 numNodePats = 0, sizeNodePats = 0;
 
 	ASSERT(PointIsInInit(pPoint));
 
@@ -765,10 +791,9 @@ static FSTATUS ParseNodePairPatFilePoint(FabricData_t *fabricp, char *arg, Point
 		//When only one node is given
 		} else {
 			if (strlen(patternLine) <= STL_NODE_DESCRIPTION_ARRAY_SIZE) {
-				// Only when there is insufficient memory error or invalid operation error mark as error and return
-				// else proceed with next node in list
-				status = FindNodeNamePatPointUncompress(fabricp, patternLine, pPoint, find_flag);
-				if ((FSUCCESS != status) && (FNOT_FOUND != status))
+				// patterns are searched for together once the file is read
+				status = NodePatListAdd(&nodePats, &numNodePats, &sizeNodePats, patternLine);
+				if (FSUCCESS != status)
 					goto fail;
 			} else {
 				//just log the error message and parse next line
@@ -778,11 +803,34 @@ static FSTATUS ParseNodePairPatFilePoint(FabricData_t *fabricp, char *arg, Point
 		}
 		memset(patternLine, 0, sizeof(patternLine));
 	}
+	if (numNodePats) {
+		char **patterns;
+		uint32 i;
+
+		// one pass over the fabric for all the patterns in the file
+		patterns = (char **)MemoryAllocate2AndClear(sizeof(char *)*numNodePats,
+						IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+		if (! patterns) {
+			fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
+			status = FINSUFFICIENT_MEMORY;
+			goto fail;
+		}
+		for (i=0; i < numNodePats; i++)
+			patterns[i] = nodePats[i];
+		status = FindNodeNamePatListPoint(fabricp, patterns, numNodePats, pPoint, find_flag);
+		MemoryDeallocate(patterns);
+		// Only when there is insufficient memory error or invalid operation error mark as error and return
+		if ((FSUCCESS != status) && (FNOT_FOUND != status))
+			goto fail;
+		MemoryDeallocate(nodePats);
+	}
 	PointCompress(pPoint);
 	fclose(fp);
 	return FSUCCESS;
 
 fail:
+	if (nodePats)
+		MemoryDeallocate(nodePats);
 	fclose(fp);
 	return status;
 }
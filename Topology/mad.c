@@ -38,6 +38,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define DBGPRINT(format, args...) if (g_verbose_file) { fprintf(g_verbose_file, format, ##args); }
 #include <limits.h>
 #include <opamgt_sa_priv.h>
+#include <opamgt_pa_priv.h>
 
 // umadt timeouts for DMA and PMA operations
 #define SEND_WAIT_TIME (100)	// 100 milliseconds for sends
@@ -266,6 +267,353 @@ FSTATUS send_recv_mad(MADT_HANDLE umadtHandle, IB_PATH_RECORD *pathp,
 }
 #endif
 
+/* ------------------------------------------------------------------------- */
+/* Pipelined MAD engine
+ *
+ * The *_send_recv routines in this file issue a single MAD and wait for its
+ * response, so a sweep is limited to one round trip per attribute.
+ * A MadPipe_t accepts any number of requests into a submit queue and keeps
+ * up to window of them outstanding at once.  Outstanding requests are held
+ * in a completion table indexed by TransactionID so responses may arrive in
+ * any order.  Each attempt gets its own TransactionID, so a late response
+ * or timeout report for an earlier attempt is simply discarded.
+ *
+ * The transport is pluggable so the engine can be driven by a loopback
+ * transport which injects latency, drops and reordering.
+ */
+typedef struct MadPipeReq_s MadPipeReq_t;
+
+// class specific processing of a response, mad is in wire format on entry
+typedef FSTATUS (MadPipeComplete)(MadPipe_t *pipep, MadPipeReq_t *reqp,
+								uint8_t *mad, size_t size);
+
+struct MadPipeReq_s {
+	LIST_ITEM		QueueEntry;		// MadPipe_t.SubmitQueue or FreeList
+	uint32			tid;			// TransactionID of current attempt
+	int				attemptsLeft;
+	uint64			deadline;		// GetTimeStamp() when attempt expires
+	size_t			sendSize;
+	struct omgt_mad_addr addr;
+	MadPipeComplete	*complete;		// class specific response processing
+	uint8_t			*buffer;		// caller's output buffer
+	uint32			bufferLength;
+	uint8_t			path[64];		// directed route path, SMA only
+	uint8_t			hasPath;
+	MadPipeCallback	*callback;
+	void			*context;
+	uint8_t			mad[STL_MAD_BLOCK_SIZE];	// request in wire format
+};
+
+struct MadPipe_s {
+	MadPipeTransport_t transport;
+	struct omgt_port *port;			// for pkey selection, may be NULL
+	uint32			window;			// max outstanding requests
+	uint32			outstanding;	// requests in Table
+	uint32			tableMask;		// Table size - 1
+	MadPipeReq_t	**Table;		// outstanding requests, index is tid
+	QUICK_LIST		SubmitQueue;	// requests waiting for a window slot
+	QUICK_LIST		FreeList;		// completed requests for reuse
+	FSTATUS			status;			// first failure since last MadPipeWait
+	uint8_t			recvMad[STL_MAD_BLOCK_SIZE];
+};
+
+static FSTATUS omgt_pipe_send(void *context, uint8_t *mad, size_t size,
+				struct omgt_mad_addr *addr, int timeout_ms)
+{
+	return omgt_send_mad2((struct omgt_port *)context, mad, size, addr,
+							timeout_ms, 0);
+}
+
+static FSTATUS omgt_pipe_recv(void *context, uint8_t *mad, size_t *size,
+				int timeout_ms)
+{
+	return omgt_recv_mad_no_alloc((struct omgt_port *)context, mad, size,
+							timeout_ms, NULL);
+}
+
+/* port is optional and only used to select the management pkey */
+MadPipe_t *MadPipeCreateTransport(struct omgt_port *port,
+				const MadPipeTransport_t *transport, uint32 window)
+{
+	MadPipe_t *pipep;
+	uint32 tableSize = 1;
+
+	if (! window)
+		window = 1;
+	// keep table at least 2x window so linear probes stay short
+	while (tableSize < window*2)
+		tableSize <<= 1;
+
+	pipep = (MadPipe_t *)MemoryAllocate2AndClear(sizeof(MadPipe_t), IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! pipep)
+		return NULL;
+	pipep->Table = (MadPipeReq_t **)MemoryAllocate2AndClear(
+						sizeof(MadPipeReq_t *)*tableSize, IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! pipep->Table) {
+		MemoryDeallocate(pipep);
+		return NULL;
+	}
+	pipep->transport = *transport;
+	pipep->port = port;
+	pipep->window = window;
+	pipep->tableMask = tableSize - 1;
+	pipep->status = FSUCCESS;
+	QListInitState(&pipep->SubmitQueue);
+	QListInit(&pipep->SubmitQueue);
+	QListInitState(&pipep->FreeList);
+	QListInit(&pipep->FreeList);
+	return pipep;
+}
+
+MadPipe_t *MadPipeCreate(struct omgt_port *port, uint32 window)
+{
+	MadPipeTransport_t transport;
+
+	transport.send = omgt_pipe_send;
+	transport.recv = omgt_pipe_recv;
+	transport.context = port;
+	return MadPipeCreateTransport(port, &transport, window);
+}
+
+static void MadPipeFreeList(QUICK_LIST *listp)
+{
+	LIST_ITEM *p;
+
+	while (NULL != (p = QListRemoveHead(listp)))
+		MemoryDeallocate(QListObj(p));
+}
+
+void MadPipeDestroy(MadPipe_t *pipep)
+{
+	uint32 i;
+
+	if (! pipep)
+		return;
+	for (i=0; i <= pipep->tableMask; i++) {
+		if (pipep->Table[i])
+			MemoryDeallocate(pipep->Table[i]);
+	}
+	MadPipeFreeList(&pipep->SubmitQueue);
+	MadPipeFreeList(&pipep->FreeList);
+	MemoryDeallocate(pipep->Table);
+	MemoryDeallocate(pipep);
+}
+
+static MadPipeReq_t *MadPipeAllocReq(MadPipe_t *pipep)
+{
+	LIST_ITEM *p = QListRemoveHead(&pipep->FreeList);
+	MadPipeReq_t *reqp;
+
+	if (p) {
+		reqp = (MadPipeReq_t *)QListObj(p);
+	} else {
+		reqp = (MadPipeReq_t *)MemoryAllocate2(sizeof(MadPipeReq_t), IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+		if (! reqp)
+			return NULL;
+	}
+	MemoryClear(reqp, sizeof(*reqp) - sizeof(reqp->mad));
+	QListSetObj(&reqp->QueueEntry, reqp);
+	reqp->attemptsLeft = g_smaRetries;
+	return reqp;
+}
+
+static void MadPipeQueueReq(MadPipe_t *pipep, MadPipeReq_t *reqp)
+{
+	QListInsertTail(&pipep->SubmitQueue, &reqp->QueueEntry);
+}
+
+/* locate slot for tid in the completion table, -1 if not outstanding */
+static int MadPipeFindSlot(MadPipe_t *pipep, uint32 tid)
+{
+	uint32 i, slot;
+
+	for (i=0, slot = tid & pipep->tableMask; i <= pipep->tableMask;
+				i++, slot = (slot+1) & pipep->tableMask) {
+		if (! pipep->Table[slot])
+			return -1;
+		if (pipep->Table[slot]->tid == tid)
+			return (int)slot;
+	}
+	return -1;
+}
+
+static void MadPipeRemoveSlot(MadPipe_t *pipep, uint32 slot)
+{
+	uint32 next, home;
+
+	pipep->Table[slot] = NULL;
+	pipep->outstanding--;
+	// backward shift so later probes in this run stay reachable
+	for (next = (slot+1) & pipep->tableMask; pipep->Table[next];
+				next = (next+1) & pipep->tableMask) {
+		home = pipep->Table[next]->tid & pipep->tableMask;
+		if (((next - home) & pipep->tableMask) >= ((next - slot) & pipep->tableMask)) {
+			pipep->Table[slot] = pipep->Table[next];
+			pipep->Table[next] = NULL;
+			slot = next;
+		}
+	}
+}
+
+static void MadPipeFinish(MadPipe_t *pipep, MadPipeReq_t *reqp, FSTATUS status)
+{
+	if (status != FSUCCESS && pipep->status == FSUCCESS)
+		pipep->status = status;
+	if (reqp->callback)
+		(*reqp->callback)(reqp->context, status);
+	QListInsertHead(&pipep->FreeList, &reqp->QueueEntry);
+}
+
+/* assign a fresh TransactionID and post the request.
+ * On failure the request has been completed with the failing status.
+ */
+static void MadPipeStart(MadPipe_t *pipep, MadPipeReq_t *reqp)
+{
+	MAD_COMMON *hdr = (MAD_COMMON *)reqp->mad;
+	uint32 slot;
+	FSTATUS status;
+
+	do {
+		reqp->tid = (uint32)(++g_transId);
+	} while (! reqp->tid || MadPipeFindSlot(pipep, reqp->tid) >= 0);
+	// header was swapped to wire format when built, low 32 bits are the
+	// portion of TransactionID the kernel leaves to us
+	hdr->TransactionID = hton64((uint64)reqp->tid);
+
+	for (slot = reqp->tid & pipep->tableMask; pipep->Table[slot];
+				slot = (slot+1) & pipep->tableMask)
+		;
+	pipep->Table[slot] = reqp;
+	pipep->outstanding++;
+
+	reqp->attemptsLeft--;
+	reqp->deadline = GetTimeStamp() + (uint64)RESP_WAIT_TIME*2*1000;
+	status = (*pipep->transport.send)(pipep->transport.context, reqp->mad,
+							reqp->sendSize, &reqp->addr, RESP_WAIT_TIME);
+	if (status != FSUCCESS) {
+		DBGPRINT("MadPipe: send failed: %s\n", iba_fstatus_msg(status));
+		MadPipeRemoveSlot(pipep, slot);
+		if (reqp->attemptsLeft > 0)
+			MadPipeQueueReq(pipep, reqp);
+		else
+			MadPipeFinish(pipep, reqp, status);
+	}
+}
+
+/* request timed out or could not be processed, retry or fail it */
+static void MadPipeRetry(MadPipe_t *pipep, uint32 slot, FSTATUS status)
+{
+	MadPipeReq_t *reqp = pipep->Table[slot];
+
+	MadPipeRemoveSlot(pipep, slot);
+	if (reqp->attemptsLeft > 0) {
+		DBGPRINT("MadPipe: retry TID 0x%x: %s\n", reqp->tid, iba_fstatus_msg(status));
+		MadPipeQueueReq(pipep, reqp);
+	} else {
+		DBGPRINT("MadPipe: TID 0x%x failed: %s\n", reqp->tid, iba_fstatus_msg(status));
+		MadPipeFinish(pipep, reqp, status);
+	}
+}
+
+static void MadPipeExpire(MadPipe_t *pipep)
+{
+	uint64 now = GetTimeStamp();
+	uint32 slot;
+
+	for (slot=0; slot <= pipep->tableMask; slot++) {
+		while (pipep->Table[slot] && pipep->Table[slot]->deadline <= now)
+			MadPipeRetry(pipep, slot, FTIMEOUT);
+	}
+}
+
+/* fill the window from the submit queue */
+static void MadPipeFill(MadPipe_t *pipep)
+{
+	LIST_ITEM *p;
+
+	while (pipep->outstanding < pipep->window
+			&& NULL != (p = QListRemoveHead(&pipep->SubmitQueue)))
+		MadPipeStart(pipep, (MadPipeReq_t *)QListObj(p));
+}
+
+/* process at most one completion from the transport */
+static void MadPipePollOne(MadPipe_t *pipep, int timeout_ms)
+{
+	size_t size = sizeof(pipep->recvMad);
+	MAD_COMMON *hdr = (MAD_COMMON *)pipep->recvMad;
+	FSTATUS status;
+	int slot;
+
+	status = (*pipep->transport.recv)(pipep->transport.context,
+							pipep->recvMad, &size, timeout_ms);
+	if (status != FSUCCESS && status != FTIMEOUT && status != FREJECT)
+		return;	// nothing received
+	slot = MadPipeFindSlot(pipep, (uint32)ntoh64(hdr->TransactionID));
+	if (slot < 0) {
+		DBGPRINT("MadPipe: discarding unexpected TID 0x%"PRIx64"\n",
+					ntoh64(hdr->TransactionID));
+		return;
+	}
+	if (status == FSUCCESS) {
+		MadPipeReq_t *reqp = pipep->Table[slot];
+
+		MadPipeRemoveSlot(pipep, slot);
+		MadPipeFinish(pipep, reqp,
+					(*reqp->complete)(pipep, reqp, pipep->recvMad, size));
+	} else {
+		// transport returned our request, its response never arrived
+		MadPipeRetry(pipep, slot, status);
+	}
+}
+
+/* issue queued requests and process responses until every submitted request
+ * has completed.  Returns FSUCCESS if all requests succeeded, otherwise the
+ * status of the first failure.
+ */
+FSTATUS MadPipeWait(MadPipe_t *pipep)
+{
+	FSTATUS status;
+
+	for (;;) {
+		MadPipeFill(pipep);
+		if (! pipep->outstanding)
+			break;
+		MadPipePollOne(pipep, RESP_WAIT_TIME);
+		MadPipeExpire(pipep);
+	}
+	status = pipep->status;
+	pipep->status = FSUCCESS;
+	return status;
+}
+
+/* check a response answers reqp and holds at least minSize bytes before
+ * a complete routine parses it.  mad is in wire format.
+ */
+static FSTATUS MadPipeCheckResp(MadPipeReq_t *reqp, uint8_t *mad, size_t size,
+				size_t minSize)
+{
+	MAD_COMMON *req = (MAD_COMMON *)reqp->mad;
+	MAD_COMMON *resp = (MAD_COMMON *)mad;
+	uint8 method;
+
+	if (size < minSize || size < sizeof(MAD_COMMON)) {
+		DBGPRINT("MadPipe: TID 0x%x short response: %u bytes, expected %u\n",
+					reqp->tid, (unsigned)size, (unsigned)minSize);
+		return FERROR;
+	}
+	// Get and Set are both answered by GetResp
+	method = (req->mr.AsReg8 == MMTHD_SET) ? MMTHD_GET_RESP
+											: (req->mr.AsReg8 | 0x80);
+	if (resp->mr.AsReg8 != method || resp->MgmtClass != req->MgmtClass
+			|| resp->AttributeID != req->AttributeID) {
+		DBGPRINT("MadPipe: TID 0x%x unexpected response: class 0x%x method 0x%x attr 0x%x\n",
+					reqp->tid, resp->MgmtClass, resp->mr.AsReg8,
+					ntoh16(resp->AttributeID));
+		return FERROR;
+	}
+	return FSUCCESS;
+}
+
 #ifdef PRODUCT_OPENIB_FF
 
 static __inline__ void debugLogSmaRequest(const char* requestName, uint8_t* path, STL_LID dlid, STL_LID slid) {
@@ -287,10 +635,9 @@ static __inline__ void debugLogSmaRequest(const char* requestName, uint8_t* path
 }
 
 /**
- * Issue a single SMA mad and get the response.
- * Retry as needed if unable to send or don't get a response
+ * Build a SMA request in wire format along with its address
  *
- * @param port The omgt_port to communicate with the fabric
+ * @param port The omgt_port to communicate with the fabric, NULL to use the default pkey
  * @param dlid Destination LID to send packet to
  * @param slid Source LID of mixed LRDR packet. Path describes hops after reaching this LID
  * @param path Directed route path to destination
@@ -298,10 +645,13 @@ static __inline__ void debugLogSmaRequest(const char* requestName, uint8_t* path
  * @param attr Attribute type being issued for this request
  * @param modifier Attribute modifier for the specified attribute
  * @param buffer Pointer to attribute data
- * @param bufferLen The Length of the attribute data in the buffer
+ * @param bufferLength The Length of the attribute data in the buffer
+ * @param smp SMP to build
+ * @param addr Address to build
+ * @param send_size Returns number of bytes of smp to send
  * @return FSTATUS return code
  */
-static FSTATUS stl_sma_send_recv_mad(struct omgt_port *port,
+static FSTATUS stl_sma_build_mad(struct omgt_port *port,
 									 STL_LID dlid,
 									 STL_LID slid,
 									 uint8_t* path,
@@ -309,82 +659,161 @@ static FSTATUS stl_sma_send_recv_mad(struct omgt_port *port,
 									 uint32_t attr, 
 									 uint32_t modifier, 
 									 uint8_t* buffer,
-									 uint32_t bufferLength)
+									 uint32_t bufferLength,
+									 STL_SMP *smp,
+									 struct omgt_mad_addr *addr,
+									 size_t *send_size)
 {
-	FSTATUS fstatus;
-	STL_SMP smp;
-	struct omgt_mad_addr addr;
-	size_t send_size;
-    size_t recv_size;
+	uint16_t pkey;
 
-	memset(&smp, 0, sizeof(smp));
-	memset(&addr, 0, sizeof(addr));
+	memset(smp, 0, sizeof(*smp));
+	memset(addr, 0, sizeof(*addr));
 
 	if(dlid && path == NULL) {
 		// LID routed only
-		smp.common.MgmtClass = MCLASS_SM_LID_ROUTED;
-		smp.common.u.NS.Status.AsReg16 = 0;
-		addr.lid = dlid;
+		smp->common.MgmtClass = MCLASS_SM_LID_ROUTED;
+		smp->common.u.NS.Status.AsReg16 = 0;
+		addr->lid = dlid;
 	} else if (!dlid && !slid && path) {
 		// Directed route only
-		addr.lid = STL_LID_PERMISSIVE;
-		smp.common.MgmtClass = MCLASS_SM_DIRECTED_ROUTE;
-		smp.common.u.DR.s.D = 0;
-		smp.common.u.DR.s.Status = 0;
-		smp.common.u.DR.HopPointer = 0;
-		smp.common.u.DR.HopCount = path[0];
-		smp.SmpExt.DirectedRoute.DrSLID = STL_LID_PERMISSIVE;
-		smp.SmpExt.DirectedRoute.DrDLID = STL_LID_PERMISSIVE;
-		memcpy(smp.SmpExt.DirectedRoute.InitPath, path, sizeof(smp.SmpExt.DirectedRoute.InitPath));
+		addr->lid = STL_LID_PERMISSIVE;
+		smp->common.MgmtClass = MCLASS_SM_DIRECTED_ROUTE;
+		smp->common.u.DR.s.D = 0;
+		smp->common.u.DR.s.Status = 0;
+		smp->common.u.DR.HopPointer = 0;
+		smp->common.u.DR.HopCount = path[0];
+		smp->SmpExt.DirectedRoute.DrSLID = STL_LID_PERMISSIVE;
+		smp->SmpExt.DirectedRoute.DrDLID = STL_LID_PERMISSIVE;
+		memcpy(smp->SmpExt.DirectedRoute.InitPath, path, sizeof(smp->SmpExt.DirectedRoute.InitPath));
 	} else if (!dlid && slid && path) {
 		// Mixed LR-DR (initial LID route, then DR)
-		addr.lid = STL_LID_PERMISSIVE;
-		smp.common.MgmtClass = MCLASS_SM_DIRECTED_ROUTE;
-		smp.common.u.DR.s.D = 0;
-		smp.common.u.DR.s.Status = 0;
-		smp.common.u.DR.HopPointer = 0;
-		smp.common.u.DR.HopCount = path[0];
-		smp.SmpExt.DirectedRoute.DrSLID = slid;
-		smp.SmpExt.DirectedRoute.DrDLID = STL_LID_PERMISSIVE;
-		memcpy(smp.SmpExt.DirectedRoute.InitPath, path, sizeof(smp.SmpExt.DirectedRoute.InitPath));
+		addr->lid = STL_LID_PERMISSIVE;
+		smp->common.MgmtClass = MCLASS_SM_DIRECTED_ROUTE;
+		smp->common.u.DR.s.D = 0;
+		smp->common.u.DR.s.Status = 0;
+		smp->common.u.DR.HopPointer = 0;
+		smp->common.u.DR.HopCount = path[0];
+		smp->SmpExt.DirectedRoute.DrSLID = slid;
+		smp->SmpExt.DirectedRoute.DrDLID = STL_LID_PERMISSIVE;
+		memcpy(smp->SmpExt.DirectedRoute.InitPath, path, sizeof(smp->SmpExt.DirectedRoute.InitPath));
 	} else {
 		DBGPRINT("ERROR: unable to route packet: slid, dlid, or path not properly specified\n");
 		return (FINVALID_PARAMETER);
 	}
 
-	smp.common.BaseVersion = STL_BASE_VERSION;
-	smp.common.ClassVersion = STL_SM_CLASS_VERSION;
-	smp.common.mr.AsReg8 = 0;
-	smp.common.mr.s.Method = method;
+	smp->common.BaseVersion = STL_BASE_VERSION;
+	smp->common.ClassVersion = STL_SM_CLASS_VERSION;
+	smp->common.mr.AsReg8 = 0;
+	smp->common.mr.s.Method = method;
 #if defined(IB_STACK_IBACCESS) || defined(CAL_IBACCESS)
-	smp.common.TransactionID = (++g_transId)<<24;
+	smp->common.TransactionID = (++g_transId)<<24;
 #else
-	smp.common.TransactionID = (++g_transId) & 0xffffffff;
+	smp->common.TransactionID = (++g_transId) & 0xffffffff;
 #endif
-	smp.common.AttributeID = attr;
-	smp.common.AttributeModifier = modifier;
-	smp.M_Key = g_mkey;
+	smp->common.AttributeID = attr;
+	smp->common.AttributeModifier = modifier;
+	smp->M_Key = g_mkey;
 
 	// Copy the attribute information into the SMP
-	memcpy(stl_get_smp_data(&smp), buffer, bufferLength);
+	memcpy(stl_get_smp_data(smp), buffer, bufferLength);
 
     // Determine which pkey to use (full or limited)
     // Attempt to use full at all times, otherwise, can
     // use the limited for queries of the local port.
-    uint16_t pkey = omgt_get_mgmt_pkey(port, dlid, 0);
+    pkey = port ? omgt_get_mgmt_pkey(port, dlid, 0) : OMGT_DEFAULT_PKEY;
     if (pkey==0) {
         DBGPRINT("ERROR: Local port does not have management privileges\n");
         return (FPROTECTION);
     }
 
-	addr.qpn = 0;
-	addr.qkey = 0;
-	addr.pkey = pkey;
+	addr->qpn = 0;
+	addr->qkey = 0;
+	addr->pkey = pkey;
 
-	send_size = bufferLength;
-    send_size += stl_get_smp_header_size(&smp);
-    send_size = ROUNDUP_TYPE(size_t, send_size, 8);
-	STL_BSWAP_SMP_HEADER(&smp);
+	*send_size = bufferLength;
+    *send_size += stl_get_smp_header_size(smp);
+    *send_size = ROUNDUP_TYPE(size_t, *send_size, 8);
+	STL_BSWAP_SMP_HEADER(smp);
+	return FSUCCESS;
+}
+
+/**
+ * Validate a SMA response and return its attribute data
+ *
+ * @param smp Response SMP, header in host byte order
+ * @param path Directed route path request was sent to
+ * @param buffer Pointer to space for attribute data
+ * @param bufferLength The Length of the attribute data in the buffer
+ * @return FSTATUS return code
+ */
+static FSTATUS stl_sma_process_resp(STL_SMP *smp,
+									 uint8_t* path,
+									 uint8_t* buffer,
+									 uint32_t bufferLength)
+{
+	FSTATUS fstatus = FSUCCESS;
+
+	if (smp->common.MgmtClass == MCLASS_SM_DIRECTED_ROUTE && path && memcmp(path, smp->SmpExt.DirectedRoute.InitPath, sizeof(smp->SmpExt.DirectedRoute.InitPath)) != 0) {
+		int i;
+
+		DBGPRINT("Response failed directed route validation, received packet with path: ");
+		for(i = 1; i < 64; i++) {
+			if(smp->SmpExt.DirectedRoute.InitPath[i] != 0) {
+				DBGPRINT("%d ", smp->SmpExt.DirectedRoute.InitPath[i]);
+			} else {
+				break;
+			}
+		}
+		DBGPRINT("\n");
+
+		fstatus = FERROR;
+	}
+
+	if (smp->common.u.DR.s.Status != MAD_STATUS_SUCCESS) {
+		DBGPRINT("SMA response with bad status: 0x%x\n", smp->common.u.DR.s.Status);
+		fstatus = FERROR;
+	} else {
+		memcpy(buffer, stl_get_smp_data(smp), bufferLength);
+	}
+
+	return fstatus;
+}
+
+/**
+ * Issue a single SMA mad and get the response.
+ * Retry as needed if unable to send or don't get a response
+ *
+ * @param port The omgt_port to communicate with the fabric
+ * @param dlid Destination LID to send packet to
+ * @param slid Source LID of mixed LRDR packet. Path describes hops after reaching this LID
+ * @param path Directed route path to destination
+ * @param method Request method, likely either get or set
+ * @param attr Attribute type being issued for this request
+ * @param modifier Attribute modifier for the specified attribute
+ * @param buffer Pointer to attribute data
+ * @param bufferLen The Length of the attribute data in the buffer
+ * @return FSTATUS return code
+ */
+static FSTATUS stl_sma_send_recv_mad(struct omgt_port *port,
+									 STL_LID dlid,
+									 STL_LID slid,
+									 uint8_t* path,
+									 uint8_t method, 
+									 uint32_t attr, 
+									 uint32_t modifier, 
+									 uint8_t* buffer,
+									 uint32_t bufferLength)
+{
+	FSTATUS fstatus;
+	STL_SMP smp;
+	struct omgt_mad_addr addr;
+	size_t send_size;
+    size_t recv_size;
+
+	fstatus = stl_sma_build_mad(port, dlid, slid, path, method, attr, modifier,
+								buffer, bufferLength, &smp, &addr, &send_size);
+	if (fstatus != FSUCCESS)
+		return fstatus;
 
 #ifdef IB_DEBUG
 	DBGPRINT("Sending STL MAD:\n");
@@ -406,30 +835,67 @@ static FSTATUS stl_sma_send_recv_mad(struct omgt_port *port,
 #endif
 	STL_BSWAP_SMP_HEADER(&smp);
 
-	if (smp.common.MgmtClass == MCLASS_SM_DIRECTED_ROUTE && path && memcmp(path, smp.SmpExt.DirectedRoute.InitPath, sizeof(smp.SmpExt.DirectedRoute.InitPath)) != 0) {
-		int i;
+	if (stl_sma_process_resp(&smp, path, buffer, bufferLength) != FSUCCESS)
+		fstatus = FERROR;
 
-		DBGPRINT("Response failed directed route validation, received packet with path: ");
-		for(i = 1; i < 64; i++) {
-			if(smp.SmpExt.DirectedRoute.InitPath[i] != 0) {
-				DBGPRINT("%d ", smp.SmpExt.DirectedRoute.InitPath[i]);
-			} else {
-				break;
-			}
-		}
-		DBGPRINT("\n");
+	return fstatus;
+}
 
-		fstatus = FERROR;
-	}
+static FSTATUS MadPipeSmaComplete(MadPipe_t *pipep, MadPipeReq_t *reqp,
+				uint8_t *mad, size_t size)
+{
+	STL_SMP *smp = (STL_SMP *)mad;
 
-	if (smp.common.u.DR.s.Status != MAD_STATUS_SUCCESS) {
-		DBGPRINT("SMA response with bad status: 0x%x\n", smp.common.u.DR.s.Status);
-		fstatus = FERROR;
-	} else {
-		memcpy(buffer, stl_get_smp_data(&smp), bufferLength);
-	}
+	if (MadPipeCheckResp(reqp, mad, size,
+			stl_get_smp_header_size((STL_SMP *)reqp->mad) + reqp->bufferLength)
+			!= FSUCCESS)
+		return FERROR;
+	STL_BSWAP_SMP_HEADER(smp);
+	return stl_sma_process_resp(smp, reqp->hasPath ? reqp->path : NULL,
+								reqp->buffer, reqp->bufferLength);
+}
 
-	return fstatus;
+/**
+ * Queue a SMA request on a MadPipe_t.  Arguments are as for
+ * stl_sma_send_recv_mad.  buffer must remain valid until callback is
+ * called, at which point it holds the response attribute data.
+ */
+FSTATUS MadPipeSmaSubmit(MadPipe_t *pipep,
+						STL_LID dlid,
+						STL_LID slid,
+						uint8_t* path,
+						uint8_t method,
+						uint32_t attr,
+						uint32_t modifier,
+						uint8_t* buffer,
+						uint32_t bufferLength,
+						MadPipeCallback *callback,
+						void *context)
+{
+	MadPipeReq_t *reqp;
+	FSTATUS fstatus;
+
+	reqp = MadPipeAllocReq(pipep);
+	if (! reqp)
+		return FINSUFFICIENT_MEMORY;
+	fstatus = stl_sma_build_mad(pipep->port, dlid, slid, path, method, attr,
+						modifier, buffer, bufferLength, (STL_SMP *)reqp->mad,
+						&reqp->addr, &reqp->sendSize);
+	if (fstatus != FSUCCESS) {
+		QListInsertHead(&pipep->FreeList, &reqp->QueueEntry);
+		return fstatus;
+	}
+	if (path) {
+		memcpy(reqp->path, path, sizeof(reqp->path));
+		reqp->hasPath = 1;
+	}
+	reqp->complete = MadPipeSmaComplete;
+	reqp->buffer = buffer;
+	reqp->bufferLength = bufferLength;
+	reqp->callback = callback;
+	reqp->context = context;
+	MadPipeQueueReq(pipep, reqp);
+	return FSUCCESS;
 }
 
 /**
@@ -1640,22 +2106,19 @@ static FSTATUS ProcessPmaClassPortInfo(PortData* portp, STL_CLASS_PORT_INFO *cla
 	return FSUCCESS;
 }
 
-/* issue a single PMA mad and get the response.
- * Retry as needed if unable to send or don't get a response
+/* fill in the header and address for a PMA request.
+ * The header is returned in wire format.
  */
-static FSTATUS stl_pm_send_recv_mad(struct omgt_port *port, IB_PATH_RECORD *pathp,
-	uint32 qpn, uint32 qkey, uint8 method, uint32 attr, uint32 modifier, STL_PERF_MAD *mad)
+static void stl_pm_build_mad(IB_PATH_RECORD *pathp, uint32 qpn, uint32 qkey,
+	uint8 method, uint32 attr, uint32 modifier, STL_PERF_MAD *mad,
+	struct omgt_mad_addr *addr)
 {
-	FSTATUS fstatus;
-	struct omgt_mad_addr addr;
-    size_t recv_size;
-
-	memset(&addr, 0, sizeof(addr));
-	addr.lid = pathp->DLID;
-	addr.qpn = qpn;
-	addr.qkey = qkey;
-	addr.pkey = pathp->P_Key;
-	addr.sl = pathp->u2.s.SL;
+	memset(addr, 0, sizeof(*addr));
+	addr->lid = pathp->DLID;
+	addr->qpn = qpn;
+	addr->qkey = qkey;
+	addr->pkey = pathp->P_Key;
+	addr->sl = pathp->u2.s.SL;
 
 	mad->common.BaseVersion = STL_BASE_VERSION;
 	mad->common.MgmtClass = MCLASS_PERF;
@@ -1672,6 +2135,19 @@ static FSTATUS stl_pm_send_recv_mad(struct omgt_port *port, IB_PATH_RECORD *path
 	mad->common.AttributeModifier = modifier;
 	// rest of fields should be ignored for a Get, zero'ed above
 	BSWAP_MAD_HEADER((MAD*)mad);
+}
+
+/* issue a single PMA mad and get the response.
+ * Retry as needed if unable to send or don't get a response
+ */
+static FSTATUS stl_pm_send_recv_mad(struct omgt_port *port, IB_PATH_RECORD *pathp,
+	uint32 qpn, uint32 qkey, uint8 method, uint32 attr, uint32 modifier, STL_PERF_MAD *mad)
+{
+	FSTATUS fstatus;
+	struct omgt_mad_addr addr;
+    size_t recv_size;
+
+	stl_pm_build_mad(pathp, qpn, qkey, method, attr, modifier, mad, &addr);
 #ifdef IB_DEBUG
 	DBGPRINT("Sending MAD:\n");
 	DumpMad(mad);
@@ -1736,6 +2212,188 @@ fail:
 	return fstatus;
 }
 
+static FSTATUS MadPipePmComplete(MadPipe_t *pipep, MadPipeReq_t *reqp,
+				uint8_t *mad, size_t size)
+{
+	STL_PERF_MAD *resp = (STL_PERF_MAD *)reqp->buffer;
+
+	if (MadPipeCheckResp(reqp, mad, size, sizeof(MAD_COMMON)) != FSUCCESS)
+		return FERROR;
+	MemoryCopy(resp, mad, MIN(size, sizeof(*resp)));
+	BSWAP_MAD_HEADER((MAD*)resp);
+	if (resp->common.u.NS.Status.AsReg16 != MAD_STATUS_SUCCESS) {
+		DBGPRINT("PMA response with bad status: 0x%x\n", resp->common.u.NS.Status.AsReg16);
+		return FERROR;
+	}
+	return FSUCCESS;
+}
+
+static FSTATUS MadPipePmQueue(MadPipe_t *pipep, PortData *portp, uint8 method,
+				uint32 attr, uint32 modifier, STL_PERF_MAD *req,
+				MadPipeComplete *complete, uint8_t *buffer, uint32 bufferLength,
+				MadPipeCallback *callback, void *context)
+{
+	MadPipeReq_t *reqp;
+	STL_PERF_MAD *mad;
+
+	ASSERT(portp->pathp->DLID);
+	reqp = MadPipeAllocReq(pipep);
+	if (! reqp)
+		return FINSUFFICIENT_MEMORY;
+	mad = (STL_PERF_MAD *)reqp->mad;
+	*mad = *req;
+	stl_pm_build_mad(portp->pathp, 1, QP1_WELL_KNOWN_Q_KEY, method, attr,
+					modifier, mad, &reqp->addr);
+	reqp->sendSize = sizeof(*mad);
+	reqp->complete = complete;
+	reqp->buffer = buffer;
+	reqp->bufferLength = bufferLength;
+	reqp->callback = callback;
+	reqp->context = context;
+	MadPipeQueueReq(pipep, reqp);
+	return FSUCCESS;
+}
+
+/* Queue a PMA request to portp on a MadPipe_t.
+ * req and resp are as for stl_pm_send_recv, resp must remain valid until
+ * callback is called, at which point it holds the response.
+ */
+FSTATUS MadPipePmSubmit(MadPipe_t *pipep, PortData *portp, uint8 method,
+				uint32 attr, uint32 modifier, STL_PERF_MAD *req, STL_PERF_MAD *resp,
+				MadPipeCallback *callback, void *context)
+{
+	return MadPipePmQueue(pipep, portp, method, attr, modifier, req,
+					MadPipePmComplete, (uint8_t *)resp, sizeof(*resp),
+					callback, context);
+}
+
+static FSTATUS MadPipePmPortStatusComplete(MadPipe_t *pipep, MadPipeReq_t *reqp,
+				uint8_t *mad, size_t size)
+{
+	STL_PERF_MAD *resp = (STL_PERF_MAD *)mad;
+	STL_PORT_STATUS_RSP *pPortStatus = (STL_PORT_STATUS_RSP *)reqp->buffer;
+
+	// PMA returns only the VLs selected, at least as many as are copied
+	if (MadPipeCheckResp(reqp, mad, size,
+			sizeof(MAD_COMMON) + sizeof(*pPortStatus)) != FSUCCESS)
+		return FERROR;
+	BSWAP_MAD_HEADER((MAD*)resp);
+	if (resp->common.u.NS.Status.AsReg16 != MAD_STATUS_SUCCESS) {
+		DBGPRINT("PMA response with bad status: 0x%x\n", resp->common.u.NS.Status.AsReg16);
+		return FERROR;
+	}
+	// swap in the MAD, it holds every VL selected, pPortStatus only 1
+	BSWAP_STL_PORT_STATUS_RSP((STL_PORT_STATUS_RSP *)resp->PerfData);
+	*pPortStatus = *(STL_PORT_STATUS_RSP *)resp->PerfData;
+	return FSUCCESS;
+}
+
+/* Queue a Get(PortStatus) as issued by STLPmGetPortStatus on a MadPipe_t.
+ * pPortStatus must remain valid until callback is called.
+ */
+FSTATUS MadPipePmGetPortStatus(MadPipe_t *pipep, PortData *portp, uint8 portNum,
+				STL_PORT_STATUS_RSP *pPortStatus,
+				MadPipeCallback *callback, void *context)
+{
+	STL_PERF_MAD req;
+	STL_PORT_STATUS_REQ* p = (STL_PORT_STATUS_REQ *)&(req.PerfData);
+
+	MemoryClear(&req, sizeof(req));
+	p->PortNumber = portNum;
+	p->VLSelectMask = 0x8001; // only do VLs 15 and 0 for now, we will ignore VL counters for now
+	BSWAP_STL_PORT_STATUS_REQ(p);
+
+	DBGPRINT("Queuing STL PM Get(PortStatus %d) to LID 0x%04x Node 0x%016"PRIx64"\n",
+				portNum, portp->pathp->DLID,
+				portp->nodep->NodeInfo.NodeGUID);
+	return MadPipePmQueue(pipep, portp, MMTHD_GET, STL_PM_ATTRIB_ID_PORT_STATUS,
+					0x01000000, &req, MadPipePmPortStatusComplete,
+					(uint8_t *)pPortStatus, sizeof(*pPortStatus), callback, context);
+}
+
+static FSTATUS MadPipePmClassPortInfoComplete(MadPipe_t *pipep, MadPipeReq_t *reqp,
+				uint8_t *mad, size_t size)
+{
+	STL_PERF_MAD *resp = (STL_PERF_MAD *)mad;
+	PortData *portp = (PortData *)reqp->buffer;
+	STL_CLASS_PORT_INFO classPortInfo;
+
+	if (MadPipeCheckResp(reqp, mad, size,
+			sizeof(MAD_COMMON) + sizeof(classPortInfo)) != FSUCCESS)
+		return FERROR;
+	BSWAP_MAD_HEADER((MAD*)resp);
+	if (resp->common.u.NS.Status.AsReg16 != MAD_STATUS_SUCCESS) {
+		DBGPRINT("PMA response with bad status: 0x%x\n", resp->common.u.NS.Status.AsReg16);
+		return FERROR;
+	}
+	classPortInfo = *(STL_CLASS_PORT_INFO *)resp->PerfData;
+	return ProcessPmaClassPortInfo(portp, &classPortInfo, portp->pathp);
+}
+
+/* Queue a Get(ClassPortInfo) as issued by STLPmGetClassPortInfo on a
+ * MadPipe_t.  portp is updated when the response arrives, before callback
+ * is called.  If portp already has its ClassPortInfo nothing is queued.
+ */
+FSTATUS MadPipePmGetClassPortInfo(MadPipe_t *pipep, PortData *portp,
+				MadPipeCallback *callback, void *context)
+{
+	STL_PERF_MAD req;
+
+	if (portp->PmaGotClassPortInfo)
+		return FSUCCESS;	// if we already have, no use asking again
+	MemoryClear(&req, sizeof(req));
+
+	DBGPRINT("Queuing PM Get(ClassPortInfo) to LID 0x%08x Node 0x%016"PRIx64"\n",
+				portp->pathp->DLID,
+				portp->nodep->NodeInfo.NodeGUID);
+	return MadPipePmQueue(pipep, portp, MMTHD_GET, STL_PM_ATTRIB_ID_CLASS_PORTINFO,
+					0, &req, MadPipePmClassPortInfoComplete,
+					(uint8_t *)portp, 0, callback, context);
+}
+
+#ifdef PRODUCT_OPENIB_FF
+static FSTATUS MadPipePaPortCountersComplete(MadPipe_t *pipep, MadPipeReq_t *reqp,
+				uint8_t *mad, size_t size)
+{
+	return iba_pa_single_mad_port_counters_parse_response(pipep->port, mad,
+					size, (STL_PORT_COUNTERS_DATA *)reqp->buffer);
+}
+
+/* Queue a PA Get(PortCounters) as issued by omgt_pa_get_port_stats2 on a
+ * MadPipe_t.  The pipe must have been created with a port which has
+ * connected to the PA.  pPortCounters must remain valid until callback
+ * is called.
+ */
+FSTATUS MadPipePaGetPortCounters(MadPipe_t *pipep, STL_PA_IMAGE_ID_DATA imageId,
+				STL_LID lid, uint8 portNum, uint32 user_cntrs,
+				STL_PORT_COUNTERS_DATA *pPortCounters,
+				MadPipeCallback *callback, void *context)
+{
+	MadPipeReq_t *reqp;
+	FSTATUS fstatus;
+
+	if (! pipep->port)
+		return FINVALID_PARAMETER;
+	reqp = MadPipeAllocReq(pipep);
+	if (! reqp)
+		return FINSUFFICIENT_MEMORY;
+	fstatus = iba_pa_single_mad_port_counters_build_request(pipep->port, lid,
+					portNum, 0, user_cntrs, &imageId, reqp->mad,
+					&reqp->sendSize, &reqp->addr);
+	if (fstatus != FSUCCESS) {
+		QListInsertHead(&pipep->FreeList, &reqp->QueueEntry);
+		return fstatus;
+	}
+	reqp->complete = MadPipePaPortCountersComplete;
+	reqp->buffer = (uint8_t *)pPortCounters;
+	reqp->bufferLength = sizeof(*pPortCounters);
+	reqp->callback = callback;
+	reqp->context = context;
+	MadPipeQueueReq(pipep, reqp);
+	return FSUCCESS;
+}
+#endif
+
 /* Get STL Class Port Info from PMA at portp
  * Retry and handle redirection as needed
  * portp is the port to issue PMA request to (can be port 0 of switch)
@@ -1860,25 +2518,21 @@ fail:
 
 
 #if !defined(VXWORKS) || defined(BUILD_DMC)
-static FSTATUS dm_send_recv(struct omgt_port *port,
-							IB_PATH_RECORD *pathp, 
-							uint32 attr, 
-							uint32 modifier,
-							DM_MAD *mad)
+/* fill in the header and address for a DM request.
+ * The header is returned in wire format.
+ */
+static void dm_build_mad(IB_PATH_RECORD *pathp, uint32 attr, uint32 modifier,
+							DM_MAD *mad, struct omgt_mad_addr *addr)
 {
-	FSTATUS fstatus;
-	struct omgt_mad_addr addr;
-    size_t recv_size;
-
-	memset(&addr, 0, sizeof(addr));
-	addr.lid = pathp->DLID;
+	memset(addr, 0, sizeof(*addr));
+	addr->lid = pathp->DLID;
 	if (pathp->u1.s.HopLimit == 1) {
 		if ((pathp->DGID.Type.Global.InterfaceID >> 40) == OUI_TRUESCALE)
-			addr.lid = pathp->DGID.Type.Global.InterfaceID & 0xFFFFFFFF;
+			addr->lid = pathp->DGID.Type.Global.InterfaceID & 0xFFFFFFFF;
 	}
-	addr.qpn = 1;
-	addr.qkey = QP1_WELL_KNOWN_Q_KEY;
-	addr.pkey = pathp->P_Key;
+	addr->qpn = 1;
+	addr->qkey = QP1_WELL_KNOWN_Q_KEY;
+	addr->pkey = pathp->P_Key;
 
 	mad->common.BaseVersion = IB_BASE_VERSION;
 	mad->common.MgmtClass = MCLASS_DEV_MGT;
@@ -1894,6 +2548,19 @@ static FSTATUS dm_send_recv(struct omgt_port *port,
 	mad->common.AttributeModifier = modifier;
 	// rest of fields should be ignored for a Get, zero'ed above
 	BSWAP_MAD_HEADER((MAD*)mad);
+}
+
+static FSTATUS dm_send_recv(struct omgt_port *port,
+							IB_PATH_RECORD *pathp, 
+							uint32 attr, 
+							uint32 modifier,
+							DM_MAD *mad)
+{
+	FSTATUS fstatus;
+	struct omgt_mad_addr addr;
+    size_t recv_size;
+
+	dm_build_mad(pathp, attr, modifier, mad, &addr);
 
 	ASSERT(addr.lid);
     recv_size = sizeof(*mad);
@@ -1912,6 +2579,46 @@ static FSTATUS dm_send_recv(struct omgt_port *port,
 	return fstatus;
 }
 
+static FSTATUS MadPipeDmComplete(MadPipe_t *pipep, MadPipeReq_t *reqp,
+				uint8_t *mad, size_t size)
+{
+	DM_MAD *resp = (DM_MAD *)reqp->buffer;
+
+	if (MadPipeCheckResp(reqp, mad, size, sizeof(MAD_COMMON)) != FSUCCESS)
+		return FERROR;
+	MemoryCopy(resp, mad, MIN(size, sizeof(*resp)));
+	BSWAP_MAD_HEADER((MAD*)resp);
+	if (resp->common.u.NS.Status.AsReg16 != MAD_STATUS_SUCCESS) {
+		DBGPRINT("DMA response with bad status: 0x%x\n", resp->common.u.NS.Status.AsReg16);
+		return FERROR;
+	}
+	return FSUCCESS;
+}
+
+/* Queue a DM Get on a MadPipe_t.  mad must remain valid until callback is
+ * called, at which point it holds the response.
+ */
+FSTATUS MadPipeDmSubmit(MadPipe_t *pipep, IB_PATH_RECORD *pathp, uint32 attr,
+				uint32 modifier, DM_MAD *mad, MadPipeCallback *callback, void *context)
+{
+	MadPipeReq_t *reqp;
+
+	reqp = MadPipeAllocReq(pipep);
+	if (! reqp)
+		return FINSUFFICIENT_MEMORY;
+	MemoryClear(reqp->mad, sizeof(DM_MAD));
+	dm_build_mad(pathp, attr, modifier, (DM_MAD *)reqp->mad, &reqp->addr);
+	ASSERT(reqp->addr.lid);
+	reqp->sendSize = sizeof(DM_MAD);
+	reqp->complete = MadPipeDmComplete;
+	reqp->buffer = (uint8_t *)mad;
+	reqp->bufferLength = sizeof(*mad);
+	reqp->callback = callback;
+	reqp->context = context;
+	MadPipeQueueReq(pipep, reqp);
+	return FSUCCESS;
+}
+
 FSTATUS DmGetIouInfo(struct omgt_port *port, IB_PATH_RECORD *pathp, IOUnitInfo *pIouInfo)
 {
 	DM_MAD mad;
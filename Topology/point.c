@@ -36,6 +36,213 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define MIN_LIST_ITEMS 100	// minimum items for ListInit to allocate for
 
+#define POINT_SET_MIN_ITEMS 32	// list length at which sets are built
+#define POINT_SET_MIN_SIZE 64
+
+static uint32 PointSetHash(const void *object, uint32 size)
+{
+	uint64 key = (uint64)(uintn)object >> 3;	// objects are 8 byte aligned
+
+	return (uint32)((key * 0x9E3779B97F4A7C15ULL) >> 32) & (size - 1);
+}
+
+static void PointSetDestroy(PointSet_t *set)
+{
+	if (set->Buckets)
+		MemoryDeallocate(set->Buckets);
+	set->Buckets = NULL;
+	set->Size = 0;
+	set->Count = 0;
+}
+
+static boolean PointSetContains(const PointSet_t *set, const void *object)
+{
+	uint32 i;
+
+	if (! set->Size)
+		return FALSE;
+	for (i = PointSetHash(object, set->Size); set->Buckets[i]; i = (i+1) & (set->Size-1)) {
+		if (set->Buckets[i] == object)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* add object to set, duplicates are ignored */
+static FSTATUS PointSetInsert(PointSet_t *set, void *object)
+{
+	uint32 i;
+
+	if ((set->Count+1)*2 > set->Size) {
+		/* keep load factor at or below 1/2 */
+		uint32 size = set->Size ? set->Size*2 : POINT_SET_MIN_SIZE;
+		void **buckets = (void **)MemoryAllocate2AndClear(sizeof(void *)*size,
+								IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+		if (! buckets)
+			return FINSUFFICIENT_MEMORY;
+		for (i=0; i < set->Size; i++) {
+			uint32 j;
+			if (! set->Buckets[i])
+				continue;
+			for (j = PointSetHash(set->Buckets[i], size); buckets[j]; j = (j+1) & (size-1))
+				;
+			buckets[j] = set->Buckets[i];
+		}
+		if (set->Buckets)
+			MemoryDeallocate(set->Buckets);
+		set->Buckets = buckets;
+		set->Size = size;
+	}
+	for (i = PointSetHash(object, set->Size); set->Buckets[i]; i = (i+1) & (set->Size-1)) {
+		if (set->Buckets[i] == object)
+			return FSUCCESS;
+	}
+	set->Buckets[i] = object;
+	set->Count++;
+	return FSUCCESS;
+}
+
+static void PointFabricSetDestroy(Point *point)
+{
+	if (! point->FabricSet)
+		return;
+	PointSetDestroy(&point->FabricSet->Objects);
+	PointSetDestroy(&point->FabricSet->Nodes);
+	PointSetDestroy(&point->FabricSet->Systems);
+	MemoryDeallocate(point->FabricSet);
+	point->FabricSet = NULL;
+}
+
+/* add an object from the fabric list (or either side of a node pair list)
+ * to the point's sets
+ */
+static FSTATUS PointFabricSetInsert(PointFabricSet_t *fset, PointType type, void *object)
+{
+	FSTATUS status;
+	NodeData *nodep;
+
+	switch (type) {
+	case POINT_TYPE_PORT_LIST:
+		status = PointSetInsert(&fset->Objects, object);
+		nodep = ((PortData*)object)->nodep;
+		if (FSUCCESS == status)
+			status = PointSetInsert(&fset->Nodes, nodep);
+		break;
+	case POINT_TYPE_NODE_LIST:
+		/* Objects are the nodes */
+		nodep = (NodeData*)object;
+		status = PointSetInsert(&fset->Objects, object);
+		break;
+#if !defined(VXWORKS) || defined(BUILD_DMC)
+	case POINT_TYPE_IOC_LIST:
+		status = PointSetInsert(&fset->Objects, object);
+		nodep = ((IocData*)object)->ioup->nodep;
+		if (FSUCCESS == status)
+			status = PointSetInsert(&fset->Nodes, nodep);
+		break;
+#endif
+	case POINT_TYPE_NODE_PAIR_LIST:
+		nodep = (NodeData*)object;
+		status = PointSetInsert(&fset->Nodes, object);
+		break;
+	default:
+		ASSERT(0);
+		return FINVALID_OPERATION;
+	}
+	if (FSUCCESS != status)
+		return status;
+	if (! nodep->systemp)
+		return FINVALID_OPERATION;	/* can't be represented, use the lists */
+	return PointSetInsert(&fset->Systems, nodep->systemp);
+}
+
+static FSTATUS PointFabricSetAddList(PointFabricSet_t *fset, PointType type, DLIST *pList)
+{
+	FSTATUS status;
+	LIST_ITERATOR i;
+
+	for (i=ListHead(pList); i != NULL; i = ListNext(pList, i)) {
+		status = PointFabricSetInsert(fset, type, ListObj(i));
+		if (FSUCCESS != status)
+			return status;
+	}
+	return FSUCCESS;
+}
+
+/* keep the fabric sets in sync after object was appended to the list.
+ * The sets are only an accelerator, if memory can't be allocated for them
+ * they are discarded and the lists are searched instead
+ */
+static void PointFabricSetUpdate(Point *point, void *object)
+{
+	FSTATUS status;
+	uint32 count;
+
+	if (point->FabricSet) {
+		status = PointFabricSetInsert(point->FabricSet, point->Type, object);
+		if (FSUCCESS != status)
+			PointFabricSetDestroy(point);
+		return;
+	}
+	if (point->Type == POINT_TYPE_NODE_PAIR_LIST)
+		count = ListCount(&point->u.nodePairList.nodePairList1)
+				+ ListCount(&point->u.nodePairList.nodePairList2);
+	else
+		count = ListCount(&point->u.nodeList);
+	if (count < POINT_SET_MIN_ITEMS)
+		return;
+	point->FabricSet = (PointFabricSet_t*)MemoryAllocate2AndClear(sizeof(PointFabricSet_t),
+								IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! point->FabricSet)
+		return;
+	if (point->Type == POINT_TYPE_NODE_PAIR_LIST) {
+		status = PointFabricSetAddList(point->FabricSet, point->Type,
+								&point->u.nodePairList.nodePairList1);
+		if (FSUCCESS == status)
+			status = PointFabricSetAddList(point->FabricSet, point->Type,
+								&point->u.nodePairList.nodePairList2);
+	} else {
+		/* port, node and ioc lists all overlay u.nodeList */
+		status = PointFabricSetAddList(point->FabricSet, point->Type, &point->u.nodeList);
+	}
+	if (FSUCCESS != status)
+		PointFabricSetDestroy(point);
+}
+
+static void PointObjectSetDestroy(PointSet_t **setp)
+{
+	if (! *setp)
+		return;
+	PointSetDestroy(*setp);
+	MemoryDeallocate(*setp);
+	*setp = NULL;
+}
+
+/* same as PointFabricSetUpdate for the ExpectedNode, ExpectedSM and
+ * ExpectedLink lists, which only need a set of the listed objects
+ */
+static void PointObjectSetUpdate(PointSet_t **setp, DLIST *pList, void *object)
+{
+	FSTATUS status = FSUCCESS;
+	LIST_ITERATOR i;
+
+	if (*setp) {
+		if (FSUCCESS != PointSetInsert(*setp, object))
+			PointObjectSetDestroy(setp);
+		return;
+	}
+	if (ListCount(pList) < POINT_SET_MIN_ITEMS)
+		return;
+	*setp = (PointSet_t*)MemoryAllocate2AndClear(sizeof(PointSet_t),
+								IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! *setp)
+		return;
+	for (i=ListHead(pList); FSUCCESS == status && i != NULL; i = ListNext(pList, i))
+		status = PointSetInsert(*setp, ListObj(i));
+	if (FSUCCESS != status)
+		PointObjectSetDestroy(setp);
+}
+
 void PointInit(Point *point)
 {
 	point->Type = POINT_TYPE_NONE;
@@ -44,6 +251,10 @@ void PointInit(Point *point)
 	point->EnodeType = POINT_ENODE_TYPE_NONE;
 	point->EsmType = POINT_ESM_TYPE_NONE;
 	point->ElinkType = POINT_ELINK_TYPE_NONE;
+	point->FabricSet = NULL;
+	point->EnodeSet = NULL;
+	point->EsmSet = NULL;
+	point->ElinkSet = NULL;
 }
 
 /* initialize a non-list point */
@@ -282,6 +493,7 @@ void PointFabricDestroy(Point *point)
 	default:
 		break;
 	}
+	PointFabricSetDestroy(point);
 	point->Type = POINT_TYPE_NONE;
 }
 
@@ -294,6 +506,7 @@ void PointEnodeDestroy(Point *point)
 	default:
 		break;
 	}
+	PointObjectSetDestroy(&point->EnodeSet);
 	point->EnodeType = POINT_ENODE_TYPE_NONE;
 }
 
@@ -306,6 +519,7 @@ void PointEsmDestroy(Point *point)
 	default:
 		break;
 	}
+	PointObjectSetDestroy(&point->EsmSet);
 	point->EsmType = POINT_ESM_TYPE_NONE;
 }
 
@@ -318,6 +532,7 @@ void PointElinkDestroy(Point *point)
 	default:
 		break;
 	}
+	PointObjectSetDestroy(&point->ElinkSet);
 	point->ElinkType = POINT_ELINK_TYPE_NONE;
 }
 
@@ -393,6 +608,7 @@ FSTATUS PointListAppend(Point *point, PointType type, void *object)
 		PointDestroy(point);
 		return FINSUFFICIENT_MEMORY;
 	}
+	PointFabricSetUpdate(point, object);
 	return FSUCCESS;
 }
 
@@ -432,6 +648,7 @@ FSTATUS PointEnodeListAppend(Point *point, PointEnodeType type, void *object)
 		PointDestroy(point);
 		return FINSUFFICIENT_MEMORY;
 	}
+	PointObjectSetUpdate(&point->EnodeSet, pList, object);
 	return FSUCCESS;
 }
 
@@ -471,6 +688,7 @@ FSTATUS PointEsmListAppend(Point *point, PointEsmType type, void *object)
 		PointDestroy(point);
 		return FINSUFFICIENT_MEMORY;
 	}
+	PointObjectSetUpdate(&point->EsmSet, pList, object);
 	return FSUCCESS;
 }
 
@@ -510,6 +728,7 @@ FSTATUS PointElinkListAppend(Point *point, PointElinkType type, void *object)
 		PointDestroy(point);
 		return FINSUFFICIENT_MEMORY;
 	}
+	PointObjectSetUpdate(&point->ElinkSet, pList, object);
 	return FSUCCESS;
 }
 
@@ -550,10 +769,30 @@ FSTATUS PointNodePairListAppend(Point *point, uint8 side, void *object)
 		PointDestroy(point);
 		return FINSUFFICIENT_MEMORY;
 	}
+	PointFabricSetUpdate(point, object);
 
 	return FSUCCESS;
 }
 
+/* struct copy for the single object cases of the Copy routines.
+ * The struct copy would leave dest sharing src's sets, so dest's own sets are
+ * freed first and dest's set pointers are cleared after the copy.  A NULL set
+ * only means lookups walk the list, list copies rebuild dest's sets as
+ * they Append.
+ */
+static void PointCopyStruct(Point *dest, Point *src)
+{
+	PointFabricSetDestroy(dest);
+	PointObjectSetDestroy(&dest->EnodeSet);
+	PointObjectSetDestroy(&dest->EsmSet);
+	PointObjectSetDestroy(&dest->ElinkSet);
+	*dest = *src;
+	dest->FabricSet = NULL;
+	dest->EnodeSet = NULL;
+	dest->EsmSet = NULL;
+	dest->ElinkSet = NULL;
+}
+
 /* Failures imply a caller bug or a failure to allocate memory */
 /* On failure will Destroy the whole dest point leaving it !PointValid */
 FSTATUS PointFabricCopy(Point *dest, Point *src)
@@ -573,7 +812,7 @@ FSTATUS PointFabricCopy(Point *dest, Point *src)
 #endif
 	case POINT_TYPE_SYSTEM:
 	default:
-		*dest = *src;
+		PointCopyStruct(dest, src);
 		break;
 	case POINT_TYPE_PORT_LIST:
 		pSrcList = &src->u.portList;
@@ -615,7 +854,7 @@ FSTATUS PointEnodeCopy(Point *dest, Point *src)
 	switch (src->EnodeType) {
 	case POINT_ENODE_TYPE_NONE:
 	case POINT_ENODE_TYPE_NODE:
-		*dest = *src;
+		PointCopyStruct(dest, src);
 		break;
 	case POINT_ENODE_TYPE_NODE_LIST:
 		pSrcList = &src->u2.enodeList;
@@ -646,7 +885,7 @@ FSTATUS PointEsmCopy(Point *dest, Point *src)
 	switch (src->EsmType) {
 	case POINT_ESM_TYPE_NONE:
 	case POINT_ESM_TYPE_SM:
-		*dest = *src;
+		PointCopyStruct(dest, src);
 		break;
 	case POINT_ESM_TYPE_SM_LIST:
 		pSrcList = &src->u3.esmList;
@@ -677,7 +916,7 @@ FSTATUS PointElinkCopy(Point *dest, Point *src)
 	switch (src->ElinkType) {
 	case POINT_ELINK_TYPE_NONE:
 	case POINT_ELINK_TYPE_LINK:
-		*dest = *src;
+		PointCopyStruct(dest, src);
 		break;
 	case POINT_ELINK_TYPE_LINK_LIST:
 		pSrcList = &src->u4.elinkList;
@@ -818,6 +1057,8 @@ boolean ComparePortPoint(PortData *portp, Point *point)
 	case POINT_TYPE_PORT:
 		return (portp == point->u.portp);
 	case POINT_TYPE_PORT_LIST:
+		if (point->FabricSet)
+			return PointSetContains(&point->FabricSet->Objects, portp);
 		{
 		LIST_ITERATOR i;
 		DLIST *pList = &point->u.portList;
@@ -832,6 +1073,8 @@ boolean ComparePortPoint(PortData *portp, Point *point)
 	case POINT_TYPE_NODE:
 		return (portp->nodep == point->u.nodep);
 	case POINT_TYPE_NODE_LIST:
+		if (point->FabricSet)
+			return PointSetContains(&point->FabricSet->Objects, portp->nodep);
 		{
 		LIST_ITERATOR i;
 		DLIST *pList = &point->u.nodeList;
@@ -847,6 +1090,8 @@ boolean ComparePortPoint(PortData *portp, Point *point)
 	case POINT_TYPE_IOC:
 		return (portp->nodep == point->u.iocp->ioup->nodep);
 	case POINT_TYPE_IOC_LIST:
+		if (point->FabricSet)
+			return PointSetContains(&point->FabricSet->Nodes, portp->nodep);
 		{
 		LIST_ITERATOR i;
 		DLIST *pList = &point->u.nodeList;
@@ -862,6 +1107,8 @@ boolean ComparePortPoint(PortData *portp, Point *point)
 	case POINT_TYPE_SYSTEM:
 		return (portp->nodep->systemp == point->u.systemp);
 	case POINT_TYPE_NODE_PAIR_LIST:
+		if (point->FabricSet)
+			return PointSetContains(&point->FabricSet->Nodes, portp->nodep);
 		{
 		LIST_ITERATOR i;
 		DLIST *pList1 = &point->u.nodePairList.nodePairList1;
@@ -897,6 +1144,8 @@ boolean CompareNodePoint(NodeData *nodep, Point *point)
 	case POINT_TYPE_PORT:
 		return (nodep == point->u.portp->nodep);
 	case POINT_TYPE_PORT_LIST:
+		if (point->FabricSet)
+			return PointSetContains(&point->FabricSet->Nodes, nodep);
 		{
 		LIST_ITERATOR i;
 		DLIST *pList = &point->u.portList;
@@ -911,6 +1160,8 @@ boolean CompareNodePoint(NodeData *nodep, Point *point)
 	case POINT_TYPE_NODE:
 		return (nodep == point->u.nodep);
 	case POINT_TYPE_NODE_LIST:
+		if (point->FabricSet)
+			return PointSetContains(&point->FabricSet->Objects, nodep);
 		{
 		LIST_ITERATOR i;
 		DLIST *pList = &point->u.nodeList;
@@ -926,6 +1177,8 @@ boolean CompareNodePoint(NodeData *nodep, Point *point)
 	case POINT_TYPE_IOC:
 		return (nodep == point->u.iocp->ioup->nodep);
 	case POINT_TYPE_IOC_LIST:
+		if (point->FabricSet)
+			return PointSetContains(&point->FabricSet->Nodes, nodep);
 		{
 		LIST_ITERATOR i;
 		DLIST *pList = &point->u.nodeList;
@@ -941,6 +1194,8 @@ boolean CompareNodePoint(NodeData *nodep, Point *point)
 	case POINT_TYPE_SYSTEM:
 		return (nodep->systemp == point->u.systemp);
 	case POINT_TYPE_NODE_PAIR_LIST:
+		if (point->FabricSet)
+			return PointSetContains(&point->FabricSet->Nodes, nodep);
 		{
 		LIST_ITERATOR i;
 		DLIST *pList1 = &point->u.nodePairList.nodePairList1;
@@ -989,6 +1244,8 @@ boolean CompareIocPoint(IocData *iocp, Point *point)
 	case POINT_TYPE_IOC:
 		return (iocp == point->u.iocp);
 	case POINT_TYPE_IOC_LIST:
+		if (point->FabricSet)
+			return PointSetContains(&point->FabricSet->Objects, iocp);
 		{
 		LIST_ITERATOR i;
 		DLIST *pList = &point->u.nodeList;
@@ -1029,6 +1286,8 @@ boolean CompareSystemPoint(SystemData *systemp, Point *point)
 	case POINT_TYPE_PORT:
 		return (systemp == point->u.portp->nodep->systemp);
 	case POINT_TYPE_PORT_LIST:
+		if (point->FabricSet)
+			return PointSetContains(&point->FabricSet->Systems, systemp);
 		{
 		LIST_ITERATOR i;
 		DLIST *pList = &point->u.portList;
@@ -1043,6 +1302,8 @@ boolean CompareSystemPoint(SystemData *systemp, Point *point)
 	case POINT_TYPE_NODE:
 		return (systemp == point->u.nodep->systemp);
 	case POINT_TYPE_NODE_LIST:
+		if (point->FabricSet)
+			return PointSetContains(&point->FabricSet->Systems, systemp);
 		{
 		LIST_ITERATOR i;
 		DLIST *pList = &point->u.nodeList;
@@ -1058,6 +1319,8 @@ boolean CompareSystemPoint(SystemData *systemp, Point *point)
 	case POINT_TYPE_IOC:
 		return (systemp == point->u.iocp->ioup->nodep->systemp);
 	case POINT_TYPE_IOC_LIST:
+		if (point->FabricSet)
+			return PointSetContains(&point->FabricSet->Systems, systemp);
 		{
 		LIST_ITERATOR i;
 		DLIST *pList = &point->u.nodeList;
@@ -1073,6 +1336,8 @@ boolean CompareSystemPoint(SystemData *systemp, Point *point)
 	case POINT_TYPE_SYSTEM:
 		return (systemp == point->u.systemp);
 	case POINT_TYPE_NODE_PAIR_LIST:
+		if (point->FabricSet)
+			return PointSetContains(&point->FabricSet->Systems, systemp);
 		{
 		LIST_ITERATOR i;
 		DLIST *pList1 = &point->u.nodePairList.nodePairList1;
@@ -1109,6 +1374,8 @@ boolean CompareExpectedNodePoint(ExpectedNode *enodep, Point *point)
 	case POINT_ENODE_TYPE_NODE:
 		return (enodep == point->u2.enodep);
 	case POINT_ENODE_TYPE_NODE_LIST:
+		if (point->EnodeSet)
+			return PointSetContains(point->EnodeSet, enodep);
 		{
 		LIST_ITERATOR i;
 		DLIST *pList = &point->u2.enodeList;
@@ -1138,6 +1405,8 @@ boolean CompareExpectedSMPoint(ExpectedSM *esmp, Point *point)
 	case POINT_ESM_TYPE_SM:
 		return (esmp == point->u3.esmp);
 	case POINT_ESM_TYPE_SM_LIST:
+		if (point->EsmSet)
+			return PointSetContains(point->EsmSet, esmp);
 		{
 		LIST_ITERATOR i;
 		DLIST *pList = &point->u3.esmList;
@@ -1167,6 +1436,8 @@ boolean CompareExpectedLinkPoint(ExpectedLink *elinkp, Point *point)
 	case POINT_ELINK_TYPE_LINK:
 		return (elinkp == point->u4.elinkp);
 	case POINT_ELINK_TYPE_LINK_LIST:
+		if (point->ElinkSet)
+			return PointSetContains(point->ElinkSet, elinkp);
 		{
 		LIST_ITERATOR i;
 		DLIST *pList = &point->u4.elinkList;
@@ -1221,9 +1492,14 @@ void PointFabricCompress(Point *point)
 			LIST_ITERATOR i;
 			DLIST *pList = &point->u.portList;
 
-			for (i=ListHead(pList); portp && i != NULL; i = ListNext(pList, i)) {
-				if (portp->nodep != ((PortData*)ListObj(i))->nodep)
+			if (point->FabricSet) {
+				if (point->FabricSet->Nodes.Count != 1)
 					portp = NULL;	/* not in same node, flag for below */
+			} else {
+				for (i=ListHead(pList); portp && i != NULL; i = ListNext(pList, i)) {
+					if (portp->nodep != ((PortData*)ListObj(i))->nodep)
+						portp = NULL;	/* not in same node, flag for below */
+				}
 			}
 			if (portp) {
 				/* degenerate case, simplify as a single node */
@@ -1284,9 +1560,14 @@ void PointFabricCompress(Point *point)
 			LIST_ITERATOR i;
 			DLIST *pList = &point->u.nodeList;
 
-			for (i=ListHead(pList); nodep && i != NULL; i = ListNext(pList, i)) {
-				if (nodep->systemp != ((NodeData*)ListObj(i))->systemp)
+			if (point->FabricSet) {
+				if (point->FabricSet->Systems.Count != 1)
 					nodep = NULL;	/* not in same system, flag for below */
+			} else {
+				for (i=ListHead(pList); nodep && i != NULL; i = ListNext(pList, i)) {
+					if (nodep->systemp != ((NodeData*)ListObj(i))->systemp)
+						nodep = NULL;	/* not in same system, flag for below */
+				}
 			}
 			if (nodep) {
 				/* degenerate case, simplify as a single system */
@@ -1316,9 +1597,15 @@ void PointFabricCompress(Point *point)
 			LIST_ITERATOR i;
 			DLIST *pList = &point->u.iocList;
 
-			for (i=ListHead(pList); iocp && i != NULL; i = ListNext(pList, i)) {
-				if (iocp->ioup != ((IocData*)ListObj(i))->ioup)
+			/* each node has at most one iou */
+			if (point->FabricSet) {
+				if (point->FabricSet->Nodes.Count != 1)
 					iocp = NULL;	/* not in same iou, flag for below */
+			} else {
+				for (i=ListHead(pList); iocp && i != NULL; i = ListNext(pList, i)) {
+					if (iocp->ioup != ((IocData*)ListObj(i))->ioup)
+						iocp = NULL;	/* not in same iou, flag for below */
+				}
 			}
 			if (iocp) {
 				/* degenerate case, simplify as a single node */
@@ -72,7 +72,11 @@ static PortData *LookupRoute(NodeData *nodep, STL_LID dlid, PortData* inportp, i
 	if (portNum == 0xff)
 		return NULL;	// invalid table entry, no route
 
-	portp = FindNodePort(nodep, portNum);
+	if (nodep->switchp->PortsByNum)
+		portp = (portNum < nodep->switchp->PortsByNumSize)
+					? nodep->switchp->PortsByNum[portNum] : NULL;
+	else
+		portp = FindNodePort(nodep, portNum);
 	// Analysis is focused on datapath routes.  While VL15 can route through an
 	// Init port, that analysis is atypical.  Prior to FF_DOWNPORTINFO
 	// we would tend not to have ports Down or Init in our DB so
@@ -94,6 +98,7 @@ FSTATUS WalkRoutePort(FabricData_t *fabricp, PortData *portp, STL_LID dlid, uint
 	PortData *portp2;	// next port in route
 	FSTATUS status;
 	PortData *hops[64];
+	uint64 visited = 0;	// bitmap of hashed hops entries
 	uint8 numhops = 0;
 	uint8 sc = 0, vl = 0;
 	if (portp->pQOS) {
@@ -120,14 +125,20 @@ FSTATUS WalkRoutePort(FabricData_t *fabricp, PortData *portp, STL_LID dlid, uint
 	while (portp->nodep->NodeInfo.NodeType == STL_NODE_SW
 				&& (numhops == 0 || portp->PortNum != 0)) {
 		SwitchData *switchp;
+		uint64 bit;
 		uint8 i;
 
 		if (numhops >= 64)
 			return FNOT_DONE;	// too long a path
-		for (i=0; i< numhops; i++) {
-			if (hops[i] == portp)
-				return FNOT_DONE;	// looping path
+		// only search hops when the port's bit shows it may be a repeat
+		bit = 1ULL << ((((uint64)(uintptr_t)portp) * 0x9E3779B97F4A7C15ULL) >> 58);
+		if (visited & bit) {
+			for (i=0; i< numhops; i++) {
+				if (hops[i] == portp)
+					return FNOT_DONE;	// looping path
+			}
 		}
+		visited |= bit;
 		hops[numhops++] = portp;
 
 		// portp is entry port to a switch
@@ -499,10 +510,11 @@ FSTATUS TabulateRoute(FabricData_t *fabricp, STL_LID slid, STL_LID dlid,
 				   	NULL);
 }
 
-// tabulate all routes from portp1 to portp2
-FSTATUS TabulateRoutes(FabricData_t *fabricp, PortData *portp1,
-			   			PortData *portp2, uint32 *totalPaths, 
-						uint32 *badPaths, boolean fatTree)
+// tabulate all routes from portp1 to portp2 using the given callback,
+// baseContext and lmcContext are passed to callback for base and LMC LIDs
+static FSTATUS TabulateRoutesCallback(FabricData_t *fabricp, PortData *portp1,
+			   			PortData *portp2, uint32 *totalPaths, uint32 *badPaths,
+						RouteCallback_t *callback, void *baseContext, void *lmcContext)
 {
 	int  offset;
 	int  count = (1<<portp1->PortInfo.s1.LMC);
@@ -514,9 +526,7 @@ FSTATUS TabulateRoutes(FabricData_t *fabricp, PortData *portp1,
 	// IB is destination routed, so just need starting port, no need to
 	// iterate on all SLIDs for that port
 	status = WalkRoutePort(fabricp, portp1,
-				   portp2->PortInfo.LID, 0, 0,
-				   fatTree?TabulateRouteCallbackFatTree:TabulateRouteCallback,
-				   NULL);	// Base LID
+				   portp2->PortInfo.LID, 0, 0, callback, baseContext);	// Base LID
 	if (status == FUNAVAILABLE)
 		return status;
 	(*totalPaths)++;
@@ -525,9 +535,7 @@ FSTATUS TabulateRoutes(FabricData_t *fabricp, PortData *portp1,
 
 	for (offset = 1; offset < count; offset++) {
 		status = WalkRoutePort(fabricp, portp1,
-				   portp2->PortInfo.LID|offset, 0, 0,
-				   fatTree?TabulateRouteCallbackFatTree:TabulateRouteCallback,
-				   (void*)1);	// LMC LID
+				   portp2->PortInfo.LID|offset, 0, 0, callback, lmcContext);	// LMC LID
 		if (status == FUNAVAILABLE)
 			return status;
 		(*totalPaths)++;
@@ -537,21 +545,261 @@ FSTATUS TabulateRoutes(FabricData_t *fabricp, PortData *portp1,
 	return FSUCCESS;
 }
 
+// tabulate all routes from portp1 to portp2
+FSTATUS TabulateRoutes(FabricData_t *fabricp, PortData *portp1,
+			   			PortData *portp2, uint32 *totalPaths, 
+						uint32 *badPaths, boolean fatTree)
+{
+	return TabulateRoutesCallback(fabricp, portp1, portp2, totalPaths, badPaths,
+				   fatTree?TabulateRouteCallbackFatTree:TabulateRouteCallback,
+				   NULL, (void*)1);
+}
+
+// The N x N tabulation of FI routes is split by source port across worker
+// threads.  Each thread tallies into its own array of analysisData indexed by
+// PortData.analysisIndex and the arrays are summed into the ports at the end.
+// Since the tallies are pure counts the result is identical to a serial walk.
+#define TABULATE_MAX_THREADS	16
+#define TABULATE_MIN_SOURCES	32	// min source ports per worker thread
+
+typedef union PortAnalysisData_u PortAnalysisData_t;
+
+// context for a single route walk by a tabulation thread
+typedef struct TabulateWalkContext_s {
+	PortAnalysisData_t *tally;	// thread's tally, indexed by analysisIndex
+	boolean isBaseLid;
+} TabulateWalkContext_t;
+
+typedef struct TabulateThreadContext_s {
+	FabricData_t *fabricp;
+	PortData **ports;		// FI ports, both sources and destinations
+	uint32 numPorts;
+	uint32 first;			// first source port index for this thread
+	uint32 stride;			// source port index increment
+	boolean fatTree;
+	TabulateWalkContext_t base;
+	TabulateWalkContext_t lmc;
+	uint32 totalPaths;
+	uint32 badPaths;
+	FSTATUS status;
+} TabulateThreadContext_t;
+
+// per-thread equivalent of TabulateRouteCallbackFatTree
+static FSTATUS TabulateThreadCallbackFatTree(PortData *entryPortp, PortData *exitPortp, uint8 vl, void *context)
+{
+	TabulateWalkContext_t *walkp = (TabulateWalkContext_t *)context;
+
+	if (exitPortp) {
+		PortAnalysisData_t *datap = &walkp->tally[exitPortp->analysisIndex];
+
+		if (exitPortp->neighbor && exitPortp->nodep->analysis < exitPortp->neighbor->nodep->analysis) {
+			datap->fatTreeRoutes.uplinkAllPaths++;
+			if (walkp->isBaseLid)
+				datap->fatTreeRoutes.uplinkBasePaths++;
+		} else {
+			// for now == tier or no neighbor unexpected, but treat as downlink
+			datap->fatTreeRoutes.downlinkAllPaths++;
+			if (walkp->isBaseLid)
+				datap->fatTreeRoutes.downlinkBasePaths++;
+		}
+	}
+	return FSUCCESS;
+}
+
+// per-thread equivalent of TabulateRouteCallback
+static FSTATUS TabulateThreadCallback(PortData *entryPortp, PortData *exitPortp, uint8 vl, void *context)
+{
+	TabulateWalkContext_t *walkp = (TabulateWalkContext_t *)context;
+
+	if (entryPortp) {
+		PortAnalysisData_t *datap = &walkp->tally[entryPortp->analysisIndex];
+
+		datap->routes.recvAllPaths++;
+		if (walkp->isBaseLid)
+			datap->routes.recvBasePaths++;
+	}
+
+	if (exitPortp) {
+		PortAnalysisData_t *datap = &walkp->tally[exitPortp->analysisIndex];
+
+		datap->routes.xmitAllPaths++;
+		if (walkp->isBaseLid)
+			datap->routes.xmitBasePaths++;
+	}
+	return FSUCCESS;
+}
+
+static void *TabulateThread(void *context)
+{
+	TabulateThreadContext_t *threadp = (TabulateThreadContext_t *)context;
+	RouteCallback_t *callback = threadp->fatTree
+					? TabulateThreadCallbackFatTree : TabulateThreadCallback;
+	uint32 pathCount, badPathCount;
+	uint32 s, d;
+
+	threadp->status = FSUCCESS;
+	for (s = threadp->first; s < threadp->numPorts; s += threadp->stride) {
+		PortData *portp1 = threadp->ports[s];
+
+		for (d = 0; d < threadp->numPorts; d++) {
+			PortData *portp2 = threadp->ports[d];
+
+			// skip loopback paths
+			if (portp1 == portp2)
+				continue;
+			threadp->status = TabulateRoutesCallback(threadp->fabricp,
+						portp1, portp2, &pathCount, &badPathCount,
+						callback, &threadp->base, &threadp->lmc);
+			if (threadp->status == FUNAVAILABLE)
+				return NULL;
+			threadp->totalPaths += pathCount;
+			threadp->badPaths += badPathCount;
+		}
+	}
+	return NULL;
+}
+
+// number all ports in the fabric for use as indexes into tallies
+static uint32 IndexAnalysisPorts(FabricData_t *fabricp)
+{
+	cl_map_item_t *n;
+	cl_map_item_t *p;
+	uint32 index = 0;
+
+	for (n=cl_qmap_head(&fabricp->AllNodes); n != cl_qmap_end(&fabricp->AllNodes); n = cl_qmap_next(n)) {
+		NodeData *nodep = PARENT_STRUCT(n, NodeData, AllNodesEntry);
+		for (p=cl_qmap_head(&nodep->Ports); p != cl_qmap_end(&nodep->Ports); p = cl_qmap_next(p)) {
+			PortData *portp = PARENT_STRUCT(p, PortData, NodePortsEntry);
+			portp->analysisIndex = index++;
+		}
+	}
+	return index;
+}
+
+// tabulate routes between all pairs of the given FI ports, splitting the
+// source ports across worker threads
+static FSTATUS TabulatePortRoutes(FabricData_t *fabricp, PortData **ports,
+						uint32 numPorts, uint32 *totalPaths, uint32 *badPaths,
+						boolean fatTree)
+{
+	TabulateThreadContext_t *threads;
+	PortAnalysisData_t *tallies;
+	uint32 numIndexes = IndexAnalysisPorts(fabricp);
+	uint32 numThreads = 1;
+	uint32 t;
+	cl_map_item_t *n;
+	cl_map_item_t *p;
+	FSTATUS status = FSUCCESS;
+
+#ifndef __VXWORKS__
+	{
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		if (cpus > 1)
+			numThreads = MIN((uint32)cpus, TABULATE_MAX_THREADS);
+		numThreads = MIN(numThreads, numPorts/TABULATE_MIN_SOURCES);
+		if (! numThreads)
+			numThreads = 1;
+	}
+#endif
+
+	threads = (TabulateThreadContext_t *)MemoryAllocate2AndClear(
+					sizeof(TabulateThreadContext_t) * numThreads,
+					IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	tallies = (PortAnalysisData_t *)MemoryAllocate2AndClear(
+					sizeof(PortAnalysisData_t) * numIndexes * numThreads + 1,
+					IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! threads || ! tallies) {
+		fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
+		status = FINSUFFICIENT_MEMORY;
+		goto done;
+	}
+
+	for (t = 0; t < numThreads; t++) {
+		threads[t].fabricp = fabricp;
+		threads[t].ports = ports;
+		threads[t].numPorts = numPorts;
+		threads[t].first = t;
+		threads[t].stride = numThreads;
+		threads[t].fatTree = fatTree;
+		threads[t].base.tally = &tallies[numIndexes * t];
+		threads[t].base.isBaseLid = TRUE;
+		threads[t].lmc.tally = &tallies[numIndexes * t];
+		threads[t].lmc.isBaseLid = FALSE;
+	}
+
+#ifndef __VXWORKS__
+	if (numThreads > 1) {
+		pthread_t threadIds[TABULATE_MAX_THREADS];
+		uint32 started;
+
+		// thread 0 runs in caller's context
+		for (started = 1; started < numThreads; started++) {
+			if (pthread_create(&threadIds[started], NULL, TabulateThread, &threads[started]))
+				break;
+		}
+		// any thread which could not be started is run here
+		for (t = started; t < numThreads; t++)
+			(void)TabulateThread(&threads[t]);
+		(void)TabulateThread(&threads[0]);
+		for (t = 1; t < started; t++)
+			pthread_join(threadIds[t], NULL);
+	} else
+#endif
+		(void)TabulateThread(&threads[0]);
+
+	// reduce per-thread tallies into the ports
+	for (t = 0; t < numThreads; t++) {
+		if (threads[t].status == FUNAVAILABLE)
+			status = FUNAVAILABLE;
+		*totalPaths += threads[t].totalPaths;
+		*badPaths += threads[t].badPaths;
+	}
+	if (status != FSUCCESS)
+		goto done;
+	for (n=cl_qmap_head(&fabricp->AllNodes); n != cl_qmap_end(&fabricp->AllNodes); n = cl_qmap_next(n)) {
+		NodeData *nodep = PARENT_STRUCT(n, NodeData, AllNodesEntry);
+		for (p=cl_qmap_head(&nodep->Ports); p != cl_qmap_end(&nodep->Ports); p = cl_qmap_next(p)) {
+			PortData *portp = PARENT_STRUCT(p, PortData, NodePortsEntry);
+
+			for (t = 0; t < numThreads; t++) {
+				PortAnalysisData_t *datap = &tallies[numIndexes * t + portp->analysisIndex];
+
+				// both layouts are 4 counters, sum field by field
+				portp->analysisData.routes.recvBasePaths += datap->routes.recvBasePaths;
+				portp->analysisData.routes.xmitBasePaths += datap->routes.xmitBasePaths;
+				portp->analysisData.routes.recvAllPaths += datap->routes.recvAllPaths;
+				portp->analysisData.routes.xmitAllPaths += datap->routes.xmitAllPaths;
+			}
+		}
+	}
+
+done:
+	if (tallies)
+		MemoryDeallocate(tallies);
+	if (threads)
+		MemoryDeallocate(threads);
+	return status;
+}
+
 // tabulate all the routes between FIs
 FSTATUS TabulateCARoutes(FabricData_t *fabricp, Point *focus, uint32 *totalPaths,
 							uint32 *badPaths, boolean fatTree)
 {
 	LIST_ITERATOR i, j;
 	cl_map_item_t *p1, *p2;
-	LIST_ITEM *n1, *n2;
+	LIST_ITEM *n1;
 	FSTATUS status;
 	uint32 pathCount, badPathCount;
 	int noOfLeftNodes, noOfRightNodes;
+	PortData **ports;
+	uint32 numPorts = 0;
 
 	*totalPaths = 0;
 	*badPaths = 0;
 
 	ClearAnalysisData(fabricp);
+	(void)FabricDataCompileRouteTables(fabricp);
 
 	if (fatTree)
 		DetermineSwitchTiers(fabricp);
@@ -598,7 +846,7 @@ FSTATUS TabulateCARoutes(FabricData_t *fabricp, Point *focus, uint32 *totalPaths
 	/* If there is FI in the list, make N x N pairs and  tabulate routes for the formed pairs*/
 	}else if(PointHaveFI(focus)){
 		FIPortIterator a, b;
-		PortData *portp1, *portp2;
+		PortData *portp1;
 		//point type which haveFI and only matches 1 node is invalid and should return error
 		if((POINT_TYPE_PORT == focus->Type) || (POINT_TYPE_NODE == focus->Type) ||
 #if !defined(VXWORKS) || defined(BUILD_DMC)
@@ -611,18 +859,20 @@ FSTATUS TabulateCARoutes(FabricData_t *fabricp, Point *focus, uint32 *totalPaths
 			status = FINVALID_PARAMETER;
 			return status;
 		}
-		for(portp1 = FIPortIteratorHead(&a, focus); portp1 != NULL; portp1 = FIPortIteratorNext(&a) ) {
-			for(portp2 = FIPortIteratorHead(&b, focus); portp2 != NULL; portp2 = FIPortIteratorNext(&b) ) {
-				// skip loopback paths
-				if (portp1 == portp2)
-					continue;
-				status = TabulateRoutes(fabricp, portp1, portp2, &pathCount, &badPathCount, fatTree);
-				if (status == FUNAVAILABLE)
-					return status;
-				*totalPaths += pathCount;
-				*badPaths += badPathCount;
-			}
+		for(portp1 = FIPortIteratorHead(&a, focus); portp1 != NULL; portp1 = FIPortIteratorNext(&a) )
+			numPorts++;
+		ports = (PortData **)MemoryAllocate2AndClear(sizeof(PortData *)*(numPorts+1), IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+		if (! ports) {
+			fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
+			return FINSUFFICIENT_MEMORY;
 		}
+		numPorts = 0;
+		for(portp1 = FIPortIteratorHead(&b, focus); portp1 != NULL; portp1 = FIPortIteratorNext(&b) )
+			ports[numPorts++] = portp1;
+		status = TabulatePortRoutes(fabricp, ports, numPorts, totalPaths, badPaths, fatTree);
+		MemoryDeallocate(ports);
+		if (status != FSUCCESS)
+			return status;
 	} else {
 		// TBD - because IB is DLID routed, can save effort by getting routes from
 		// 1 FI per switch to all other FIs (or all FIs on other switches) and
@@ -632,28 +882,23 @@ FSTATUS TabulateCARoutes(FabricData_t *fabricp, Point *focus, uint32 *totalPaths
 		// finding FIs is not to high, maybe we can loop here based on all switches?
 		for (n1=QListHead(&fabricp->AllFIs); n1 != NULL; n1 = QListNext(&fabricp->AllFIs, n1)) {
 			NodeData *nodep1 = (NodeData *)QListObj(n1);
-			for (p1=cl_qmap_head(&nodep1->Ports); p1 != cl_qmap_end(&nodep1->Ports); p1 = cl_qmap_next(p1)) {
-				PortData *portp1 = PARENT_STRUCT(p1, PortData, NodePortsEntry);
-
-				for (n2=QListHead(&fabricp->AllFIs); n2 != NULL; n2 = QListNext(&fabricp->AllFIs, n2)) {
-					NodeData *nodep2 = (NodeData *)QListObj(n2);
-
-					// enable this if we want to skip node to self paths
-					//if (nodep1 == nodep2) continue;
-
-					for (p2=cl_qmap_head(&nodep2->Ports); p2 != cl_qmap_end(&nodep2->Ports); p2 = cl_qmap_next(p2)) {
-						PortData *portp2 = PARENT_STRUCT(p2, PortData, NodePortsEntry);
-						// skip loopback paths
-						if (portp1 == portp2) continue;
-							status = TabulateRoutes(fabricp, portp1, portp2, &pathCount, &badPathCount, fatTree);
-						if (status == FUNAVAILABLE)
-							return status;
-						*totalPaths += pathCount;
-						*badPaths += badPathCount;
-					}
-				}
-			}
+			numPorts += cl_qmap_count(&nodep1->Ports);
+		}
+		ports = (PortData **)MemoryAllocate2AndClear(sizeof(PortData *)*(numPorts+1), IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+		if (! ports) {
+			fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
+			return FINSUFFICIENT_MEMORY;
 		}
+		numPorts = 0;
+		for (n1=QListHead(&fabricp->AllFIs); n1 != NULL; n1 = QListNext(&fabricp->AllFIs, n1)) {
+			NodeData *nodep1 = (NodeData *)QListObj(n1);
+			for (p1=cl_qmap_head(&nodep1->Ports); p1 != cl_qmap_end(&nodep1->Ports); p1 = cl_qmap_next(p1))
+				ports[numPorts++] = PARENT_STRUCT(p1, PortData, NodePortsEntry);
+		}
+		status = TabulatePortRoutes(fabricp, ports, numPorts, totalPaths, badPaths, fatTree);
+		MemoryDeallocate(ports);
+		if (status != FSUCCESS)
+			return status;
 	}
 	return FSUCCESS;
 }
@@ -756,6 +1001,8 @@ FSTATUS ReportCARoutes(FabricData_t *fabricp,
 	cl_map_item_t *p1, *p2;
 	FSTATUS status;
 
+	(void)FabricDataCompileRouteTables(fabricp);
+
 	// TBD - because IB is DLID routed, can save effort by getting routes from
 	// 1 FI per switch to all other FIs (or all FIs on other switches) and
 	// then multiply the result for that FI by the number of FIs on that switch
@@ -993,6 +1240,8 @@ FSTATUS ValidateAllRoutes(FabricData_t *fabricp, EUI64 portGuid, uint8 rc,
 		}
 	}
 
+	(void)FabricDataCompileRouteTables(fabricp);
+
 	for (n1=cl_qmap_head(&fabricp->AllNodes); n1 != cl_qmap_end(&fabricp->AllNodes); n1 = cl_qmap_next(n1)) {
 		NodeData *nodep1 = PARENT_STRUCT(n1, NodeData, AllNodesEntry);
 		for (p1=cl_qmap_head(&nodep1->Ports); p1 != cl_qmap_end(&nodep1->Ports); p1 = cl_qmap_next(p1)) {
@@ -105,6 +105,8 @@ PortData * FindPortGuid(FabricData_t *fabricp, EUI64 guid)
 {
 	LIST_ITEM *p;
 
+	if (guid && FSUCCESS == PortGuidIndexUpdate(fabricp))
+		return (PortData *)GuidIndexFind(&fabricp->PortGuidIndex, guid);
 	for (p=QListHead(&fabricp->AllPorts); p != NULL; p = QListNext(&fabricp->AllPorts, p)) {
 		PortData *portp = (PortData *)QListObj(p);
 
@@ -292,6 +294,8 @@ NodeData * FindNodeGuid(const FabricData_t *fabricp, EUI64 guid)
 {
 	cl_map_item_t *mi;
 
+	if (guid && fabricp->NodeGuidIndex.Entries)
+		return (NodeData *)GuidIndexFind(&fabricp->NodeGuidIndex, guid);
 	mi = cl_qmap_get(&fabricp->AllNodes, guid);
 	if (mi == cl_qmap_end(&fabricp->AllNodes))
 		return NULL;
@@ -386,7 +390,19 @@ FSTATUS FindNodeNamePoint(FabricData_t *fabricp, char *name, Point *pPoint, uint
 	ASSERT(! PointValid(pPoint));
 	if (0 == find_flag)
 		return FINVALID_OPERATION;
-	if (find_flag & FIND_FLAG_FABRIC) {
+	if ((find_flag & FIND_FLAG_FABRIC) && fabricp->NodeNameIndex.Buckets) {
+		// index chains are in NodeGUID order, same as AllNodes
+		NodeData *nodep;
+		for (nodep = NodeNameIndexChain(fabricp, name); nodep; nodep = nodep->NodeNameNext) {
+			if (strncmp((char*)nodep->NodeDesc.NodeString,
+						name, STL_NODE_DESCRIPTION_ARRAY_SIZE) == 0)
+			{
+				status = PointListAppend(pPoint, POINT_TYPE_NODE_LIST, nodep);
+				if (FSUCCESS != status)
+					return status;
+			}
+		}
+	} else if (find_flag & FIND_FLAG_FABRIC) {
 		cl_map_item_t *p;
 		for (p=cl_qmap_head(&fabricp->AllNodes); p != cl_qmap_end(&fabricp->AllNodes); p = cl_qmap_next(p)) {
 			NodeData *nodep = PARENT_STRUCT(p, NodeData, AllNodesEntry);
@@ -460,6 +476,298 @@ FSTATUS FindNodeNamePoint(FabricData_t *fabricp, char *name, Point *pPoint, uint
 
 #ifndef __VXWORKS__
 
+// Precompiled form of an fnmatch() pattern.  The literal text ahead of the
+// first wildcard and after the last one lets most candidate strings be
+// rejected with a memcmp, and patterns without wildcards never reach fnmatch.
+typedef struct TopPattern_s {
+	const char	*pattern;
+	unsigned	prefix_len;	// literal chars before first wildcard
+	const char	*suffix;	// literal chars after last wildcard
+	unsigned	suffix_len;
+	boolean		literal;	// no wildcards, exact string compare
+} TopPattern_t;
+
+static void TopPatternCompile(TopPattern_t *pat, const char *pattern)
+{
+	size_t len = strlen(pattern);
+	const char *p;
+
+	pat->pattern = pattern;
+	pat->prefix_len = (unsigned)strcspn(pattern, "*?[\\");
+	pat->literal = (pat->prefix_len == len);
+	// ']' also stops the suffix so a bracket expression is never treated
+	// as literal text
+	for (p = pattern + len; p > pattern + pat->prefix_len
+						&& ! strchr("*?[]\\", p[-1]); p--)
+		;
+	pat->suffix = p;
+	pat->suffix_len = pat->literal ? 0 : (unsigned)(pattern + len - p);
+}
+
+static boolean TopPatternMatch(const TopPattern_t *pat, const char *str)
+{
+	size_t len;
+
+	if (strncmp(str, pat->pattern, pat->prefix_len) != 0)
+		return FALSE;
+	if (pat->literal)
+		return (str[pat->prefix_len] == '\0');
+	if (pat->suffix_len) {
+		len = strlen(str);
+		if (len < pat->prefix_len + pat->suffix_len
+			|| memcmp(str + len - pat->suffix_len, pat->suffix, pat->suffix_len) != 0)
+			return FALSE;
+	}
+	return (fnmatch(pat->pattern, str, 0) == 0);
+}
+
+// Index of the distinct literal prefixes of a list of patterns, kept in
+// string order.  Each prefix is linked to the longest other prefix in the
+// index which is a prefix of it, so every prefix of a given string can be
+// found with one binary search and a walk up the parent links, the same
+// set a walk down a trie of the prefixes would visit.
+typedef struct TopPatternPrefix_s {
+	const char	*prefix;
+	unsigned	len;
+	int32		parent;		// enclosing prefix, -1 if none
+	uint32		first;		// first entry in TopPatternIndex_t.order
+	uint32		count;		// patterns sharing this prefix
+} TopPatternPrefix_t;
+
+typedef struct TopPatternIndex_s {
+	TopPattern_t		*patterns;
+	uint32				count;
+	TopPattern_t		**order;	// patterns grouped by prefix
+	TopPatternPrefix_t	*prefixes;
+	uint32				num_prefixes;
+} TopPatternIndex_t;
+
+// a match of patterns[pattern] against object
+typedef struct TopPatternHit_s {
+	uint32	pattern;
+	void	*object;
+} TopPatternHit_t;
+
+typedef struct TopPatternHits_s {
+	TopPatternHit_t	*hits;
+	uint32			count;
+	uint32			size;
+} TopPatternHits_t;
+
+static int TopPrefixCompare(const char *a, unsigned alen, const char *b, unsigned blen)
+{
+	int res = memcmp(a, b, MIN(alen, blen));
+
+	if (res)
+		return res;
+	return (alen < blen) ? -1 : (alen > blen);
+}
+
+static int TopPatternOrderCompare(const void *a, const void *b)
+{
+	const TopPattern_t *pa = *(TopPattern_t * const *)a;
+	const TopPattern_t *pb = *(TopPattern_t * const *)b;
+	int res = TopPrefixCompare(pa->pattern, pa->prefix_len, pb->pattern, pb->prefix_len);
+
+	if (res)
+		return res;
+	// keep patterns with the same prefix in list order
+	return (pa < pb) ? -1 : (pa > pb);
+}
+
+static void TopPatternIndexDestroy(TopPatternIndex_t *index)
+{
+	if (index->patterns)
+		MemoryDeallocate(index->patterns);
+	if (index->order)
+		MemoryDeallocate(index->order);
+	if (index->prefixes)
+		MemoryDeallocate(index->prefixes);
+	MemoryClear(index, sizeof(*index));
+}
+
+static FSTATUS TopPatternIndexBuild(TopPatternIndex_t *index, char **patterns, uint32 count)
+{
+	int32 *stack;
+	uint32 i, depth = 0;
+
+	MemoryClear(index, sizeof(*index));
+	index->patterns = (TopPattern_t *)MemoryAllocate2AndClear(
+						sizeof(TopPattern_t)*count+1, IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	index->order = (TopPattern_t **)MemoryAllocate2AndClear(
+						sizeof(TopPattern_t *)*count+1, IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	index->prefixes = (TopPatternPrefix_t *)MemoryAllocate2AndClear(
+						sizeof(TopPatternPrefix_t)*count+1, IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! index->patterns || ! index->order || ! index->prefixes)
+		goto fail;
+	index->count = count;
+	for (i=0; i < count; i++) {
+		TopPatternCompile(&index->patterns[i], patterns[i]);
+		index->order[i] = &index->patterns[i];
+	}
+	qsort(index->order, count, sizeof(TopPattern_t *), TopPatternOrderCompare);
+
+	for (i=0; i < count; i++) {
+		TopPattern_t *pat = index->order[i];
+		TopPatternPrefix_t *prefixp;
+
+		if (index->num_prefixes) {
+			prefixp = &index->prefixes[index->num_prefixes-1];
+			if (prefixp->len == pat->prefix_len
+				&& memcmp(prefixp->prefix, pat->pattern, prefixp->len) == 0) {
+				prefixp->count++;
+				continue;
+			}
+		}
+		prefixp = &index->prefixes[index->num_prefixes++];
+		prefixp->prefix = pat->pattern;
+		prefixp->len = pat->prefix_len;
+		prefixp->first = i;
+		prefixp->count = 1;
+	}
+
+	// prefixes are in trie pre-order, so the enclosing prefixes of each
+	// entry are on a stack of the entries visited so far
+	stack = (int32 *)MemoryAllocate2AndClear(sizeof(int32)*index->num_prefixes+1,
+						IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! stack)
+		goto fail;
+	for (i=0; i < index->num_prefixes; i++) {
+		TopPatternPrefix_t *prefixp = &index->prefixes[i];
+
+		while (depth) {
+			TopPatternPrefix_t *top = &index->prefixes[stack[depth-1]];
+			if (top->len < prefixp->len
+				&& memcmp(top->prefix, prefixp->prefix, top->len) == 0)
+				break;
+			depth--;
+		}
+		prefixp->parent = depth ? stack[depth-1] : -1;
+		stack[depth++] = (int32)i;
+	}
+	MemoryDeallocate(stack);
+	return FSUCCESS;
+
+fail:
+	fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
+	TopPatternIndexDestroy(index);
+	return FINSUFFICIENT_MEMORY;
+}
+
+static FSTATUS TopPatternHitAdd(TopPatternHits_t *hits, uint32 pattern, void *object)
+{
+	if (hits->count == hits->size) {
+		uint32 size = hits->size ? hits->size * 2 : 1024;
+		TopPatternHit_t *newhits = (TopPatternHit_t *)MemoryAllocate2AndClear(
+						sizeof(TopPatternHit_t)*size, IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+		if (! newhits) {
+			fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
+			return FINSUFFICIENT_MEMORY;
+		}
+		if (hits->hits) {
+			MemoryCopy(newhits, hits->hits, sizeof(TopPatternHit_t)*hits->count);
+			MemoryDeallocate(hits->hits);
+		}
+		hits->hits = newhits;
+		hits->size = size;
+	}
+	hits->hits[hits->count].pattern = pattern;
+	hits->hits[hits->count].object = object;
+	hits->count++;
+	return FSUCCESS;
+}
+
+// record a hit for every pattern in the index which matches str
+static FSTATUS TopPatternIndexMatch(const TopPatternIndex_t *index, const char *str,
+						TopPatternHits_t *hits, void *object)
+{
+	unsigned len = (unsigned)strlen(str);
+	int32 lo = 0, hi = (int32)index->num_prefixes - 1, i = -1;
+	FSTATUS status;
+
+	// find the last prefix which sorts at or before str
+	while (lo <= hi) {
+		int32 mid = lo + (hi - lo)/2;
+		const TopPatternPrefix_t *prefixp = &index->prefixes[mid];
+
+		if (TopPrefixCompare(prefixp->prefix, prefixp->len, str, len) <= 0) {
+			i = mid;
+			lo = mid + 1;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	// every prefix of str is i or one of its parents
+	while (i >= 0 && ! (index->prefixes[i].len <= len
+				&& memcmp(index->prefixes[i].prefix, str, index->prefixes[i].len) == 0))
+		i = index->prefixes[i].parent;
+	for (; i >= 0; i = index->prefixes[i].parent) {
+		const TopPatternPrefix_t *prefixp = &index->prefixes[i];
+		uint32 j;
+
+		for (j = prefixp->first; j < prefixp->first + prefixp->count; j++) {
+			const TopPattern_t *pat = index->order[j];
+
+			if (! pat->literal && pat->suffix_len
+				&& (len < pat->prefix_len + pat->suffix_len
+					|| memcmp(str + len - pat->suffix_len, pat->suffix, pat->suffix_len) != 0))
+				continue;
+			if (pat->literal ? (len == pat->prefix_len)
+						: (fnmatch(pat->pattern, str, 0) == 0)) {
+				status = TopPatternHitAdd(hits, (uint32)(pat - index->patterns), object);
+				if (FSUCCESS != status)
+					return status;
+			}
+		}
+	}
+	return FSUCCESS;
+}
+
+// stable sort of hits by pattern so they can be appended in the same order
+// as one search per pattern would, matched[] counts the hits per pattern
+static FSTATUS TopPatternHitsSort(TopPatternHits_t *hits, uint32 num_patterns, uint32 *matched)
+{
+	TopPatternHit_t *sorted;
+	uint32 *next;
+	uint32 i, pos = 0;
+
+	if (! hits->count)
+		return FSUCCESS;
+	sorted = (TopPatternHit_t *)MemoryAllocate2AndClear(
+						sizeof(TopPatternHit_t)*hits->size, IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	next = (uint32 *)MemoryAllocate2AndClear(sizeof(uint32)*num_patterns,
+						IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! sorted || ! next) {
+		fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
+		if (sorted)
+			MemoryDeallocate(sorted);
+		if (next)
+			MemoryDeallocate(next);
+		return FINSUFFICIENT_MEMORY;
+	}
+	for (i=0; i < hits->count; i++)
+		next[hits->hits[i].pattern]++;
+	for (i=0; i < num_patterns; i++) {
+		uint32 n = next[i];
+		matched[i] += n;
+		next[i] = pos;
+		pos += n;
+	}
+	for (i=0; i < hits->count; i++)
+		sorted[next[hits->hits[i].pattern]++] = hits->hits[i];
+	MemoryDeallocate(hits->hits);
+	MemoryDeallocate(next);
+	hits->hits = sorted;
+	return FSUCCESS;
+}
+
+static void TopPatternHitsDestroy(TopPatternHits_t *hits)
+{
+	if (hits->hits)
+		MemoryDeallocate(hits->hits);
+	MemoryClear(hits, sizeof(*hits));
+}
+
 /* append searched objects that match the pattern */
 FSTATUS PopoulateNodePatPairs(NodePairList_t *nodePatPairs, uint8 side, void *object)
 {
@@ -489,12 +797,14 @@ FSTATUS FindNodePatPairs(FabricData_t *fabricp, char *pattern, NodePairList_t *n
 								uint8 find_flag, uint8 side)
 {
 	FSTATUS status;
+	TopPattern_t pat;
 
 	if (0 == find_flag)
 		return FINVALID_OPERATION;
 
 	if (0 == side)
 		return FINVALID_OPERATION;
+	TopPatternCompile(&pat, pattern);
 
 	if (find_flag & FIND_FLAG_FABRIC){
 		cl_map_item_t *p;
@@ -502,7 +812,7 @@ FSTATUS FindNodePatPairs(FabricData_t *fabricp, char *pattern, NodePairList_t *n
 		for (p = cl_qmap_head(&fabricp->AllNodes); p != cl_qmap_end(&fabricp->AllNodes); p = cl_qmap_next(p)){
 			NodeData *nodep = PARENT_STRUCT(p, NodeData, AllNodesEntry);
 			/* find all SWs and FIs that match the pattern */
-			if (fnmatch(pattern, (char*)nodep->NodeDesc.NodeString, 0) == 0){
+			if (TopPatternMatch(&pat, (char*)nodep->NodeDesc.NodeString)){
 				status = PopoulateNodePatPairs(nodePatPairs, side, nodep);
 				if (FSUCCESS != status)
 					return status;
@@ -530,6 +840,21 @@ FSTATUS FindNodeNamePatPoint(FabricData_t *fabricp, char *pattern, Point *pPoint
 	return status;
 }
 
+static FSTATUS NodeNamePatAppend(Point *pPoint, NodeData *nodep)
+{
+	FSTATUS status;
+
+	status = PointListAppend(pPoint, POINT_TYPE_NODE_LIST, nodep);
+	if (FSUCCESS != status)
+		return status;
+	//Set flag if the node is a switch or FI
+	if (nodep->NodeInfo.NodeType == STL_NODE_SW)
+		pPoint->haveSW = TRUE;
+	else if (nodep->NodeInfo.NodeType == STL_NODE_FI)
+		pPoint->haveFI = TRUE;
+	return FSUCCESS;
+}
+
 // search for the NodeData, ExpectedNode and ExpectedSM
 // corresponding to the given node name pattern
 // FNOT_FOUND - no instances found
@@ -538,24 +863,33 @@ FSTATUS FindNodeNamePatPoint(FabricData_t *fabricp, char *pattern, Point *pPoint
 FSTATUS FindNodeNamePatPointUncompress(FabricData_t *fabricp, char *pattern, Point *pPoint, uint8 find_flag)
 {
 	FSTATUS status;
+	TopPattern_t pat;
 
 	ASSERT(pPoint);
 	if (0 == find_flag)
 		return FINVALID_OPERATION;
-	if (find_flag & FIND_FLAG_FABRIC) {
+	TopPatternCompile(&pat, pattern);
+	if ((find_flag & FIND_FLAG_FABRIC) && pat.literal
+		&& fabricp->NodeNameIndex.Buckets) {
+		// no wildcards, only nodes in the name's hash chain can match
+		NodeData *nodep;
+		for (nodep = NodeNameIndexChain(fabricp, pattern); nodep; nodep = nodep->NodeNameNext) {
+			if (TopPatternMatch(&pat, (char*)nodep->NodeDesc.NodeString))
+			{
+				status = NodeNamePatAppend(pPoint, nodep);
+				if (FSUCCESS != status)
+					return status;
+			}
+		}
+	} else if (find_flag & FIND_FLAG_FABRIC) {
 		cl_map_item_t *p;
 		for (p=cl_qmap_head(&fabricp->AllNodes); p != cl_qmap_end(&fabricp->AllNodes); p = cl_qmap_next(p)) {
 			NodeData *nodep = PARENT_STRUCT(p, NodeData, AllNodesEntry);
-			if (fnmatch(pattern, (char*)nodep->NodeDesc.NodeString, 0) == 0)
+			if (TopPatternMatch(&pat, (char*)nodep->NodeDesc.NodeString))
 			{
-				status = PointListAppend(pPoint, POINT_TYPE_NODE_LIST, nodep);
+				status = NodeNamePatAppend(pPoint, nodep);
 				if (FSUCCESS != status)
 					return status;
-				//Set flag if the node is a switch or FI
-				if (nodep->NodeInfo.NodeType == STL_NODE_SW)
-					pPoint->haveSW = TRUE;
-				else if (nodep->NodeInfo.NodeType == STL_NODE_FI)
-					pPoint->haveFI = TRUE;
 			}
 		}
 	}
@@ -566,7 +900,7 @@ FSTATUS FindNodeNamePatPointUncompress(FabricData_t *fabricp, char *pattern, Poi
 			for (p=QListHead(pList); p != NULL; p = QListNext(pList, p)) {
 				ExpectedNode *enodep = (ExpectedNode *)QListObj(p);
 				if (enodep->NodeDesc
-					&& 0 == fnmatch(pattern, enodep->NodeDesc, 0))
+					&& TopPatternMatch(&pat, enodep->NodeDesc))
 				{
 					status = PointEnodeListAppend(pPoint, POINT_ENODE_TYPE_NODE_LIST, enodep);
 					if (FSUCCESS != status)
@@ -584,7 +918,7 @@ FSTATUS FindNodeNamePatPointUncompress(FabricData_t *fabricp, char *pattern, Poi
 		for (p=QListHead(&fabricp->ExpectedSMs); p != NULL; p = QListNext(&fabricp->ExpectedSMs, p)) {
 			ExpectedSM *esmp = (ExpectedSM *)QListObj(p);
 			if (esmp->NodeDesc
-				&& 0 == fnmatch(pattern, esmp->NodeDesc, 0))
+				&& TopPatternMatch(&pat, esmp->NodeDesc))
 			{
 				status = PointEsmListAppend(pPoint, POINT_ESM_TYPE_SM_LIST, esmp);
 				if (FSUCCESS != status)
@@ -597,9 +931,9 @@ FSTATUS FindNodeNamePatPointUncompress(FabricData_t *fabricp, char *pattern, Poi
 		for (p=QListHead(&fabricp->ExpectedLinks); p != NULL; p = QListNext(&fabricp->ExpectedLinks, p)) {
 			ExpectedLink *elinkp = (ExpectedLink *)QListObj(p);
 			if ((elinkp->portselp1 && elinkp->portselp1->NodeDesc
-					&& 0 == fnmatch(pattern, elinkp->portselp1->NodeDesc, 0))
+					&& TopPatternMatch(&pat, elinkp->portselp1->NodeDesc))
 				|| (elinkp->portselp2 && elinkp->portselp2->NodeDesc
-					&& 0 == fnmatch(pattern, elinkp->portselp2->NodeDesc, 0)))
+					&& TopPatternMatch(&pat, elinkp->portselp2->NodeDesc)))
 			{
 				status = PointElinkListAppend(pPoint, POINT_ELINK_TYPE_LINK_LIST, elinkp);
 				if (FSUCCESS != status)
@@ -615,6 +949,150 @@ FSTATUS FindNodeNamePatPointUncompress(FabricData_t *fabricp, char *pattern, Poi
 	return FSUCCESS;
 }
 
+// search for the NodeData, ExpectedNode, ExpectedSM and ExpectedLink
+// corresponding to any of the given node name patterns.
+// Equivalent to calling FindNodeNamePatPointUncompress for each pattern in
+// turn, including the order of the resulting lists and which patterns are
+// reported as Not Found, but each list is only scanned once with all the
+// patterns tested against every entry.
+// FNOT_FOUND - no instances found
+// FINVALID_OPERATION - find_flag contains no applicable searches
+// other - error allocating memory or initializing structures
+FSTATUS FindNodeNamePatListPoint(FabricData_t *fabricp, char **patterns, uint32 count, Point *pPoint, uint8 find_flag)
+{
+	FSTATUS status;
+	TopPatternIndex_t index;
+	TopPatternHits_t hits;
+	uint32 *matched;
+	uint32 i;
+	boolean wasValid;
+
+	ASSERT(pPoint);
+	if (0 == find_flag)
+		return FINVALID_OPERATION;
+	wasValid = PointValid(pPoint);
+	matched = (uint32 *)MemoryAllocate2AndClear(sizeof(uint32)*count+1,
+						IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! matched) {
+		fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
+		return FINSUFFICIENT_MEMORY;
+	}
+	status = TopPatternIndexBuild(&index, patterns, count);
+	if (FSUCCESS != status) {
+		MemoryDeallocate(matched);
+		return status;
+	}
+	MemoryClear(&hits, sizeof(hits));
+
+	if (find_flag & FIND_FLAG_FABRIC) {
+		cl_map_item_t *p;
+		for (p=cl_qmap_head(&fabricp->AllNodes); p != cl_qmap_end(&fabricp->AllNodes); p = cl_qmap_next(p)) {
+			NodeData *nodep = PARENT_STRUCT(p, NodeData, AllNodesEntry);
+			status = TopPatternIndexMatch(&index, (char*)nodep->NodeDesc.NodeString, &hits, nodep);
+			if (FSUCCESS != status)
+				goto done;
+		}
+		status = TopPatternHitsSort(&hits, count, matched);
+		if (FSUCCESS != status)
+			goto done;
+		for (i=0; i < hits.count; i++) {
+			status = NodeNamePatAppend(pPoint, (NodeData *)hits.hits[i].object);
+			if (FSUCCESS != status)
+				goto done;
+		}
+		hits.count = 0;
+	}
+	if (find_flag & FIND_FLAG_ENODE) {
+		LIST_ITEM *p;
+		QUICK_LIST *pList = &fabricp->ExpectedFIs;
+		while (pList != NULL) {
+			for (p=QListHead(pList); p != NULL; p = QListNext(pList, p)) {
+				ExpectedNode *enodep = (ExpectedNode *)QListObj(p);
+				if (enodep->NodeDesc) {
+					status = TopPatternIndexMatch(&index, enodep->NodeDesc, &hits, enodep);
+					if (FSUCCESS != status)
+						goto done;
+				}
+			}
+			if (pList == &fabricp->ExpectedFIs)
+				pList = &fabricp->ExpectedSWs;
+			else
+				pList = NULL;
+		}
+		status = TopPatternHitsSort(&hits, count, matched);
+		if (FSUCCESS != status)
+			goto done;
+		for (i=0; i < hits.count; i++) {
+			status = PointEnodeListAppend(pPoint, POINT_ENODE_TYPE_NODE_LIST, hits.hits[i].object);
+			if (FSUCCESS != status)
+				goto done;
+		}
+		hits.count = 0;
+	}
+	if (find_flag & FIND_FLAG_ESM) {
+		LIST_ITEM *p;
+		for (p=QListHead(&fabricp->ExpectedSMs); p != NULL; p = QListNext(&fabricp->ExpectedSMs, p)) {
+			ExpectedSM *esmp = (ExpectedSM *)QListObj(p);
+			if (esmp->NodeDesc) {
+				status = TopPatternIndexMatch(&index, esmp->NodeDesc, &hits, esmp);
+				if (FSUCCESS != status)
+					goto done;
+			}
+		}
+		status = TopPatternHitsSort(&hits, count, matched);
+		if (FSUCCESS != status)
+			goto done;
+		for (i=0; i < hits.count; i++) {
+			status = PointEsmListAppend(pPoint, POINT_ESM_TYPE_SM_LIST, hits.hits[i].object);
+			if (FSUCCESS != status)
+				goto done;
+		}
+		hits.count = 0;
+	}
+	if (find_flag & FIND_FLAG_ELINK) {
+		LIST_ITEM *p;
+		for (p=QListHead(&fabricp->ExpectedLinks); p != NULL; p = QListNext(&fabricp->ExpectedLinks, p)) {
+			ExpectedLink *elinkp = (ExpectedLink *)QListObj(p);
+			if (elinkp->portselp1 && elinkp->portselp1->NodeDesc) {
+				status = TopPatternIndexMatch(&index, elinkp->portselp1->NodeDesc, &hits, elinkp);
+				if (FSUCCESS != status)
+					goto done;
+			}
+			if (elinkp->portselp2 && elinkp->portselp2->NodeDesc) {
+				status = TopPatternIndexMatch(&index, elinkp->portselp2->NodeDesc, &hits, elinkp);
+				if (FSUCCESS != status)
+					goto done;
+			}
+		}
+		status = TopPatternHitsSort(&hits, count, matched);
+		if (FSUCCESS != status)
+			goto done;
+		for (i=0; i < hits.count; i++) {
+			// a link whose two sides both match a pattern is added once,
+			// its two hits are adjacent after the sort
+			if (i && hits.hits[i].pattern == hits.hits[i-1].pattern
+				&& hits.hits[i].object == hits.hits[i-1].object)
+				continue;
+			status = PointElinkListAppend(pPoint, POINT_ELINK_TYPE_LINK_LIST, hits.hits[i].object);
+			if (FSUCCESS != status)
+				goto done;
+		}
+		hits.count = 0;
+	}
+	// one at a time, a pattern is only reported while pPoint is still empty,
+	// so only the unmatched patterns before the first match are reported
+	for (i=0; i < count && ! wasValid && ! matched[i]; i++)
+		fprintf(stderr, "%s: Node name pattern Not Found: %s\n",
+						g_Top_cmdname, patterns[i]);
+	status = PointValid(pPoint) ? FSUCCESS : FNOT_FOUND;
+
+done:
+	TopPatternHitsDestroy(&hits);
+	TopPatternIndexDestroy(&index);
+	MemoryDeallocate(matched);
+	return status;
+}
+
 // search for nodes whose ExpectedNode has the given node details
 // FNOT_FOUND - no instances found
 // FINVALID_OPERATION - find_flag contains no applicable searches
@@ -622,16 +1100,18 @@ FSTATUS FindNodeNamePatPointUncompress(FabricData_t *fabricp, char *pattern, Poi
 FSTATUS FindNodeDetailsPatPoint(FabricData_t *fabricp, const char* pattern, Point *pPoint, uint8 find_flag)
 {
 	FSTATUS status;
+	TopPattern_t pat;
 
 	ASSERT(! PointValid(pPoint));
 	if (0 == (find_flag & (FIND_FLAG_FABRIC|FIND_FLAG_ENODE)))
 		return FINVALID_OPERATION;
+	TopPatternCompile(&pat, pattern);
 	if (find_flag & FIND_FLAG_FABRIC) {
 		cl_map_item_t *p;
 		for (p=cl_qmap_head(&fabricp->AllNodes); p != cl_qmap_end(&fabricp->AllNodes); p = cl_qmap_next(p)) {
 			NodeData *nodep = PARENT_STRUCT(p, NodeData, AllNodesEntry);
 			if (nodep->enodep && nodep->enodep->details
-				&& fnmatch(pattern, nodep->enodep->details, 0) == 0)
+				&& TopPatternMatch(&pat, nodep->enodep->details))
 			{
 				status = PointListAppend(pPoint, POINT_TYPE_NODE_LIST, nodep);
 				if (FSUCCESS != status)
@@ -646,7 +1126,7 @@ FSTATUS FindNodeDetailsPatPoint(FabricData_t *fabricp, const char* pattern, Poin
 			for (p=QListHead(pList); p != NULL; p = QListNext(pList, p)) {
 				ExpectedNode *enodep = (ExpectedNode *)QListObj(p);
 				if (enodep->details
-					&& fnmatch(pattern, enodep->details, 0) == 0)
+					&& TopPatternMatch(&pat, enodep->details))
 				{
 					status = PointEnodeListAppend(pPoint, POINT_ENODE_TYPE_NODE_LIST, enodep);
 					if (FSUCCESS != status)
@@ -792,10 +1272,12 @@ FSTATUS FindIocNamePoint(FabricData_t *fabricp, char *name, Point *pPoint, uint8
 FSTATUS FindIocNamePatPoint(FabricData_t *fabricp, char *pattern, Point *pPoint, uint8 find_flag)
 {
 	FSTATUS status;
+	TopPattern_t pat;
 
 	ASSERT(! PointValid(pPoint));
 	if (0 == (find_flag & FIND_FLAG_FABRIC))
 		return FINVALID_OPERATION;
+	TopPatternCompile(&pat, pattern);
 	if (find_flag & FIND_FLAG_FABRIC) {
 		cl_map_item_t *p;
 		for (p=cl_qmap_head(&fabricp->AllIOCs); p != cl_qmap_end(&fabricp->AllIOCs); p = cl_qmap_next(p)) {
@@ -804,7 +1286,7 @@ FSTATUS FindIocNamePatPoint(FabricData_t *fabricp, char *pattern, Point *pPoint,
 
 			strncpy(Name, (char*)iocp->IocProfile.IDString, IOC_IDSTRING_SIZE);
 			Name[IOC_IDSTRING_SIZE] = '\0';
-			if (fnmatch(pattern, Name, 0) == 0)
+			if (TopPatternMatch(&pat, Name))
 			{
 				status = PointListAppend(pPoint, POINT_TYPE_IOC_LIST, iocp);
 				if (FSUCCESS != status)
@@ -1152,10 +1634,12 @@ FSTATUS FindPortPhysStatePoint(FabricData_t *fabricp, IB_PORT_PHYS_STATE physsta
 FSTATUS FindCableLabelPatPoint(FabricData_t *fabricp, const char* pattern, Point *pPoint, uint8 find_flag)
 {
 	FSTATUS status;
+	TopPattern_t pat;
 
 	ASSERT(! PointValid(pPoint));
 	if (0 == (find_flag & (FIND_FLAG_FABRIC|FIND_FLAG_ELINK)))
 		return FINVALID_OPERATION;
+	TopPatternCompile(&pat, pattern);
 	if (find_flag & FIND_FLAG_FABRIC) {
 		LIST_ITEM *p;
 		for (p=QListHead(&fabricp->AllPorts); p != NULL; p = QListNext(&fabricp->AllPorts, p)) {
@@ -1163,7 +1647,7 @@ FSTATUS FindCableLabelPatPoint(FabricData_t *fabricp, const char* pattern, Point
 
 			if (! portp->elinkp || ! portp->elinkp->CableData.label)
 				continue;	// no cable information
-			if (fnmatch(pattern, portp->elinkp->CableData.label, 0) == 0)
+			if (TopPatternMatch(&pat, portp->elinkp->CableData.label))
 			{
 				status = PointListAppend(pPoint, POINT_TYPE_PORT_LIST, portp);
 				if (FSUCCESS != status)
@@ -1179,7 +1663,7 @@ FSTATUS FindCableLabelPatPoint(FabricData_t *fabricp, const char* pattern, Point
 			ExpectedLink *elinkp = (ExpectedLink *)QListObj(p);
 			if (! elinkp->CableData.label)
 				continue;	// no cable information
-			if (fnmatch(pattern, elinkp->CableData.label, 0) == 0)
+			if (TopPatternMatch(&pat, elinkp->CableData.label))
 			{
 				status = PointElinkListAppend(pPoint, POINT_ELINK_TYPE_LINK_LIST, elinkp);
 				if (FSUCCESS != status)
@@ -1204,10 +1688,12 @@ FSTATUS FindCableLabelPatPoint(FabricData_t *fabricp, const char* pattern, Point
 FSTATUS FindCableLenPatPoint(FabricData_t *fabricp, const char* pattern, Point *pPoint, uint8 find_flag)
 {
 	FSTATUS status;
+	TopPattern_t pat;
 
 	ASSERT(! PointValid(pPoint));
 	if (0 == (find_flag & (FIND_FLAG_FABRIC|FIND_FLAG_ELINK)))
 		return FINVALID_OPERATION;
+	TopPatternCompile(&pat, pattern);
 	if (find_flag & FIND_FLAG_FABRIC) {
 		LIST_ITEM *p;
 		for (p=QListHead(&fabricp->AllPorts); p != NULL; p = QListNext(&fabricp->AllPorts, p)) {
@@ -1215,7 +1701,7 @@ FSTATUS FindCableLenPatPoint(FabricData_t *fabricp, const char* pattern, Point *
 
 			if (! portp->elinkp || ! portp->elinkp->CableData.length)
 				continue;	// no cable information
-			if (fnmatch(pattern, portp->elinkp->CableData.length, 0) == 0)
+			if (TopPatternMatch(&pat, portp->elinkp->CableData.length))
 			{
 				status = PointListAppend(pPoint, POINT_TYPE_PORT_LIST, portp);
 				if (FSUCCESS != status)
@@ -1232,7 +1718,7 @@ FSTATUS FindCableLenPatPoint(FabricData_t *fabricp, const char* pattern, Point *
 			ExpectedLink *elinkp = (ExpectedLink *)QListObj(p);
 			if (! elinkp->CableData.length)
 				continue;	// no cable information
-			if (fnmatch(pattern, elinkp->CableData.length, 0) == 0)
+			if (TopPatternMatch(&pat, elinkp->CableData.length))
 			{
 				status = PointElinkListAppend(pPoint, POINT_ELINK_TYPE_LINK_LIST, elinkp);
 				if (FSUCCESS != status)
@@ -1256,17 +1742,19 @@ FSTATUS FindCableLenPatPoint(FabricData_t *fabricp, const char* pattern, Point *
 FSTATUS FindCableDetailsPatPoint(FabricData_t *fabricp, const char* pattern, Point *pPoint, uint8 find_flag)
 {
 	FSTATUS status;
+	TopPattern_t pat;
 
 	ASSERT(! PointValid(pPoint));
 	if (0 == (find_flag & (FIND_FLAG_FABRIC|FIND_FLAG_ELINK)))
 		return FINVALID_OPERATION;
+	TopPatternCompile(&pat, pattern);
 	if (find_flag & FIND_FLAG_FABRIC) {
 		LIST_ITEM *p;
 		for (p=QListHead(&fabricp->AllPorts); p != NULL; p = QListNext(&fabricp->AllPorts, p)) {
 			PortData *portp = (PortData *)QListObj(p);
 
 			if (portp->elinkp && portp->elinkp->CableData.details
-				&& fnmatch(pattern, portp->elinkp->CableData.details, 0) == 0)
+				&& TopPatternMatch(&pat, portp->elinkp->CableData.details))
 			{
 				status = PointListAppend(pPoint, POINT_TYPE_PORT_LIST, portp);
 				if (FSUCCESS != status)
@@ -1282,7 +1770,7 @@ FSTATUS FindCableDetailsPatPoint(FabricData_t *fabricp, const char* pattern, Poi
 		for (p=QListHead(&fabricp->ExpectedLinks); p != NULL; p = QListNext(&fabricp->ExpectedLinks, p)) {
 			ExpectedLink *elinkp = (ExpectedLink *)QListObj(p);
 			if (elinkp->CableData.details
-				&& fnmatch(pattern, elinkp->CableData.details, 0) == 0)
+				&& TopPatternMatch(&pat, elinkp->CableData.details))
 			{
 				status = PointElinkListAppend(pPoint, POINT_ELINK_TYPE_LINK_LIST, elinkp);
 				if (FSUCCESS != status)
@@ -1306,6 +1794,7 @@ FSTATUS FindCableDetailsPatPoint(FabricData_t *fabricp, const char* pattern, Poi
 FSTATUS FindCabinfLenPatPoint(FabricData_t *fabricp, const char* pattern, Point *pPoint, uint8 find_flag)
 {
 	FSTATUS status;
+	TopPattern_t pat;
 	char *cur, scrubbed_pat[strlen(pattern) + 1];
 	char cablen_str[10] = {0}; // strlen("255") + 1 = 4
 	int cableInfoHighPageAddressOffset;
@@ -1319,6 +1808,7 @@ FSTATUS FindCabinfLenPatPoint(FabricData_t *fabricp, const char* pattern, Point
 	snprintf(scrubbed_pat, sizeof(scrubbed_pat), "%s", pattern);
 	if (NULL != (cur = strchr(scrubbed_pat, 'm')))
 		*cur = '\0';
+	TopPatternCompile(&pat, scrubbed_pat);
 
 	if (find_flag & FIND_FLAG_FABRIC) {
 		LIST_ITEM *p;
@@ -1350,7 +1840,7 @@ FSTATUS FindCabinfLenPatPoint(FabricData_t *fabricp, const char* pattern, Point
 				StlCableInfoOM4LengthToText(pCableInfo->len_om4, cableLenValid, sizeof(cablen_str), cablen_str);
 				if (NULL != (cur = strchr(cablen_str, 'm')))
 					*cur = '\0';
-				if (fnmatch(scrubbed_pat, cablen_str, 0) != 0)
+				if (! TopPatternMatch(&pat, cablen_str))
 					continue;
 
 				status = PointListAppend(pPoint, POINT_TYPE_PORT_LIST, portp);
@@ -1363,7 +1853,7 @@ FSTATUS FindCabinfLenPatPoint(FabricData_t *fabricp, const char* pattern, Point
 				StlCableInfoDDCableLengthToText(pCableInfoDD->cableLengthEnc, cableLenValid, sizeof(cablen_str), cablen_str);
 				if (NULL != (cur = strchr(cablen_str, 'm')))
 					*cur = '\0';
-				if (fnmatch(scrubbed_pat, cablen_str, 0) != 0)
+				if (! TopPatternMatch(&pat, cablen_str))
 					continue;
 
 				status = PointListAppend(pPoint, POINT_TYPE_PORT_LIST, portp);
@@ -1392,6 +1882,7 @@ FSTATUS FindCabinfLenPatPoint(FabricData_t *fabricp, const char* pattern, Point
 FSTATUS FindCabinfVendNamePatPoint(FabricData_t *fabricp, const char* pattern, Point *pPoint, uint8 find_flag)
 {
 	FSTATUS status;
+	TopPattern_t pat;
 	uint32 len_pattern;
 	STL_CABLE_INFO_STD *pCableInfo;
 	STL_CABLE_INFO_UP0_DD *pCableInfoDD;
@@ -1409,6 +1900,7 @@ FSTATUS FindCabinfVendNamePatPoint(FabricData_t *fabricp, const char* pattern, P
 		bf_pattern[sizeof(pCableInfo->vendor_name)] = '\0';
 	else
 		bf_pattern[len_pattern] = '\0';
+	TopPatternCompile(&pat, bf_pattern);
 
 	if (find_flag & FIND_FLAG_FABRIC) {
 		LIST_ITEM *p;
@@ -1435,7 +1927,7 @@ FSTATUS FindCabinfVendNamePatPoint(FabricData_t *fabricp, const char* pattern, P
 				memcpy(tempStr, pCableInfoDD->vendor_name, sizeof(pCableInfoDD->vendor_name));
 				tempStr[sizeof(pCableInfoDD->vendor_name)] = '\0';
 			}
-			if (fnmatch(bf_pattern, (const char *)tempStr, 0) == 0)
+			if (TopPatternMatch(&pat, (const char *)tempStr))
 			{
 				status = PointListAppend(pPoint, POINT_TYPE_PORT_LIST, portp);
 				if (FSUCCESS != status)
@@ -1463,6 +1955,7 @@ FSTATUS FindCabinfVendNamePatPoint(FabricData_t *fabricp, const char* pattern, P
 FSTATUS FindCabinfVendPNPatPoint(FabricData_t *fabricp, const char* pattern, Point *pPoint, uint8 find_flag)
 {
 	FSTATUS status;
+	TopPattern_t pat;
 	uint32 len_pattern;
 	STL_CABLE_INFO_STD *pCableInfo;
 	STL_CABLE_INFO_UP0_DD *pCableInfoDD;
@@ -1480,6 +1973,7 @@ FSTATUS FindCabinfVendPNPatPoint(FabricData_t *fabricp, const char* pattern, Poi
 		bf_pattern[sizeof(pCableInfo->vendor_pn)] = '\0';
 	else
 		bf_pattern[len_pattern] = '\0';
+	TopPatternCompile(&pat, bf_pattern);
 
 	if (find_flag & FIND_FLAG_FABRIC) {
 		LIST_ITEM *p;
@@ -1506,7 +2000,7 @@ FSTATUS FindCabinfVendPNPatPoint(FabricData_t *fabricp, const char* pattern, Poi
 				memcpy(tempStr, pCableInfoDD->vendor_pn, sizeof(pCableInfoDD->vendor_pn));
 				tempStr[sizeof(pCableInfoDD->vendor_pn)] = '\0';
 			}
-			if (fnmatch(bf_pattern, (const char *)tempStr, 0) == 0)
+			if (TopPatternMatch(&pat, (const char *)tempStr))
 			{
 				status = PointListAppend(pPoint, POINT_TYPE_PORT_LIST, portp);
 				if (FSUCCESS != status)
@@ -1534,6 +2028,7 @@ FSTATUS FindCabinfVendPNPatPoint(FabricData_t *fabricp, const char* pattern, Poi
 FSTATUS FindCabinfVendRevPatPoint(FabricData_t *fabricp, const char* pattern, Point *pPoint, uint8 find_flag)
 {
 	FSTATUS status;
+	TopPattern_t pat;
 	uint32 len_pattern;
 	STL_CABLE_INFO_STD *pCableInfo;
 	STL_CABLE_INFO_UP0_DD *pCableInfoDD;
@@ -1551,6 +2046,7 @@ FSTATUS FindCabinfVendRevPatPoint(FabricData_t *fabricp, const char* pattern, Po
 		bf_pattern[sizeof(pCableInfo->vendor_rev)] = '\0';
 	else
 		bf_pattern[len_pattern] = '\0';
+	TopPatternCompile(&pat, bf_pattern);
 
 	if (find_flag & FIND_FLAG_FABRIC) {
 		LIST_ITEM *p;
@@ -1577,7 +2073,7 @@ FSTATUS FindCabinfVendRevPatPoint(FabricData_t *fabricp, const char* pattern, Po
 				memcpy(tempStr, pCableInfoDD->vendor_rev, sizeof(pCableInfoDD->vendor_rev));
 				tempStr[sizeof(pCableInfoDD->vendor_rev)] = '\0';
 			}
-			if (fnmatch(bf_pattern, (const char *)tempStr, 0) == 0)
+			if (TopPatternMatch(&pat, (const char *)tempStr))
 			{
 				status = PointListAppend(pPoint, POINT_TYPE_PORT_LIST, portp);
 				if (FSUCCESS != status)
@@ -1605,6 +2101,7 @@ FSTATUS FindCabinfVendRevPatPoint(FabricData_t *fabricp, const char* pattern, Po
 FSTATUS FindCabinfVendSNPatPoint(FabricData_t *fabricp, const char* pattern, Point *pPoint, uint8 find_flag)
 {
 	FSTATUS status;
+	TopPattern_t pat;
 	uint32 len_pattern;
 	STL_CABLE_INFO_STD *pCableInfo;
 	STL_CABLE_INFO_UP0_DD *pCableInfoDD;
@@ -1622,6 +2119,7 @@ FSTATUS FindCabinfVendSNPatPoint(FabricData_t *fabricp, const char* pattern, Poi
 		bf_pattern[sizeof(pCableInfo->vendor_sn)] = '\0';
 	else
 		bf_pattern[len_pattern] = '\0';
+	TopPatternCompile(&pat, bf_pattern);
 
 	if (find_flag & FIND_FLAG_FABRIC) {
 		LIST_ITEM *p;
@@ -1648,7 +2146,7 @@ FSTATUS FindCabinfVendSNPatPoint(FabricData_t *fabricp, const char* pattern, Poi
 				memcpy(tempStr, pCableInfoDD->vendor_sn, sizeof(pCableInfoDD->vendor_sn));
 				tempStr[sizeof(pCableInfoDD->vendor_sn)] = '\0';
 			}
-			if (fnmatch(bf_pattern, (const char *)tempStr, 0) == 0)
+			if (TopPatternMatch(&pat, (const char *)tempStr))
 			{
 				status = PointListAppend(pPoint, POINT_TYPE_PORT_LIST, portp);
 				if (FSUCCESS != status)
@@ -1760,15 +2258,17 @@ FSTATUS FindCabinfCableTypePoint(FabricData_t *fabricp, char *pattern, Point *pP
 FSTATUS FindLinkDetailsPatPoint(FabricData_t *fabricp, const char* pattern, Point *pPoint, uint8 find_flag)
 {
 	FSTATUS status;	
+	TopPattern_t pat;
 	ASSERT(! PointValid(pPoint));
 	if (0 == (find_flag & (FIND_FLAG_FABRIC|FIND_FLAG_ELINK)))
 		return FINVALID_OPERATION;
+	TopPatternCompile(&pat, pattern);
 	if (find_flag & FIND_FLAG_FABRIC) {
 		LIST_ITEM *p;
 		for (p=QListHead(&fabricp->AllPorts); p != NULL; p = QListNext(&fabricp->AllPorts, p)) {
 			PortData *portp = (PortData *)QListObj(p);
 			if (portp->elinkp && portp->elinkp->details
-				&& fnmatch(pattern, portp->elinkp->details, 0) == 0)
+				&& TopPatternMatch(&pat, portp->elinkp->details))
 			{
 				status = PointListAppend(pPoint, POINT_TYPE_PORT_LIST, portp);
 				if (FSUCCESS != status)
@@ -1783,7 +2283,7 @@ FSTATUS FindLinkDetailsPatPoint(FabricData_t *fabricp, const char* pattern, Poin
 		LIST_ITEM *p;
 		for (p=QListHead(&fabricp->ExpectedLinks); p != NULL; p = QListNext(&fabricp->ExpectedLinks, p)) {
 			ExpectedLink *elinkp = (ExpectedLink *)QListObj(p);
-			if (elinkp->details && fnmatch(pattern, elinkp->details, 0) == 0)
+			if (elinkp->details && TopPatternMatch(&pat, elinkp->details))
 			{
 				status = PointElinkListAppend(pPoint, POINT_ELINK_TYPE_LINK_LIST, elinkp);
 				if (FSUCCESS != status)
@@ -1807,10 +2307,12 @@ FSTATUS FindLinkDetailsPatPoint(FabricData_t *fabricp, const char* pattern, Poin
 FSTATUS FindPortDetailsPatPoint(FabricData_t *fabricp, const char* pattern, Point *pPoint, uint8 find_flag)
 {
 	FSTATUS status;
+	TopPattern_t pat;
 
 	ASSERT(! PointValid(pPoint));
 	if (0 == (find_flag & (FIND_FLAG_FABRIC|FIND_FLAG_ELINK)))
 		return FINVALID_OPERATION;
+	TopPatternCompile(&pat, pattern);
 	if (find_flag & FIND_FLAG_FABRIC) {
 		LIST_ITEM *p;
 		for (p=QListHead(&fabricp->AllPorts); p != NULL; p = QListNext(&fabricp->AllPorts, p)) {
@@ -1818,7 +2320,7 @@ FSTATUS FindPortDetailsPatPoint(FabricData_t *fabricp, const char* pattern, Poin
 			PortSelector *portselp = GetPortSelector(portp);
 
 			if (portselp && portselp->details
-				&& fnmatch(pattern, portselp->details, 0) == 0)
+				&& TopPatternMatch(&pat, portselp->details))
 			{
 				status = PointListAppend(pPoint, POINT_TYPE_PORT_LIST, portp);
 				if (FSUCCESS != status)
@@ -1834,9 +2336,9 @@ FSTATUS FindPortDetailsPatPoint(FabricData_t *fabricp, const char* pattern, Poin
 		for (p=QListHead(&fabricp->ExpectedLinks); p != NULL; p = QListNext(&fabricp->ExpectedLinks, p)) {
 			ExpectedLink *elinkp = (ExpectedLink *)QListObj(p);
 			if ((elinkp->portselp1 && elinkp->portselp1->details
-					&& fnmatch(pattern, elinkp->portselp1->details, 0) == 0)
+					&& TopPatternMatch(&pat, elinkp->portselp1->details))
 				|| (elinkp->portselp2 && elinkp->portselp2->details
-					&& fnmatch(pattern, elinkp->portselp2->details, 0) == 0))
+					&& TopPatternMatch(&pat, elinkp->portselp2->details)))
 			{
 				status = PointElinkListAppend(pPoint, POINT_ELINK_TYPE_LINK_LIST, elinkp);
 				if (FSUCCESS != status)
@@ -1926,17 +2428,19 @@ PortData * FindMasterSm(FabricData_t *fabricp)
 FSTATUS FindSmDetailsPatPoint(FabricData_t *fabricp, const char* pattern, Point *pPoint, uint8 find_flag)
 {
 	FSTATUS status;
+	TopPattern_t pat;
 
 	ASSERT(! PointValid(pPoint));
 	if (0 == (find_flag & (FIND_FLAG_FABRIC|FIND_FLAG_ESM)))
 		return FINVALID_OPERATION;
+	TopPatternCompile(&pat, pattern);
 	if (find_flag & FIND_FLAG_FABRIC) {
 		cl_map_item_t *p;
 		for (p=cl_qmap_head(&fabricp->AllSMs); p != cl_qmap_end(&fabricp->AllSMs); p = cl_qmap_next(p)) {
 			SMData *smp = PARENT_STRUCT(p, SMData, AllSMsEntry);
 			if (! smp->esmp || ! smp->esmp->details)
 				continue;	// no SM details information
-			if (fnmatch(pattern, smp->esmp->details, 0) == 0)
+			if (TopPatternMatch(&pat, smp->esmp->details))
 			{
 				status = PointListAppend(pPoint, POINT_TYPE_PORT_LIST, smp->portp);
 				if (FSUCCESS != status)
@@ -1953,7 +2457,7 @@ FSTATUS FindSmDetailsPatPoint(FabricData_t *fabricp, const char* pattern, Point
 			ExpectedSM *esmp = (ExpectedSM *)QListObj(p);
 			if (! esmp->details)
 				continue;	// no SM details information
-			if (fnmatch(pattern, esmp->details, 0) == 0)
+			if (TopPatternMatch(&pat, esmp->details))
 			{
 				status = PointEsmListAppend(pPoint, POINT_ESM_TYPE_SM_LIST, esmp);
 				if (FSUCCESS != status)
@@ -95,6 +95,17 @@ void PortStatusDataXmlOutputOptional(IXmlOutputState_t *state, const char *tag,
 	IXmlOutputOptionalStruct(state, tag, (STL_PORT_COUNTERS_DATA *)data, NULL, PortStatusDataFields);
 }
 
+static void *PortStatusDataXmlParserStart(IXmlParserState_t *state, void *parent, const char **attr)
+{
+	void *p = FabricDataAllocate(IXmlParserGetContext(state), sizeof(STL_PORT_COUNTERS_DATA));
+
+	if (! p) {
+		IXmlParserPrintError(state, "Unable to allocate memory");
+		return NULL;
+	}
+	return p;
+}
+
 static void PortStatusDataXmlParserEnd(IXmlParserState_t *state, const IXML_FIELD *field, void *object, void *parent, XML_Char *content, unsigned len, boolean valid)
 {
 	STL_PORT_COUNTERS_DATA *pPortCountersData = (STL_PORT_COUNTERS_DATA *)object;
@@ -114,7 +125,7 @@ static void PortStatusDataXmlParserEnd(IXmlParserState_t *state, const IXML_FIEL
 
 failinsert:
 failvalidate:
-	MemoryDeallocate(pPortCountersData);
+	FabricDataDeallocate(IXmlParserGetContext(state), pPortCountersData);
 }
 
 /****************************************************************************/
@@ -141,8 +152,8 @@ static void *SLtoSCMapXmlParserStart(IXmlParserState_t *state, void *parent, con
 	}
 
 	if (!pQOS) {
-		if ( !( pQOS = portp->pQOS = (QOSData *)MemoryAllocate2AndClear(
-				sizeof(QOSData), IBA_MEM_FLAG_PREMPTABLE, MYTAG ) ) ) {
+		if ( !( pQOS = portp->pQOS = (QOSData *)FabricDataAllocate(
+				IXmlParserGetContext(state), sizeof(QOSData)) ) ) {
 			IXmlParserPrintError(state, "Unable to allocate memory");
 			return (NULL);
 		}
@@ -153,8 +164,8 @@ static void *SLtoSCMapXmlParserStart(IXmlParserState_t *state, void *parent, con
 		return (NULL);
 	}
 
-	if ( !( pQOS->SL2SCMap = (STL_SLSCMAP *)MemoryAllocate2(
-			sizeof(STL_SLSCMAP), IBA_MEM_FLAG_PREMPTABLE, MYTAG ) ) ) {
+	if ( !( pQOS->SL2SCMap = (STL_SLSCMAP *)FabricDataAllocate(
+			IXmlParserGetContext(state), sizeof(STL_SLSCMAP) ) ) ) {
 		IXmlParserPrintError(state, "Unable to allocate memory");
 		return (NULL);
 	}
@@ -283,8 +294,8 @@ static void *SCtoSLMapXmlParserStart(IXmlParserState_t *state, void *parent, con
 	}
 
 	if (!pQOS) {
-		if ( !( pQOS = portp->pQOS = (QOSData *)MemoryAllocate2AndClear(
-				sizeof(QOSData), IBA_MEM_FLAG_PREMPTABLE, MYTAG ) ) ) {
+		if ( !( pQOS = portp->pQOS = (QOSData *)FabricDataAllocate(
+				IXmlParserGetContext(state), sizeof(QOSData)) ) ) {
 			IXmlParserPrintError(state, "Unable to allocate memory");
 			return (NULL);
 		}
@@ -295,8 +306,8 @@ static void *SCtoSLMapXmlParserStart(IXmlParserState_t *state, void *parent, con
 		return (NULL);
 	}
 
-	if ( !( pQOS->SC2SLMap = (STL_SCSLMAP *)MemoryAllocate2AndClear(
-			sizeof(STL_SCSLMAP), IBA_MEM_FLAG_PREMPTABLE, MYTAG ) ) ) {
+	if ( !( pQOS->SC2SLMap = (STL_SCSLMAP *)FabricDataAllocate(
+			IXmlParserGetContext(state), sizeof(STL_SCSLMAP) ) ) ) {
 		IXmlParserPrintError(state, "Unable to allocate memory");
 		return (NULL);
 	}
@@ -429,8 +440,8 @@ static void *SCtoSCMapXmlParserStart(IXmlParserState_t *state, void *parent, con
 	}
 
 	if (!pQOS) {
-		if ( !( pQOS = portp->pQOS = (QOSData *)MemoryAllocate2AndClear(
-				sizeof(QOSData), IBA_MEM_FLAG_PREMPTABLE, MYTAG ) ) ) {
+		if ( !( pQOS = portp->pQOS = (QOSData *)FabricDataAllocate(
+				IXmlParserGetContext(state), sizeof(QOSData)) ) ) {
 			IXmlParserPrintError(state, "Unable to allocate memory");
 			return (NULL);
 		}
@@ -439,7 +450,7 @@ static void *SCtoSCMapXmlParserStart(IXmlParserState_t *state, void *parent, con
 	QListInitState(&pQOS->SC2SCMapList[0]);
 	if (!QListInit(&pQOS->SC2SCMapList[0])) {
 		IXmlParserPrintError(state, "Unable to initialize SC2SCMaps list");
-		MemoryDeallocate(pQOS);
+		PortDataFreeQOSData(IXmlParserGetContext(state), portp);
 		return (NULL);
 	}
 
@@ -680,8 +691,8 @@ static void *SCtoVLxMapXmlParserStart(IXmlParserState_t *state, void *parent, co
 	}
 
 	if (!pQOS) {
-		if (!(pQOS = portp->pQOS = (QOSData*)MemoryAllocate2AndClear(
-				sizeof(QOSData), IBA_MEM_FLAG_PREMPTABLE, MYTAG ))) {
+		if (!(pQOS = portp->pQOS = (QOSData*)FabricDataAllocate(
+				IXmlParserGetContext(state), sizeof(QOSData)))) {
 			IXmlParserPrintError(state, "Unable to allocate memory");
 			return (NULL);
 		}
@@ -928,8 +939,8 @@ static void *VLArbLowXmlParserStart(IXmlParserState_t *state, void *parent, cons
 	QOSData *pQOS = portp->pQOS;
 
 	if (!pQOS) {
-		if ( !( pQOS = portp->pQOS = (QOSData *)MemoryAllocate2AndClear(
-				sizeof(QOSData), IBA_MEM_FLAG_PREMPTABLE, MYTAG ) ) ) {
+		if ( !( pQOS = portp->pQOS = (QOSData *)FabricDataAllocate(
+				IXmlParserGetContext(state), sizeof(QOSData)) ) ) {
 			IXmlParserPrintError(state, "Unable to allocate memory");
 			return (NULL);
 		}
@@ -972,8 +983,8 @@ static void *VLArbHighXmlParserStart(IXmlParserState_t *state, void *parent, con
 	QOSData *pQOS = portp->pQOS;
 
 	if (!pQOS) {
-		if ( !( pQOS = portp->pQOS = (QOSData *)MemoryAllocate2AndClear(
-				sizeof(QOSData), IBA_MEM_FLAG_PREMPTABLE, MYTAG ) ) ) {
+		if ( !( pQOS = portp->pQOS = (QOSData *)FabricDataAllocate(
+				IXmlParserGetContext(state), sizeof(QOSData)) ) ) {
 			IXmlParserPrintError(state, "Unable to allocate memory");
 			return (NULL);
 		}
@@ -1016,8 +1027,8 @@ static void *VLArbPreemptElementsXmlParserStart(IXmlParserState_t *state, void *
 	QOSData *pQOS = portp->pQOS;
 
 	if (!pQOS) {
-		if ( !( pQOS = portp->pQOS = (QOSData *)MemoryAllocate2AndClear(
-				sizeof(QOSData), IBA_MEM_FLAG_PREMPTABLE, MYTAG ) ) ) {
+		if ( !( pQOS = portp->pQOS = (QOSData *)FabricDataAllocate(
+				IXmlParserGetContext(state), sizeof(QOSData)) ) ) {
 			IXmlParserPrintError(state, "Unable to allocate memory");
 			return (NULL);
 		}
@@ -1059,8 +1070,8 @@ static void *VLArbPreemptMatrixXmlParserStart(IXmlParserState_t *state, void *pa
 	QOSData *pQOS = portp->pQOS;
 
 	if (!pQOS) {
-		if ( !( pQOS = portp->pQOS = (QOSData *)MemoryAllocate2AndClear(
-				sizeof(QOSData), IBA_MEM_FLAG_PREMPTABLE, MYTAG ) ) ) {
+		if ( !( pQOS = portp->pQOS = (QOSData *)FabricDataAllocate(
+				IXmlParserGetContext(state), sizeof(QOSData)) ) ) {
 			IXmlParserPrintError(state, "Unable to allocate memory");
 			return (NULL);
 		}
@@ -1178,8 +1189,8 @@ static void *PKeyTableXmlParserStart(IXmlParserState_t *state, void *parent, con
 	}
 	num_pkeys = PortPartitionTableSize(portp);
 
-	if ( !( pPartitionTable = portp->pPartitionTable = (STL_PKEY_ELEMENT *)MemoryAllocate2AndClear(
-			sizeof(STL_PKEY_ELEMENT) * num_pkeys, IBA_MEM_FLAG_PREMPTABLE, MYTAG ) ) ) {
+	if ( !( pPartitionTable = portp->pPartitionTable = (STL_PKEY_ELEMENT *)FabricDataAllocate(
+			IXmlParserGetContext(state), sizeof(STL_PKEY_ELEMENT) * num_pkeys ) ) ) {
 		IXmlParserPrintError(state, "Unable to allocate memory");
 		return (NULL);
 	}
@@ -2211,8 +2222,8 @@ static void *CableInfoXmlParserStart(IXmlParserState_t *state, void *parent, con
 		return (NULL);
 	}
 
-	if ( !( portp->pCableInfoData = MemoryAllocate2AndClear(
-			STL_CABLE_INFO_PAGESZ, IBA_MEM_FLAG_PREMPTABLE, MYTAG ) ) ) {
+	if ( !( portp->pCableInfoData = FabricDataAllocate(
+			IXmlParserGetContext(state), STL_CABLE_INFO_PAGESZ ) ) ) {
 		IXmlParserPrintError(state, "Unable to allocate memory");
 		return (NULL);
 	}
@@ -2947,7 +2958,7 @@ static IXML_FIELD PortDataFields[] = {
 	{ tag:"VLArbitrationPreemptElements", format:'k', format_func:PortDataXmlOutputVLArbPreemptElements, subfields:VLArbFields, start_func:VLArbPreemptElementsXmlParserStart, end_func:VLArbPreemptElementsXmlParserEnd },
 	{ tag:"VLArbitrationPreemptMatrix", format:'k', format_func:PortDataXmlOutputVLArbPreemptMatrix, subfields:VLArbPreemptMatrixFields, start_func:VLArbPreemptMatrixXmlParserStart, end_func:VLArbPreemptMatrixXmlParserEnd },
 	{ tag:"PKeyTable", format:'k', format_func:PortDataXmlOutputPKeyTable, subfields:PKeyTableFields, start_func:PKeyTableXmlParserStart, end_func:PKeyTableXmlParserEnd }, // structure
-	{ tag:"PortStatus", format:'k', size:sizeof(STL_PORT_COUNTERS_DATA), format_func:PortDataXmlOutputPortStatusData, subfields:PortStatusDataFields, start_func:IXmlParserStartStruct, end_func:PortStatusDataXmlParserEnd }, // structure
+	{ tag:"PortStatus", format:'k', size:sizeof(STL_PORT_COUNTERS_DATA), format_func:PortDataXmlOutputPortStatusData, subfields:PortStatusDataFields, start_func:PortStatusDataXmlParserStart, end_func:PortStatusDataXmlParserEnd }, // structure
 	{ tag:"CableInfo", format:'k', size:128, format_func:PortDataXmlOutputCableInfo, subfields:(IXML_FIELD*)CableInfoFields, start_func:CableInfoXmlParserStart}, 
 	{ tag:"LocalPortNum", format:'u', IXML_FIELD_INFO(PortData, PortInfo.LocalPortNum) },
 	{ tag:"PortStates", format:'h', IXML_FIELD_INFO(PortData, PortInfo.PortStates.AsReg32) },
@@ -2985,7 +2996,7 @@ static void PortDataXmlOutput(IXmlOutputState_t *state, const char *tag, void *d
 
 static void *PortDataXmlParserStart(IXmlParserState_t *state, void *parent, const char **attr)
 {
-	PortData *portp = (PortData*)MemoryAllocate2AndClear(sizeof(PortData), IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	PortData *portp = (PortData*)FabricDataAllocate(IXmlParserGetContext(state), sizeof(PortData));
 
 	if (! portp) {
 		IXmlParserPrintError(state, "Unable to allocate memory");
@@ -3052,6 +3063,7 @@ static int Snapshot_PortDataComplete(IXmlParserState_t * state, void * object, v
 		}
 	}
 
+	NodeDataFreeRouteTable(nodep);
 	if (cl_qmap_insert(&nodep->Ports, portp->PortNum, &portp->NodePortsEntry) != &portp->NodePortsEntry)
 	{
 		IXmlParserPrintError(state, "Duplicate PortNum: %u", portp->PortNum);
@@ -3120,7 +3132,7 @@ static void PortDataXmlParserEnd(IXmlParserState_t *state, const IXML_FIELD *fie
 
 failvalidate:
 	Snapshot_PortDataFree(portp, fabricp);
-	MemoryDeallocate(portp);
+	FabricDataDeallocate(fabricp, portp);
 }
 
 /**
@@ -3130,8 +3142,7 @@ failvalidate:
 */
 void Snapshot_PortDataFree(PortData * portp, FabricData_t * fabricp)
 {
-	if (portp->pPortCounters)
-		MemoryDeallocate(portp->pPortCounters);
+	PortDataFreePortCounters(fabricp, portp);
 	PortDataFreeQOSData(fabricp, portp);
 	PortDataFreePartitionTable(fabricp, portp);
 }
@@ -4211,7 +4222,7 @@ static void NodeDataXmlOutput(IXmlOutputState_t *state, const char *tag, void *d
 
 static void *NodeDataXmlParserStart(IXmlParserState_t *state, void *parent, const char **attr)
 {
-	NodeData *nodep = (NodeData*)MemoryAllocate2AndClear(sizeof(NodeData), IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	NodeData *nodep = (NodeData*)FabricDataAllocate(IXmlParserGetContext(state), sizeof(NodeData));
 
 	// TBD - if enable then need quiet arg in a static global
 	//if (i%PROGRESS_FREQ == 0)
@@ -4228,12 +4239,11 @@ static void *NodeDataXmlParserStart(IXmlParserState_t *state, void *parent, cons
 	return nodep;
 }
 
-static void NodeDataXmlParserEnd(IXmlParserState_t *state, const IXML_FIELD *field, void *object, void *parent, XML_Char *content, unsigned len, boolean valid)
+// add a parsed node to the fabric, the node is freed on failure
+static FSTATUS NodeDataXmlParserAdd(IXmlParserState_t *state, NodeData *nodep, boolean valid)
 {
 	cl_map_item_t *mi;
-	NodeData *nodep = (NodeData*)object;
 	FabricData_t *fabricp = IXmlParserGetContext(state);
-	//FSTATUS status;
 
 	if (! valid)	// missing mandatory fields
 		goto failvalidate;
@@ -4258,13 +4268,19 @@ static void NodeDataXmlParserEnd(IXmlParserState_t *state, const IXML_FIELD *fie
 	//  snapshot generation time
 	if (fbFDB)
 		fabricp->flags |= FF_ROUTES;
-	return;
+	return FSUCCESS;
 
 failsystem:
 	cl_qmap_remove_item(&fabricp->AllNodes, &nodep->AllNodesEntry);
 failinsert:
 failvalidate:
-	MemoryDeallocate(nodep);
+	FabricDataDeallocate(fabricp, nodep);
+	return FERROR;
+}
+
+static void NodeDataXmlParserEnd(IXmlParserState_t *state, const IXML_FIELD *field, void *object, void *parent, XML_Char *content, unsigned len, boolean valid)
+{
+	(void)NodeDataXmlParserAdd(state, (NodeData*)object, valid);
 }
 
 static IXML_FIELD NodesFields[] = {
@@ -4863,6 +4879,81 @@ static IXML_FIELD TopLevelFields[] = {
 };
 #endif
 
+/****************************************************************************/
+/* Streaming Snapshot Input functions */
+
+/* Xml2ParseSnapshotStream hands each Node to a callback as soon as its
+ * element is closed and frees the nodes the callback does not keep.
+ * Snapshots are not parsed concurrently, so like LinkXmlParserStart we can
+ * get away with a single static.
+ */
+static struct {
+	SnapshotNodeFunc_t *node_func;
+	SnapshotLinkFunc_t *link_func;
+	void *context;
+} g_SnapshotStream;
+
+static void NodeDataXmlParserEndStream(IXmlParserState_t *state, const IXML_FIELD *field, void *object, void *parent, XML_Char *content, unsigned len, boolean valid)
+{
+	NodeData *nodep = (NodeData*)object;
+	FabricData_t *fabricp = IXmlParserGetContext(state);
+	cl_map_item_t *q;
+
+	if (FSUCCESS != NodeDataXmlParserAdd(state, nodep, valid))
+		return;
+	if ((*g_SnapshotStream.node_func)(fabricp, nodep, g_SnapshotStream.context))
+		return;
+
+	// ports were added to AllPorts as they were parsed
+	for (q=cl_qmap_head(&nodep->Ports); q != cl_qmap_end(&nodep->Ports); q = cl_qmap_next(q)) {
+		PortData *portp = PARENT_STRUCT(q, PortData, NodePortsEntry);
+		PortGuidIndexRemove(fabricp, portp);
+		QListRemoveItem(&fabricp->AllPorts, &portp->AllPortsEntry);
+	}
+	NodeDataFree(fabricp, nodep);
+}
+
+static void LinkXmlParserEndStream(IXmlParserState_t *state, const IXML_FIELD *field, void *object, void *parent, XML_Char *content, unsigned len, boolean valid)
+{
+	TempLinkData_t *link = (TempLinkData_t*)object;
+	FabricData_t *fabricp = IXmlParserGetContext(state);
+
+	if (! valid)
+		return;
+	if (g_SnapshotStream.link_func
+		&& ! (*g_SnapshotStream.link_func)(fabricp, link->from.NodeGUID, link->from.PortNum,
+							link->to.NodeGUID, link->to.PortNum, g_SnapshotStream.context))
+		return;
+	// links to nodes which were not kept are expected
+	if (FindNodeGuidPort(fabricp, link->from.NodeGUID, link->from.PortNum)
+		&& FindNodeGuidPort(fabricp, link->to.NodeGUID, link->to.PortNum))
+		LinkXmlParserEnd(state, field, object, parent, content, len, valid);
+}
+
+static IXML_FIELD StreamNodesFields[] = {
+	{ tag:"Node", format:'K', subfields:(IXML_FIELD*)NodeDataFields, start_func:NodeDataXmlParserStart, end_func:NodeDataXmlParserEndStream }, // structure
+	{ NULL }
+};
+
+static IXML_FIELD StreamLinksFields[] = {
+	{ tag:"Link", format:'K', subfields:LinkFields, start_func:LinkXmlParserStart, end_func:LinkXmlParserEndStream }, // structure
+	{ NULL }
+};
+
+/* SMs, McMembers and VirtualFabrics refer to ports which may not have been
+ * kept, so they are skipped
+ */
+static IXML_FIELD StreamSnapshotFields[] = {
+	{ tag:"Nodes", format:'K', subfields:StreamNodesFields }, // list
+	{ tag:"Links", format:'K', subfields:StreamLinksFields }, // list
+	{ NULL }
+};
+
+static IXML_FIELD StreamTopLevelFields[] = {
+	{ tag:"Snapshot", format:'K', subfields:StreamSnapshotFields, start_func:SnapshotXmlParserStart, end_func:SnapshotXmlParserEnd }, // structure
+	{ NULL }
+};
+
 static void SnapshotInfoXmlFormatAttr(IXmlOutputState_t *state, void *data)
 {
 	SnapshotOutputInfo_t *info = (SnapshotOutputInfo_t *)IXmlOutputGetContext(state);
@@ -5002,6 +5093,8 @@ FSTATUS Xml2ParseSnapshot(const char *input_file, int quiet, FabricData_t *fabri
 		fprintf(stderr, "Warning: potentially inaccurate input '%s': found %u recognized top level tags, expected 1\n", filename, tags_found);
 	}
 	BuildFabricDataLists(fabricp);
+	(void)FabricDataBuildNodeNameIndex(fabricp);
+	(void)FabricDataBuildNodeGuidIndex(fabricp);
 
 	/*
 		Resize the switch FDB tables to their full capacity.
@@ -5021,6 +5114,167 @@ FSTATUS Xml2ParseSnapshot(const char *input_file, int quiet, FabricData_t *fabri
 
 	return FSUCCESS;
 }
+
+FSTATUS Xml2ParseSnapshotStream(const char *input_file, int quiet, FabricData_t *fabricp, FabricFlags_t flags, SnapshotNodeFunc_t *node_func, SnapshotLinkFunc_t *link_func, void *context)
+{
+	unsigned tags_found, fields_found;
+	const char *filename=input_file;
+	FSTATUS status;
+
+	// nodes which are not kept must really be freed
+	if (FSUCCESS != InitFabricData(fabricp, flags & ~FF_ARENA)) {
+		fprintf(stderr, "%s: Unable to initialize fabric data memory\n", g_Top_cmdname);
+		return FERROR;
+	}
+	g_SnapshotStream.node_func = node_func;
+	g_SnapshotStream.link_func = link_func;
+	g_SnapshotStream.context = context;
+	if (strcmp(input_file, "-") == 0) {
+		filename="stdin";
+		if (! quiet) ProgressPrint(TRUE, "Parsing stdin...");
+		status = IXmlParseFile(stdin, "stdin", IXML_PARSER_FLAG_RELEASE_INPUT, StreamTopLevelFields, NULL, fabricp, NULL, NULL, &tags_found, &fields_found);
+	} else {
+		if (! quiet) ProgressPrint(TRUE, "Parsing %s...", Top_truncate_str(input_file));
+		status = IXmlParseInputFile(input_file, IXML_PARSER_FLAG_RELEASE_INPUT, StreamTopLevelFields, NULL, fabricp, NULL, NULL, &tags_found, &fields_found);
+	}
+	memset(&g_SnapshotStream, 0, sizeof(g_SnapshotStream));
+	if (FSUCCESS != status)
+		return FERROR;
+	if (tags_found != 1 || fields_found != 1) {
+		fprintf(stderr, "Warning: potentially inaccurate input '%s': found %u recognized top level tags, expected 1\n", filename, tags_found);
+	}
+	BuildFabricDataLists(fabricp);
+	(void)FabricDataBuildNodeNameIndex(fabricp);
+	(void)FabricDataBuildNodeGuidIndex(fabricp);
+	return FSUCCESS;
+}
+
+/* Xml2ParseSnapshotLinks state.  The 1st pass keeps no nodes and finds the
+ * links with a port port_func selects, the 2nd keeps only the nodes on
+ * those links.
+ */
+typedef struct SnapshotLinksNode_s {
+	cl_map_item_t	MapEntry;	// key is NodeGUID
+	uint64			ports[4];	// ports port_func selected
+} SnapshotLinksNode_t;
+
+typedef struct SnapshotLinksContext_s {
+	SnapshotPortFunc_t *port_func;
+	void		*context;		// for port_func
+	cl_qmap_t	SelectedNodes;	// nodes with ports port_func selected
+	cl_qmap_t	KeepNodes;		// nodes on links which are kept
+	uint32		links;			// links in snapshot
+	FSTATUS		status;
+} SnapshotLinksContext_t;
+
+static SnapshotLinksNode_t *SnapshotLinksNodeAdd(SnapshotLinksContext_t *ctxp, cl_qmap_t *map, EUI64 guid)
+{
+	SnapshotLinksNode_t *linksnodep;
+	cl_map_item_t *mi = cl_qmap_get(map, guid);
+
+	if (mi != cl_qmap_end(map))
+		return PARENT_STRUCT(mi, SnapshotLinksNode_t, MapEntry);
+	linksnodep = (SnapshotLinksNode_t *)MemoryAllocate2AndClear(sizeof(SnapshotLinksNode_t), IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! linksnodep) {
+		fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
+		ctxp->status = FINSUFFICIENT_MEMORY;
+		return NULL;
+	}
+	cl_qmap_insert(map, guid, &linksnodep->MapEntry);
+	return linksnodep;
+}
+
+static boolean SnapshotLinksPortSelected(SnapshotLinksContext_t *ctxp, EUI64 guid, uint8 port)
+{
+	cl_map_item_t *mi = cl_qmap_get(&ctxp->SelectedNodes, guid);
+
+	return (mi != cl_qmap_end(&ctxp->SelectedNodes)
+		&& (PARENT_STRUCT(mi, SnapshotLinksNode_t, MapEntry)->ports[port/64] & (1ULL << (port%64))));
+}
+
+static boolean SnapshotLinksSelectPorts(FabricData_t *fabricp, NodeData *nodep, void *context)
+{
+	SnapshotLinksContext_t *ctxp = (SnapshotLinksContext_t *)context;
+	cl_map_item_t *q;
+
+	for (q=cl_qmap_head(&nodep->Ports); q != cl_qmap_end(&nodep->Ports); q = cl_qmap_next(q)) {
+		PortData *portp = PARENT_STRUCT(q, PortData, NodePortsEntry);
+		SnapshotLinksNode_t *linksnodep;
+
+		if (! (*ctxp->port_func)(portp, ctxp->context))
+			continue;
+		linksnodep = SnapshotLinksNodeAdd(ctxp, &ctxp->SelectedNodes, nodep->NodeInfo.NodeGUID);
+		if (linksnodep)
+			linksnodep->ports[portp->PortNum/64] |= 1ULL << (portp->PortNum%64);
+	}
+	return FALSE;
+}
+
+static boolean SnapshotLinksSelectLink(FabricData_t *fabricp, EUI64 fromGuid, uint8 fromPort, EUI64 toGuid, uint8 toPort, void *context)
+{
+	SnapshotLinksContext_t *ctxp = (SnapshotLinksContext_t *)context;
+
+	ctxp->links++;
+	if (SnapshotLinksPortSelected(ctxp, fromGuid, fromPort)
+		|| SnapshotLinksPortSelected(ctxp, toGuid, toPort)) {
+		(void)SnapshotLinksNodeAdd(ctxp, &ctxp->KeepNodes, fromGuid);
+		(void)SnapshotLinksNodeAdd(ctxp, &ctxp->KeepNodes, toGuid);
+	}
+	return FALSE;	// no nodes are kept
+}
+
+// other links between kept nodes are not wanted
+static boolean SnapshotLinksKeepLink(FabricData_t *fabricp, EUI64 fromGuid, uint8 fromPort, EUI64 toGuid, uint8 toPort, void *context)
+{
+	SnapshotLinksContext_t *ctxp = (SnapshotLinksContext_t *)context;
+
+	return (SnapshotLinksPortSelected(ctxp, fromGuid, fromPort)
+		|| SnapshotLinksPortSelected(ctxp, toGuid, toPort));
+}
+
+static boolean SnapshotLinksKeepNode(FabricData_t *fabricp, NodeData *nodep, void *context)
+{
+	SnapshotLinksContext_t *ctxp = (SnapshotLinksContext_t *)context;
+
+	return (cl_qmap_get(&ctxp->KeepNodes, nodep->NodeInfo.NodeGUID) != cl_qmap_end(&ctxp->KeepNodes));
+}
+
+static void SnapshotLinksFreeNodes(cl_qmap_t *map)
+{
+	cl_map_item_t *mi;
+
+	while ((mi = cl_qmap_head(map)) != cl_qmap_end(map)) {
+		cl_qmap_remove_item(map, mi);
+		MemoryDeallocate(PARENT_STRUCT(mi, SnapshotLinksNode_t, MapEntry));
+	}
+}
+
+FSTATUS Xml2ParseSnapshotLinks(const char *input_file, int quiet, FabricData_t *fabricp, FabricFlags_t flags, SnapshotPortFunc_t *port_func, void *context, uint32 *linksp)
+{
+	SnapshotLinksContext_t links;
+	FSTATUS status;
+
+	*linksp = 0;
+	links.port_func = port_func;
+	links.context = context;
+	cl_qmap_init(&links.SelectedNodes, NULL);
+	cl_qmap_init(&links.KeepNodes, NULL);
+	links.links = 0;
+	links.status = FSUCCESS;
+	status = Xml2ParseSnapshotStream(input_file, quiet, fabricp, flags,
+						SnapshotLinksSelectPorts, SnapshotLinksSelectLink, &links);
+	DestroyFabricData(fabricp);
+	if (status == FSUCCESS)
+		status = links.status;
+	if (status == FSUCCESS)
+		status = Xml2ParseSnapshotStream(input_file, quiet, fabricp, flags,
+						SnapshotLinksKeepNode, SnapshotLinksKeepLink, &links);
+	if (status == FSUCCESS)
+		*linksp = links.links;
+	SnapshotLinksFreeNodes(&links.SelectedNodes);
+	SnapshotLinksFreeNodes(&links.KeepNodes);
+	return status;
+}
 #else
 FSTATUS Xml2ParseSnapshot(const char *input_file, int quiet, FabricData_t *fabricp, FabricFlags_t flags, boolean allocFull, XML_Memory_Handling_Suite* memsuite)
 {
@@ -5047,6 +5301,8 @@ FSTATUS Xml2ParseSnapshot(const char *input_file, int quiet, FabricData_t *fabri
 		fprintf(stderr, "Warning: potentially inaccurate input '%s': found %u recognized top level tags, expected 1\n", filename, tags_found);
 	}
 	BuildFabricDataLists(fabricp);
+	(void)FabricDataBuildNodeNameIndex(fabricp);
+	(void)FabricDataBuildNodeGuidIndex(fabricp);
 
 	/*
 		Resize the switch FDB tables to their full capacity.
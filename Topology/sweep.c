@@ -51,6 +51,147 @@ static int	g_paclient_state = OMGT_SERVICE_STATE_UNKNOWN;	// PaClient/PaServer c
 static FILE *g_verbose_file = NULL;	// file for verbose output
 static struct omgt_port *g_portHandle = NULL;
 
+/* ------------------------------------------------------------------------- */
+/* Parallel sweep
+ *
+ * Sweep runs its independent phases concurrently, and GetAllNodes spreads
+ * the per NodeRecord queries across worker threads.  Each thread has its
+ * own SA port.  Threads hold g_SweepLock while touching fabric data or the
+ * globals in this file and drop it only while waiting for an SA query, so
+ * the SA round trips overlap while all FabricData_t updates stay serialized.
+ * SMA and DM MADs are issued with the lock held.
+ */
+#define SWEEP_MAX_THREADS	8	// per SweepRunWorkers call
+
+static pthread_mutex_t g_SweepLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_SweepPhaseDone = PTHREAD_COND_INITIALIZER;
+static int g_SweepParallel = 0;	// workers running, callers hold g_SweepLock
+static uint32 g_SweepThreads = SWEEP_MAX_THREADS;
+
+static FSTATUS omgt_sweep_open(struct omgt_port **port, EUI64 portGuid, int ms_timeout)
+{
+	FSTATUS status;
+
+	status = omgt_open_port_by_guid(port, portGuid, NULL);
+	if (status == FSUCCESS)
+		omgt_set_timeout(*port, ms_timeout);
+	return status;
+}
+
+static void omgt_sweep_free(PQUERY_RESULT_VALUES pQueryResults)
+{
+	omgt_free_query_result_buffer(pQueryResults);
+}
+
+static const SweepSaTransport_t g_SweepOmgtTransport = {
+	omgt_sweep_open, omgt_close_port, omgt_query_sa, omgt_sweep_free
+};
+static SweepSaTransport_t g_SweepSa = {
+	omgt_sweep_open, omgt_close_port, omgt_query_sa, omgt_sweep_free
+};
+
+void SetSweepSaTransport(const SweepSaTransport_t *transport)
+{
+	g_SweepSa = transport ? *transport : g_SweepOmgtTransport;
+}
+
+void SetSweepThreads(uint32 threads)
+{
+	g_SweepThreads = threads ? MIN(threads, SWEEP_MAX_THREADS) : 1;
+}
+
+static FSTATUS SweepQuerySa(struct omgt_port *port, OMGT_QUERY *query,
+							PQUERY_RESULT_VALUES *ppQueryResults)
+{
+	FSTATUS status;
+
+	if (! g_SweepParallel)
+		return g_SweepSa.query(port, query, ppQueryResults);
+	pthread_mutex_unlock(&g_SweepLock);
+	status = g_SweepSa.query(port, query, ppQueryResults);
+	pthread_mutex_lock(&g_SweepLock);
+	return status;
+}
+
+static void SweepFreeQueryResults(PQUERY_RESULT_VALUES pQueryResults)
+{
+	g_SweepSa.free(pQueryResults);
+}
+
+// called with g_SweepLock held when running in parallel.  Must return once
+// there is nothing left for it to do
+typedef void (SweepWork)(struct omgt_port *port, void *context);
+
+typedef struct SweepWorker_s {
+	pthread_t thread;
+	struct omgt_port *port;
+	SweepWork *work;
+	void *context;
+} SweepWorker_t;
+
+static void *SweepWorkerThread(void *arg)
+{
+	SweepWorker_t *workerp = (SweepWorker_t *)arg;
+
+	pthread_mutex_lock(&g_SweepLock);
+	(*workerp->work)(workerp->port, workerp->context);
+	pthread_mutex_unlock(&g_SweepLock);
+	return NULL;
+}
+
+/* run work on the callers thread using port and on up to threads-1 workers
+ * with ports of their own.  May be nested, a worker may call this again.
+ * If worker ports can't be opened, work is done with fewer threads.
+ */
+static void SweepRunWorkers(struct omgt_port *port, EUI64 portGuid,
+							FabricData_t *fabricp, uint32 threads,
+							SweepWork *work, void *context)
+{
+	SweepWorker_t workers[SWEEP_MAX_THREADS-1];
+	int nested = g_SweepParallel;
+	uint32 count = 0;
+	uint32 i;
+
+	threads = MIN(threads, g_SweepThreads);
+	if (threads <= 1) {
+		(*work)(port, context);
+		return;
+	}
+
+	if (nested)
+		pthread_mutex_unlock(&g_SweepLock);
+	for (i=0; i < threads-1; i++) {
+		if (FSUCCESS != g_SweepSa.open(&workers[count].port, portGuid, fabricp->ms_timeout)) {
+			DBGPRINT("Unable to open port for sweep worker, using %u threads\n", count+1);
+			break;
+		}
+		workers[count].work = work;
+		workers[count].context = context;
+		count++;
+	}
+	pthread_mutex_lock(&g_SweepLock);
+	g_SweepParallel = 1;
+	for (i=0; i < count; i++) {
+		if (0 != pthread_create(&workers[i].thread, NULL, SweepWorkerThread, &workers[i])) {
+			while (i < count)
+				g_SweepSa.close(workers[--count].port);
+			break;
+		}
+	}
+
+	(*work)(port, context);
+
+	pthread_mutex_unlock(&g_SweepLock);
+	for (i=0; i < count; i++) {
+		pthread_join(workers[i].thread, NULL);
+		g_SweepSa.close(workers[i].port);
+	}
+	if (nested)
+		pthread_mutex_lock(&g_SweepLock);
+	else
+		g_SweepParallel = 0;
+}
+
 
 /* get path from our portGuid to destination portp
  * cache path in portp, if called again report from cached value
@@ -91,7 +232,7 @@ FSTATUS GetPathToPort(struct omgt_port *port, EUI64 portGuid, PortData *portp)
 					   	iba_sd_query_result_type_msg(query.OutputType));
 
 	// this call is synchronous
-	status = omgt_query_sa(port, &query, &pQueryResults);
+	status = SweepQuerySa(port, &query, &pQueryResults);
 	if (! pQueryResults)
 	{
 		fprintf(stderr, "%*sSA PathRecord query Failed: %s\n", 0, "", iba_fstatus_msg(status));
@@ -130,7 +271,7 @@ done:
 	// omgt_query_sa will have allocated a result buffer
 	// we must free the buffer when we are done with it
 	if (pQueryResults)
-		omgt_free_query_result_buffer(pQueryResults);
+		SweepFreeQueryResults(pQueryResults);
 	return status;
 
 fail:
@@ -888,7 +1029,7 @@ FSTATUS GetMasterSMData(struct omgt_port *port,
 					   	iba_sd_query_result_type_msg(query.OutputType));
 
 	// this call is synchronous
-	status = omgt_query_sa(port, &query, &pQueryResults);
+	status = SweepQuerySa(port, &query, &pQueryResults);
 
 	if (! pQueryResults)
 	{
@@ -927,7 +1068,7 @@ done:
 	// omgt_query_sa will have allocated a result buffer
 	// we must free the buffer when we are done with it
 	if (pQueryResults)
-		omgt_free_query_result_buffer(pQueryResults);
+		SweepFreeQueryResults(pQueryResults);
 
 	return status;
 
@@ -971,8 +1112,10 @@ static FSTATUS GetNodeRecordDirect(struct omgt_port *port,
 		goto fail;
 	}
 
+	NodeNameIndexRemove(fabricp, nodep);
 	nodep->NodeDesc = NodeDesc;
 	nodep->NodeInfo = NodeInfo;
+	NodeNameIndexAdd(fabricp, nodep);
 	return FSUCCESS;
 
 fail:
@@ -1214,7 +1357,7 @@ static FSTATUS GetNodePorts(struct omgt_port *port,
 					   	iba_sd_query_result_type_msg(query.OutputType));
 
 	// this call is synchronous
-	status = omgt_query_sa(port, &query, &pQueryResults);
+	status = SweepQuerySa(port, &query, &pQueryResults);
 	if (! pQueryResults)
 	{
 		fprintf(stderr, "%*sSA PortInfo query Failed: %s\n", 0, "", iba_fstatus_msg(status));
@@ -1251,7 +1394,7 @@ done:
 	// omgt_query_sa will have allocated a result buffer
 	// we must free the buffer when we are done with it
 	if (pQueryResults)
-		omgt_free_query_result_buffer(pQueryResults);
+		SweepFreeQueryResults(pQueryResults);
 
 	return status;
 
@@ -1436,7 +1579,7 @@ static FSTATUS GetNodeSwitchInfo(struct omgt_port *port,
 					   	iba_sd_query_result_type_msg(query.OutputType));
 
 	// this call is synchronous
-	status = omgt_query_sa(port, &query, &pQueryResults);
+	status = SweepQuerySa(port, &query, &pQueryResults);
 	if (! pQueryResults)
 	{
 		fprintf(stderr, "%*sSA SwitchInfo query Failed: %s\n", 0, "", iba_fstatus_msg(status));
@@ -1466,7 +1609,7 @@ done:
 	// omgt_query_sa will have allocated a result buffer
 	// we must free the buffer when we are done with it
 	if (pQueryResults)
-		omgt_free_query_result_buffer(pQueryResults);
+		SweepFreeQueryResults(pQueryResults);
 	return status;
 
 fail:
@@ -1738,7 +1881,7 @@ static FSTATUS GetAllCablesSA(struct omgt_port *port,
 					   	iba_sd_query_result_type_msg(query.OutputType));
 
 	// this call is synchronous
-	status = omgt_query_sa(port, &query, &pQueryResults);
+	status = SweepQuerySa(port, &query, &pQueryResults);
 
 	if (!pQueryResults) {
 		fprintf(stderr, "%*sSA CableInfo Record query Failed: %s\n", 0, "", iba_fstatus_msg(status));
@@ -1796,7 +1939,7 @@ static FSTATUS GetAllCablesSA(struct omgt_port *port,
 	
 done:
 	if (pQueryResults)
-		omgt_free_query_result_buffer(pQueryResults);
+		SweepFreeQueryResults(pQueryResults);
 	return status;
 
 fail:
@@ -2094,7 +2237,7 @@ static FSTATUS GetCongestionInfo(struct omgt_port *port,
 						iba_sd_query_result_type_msg(query.OutputType));
 
 	// this call is synchronous
-	status = omgt_query_sa(port, &query, &pQueryResults);
+	status = SweepQuerySa(port, &query, &pQueryResults);
 	if (! pQueryResults)
 	{
 		fprintf(stderr, "%*sSA CongestionInfo query Failed: %s\n", 0, "", iba_fstatus_msg(status));
@@ -2127,7 +2270,7 @@ done:
 	// omgt_query_sa will have allocated a result buffer
 	// we must free the buffer when we are done with it
 	if (pQueryResults)
-		omgt_free_query_result_buffer(pQueryResults);
+		SweepFreeQueryResults(pQueryResults);
 	return status;
 
 fail:
@@ -2161,7 +2304,7 @@ static FSTATUS GetHFICongestionControlTable(struct omgt_port *port,
 						iba_sd_query_result_type_msg(query.OutputType));
 
 	// this call is synchronous
-	status = omgt_query_sa(port, &query, &pQueryResults);
+	status = SweepQuerySa(port, &query, &pQueryResults);
 	if (! pQueryResults)
 	{
 		fprintf(stderr, "%*sSA HFI Congestion Control Table query Failed: %s\n", 0, "", iba_fstatus_msg(status));
@@ -2213,7 +2356,7 @@ done:
 	// omgt_query_sa will have allocated a result buffer
 	// we must free the buffer when we are done with it
 	if (pQueryResults)
-		omgt_free_query_result_buffer(pQueryResults);
+		SweepFreeQueryResults(pQueryResults);
 	return status;
 
 fail:
@@ -2310,6 +2453,145 @@ fail:
 }
 
 
+typedef struct SweepNodesContext_s {
+	EUI64 portGuid;
+	FabricData_t *fabricp;
+	SweepFlags_t flags;
+	int quiet;
+	STL_NODE_RECORD_RESULTS *pNodeRecords;
+	uint32 next;			// next NodeRecord to process
+	FSTATUS status;			// first failure, stops further processing
+	NodeData *failNodep;	// node to remove once all workers are done
+} SweepNodesContext_t;
+
+/* add the node for a NodeRecord and get the ports and other information
+ * for the LID in the record.  We get 1 NodeRecord per port on a node,
+ * so other records for the same node may be processed concurrently.
+ */
+static FSTATUS GetNodeRecordData(struct omgt_port *port,
+							SweepNodesContext_t *ctxp,
+							STL_NODE_RECORD *pNodeRecord)
+{
+	FabricData_t *fabricp = ctxp->fabricp;
+	EUI64 portGuid = ctxp->portGuid;
+	NodeData *nodep;
+	boolean new_node;
+	cl_map_item_t *q;
+	FSTATUS status;
+
+	nodep = FabricDataAddNode(fabricp, pNodeRecord, &new_node);
+	if (!nodep) {
+		return FERROR;
+	}
+	if (new_node && fabricp->flags & FF_SMADIRECT) {
+		// replace node record data with actual SMA data
+		(void)GetNodeRecordDirect(port, portGuid, fabricp, nodep, pNodeRecord->RID.LID);
+	}
+	//printf("process NodeRecord LID: 0x%x\n", pNodeRecord->RID.LID);
+	//DisplayNodeRecord(pNodeRecord, 0);
+
+	// we get 1 NodeRecord per port on a node, AddNode will only save
+	// 1 NodeData structure per node and discard the duplicates
+	// (but we need to process their corresponding ports)
+	if (fabricp->flags & FF_SMADIRECT)
+		status = GetNodePortsDirect(port, fabricp, nodep, &nodep->Ports, pNodeRecord->NodeInfo.PortGUID, pNodeRecord->RID.LID);
+	else
+		status = GetNodePorts(port, fabricp, nodep, &nodep->Ports, pNodeRecord->NodeInfo.PortGUID, pNodeRecord->RID.LID);
+	if (status != FSUCCESS)
+	{
+		// other workers may still be using nodep, caller removes it
+		if (! ctxp->failNodep)
+			ctxp->failNodep = nodep;
+		return FERROR;
+	}
+
+	/* Get Congestion Info */
+	if (fabricp->flags & FF_SMADIRECT)
+		GetCongestionInfoDirect(port, fabricp, nodep, pNodeRecord->RID.LID);
+	else
+		GetCongestionInfo(port, fabricp, nodep, pNodeRecord->RID.LID);
+
+	/* Get HFI Congestion Control Table */
+	for (q = cl_qmap_head(&nodep->Ports); q != cl_qmap_end(&nodep->Ports); q = cl_qmap_next(q)) {
+		PortData *portp = PARENT_STRUCT(q, PortData, NodePortsEntry);
+		/* For switches only address switch port 0 */
+		if (nodep->NodeInfo.NodeType == STL_NODE_SW && portp->PortNum) continue;
+		if (!portp->nodep->CongestionInfo.ControlTableCap) continue;
+		if (PortDataAllocateCongestionControlTableEntries(fabricp, portp)) return FERROR;
+
+		if (fabricp->flags & FF_SMADIRECT)
+			GetHFICongestionControlTableDirect(port, fabricp, portp, pNodeRecord->RID.LID);
+		else
+			GetHFICongestionControlTable(port, fabricp, portp, pNodeRecord->RID.LID);
+	}
+
+	// if this was the 1st time we saw the node
+	if (new_node) {
+		UpdateNodePmaCapabilities(nodep, TRUE);
+#if !defined(VXWORKS) || defined(BUILD_DMC)
+		if (ctxp->flags & SWEEP_IOUS)
+			(void)GetNodeIous(port, portGuid, fabricp, nodep);
+#endif
+		if (ctxp->flags & SWEEP_SWITCHINFO) {
+			if (fabricp->flags & FF_SMADIRECT) {
+				(void)GetNodeSwitchInfoDirect(port, nodep, pNodeRecord->RID.LID);
+			} else {
+				(void)GetNodeSwitchInfo(port, nodep, pNodeRecord->RID.LID);
+			}
+		}
+	}
+	return FSUCCESS;
+}
+
+static void GetNodeRecordsWork(struct omgt_port *port, void *context)
+{
+	SweepNodesContext_t *ctxp = (SweepNodesContext_t *)context;
+	STL_NODE_RECORD_RESULTS *p = ctxp->pNodeRecords;
+
+	while (ctxp->status == FSUCCESS && ctxp->next < p->NumNodeRecords) {
+		uint32 i = ctxp->next++;
+		FSTATUS status;
+
+		if (i%PROGRESS_FREQ == 0)
+			if (! ctxp->quiet) ProgressPrint(FALSE, "Processed %6d of %6d Nodes...", i, p->NumNodeRecords);
+		status = GetNodeRecordData(port, ctxp, &p->NodeRecords[i]);
+		if (status != FSUCCESS && ctxp->status == FSUCCESS)
+			ctxp->status = status;
+	}
+}
+
+/* add the nodes for a set of NodeRecords and get their ports and other
+ * information.  On failure the node which failed is removed.
+ */
+static FSTATUS SweepNodeRecords(struct omgt_port *port,
+						   EUI64 portGuid,
+						   FabricData_t *fabricp,
+						   SweepFlags_t flags,
+						   int quiet,
+						   STL_NODE_RECORD_RESULTS *p)
+{
+	SweepNodesContext_t context;
+
+	context.portGuid = portGuid;
+	context.fabricp = fabricp;
+	context.flags = flags;
+	context.quiet = quiet;
+	context.pNodeRecords = p;
+	context.next = 0;
+	context.status = FSUCCESS;
+	context.failNodep = NULL;
+	// SMA queries are issued with g_SweepLock held, so only the SA
+	// queries benefit from more threads
+	SweepRunWorkers(port, portGuid, fabricp,
+					(fabricp->flags & FF_SMADIRECT) ? 1 : p->NumNodeRecords,
+					GetNodeRecordsWork, &context);
+	// SweepRefresh keeps the fabric after a failure, so the node must also
+	// leave its system and free its ports.  It has no links yet
+	if (context.failNodep)
+		NodeDataFree(fabricp, context.failNodep);
+	return context.status;
+}
+
 /* query all NodeInfo Records on fabric connected to given HFI port
  * and put results into fabricp->AllNodes
  */
@@ -2333,7 +2615,7 @@ static FSTATUS GetAllNodes(struct omgt_port *port,
 					   	iba_sd_query_result_type_msg(query.OutputType));
 
 	// this call is synchronous
-	status = omgt_query_sa(port, &query, &pQueryResults);
+	status = SweepQuerySa(port, &query, &pQueryResults);
 
 	if (! pQueryResults)
 	{
@@ -2348,83 +2630,12 @@ static FSTATUS GetAllNodes(struct omgt_port *port,
 		fprintf(stderr, "%*sNo Node Records Returned\n", 0, "");
 	} else {
 		STL_NODE_RECORD_RESULTS *p = (STL_NODE_RECORD_RESULTS*)pQueryResults->QueryResult;
-		int i;
 
 		DBGPRINT("MadStatus 0x%x: %s\n", pQueryResults->MadStatus,
 					   				iba_sd_mad_status_msg(pQueryResults->MadStatus));
 		DBGPRINT("%d Bytes Returned\n", pQueryResults->ResultDataSize);
-		for (i=0; i<p->NumNodeRecords; ++i)
-		{
-			NodeData *nodep;
-			boolean new_node;
-			cl_map_item_t *q;
-
-			if (i%PROGRESS_FREQ == 0)
-				if (! quiet) ProgressPrint(FALSE, "Processed %6d of %6d Nodes...", i, p->NumNodeRecords);
-			nodep = FabricDataAddNode(fabricp, &p->NodeRecords[i], &new_node);
-			if (!nodep) {
-				goto fail;
-			}
-			if (new_node && fabricp->flags & FF_SMADIRECT) {
-				// replace node record data with actual SMA data
-				(void)GetNodeRecordDirect(port, portGuid, fabricp, nodep, p->NodeRecords[i].RID.LID);
-			}
-			//printf("process NodeRecord LID: 0x%x\n", p->NodeRecords[i].RID.LID);
-			//DisplayNodeRecord(&p->NodeRecords[i], 0);
-
-			// we get 1 NodeRecord per port on a node, AddNode will only save
-			// 1 NodeData structure per node and discard the duplicates
-			// (but we need to process their corresponding ports)
-			if (fabricp->flags & FF_SMADIRECT)
-				status = GetNodePortsDirect(port, fabricp, nodep, &nodep->Ports, p->NodeRecords[i].NodeInfo.PortGUID, p->NodeRecords[i].RID.LID);
-			else
-				status = GetNodePorts(port, fabricp, nodep, &nodep->Ports, p->NodeRecords[i].NodeInfo.PortGUID, p->NodeRecords[i].RID.LID);
-			if (status != FSUCCESS)
-			{
-				// TBD - better handling cleanup of all previous Ports for node
-				cl_qmap_remove_item(&fabricp->AllNodes, &nodep->AllNodesEntry);
-				MemoryDeallocate(nodep);
-				goto fail;
-			}
-
-			/* Get Congestion Info */
-			if (fabricp->flags & FF_SMADIRECT)
-				GetCongestionInfoDirect(port, fabricp, nodep, p->NodeRecords[i].RID.LID);
-			else
-				GetCongestionInfo(port, fabricp, nodep, p->NodeRecords[i].RID.LID);
-
-			/* Get HFI Congestion Control Table */
-			for (q = cl_qmap_head(&nodep->Ports); q != cl_qmap_end(&nodep->Ports); q = cl_qmap_next(q)) {
-				PortData *portp = PARENT_STRUCT(q, PortData, NodePortsEntry);
-				/* For switches only address switch port 0 */
-				if (nodep->NodeInfo.NodeType == STL_NODE_SW && portp->PortNum) continue;
-				if (!portp->nodep->CongestionInfo.ControlTableCap) continue;
-				if (PortDataAllocateCongestionControlTableEntries(fabricp, portp)) goto fail;
-
-				if (fabricp->flags & FF_SMADIRECT)
-					GetHFICongestionControlTableDirect(port, fabricp, portp, p->NodeRecords[i].RID.LID);
-				else
-					GetHFICongestionControlTable(port, fabricp, portp, p->NodeRecords[i].RID.LID);
-			}
-
-
-
-			// if this was the 1st time we saw the node
-			if (new_node) {
-				UpdateNodePmaCapabilities(nodep, TRUE);
-#if !defined(VXWORKS) || defined(BUILD_DMC)
-				if (flags & SWEEP_IOUS)
-					(void)GetNodeIous(port, portGuid, fabricp, nodep);
-#endif
-				if (flags & SWEEP_SWITCHINFO) {
-					if (fabricp->flags & FF_SMADIRECT) {
-						(void)GetNodeSwitchInfoDirect(port, nodep, p->NodeRecords[i].RID.LID);
-					} else {
-						(void)GetNodeSwitchInfo(port, nodep, p->NodeRecords[i].RID.LID);
-					}
-				}
-			}
-		}
+		if (FSUCCESS != SweepNodeRecords(port, portGuid, fabricp, flags, quiet, p))
+			goto fail;
 	}
 	if (! quiet) ProgressPrint(TRUE, "Done Getting All Node Records");
 	if (fabricp->flags & FF_DOWNPORTINFO) {
@@ -2438,7 +2649,7 @@ done:
 	// omgt_query_sa will have allocated a result buffer
 	// we must free the buffer when we are done with it
 	if (pQueryResults)
-		omgt_free_query_result_buffer(pQueryResults);
+		SweepFreeQueryResults(pQueryResults);
 	return status;
 
 fail:
@@ -2468,7 +2679,7 @@ static FSTATUS GetAllLinks(struct omgt_port *port,
 					   	iba_sd_query_result_type_msg(query.OutputType));
 
 	// this call is synchronous
-	status = omgt_query_sa(port, &query, &pQueryResults);
+	status = SweepQuerySa(port, &query, &pQueryResults);
 
 	if (! pQueryResults)
 	{
@@ -2506,7 +2717,7 @@ done:
 	// omgt_query_sa will have allocated a result buffer
 	// we must free the buffer when we are done with it
 	if (pQueryResults)
-		omgt_free_query_result_buffer(pQueryResults);
+		SweepFreeQueryResults(pQueryResults);
 	return status;
 
 fail:
@@ -2539,7 +2750,7 @@ static FSTATUS GetAllSMs(struct omgt_port *port,
 					   	iba_sd_query_result_type_msg(query.OutputType));
 
 	// this call is synchronous
-	status = omgt_query_sa(port, &query, &pQueryResults);
+	status = SweepQuerySa(port, &query, &pQueryResults);
 
 	if (! pQueryResults)
 	{
@@ -2593,7 +2804,7 @@ done:
 	// omgt_query_sa will have allocated a result buffer
 	// we must free the buffer when we are done with it
 	if (pQueryResults)
-		omgt_free_query_result_buffer(pQueryResults);
+		SweepFreeQueryResults(pQueryResults);
 	return status;
 
 fail:
@@ -2601,6 +2812,55 @@ fail:
 	goto done;
 }
 
+// max PA or PMA requests GetAllPortCounters keeps outstanding
+#define PORT_COUNTERS_WINDOW	32
+
+// a port selected by GetAllPortCounters
+typedef struct PortCountersReq_s {
+	PortData	*portp;		// port counters are for
+	PortData	*pmaPortp;	// port PMA requests are issued to
+	STL_LID		lid;		// LID for PA requests
+	FSTATUS		status;
+	FSTATUS		beginStatus;	// status of begin image query
+	union {
+		STL_PORT_STATUS_RSP PortStatus;	// direct PMA response
+		STL_PORT_COUNTERS_DATA BeginCounters;	// PA begin image counters
+	} u;
+} PortCountersReq_t;
+
+static void PortCountersCallback(void *context, FSTATUS status)
+{
+	((PortCountersReq_t *)context)->status = status;
+}
+
+static void PortCountersBeginCallback(void *context, FSTATUS status)
+{
+	((PortCountersReq_t *)context)->beginStatus = status;
+}
+
+// PMA paths being resolved by GetAllPortCounters
+typedef struct PortCountersPathContext_s {
+	EUI64		portGuid;
+	PortCountersReq_t *reqs;
+	uint32		num_reqs;
+	uint32		next;		// next reqs entry to resolve
+} PortCountersPathContext_t;
+
+static void GetPortCountersPathsWork(struct omgt_port *port, void *context)
+{
+	PortCountersPathContext_t *ctxp = (PortCountersPathContext_t *)context;
+
+	while (ctxp->next < ctxp->num_reqs) {
+		uint32 i = ctxp->next++;
+
+		// a switch's reqs are adjacent and share port 0, which another
+		// worker may still be resolving
+		if (i && ctxp->reqs[i-1].pmaPortp == ctxp->reqs[i].pmaPortp)
+			continue;
+		(void)GetPathToPort(port, ctxp->portGuid, ctxp->reqs[i].pmaPortp);
+	}
+}
+
 /* query all PortCounters on all ports in fabric;
    use PaClient if available, else issue direct PMA query
  */
@@ -2609,18 +2869,25 @@ FSTATUS GetAllPortCounters(EUI64 portGuid, IB_GID localGid, FabricData_t *fabric
 {
 	FSTATUS status;
 	cl_map_item_t *p;
-#ifdef PRODUCT_OPENIB_FF
 	STL_LID lid = 0;
+#ifdef PRODUCT_OPENIB_FF
 	STL_PA_IMAGE_ID_DATA img_id_end = {0};
 	STL_PA_IMAGE_ID_DATA img_id_begin = {0};
 	uint32 absolute_time;
+	boolean begin_frozen = FALSE;
 #endif
 	int i=0;
 	int num_nodes = cl_qmap_count(&fabricp->AllNodes);
 	uint32 node_count = 0;
 	uint32 nrsp_node_count = 0;
 	uint32 nrsp_port_count = 0;
-	STL_PORT_COUNTERS_DATA PortCountersData = { 0 };
+	PortCountersReq_t *reqs = NULL;
+	uint32 max_reqs = 0;
+	uint32 num_reqs = 0;
+	uint32 n;
+	MadPipe_t *pipep;
+	boolean got = FALSE;
+	boolean fail = FALSE;
 
 	if (! quiet) ProgressPrint(TRUE, "Getting All Port Counters...");
 
@@ -2685,144 +2952,91 @@ FSTATUS GetAllPortCounters(EUI64 portGuid, IB_GID localGid, FabricData_t *fabric
 		DBGPRINT("%s: Ignoring begin and/or end as we are getting counters direct from PMA", __func__);
 	}
 #endif
+	/* pass 1: select the ports to query, resolving any PMA paths needed */
+	for (p=cl_qmap_head(&fabricp->AllNodes); p != cl_qmap_end(&fabricp->AllNodes); p = cl_qmap_next(p))
+		max_reqs += cl_qmap_count(&PARENT_STRUCT(p, NodeData, AllNodesEntry)->Ports);
+	reqs = (PortCountersReq_t *)MemoryAllocate2AndClear(sizeof(PortCountersReq_t)*(max_reqs+1), IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! reqs) {
+		fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
+		status = FINSUFFICIENT_MEMORY;
+		goto fail;
+	}
 	for (p=cl_qmap_head(&fabricp->AllNodes); p != cl_qmap_end(&fabricp->AllNodes); p = cl_qmap_next(p),i++) {
 		NodeData *nodep = PARENT_STRUCT(p, NodeData, AllNodesEntry);
 		PortData *first_portp;
 		cl_map_item_t *q;
-		boolean got = FALSE;
-		boolean fail = FALSE;
 
-		if (i%PROGRESS_FREQ == 0 || node_count == 1)
-			if (! quiet) ProgressPrint(FALSE, "Processed %6d of %6d Nodes...", node_count, num_nodes);
-		if (limitstats && focus && ! CompareNodePoint(nodep, focus))
-			continue;
 		if (i%PROGRESS_FREQ == 0)
 			if (! quiet) ProgressPrint(FALSE, "Processed %6d of %6d Nodes...", i, num_nodes);
+		if (limitstats && focus && ! CompareNodePoint(nodep, focus))
+			continue;
 		if (cl_qmap_head(&nodep->Ports) == cl_qmap_end(&nodep->Ports))
 			continue; /* no ports */
 		/* issue all switch PMA requests to port 0, its only one with a LID */
 		if (nodep->NodeInfo.NodeType == STL_NODE_SW) {
 			first_portp = PARENT_STRUCT(cl_qmap_head(&nodep->Ports), PortData, NodePortsEntry);
-#ifdef PRODUCT_OPENIB_FF
 			lid = first_portp->PortInfo.LID;
-#endif
-			if (g_paclient_state != OMGT_SERVICE_STATE_OPERATIONAL) {
-				status = GetPathToPort(g_portHandle, portGuid, first_portp);
-				if (FSUCCESS != status) {
-					DBGPRINT("Unable to get Path to Port %d LID 0x%08x Node 0x%016"PRIx64"\n",
-						first_portp->PortNum,
-						first_portp->EndPortLID,
-						first_portp->nodep->NodeInfo.NodeGUID);
-					DBGPRINT("    Name: %.*s\n",
-						STL_NODE_DESCRIPTION_ARRAY_SIZE,
-						(char*)nodep->NodeDesc.NodeString);
-					//nrsp_port_count+= nodep->NodeInfo.NumPorts; // wrong
-					nrsp_port_count+= cl_qmap_count(&nodep->Ports); // better
-					nrsp_node_count++;
-					continue;
-				}
-			}
 		} else {
 			first_portp = NULL;
 		}
 
 		for (q=cl_qmap_head(&nodep->Ports); q != cl_qmap_end(&nodep->Ports); q = cl_qmap_next(q)) {
 			PortData *portp = PARENT_STRUCT(q, PortData, NodePortsEntry);
+			PortCountersReq_t *reqp = &reqs[num_reqs];
 
 			if (focus && ! ComparePortPoint(portp, focus)
 				&& (limitstats || ! portp->neighbor || ! ComparePortPoint(portp->neighbor, focus)))
 				continue;
+			if (g_paclient_state != OMGT_SERVICE_STATE_OPERATIONAL
+				&& ! PortHasPma(portp))
+				continue;
 
-#ifdef PRODUCT_OPENIB_FF
-			/* use PaClient if available */
-			if (g_paclient_state == OMGT_SERVICE_STATE_OPERATIONAL) {
-				if (!first_portp) lid = portp->PortInfo.LID;
-
-				//if getting port counters by time, get latest counters first
-				STL_PORT_COUNTERS_DATA portCounters1 = {0};
+			reqp->portp = portp;
+			reqp->lid = first_portp ? lid : portp->PortInfo.LID;
+			/* switch, issue query to port 0, CA and router, to specific port */
+			reqp->pmaPortp = first_portp ? first_portp : portp;
+			reqp->status = FSUCCESS;
+			num_reqs++;
+		}
+	}
 
-				status = omgt_pa_get_port_stats2(g_portHandle, img_id_end, lid, portp->PortNum,
-					NULL, &portCounters1, NULL, 0, !(end || begin)); //last param is user_counters flag,
-																	 //if begin or end set we want raw counters
-				if (FSUCCESS == status) {
-					PortCountersData = portCounters1;
-				}
-			}
-#endif
-			else { /* issue direct PMA query */
-				STL_PORT_STATUS_RSP PortStatus;
+	/* PMA paths are SA queries, spread them across worker threads */
+	if (g_paclient_state != OMGT_SERVICE_STATE_OPERATIONAL) {
+		PortCountersPathContext_t context;
 
-				if (! PortHasPma(portp))
-					continue;
-				if (first_portp) {
-					/* switch, issue query to port 0 */
-					if (! nodep->PmaAvoidClassPortInfo)
-						(void)STLPmGetClassPortInfo(g_portHandle, first_portp);
-					status = STLPmGetPortStatus(g_portHandle, first_portp, portp->PortNum, &PortStatus);
-				} else {
-					/* CA and router, issue query to specific port */
-					status = GetPathToPort(g_portHandle, portGuid, portp);
-					if (FSUCCESS == status) {
-						if (! nodep->PmaAvoidClassPortInfo)
-							(void)STLPmGetClassPortInfo(g_portHandle, portp);
-						status = STLPmGetPortStatus(g_portHandle, portp, portp->PortNum, &PortStatus);
-					} else {
-						DBGPRINT("Unable to get Path to Port %d LID 0x%08x Node 0x%016"PRIx64"\n",
-							portp->PortNum, portp->EndPortLID,
-							portp->nodep->NodeInfo.NodeGUID);
-						DBGPRINT("    Name: %.*s\n",
-							STL_NODE_DESCRIPTION_ARRAY_SIZE,
-							(char*)portp->nodep->NodeDesc.NodeString);
-					}
-				}
-				if (FSUCCESS == status) {
-					StlPortStatusToPortCounters(&PortStatus, &PortCountersData, &portp->PortInfo);
-				}
-			}
+		context.portGuid = portGuid;
+		context.reqs = reqs;
+		context.num_reqs = num_reqs;
+		context.next = 0;
+		SweepRunWorkers(g_portHandle, portGuid, fabricp, num_reqs,
+						GetPortCountersPathsWork, &context);
+		for (n=0; n < num_reqs; n++) {
+			PortData *pmaPortp = reqs[n].pmaPortp;
 
-			if (FSUCCESS != status) {
-				DBGPRINT("Unable to get Port Counters for Port %d LID 0x%08x Node 0x%016"PRIx64"\n",
-					portp->PortNum, portp->EndPortLID,
-					portp->nodep->NodeInfo.NodeGUID);
-				DBGPRINT("    Name: %.*s\n",
-					STL_NODE_DESCRIPTION_ARRAY_SIZE,
-					(char*)portp->nodep->NodeDesc.NodeString);
-				nrsp_port_count++;
-				fail = TRUE;
+			if (pmaPortp->pathp)
 				continue;
-			}
-
-			portp->pPortCounters = (STL_PORT_COUNTERS_DATA *)MemoryAllocate2AndClear(sizeof(STL_PORT_COUNTERS_DATA),
-				IBA_MEM_FLAG_PREMPTABLE, MYTAG);
-			if (! portp->pPortCounters) {
-				DBGPRINT("Unable to allocate memory for Port Counters for Port %d LID 0x%08x Node 0x%016"PRIx64"\n",
-					portp->PortNum, portp->EndPortLID,
-					portp->nodep->NodeInfo.NodeGUID);
-				DBGPRINT("    Name: %.*s\n",
-					STL_NODE_DESCRIPTION_ARRAY_SIZE,
-					(char*)portp->nodep->NodeDesc.NodeString);
-				nrsp_port_count++;
-				fail = TRUE;
+			reqs[n].status = FNOT_FOUND;
+			if (n && reqs[n-1].pmaPortp == pmaPortp)
 				continue;
-			}
-
-			*(portp->pPortCounters) = PortCountersData;
-			got = TRUE;
+			DBGPRINT("Unable to get Path to Port %d LID 0x%08x Node 0x%016"PRIx64"\n",
+				pmaPortp->PortNum, pmaPortp->EndPortLID,
+				pmaPortp->nodep->NodeInfo.NodeGUID);
+			DBGPRINT("    Name: %.*s\n",
+				STL_NODE_DESCRIPTION_ARRAY_SIZE,
+				(char*)pmaPortp->nodep->NodeDesc.NodeString);
 		}
-		if (got)
-			node_count++;
-		if (fail)
-			nrsp_node_count++;
 	}
+
+	/* pass 2: keep a window of PA or PMA requests outstanding, responses
+	 * land directly in one slab shared by all the ports.  When both begin
+	 * and end are given, the begin image is frozen only now and each
+	 * port's begin and end queries are issued back to back, so both images
+	 * are released as soon as the single pass completes
+	 */
+	status = FabricDataAllocatePortCountersSlab(fabricp, num_reqs);
+	if (status != FSUCCESS)
+		goto fail;
 #ifdef PRODUCT_OPENIB_FF
-	if ((begin || end) && (g_paclient_state == OMGT_SERVICE_STATE_OPERATIONAL)) {
-		status = omgt_pa_release_image(g_portHandle, img_id_end);
-		if (status != FSUCCESS) {
-			memcpy((uint8 *)&absolute_time, (uint8 *)&img_id_end.imageTime.absoluteTime, sizeof(uint32));
-			fprintf(stderr, "%s: failed to release frozen image at %s\n", __func__, ctime((time_t *)&absolute_time));
-			return status;
-		}
-	}
 	if (begin && end && (g_paclient_state == OMGT_SERVICE_STATE_OPERATIONAL)) {
 		STL_PA_IMAGE_INFO_DATA img_info_begin = {{0}};
 		// Verify Image exists
@@ -2832,78 +3046,130 @@ FSTATUS GetAllPortCounters(EUI64 portGuid, IB_GID localGid, FabricData_t *fabric
 		if (status != FSUCCESS) {
 			memcpy((uint8 *)&absolute_time, (uint8 *)&img_id_begin.imageTime.absoluteTime, sizeof(uint32));
 			fprintf(stderr, "%s: failed to get image info at %s\n", __func__, ctime((time_t *)&absolute_time));
-			return status;
+			goto fail;
 		}
 		img_id_begin = img_info_begin.imageId;
 
 		status = omgt_pa_freeze_image(g_portHandle, img_id_begin, &img_id_begin);
-		if (status == FSUCCESS) {
-			for (i = 0, p = cl_qmap_head(&fabricp->AllNodes); p != cl_qmap_end(&fabricp->AllNodes); p = cl_qmap_next(p), i++)
-			{
-				NodeData *nodep = PARENT_STRUCT(p, NodeData, AllNodesEntry);
-				PortData *first_portp;
-				cl_map_item_t *q;
-
-				if (limitstats && focus && ! CompareNodePoint(nodep, focus))
-					continue;
-				if (i%PROGRESS_FREQ == 0)
-					if (! quiet) ProgressPrint(FALSE, "Processed %6d of %6d Nodes...", i, num_nodes);
-				if (cl_qmap_head(&nodep->Ports) == cl_qmap_end(&nodep->Ports))
-					continue; /* no ports */
-				/* issue all switch PMA requests to port 0, its only one with a LID */
-				if (nodep->NodeInfo.NodeType == STL_NODE_SW) {
-					first_portp = PARENT_STRUCT(cl_qmap_head(&nodep->Ports), PortData, NodePortsEntry);
-					lid = first_portp->PortInfo.LID;
-				} else {
-					first_portp = NULL;
-				}
-
-				for (q=cl_qmap_head(&nodep->Ports); q != cl_qmap_end(&nodep->Ports); q = cl_qmap_next(q)) {
-					PortData *portp = PARENT_STRUCT(q, PortData, NodePortsEntry);
-
-					if (focus && ! ComparePortPoint(portp, focus)
-						&& (limitstats || ! portp->neighbor || ! ComparePortPoint(portp->neighbor, focus)))
-						continue;
-					if (!portp->pPortCounters) continue;
-
-					if (!first_portp) lid = portp->PortInfo.LID;
+		if (status != FSUCCESS) {
+			memcpy((uint8 *)&absolute_time, (uint8 *)&img_id_begin.imageTime.absoluteTime, sizeof(uint32));
+			fprintf(stderr, "%s: failed to freeze image at %s\n", __func__, ctime((time_t *)&absolute_time));
+			goto fail;
+		}
+		begin_frozen = TRUE;
+	}
+#endif
+	pipep = MadPipeCreate(g_portHandle, PORT_COUNTERS_WINDOW);
+	if (! pipep) {
+		fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
+		status = FINSUFFICIENT_MEMORY;
+		goto fail;
+	}
+	for (n=0; n < num_reqs; n++) {
+		PortCountersReq_t *reqp = &reqs[n];
 
-					STL_PORT_COUNTERS_DATA portCounters2 = {0};
-
-					status = omgt_pa_get_port_stats2(g_portHandle, img_id_begin, lid, portp->PortNum,
-						NULL, &portCounters2, NULL, 0, 0);
-					if (FSUCCESS == status) {
-
-						CounterSelectMask_t clearedCounters = DiffPACounters(
-							portp->pPortCounters, &portCounters2, portp->pPortCounters);
-
-						if (clearedCounters.AsReg32) {
-							char counterBuf[128];
-
-							FormatStlCounterSelectMask(counterBuf, clearedCounters);
-							fprintf(stderr, "Counters reset on LID 0x%x port %u Node 0x%016"PRIx64" Name: %.*s, reporting latest count: %s\n",
-								lid, portp->PortNum, portp->nodep->NodeInfo.NodeGUID,
-								STL_NODE_DESCRIPTION_ARRAY_SIZE, (char *)portp->nodep->NodeDesc.NodeString,
-								counterBuf);
-						}
-					}
-				}
-			} // END: for all nodes
+		reqp->beginStatus = FNOT_DONE;
+		if (FSUCCESS != reqp->status)
+			continue;
+		if (g_paclient_state == OMGT_SERVICE_STATE_OPERATIONAL) {
+			//last param is user_counters flag,
+			//if begin or end set we want raw counters
+			reqp->status = MadPipePaGetPortCounters(pipep, img_id_end,
+							reqp->lid, reqp->portp->PortNum, !(end || begin),
+							&fabricp->PortCountersSlab[n],
+							PortCountersCallback, reqp);
+			if (begin_frozen && FSUCCESS == reqp->status)
+				reqp->beginStatus = MadPipePaGetPortCounters(pipep,
+							img_id_begin, reqp->lid,
+							reqp->portp->PortNum, 0,
+							&reqp->u.BeginCounters,
+							PortCountersBeginCallback, reqp);
+		} else {
+			// ClassPortInfo goes ahead of the first PortStatus to each PMA
+			if ((! n || reqs[n-1].pmaPortp != reqp->pmaPortp)
+				&& ! reqp->pmaPortp->nodep->PmaAvoidClassPortInfo)
+				(void)MadPipePmGetClassPortInfo(pipep, reqp->pmaPortp, NULL, NULL);
+			reqp->status = MadPipePmGetPortStatus(pipep, reqp->pmaPortp,
+							reqp->portp->PortNum, &reqp->u.PortStatus,
+							PortCountersCallback, reqp);
+		}
+	}
+	(void)MadPipeWait(pipep);
+	MadPipeDestroy(pipep);
+#ifdef PRODUCT_OPENIB_FF
+	if ((begin || end) && (g_paclient_state == OMGT_SERVICE_STATE_OPERATIONAL)) {
+		status = omgt_pa_release_image(g_portHandle, img_id_end);
+		if (status != FSUCCESS) {
+			memcpy((uint8 *)&absolute_time, (uint8 *)&img_id_end.imageTime.absoluteTime, sizeof(uint32));
+			fprintf(stderr, "%s: failed to release frozen image at %s\n", __func__, ctime((time_t *)&absolute_time));
+		}
+		if (begin_frozen) {
+			begin_frozen = FALSE;
 			status = omgt_pa_release_image(g_portHandle, img_id_begin);
 			if (status != FSUCCESS) {
 				memcpy((uint8 *)&absolute_time, (uint8 *)&img_id_begin.imageTime.absoluteTime, sizeof(uint32));
 				fprintf(stderr, "%s: failed to release frozen image at %s\n", __func__, ctime((time_t *)&absolute_time));
-				return status;
 			}
-		} else if (status != FSUCCESS) {
-			memcpy((uint8 *)&absolute_time, (uint8 *)&img_id_begin.imageTime.absoluteTime, sizeof(uint32));
-			fprintf(stderr, "%s: failed to freeze image at %s\n", __func__, ctime((time_t *)&absolute_time));
-			return status;
 		}
 	}
 #endif
 
+	/* pass 3: attach results to ports, reqs are grouped by node */
+	for (n=0; n < num_reqs; n++) {
+		PortCountersReq_t *reqp = &reqs[n];
+		PortData *portp = reqp->portp;
 
+		if (FSUCCESS != reqp->status) {
+			DBGPRINT("Unable to get Port Counters for Port %d LID 0x%08x Node 0x%016"PRIx64"\n",
+				portp->PortNum, portp->EndPortLID,
+				portp->nodep->NodeInfo.NodeGUID);
+			DBGPRINT("    Name: %.*s\n",
+				STL_NODE_DESCRIPTION_ARRAY_SIZE,
+				(char*)portp->nodep->NodeDesc.NodeString);
+			nrsp_port_count++;
+			fail = TRUE;
+		} else {
+			if (g_paclient_state != OMGT_SERVICE_STATE_OPERATIONAL) {
+				StlPortStatusToPortCounters(&reqp->u.PortStatus,
+							&fabricp->PortCountersSlab[n], &portp->PortInfo);
+			} else if (FSUCCESS == reqp->beginStatus) {
+				// compute begin to end delta in place
+				CounterSelectMask_t clearedCounters = DiffPACounters(
+					&fabricp->PortCountersSlab[n], &reqp->u.BeginCounters,
+					&fabricp->PortCountersSlab[n]);
+
+				if (clearedCounters.AsReg32) {
+					char counterBuf[128];
+
+					FormatStlCounterSelectMask(counterBuf, clearedCounters);
+					fprintf(stderr, "Counters reset on LID 0x%x port %u Node 0x%016"PRIx64" Name: %.*s, reporting latest count: %s\n",
+						reqp->lid, portp->PortNum, portp->nodep->NodeInfo.NodeGUID,
+						STL_NODE_DESCRIPTION_ARRAY_SIZE, (char *)portp->nodep->NodeDesc.NodeString,
+						counterBuf);
+				}
+			}
+			PortDataFreePortCounters(fabricp, portp);
+			portp->pPortCounters = &fabricp->PortCountersSlab[n];
+			got = TRUE;
+		}
+		if (n+1 == num_reqs || reqs[n+1].portp->nodep != portp->nodep) {
+			if (got)
+				node_count++;
+			if (fail)
+				nrsp_node_count++;
+			got = fail = FALSE;
+		}
+	}
+
+	if (! quiet) ProgressPrint(TRUE, "Done Getting All Port Counters");
+	if (nrsp_port_count)
+		if (! quiet) ProgressPrint(TRUE, "Unable to get %u Ports on %u Nodes", nrsp_port_count, nrsp_node_count);
+	fabricp->flags |= FF_STATS;
+	status = FSUCCESS;	// TBD
+
+done:
+	if (reqs)
+		MemoryDeallocate(reqs);
 	//Close the opamgt port handle
 	if (g_portHandle) {
 		omgt_close_port(g_portHandle);
@@ -2912,14 +3178,19 @@ FSTATUS GetAllPortCounters(EUI64 portGuid, IB_GID localGid, FabricData_t *fabric
 		g_paclient_state = OMGT_SERVICE_STATE_UNKNOWN;
 #endif
 	}
+	return status;
 
-	if (! quiet) ProgressPrint(TRUE, "Done Getting All Port Counters");
-	if (nrsp_port_count)
-		if (! quiet) ProgressPrint(TRUE, "Unable to get %u Ports on %u Nodes", nrsp_port_count, nrsp_node_count);
-	fabricp->flags |= FF_STATS;
-	return FSUCCESS;	// TBD
+fail:
+#ifdef PRODUCT_OPENIB_FF
+	if ((begin || end) && (g_paclient_state == OMGT_SERVICE_STATE_OPERATIONAL))
+		(void)omgt_pa_release_image(g_portHandle, img_id_end);
+	if (begin_frozen)
+		(void)omgt_pa_release_image(g_portHandle, img_id_begin);
+#endif
+	goto done;
 }
 
+
 static FSTATUS GetAllVFs(struct omgt_port *port, EUI64 portGuid, FabricData_t *fabricp, int quiet)
 {
 	FSTATUS status = FERROR;
@@ -2941,7 +3212,7 @@ static FSTATUS GetAllVFs(struct omgt_port *port, EUI64 portGuid, FabricData_t *f
 		iba_sd_query_result_type_msg(query.OutputType));
 
 	// this call is synchronous
-	status = omgt_query_sa(port, &query, &pQueryResults);
+	status = SweepQuerySa(port, &query, &pQueryResults);
 	if (!pQueryResults)
 	{
 		fprintf( stderr, "%*sSA VFInfo query Failed: %s\n", 0, "",
@@ -2985,7 +3256,7 @@ static FSTATUS GetAllVFs(struct omgt_port *port, EUI64 portGuid, FabricData_t *f
 	if (! quiet) ProgressPrint(TRUE, "Done Getting vFabric Records");
 
 free:
-	omgt_free_query_result_buffer(pQueryResults);
+	SweepFreeQueryResults(pQueryResults);
 	return status;
 }
 
@@ -4032,7 +4303,7 @@ static FSTATUS GetAllFDBsSA(struct omgt_port *port, FabricData_t *fabricp, Point
 					iba_sd_query_result_type_msg(query.OutputType));
 
 				// this call is synchronous
-				status = omgt_query_sa(port, &query, &pQueryResultsLinearFDB);
+				status = SweepQuerySa(port, &query, &pQueryResultsLinearFDB);
 				if (! pQueryResultsLinearFDB)
 				{
 					fprintf( stderr, "%*sSA LinearFDB query for LID 0x%X Failed: %s\n", 0, "",
@@ -4077,7 +4348,7 @@ static FSTATUS GetAllFDBsSA(struct omgt_port *port, FabricData_t *fabricp, Point
 					iba_sd_query_result_type_msg(query.OutputType));
 
 				// this call is synchronous
-				status = omgt_query_sa(port, &query, &pQueryResultsPGT);
+				status = SweepQuerySa(port, &query, &pQueryResultsPGT);
 				if (! pQueryResultsPGT)
 				{
 					fprintf( stderr, "%*sSA PortGroup query for LID 0x%X Failed: %s\n", 0, "",
@@ -4114,7 +4385,7 @@ static FSTATUS GetAllFDBsSA(struct omgt_port *port, FabricData_t *fabricp, Point
 					iba_sd_query_result_type_msg(query.OutputType));
 
 				// this call is synchronous
-				status = omgt_query_sa(port, &query, &pQueryResultsPGFT);
+				status = SweepQuerySa(port, &query, &pQueryResultsPGFT);
 				if (! pQueryResultsPGFT)
 				{
 					fprintf( stderr, "%*sSA PGFT query for LID 0x%X Failed: %s\n", 0, "",
@@ -4160,7 +4431,7 @@ static FSTATUS GetAllFDBsSA(struct omgt_port *port, FabricData_t *fabricp, Point
 				iba_sd_query_result_type_msg(query.OutputType));
 
 			// this call is synchronous
-			status = omgt_query_sa(port, &query, &pQueryResultsMulticastFDB);
+			status = SweepQuerySa(port, &query, &pQueryResultsMulticastFDB);
 			if (! pQueryResultsMulticastFDB)
 			{
 				fprintf( stderr, "%*sSA MulticastFDB query for LID 0x%X Failed: %s\n", 0, "",
@@ -4259,23 +4530,23 @@ static FSTATUS GetAllFDBsSA(struct omgt_port *port, FabricData_t *fabricp, Point
 
 			// Free query results buffers
 			if (pQueryResultsMulticastFDB) {
-				omgt_free_query_result_buffer(pQueryResultsMulticastFDB);
+				SweepFreeQueryResults(pQueryResultsMulticastFDB);
 				pQueryResultsMulticastFDB = NULL;
 			}
 
 
 			if (pQueryResultsLinearFDB) {
-				omgt_free_query_result_buffer(pQueryResultsLinearFDB);
+				SweepFreeQueryResults(pQueryResultsLinearFDB);
 				pQueryResultsLinearFDB = NULL;
 			}
 
 			if (pQueryResultsPGT) {
-				omgt_free_query_result_buffer(pQueryResultsPGT);
+				SweepFreeQueryResults(pQueryResultsPGT);
 				pQueryResultsPGT = NULL;
 			}
 
 			if (pQueryResultsPGFT) {
-				omgt_free_query_result_buffer(pQueryResultsPGFT);
+				SweepFreeQueryResults(pQueryResultsPGFT);
 				pQueryResultsPGFT = NULL;
 			}
 
@@ -4293,29 +4564,342 @@ static FSTATUS GetAllFDBsSA(struct omgt_port *port, FabricData_t *fabricp, Point
 
 }	// End of GetAllFDBsSA()
 
-/* query all forwarding DBs on switch nodes in fabric directly from SMA
+static const MadPipeTransport_t *g_FdbSmaTransport = NULL;
+
+void SetFdbSmaTransport(const MadPipeTransport_t *transport)
+{
+	g_FdbSmaTransport = transport;
+}
+
+// max SMA FDB block requests GetAllFDBsDirect keeps outstanding in total
+#define FDB_WINDOW			64
+// max FDB block requests outstanding to any one switch, so a large fabric
+// spreads the window across switches rather than flooding a single SMA
+#define FDB_SWITCH_WINDOW	4
+// switches fetched from at once, twice what is needed to fill FDB_WINDOW
+// so a slow switch does not leave the window idle
+#define FDB_ACTIVE_SWITCHES	(2*FDB_WINDOW/FDB_SWITCH_WINDOW)
+
+// kinds of FDB block, in the order they are fetched from each switch
+typedef enum {
+	FDB_BLOCK_LFT,
+	FDB_BLOCK_MFT,
+	FDB_BLOCK_PGFT,
+	FDB_BLOCK_PGT,
+	FDB_BLOCK_DONE
+} FdbBlockKind_t;
+
+struct FdbSwitchReq_s;
+struct FdbContext_s;
+
+// a single outstanding FDB block request
+typedef struct FdbBlockReq_s {
+	struct FdbSwitchReq_s *swreqp;	// switch block is for
+	FdbBlockKind_t	kind;
+	uint32			block;
+	uint8			position;		// MFT only
+	union {
+		STL_LINEAR_FORWARDING_TABLE		LinearFDB;
+		STL_MULTICAST_FORWARDING_TABLE	MulticastFDB;
+		STL_PORT_GROUP_FORWARDING_TABLE	PortGroupFDB;
+		STL_PORT_GROUP_TABLE			PortGroupTable;
+	} u;
+} FdbBlockReq_t;
+
+// a switch whose FDB blocks are being fetched
+typedef struct FdbSwitchReq_s {
+	struct FdbContext_s *ctxp;
+	NodeData		*nodep;			// NULL when slot is idle
+	STL_LID			lid;
+	uint32			linearFDBSize;
+	uint32			multicastFDBSize;
+	uint32			pgFDBSize;
+	uint32			pgSize;
+	uint32			limit[FDB_BLOCK_DONE];	// number of blocks of each kind
+	uint8			maxPosition;	// last MFT position
+	FdbBlockKind_t	kind;			// next block to issue
+	uint32			block;
+	uint8			position;
+	uint32			outstanding;	// block requests in MadPipe
+	uint32			failures;		// blocks which could not be fetched
+	FdbBlockReq_t	blocks[FDB_SWITCH_WINDOW];
+} FdbSwitchReq_t;
+
+typedef struct FdbContext_s {
+	MadPipe_t		*pipep;
+	NodeData		**switches;		// switches to fetch from
+	uint32			numSwitches;
+	uint32			nextSwitch;		// next entry in switches to start
+	uint32			doneSwitches;
+	uint32			failedSwitches;
+	int				quiet;
+	FdbSwitchReq_t	active[FDB_ACTIVE_SWITCHES];
+} FdbContext_t;
+
+/* pick the next block to fetch from the switch into blkp.
+ * Returns FALSE when all of the switch's blocks have been issued.
+ */
+static boolean FdbNextBlock(FdbSwitchReq_t *swreqp, FdbBlockReq_t *blkp)
+{
+	while (swreqp->kind < FDB_BLOCK_DONE) {
+		if (swreqp->block < swreqp->limit[swreqp->kind]) {
+			blkp->kind = swreqp->kind;
+			blkp->block = swreqp->block;
+			blkp->position = swreqp->position;
+			if (swreqp->kind == FDB_BLOCK_MFT
+				&& swreqp->position < swreqp->maxPosition) {
+				swreqp->position++;
+			} else {
+				swreqp->position = 0;
+				swreqp->block++;
+			}
+			return TRUE;
+		}
+		swreqp->kind++;
+		swreqp->block = 0;
+		swreqp->position = 0;
+	}
+	return FALSE;
+}
+
+static void FdbBlockFailed(FdbBlockReq_t *blkp, FSTATUS status)
+{
+	FdbSwitchReq_t *swreqp = blkp->swreqp;
+	NodeData *nodep = swreqp->nodep;
+
+	switch (blkp->kind) {
+	case FDB_BLOCK_LFT:
+		fprintf(stderr, "%*sSMA Get(LFT %u) Failed to LID 0x%x Node 0x%016"PRIx64" Name: %.*s: %s\n", 0, "", blkp->block, swreqp->lid,
+			nodep->NodeInfo.NodeGUID,
+			STL_NODE_DESCRIPTION_ARRAY_SIZE,
+			(char*)nodep->NodeDesc.NodeString, iba_fstatus_msg(status));
+		break;
+	case FDB_BLOCK_MFT:
+		fprintf(stderr, "%*sSMA Get(MFT %u %u) Failed to LID 0x%08x Node 0x%016"PRIx64" Name: %.*s: %s\n", 0, "", blkp->block, blkp->position, swreqp->lid,
+			nodep->NodeInfo.NodeGUID,
+			STL_NODE_DESCRIPTION_ARRAY_SIZE,
+			(char*)nodep->NodeDesc.NodeString, iba_fstatus_msg(status));
+		break;
+	case FDB_BLOCK_PGFT:
+		fprintf(stderr, "%*sSMA Get(PortGroupFDB %u) Failed to LID 0x%x Node 0x%016"PRIx64" Name: %.*s: %s\n", 0, "", blkp->block, swreqp->lid,
+			nodep->NodeInfo.NodeGUID,
+			STL_NODE_DESCRIPTION_ARRAY_SIZE,
+			(char*)nodep->NodeDesc.NodeString, iba_fstatus_msg(status));
+		break;
+	case FDB_BLOCK_PGT:
+	default:
+		fprintf(stderr, "%*sSMA Get(PortGroupTable %u) Failed to LID 0x%x Node 0x%016"PRIx64" Name: %.*s: %s\n", 0, "", blkp->block, swreqp->lid,
+			nodep->NodeInfo.NodeGUID,
+			STL_NODE_DESCRIPTION_ARRAY_SIZE,
+			(char*)nodep->NodeDesc.NodeString, iba_fstatus_msg(status));
+		break;
+	}
+	swreqp->failures++;
+}
+
+/* copy a fetched block into the switch's tables */
+static void FdbBlockDone(FdbBlockReq_t *blkp)
+{
+	FdbSwitchReq_t *swreqp = blkp->swreqp;
+	NodeData *nodep = swreqp->nodep;
+	uint32 ix;
+
+	switch (blkp->kind) {
+	case FDB_BLOCK_LFT:
+		BSWAP_STL_LINEAR_FORWARDING_TABLE(&blkp->u.LinearFDB);
+		ix = blkp->block;
+		CopyLinearFDBBlock( &nodep->switchp->LinearFDB[ix],
+			blkp->u.LinearFDB.LftBlock,
+			MIN(swreqp->linearFDBSize - ix, (int)MAX_LFT_ELEMENTS_BLOCK));
+		break;
+	case FDB_BLOCK_MFT:
+		BSWAP_STL_MULTICAST_FORWARDING_TABLE(&blkp->u.MulticastFDB);
+		ix = blkp->block * STL_NUM_MFT_ELEMENTS_BLOCK;
+		CopyMulticastFDBBlock( nodep,
+			GetMulticastFDBEntry(nodep, ix, blkp->position),
+			blkp->u.MulticastFDB.MftBlock,
+			MIN(swreqp->multicastFDBSize-ix,STL_NUM_MFT_ELEMENTS_BLOCK));
+		break;
+	case FDB_BLOCK_PGFT:
+		BSWAP_STL_PORT_GROUP_FORWARDING_TABLE(&blkp->u.PortGroupFDB);
+		ix = blkp->block;
+		CopyPortGroupFDBBlock(&nodep->switchp->PortGroupFDB[ix],
+			blkp->u.PortGroupFDB.PgftBlock,
+			MIN(swreqp->pgFDBSize - ix, (int)NUM_PGFT_ELEMENTS_BLOCK));
+		break;
+	case FDB_BLOCK_PGT:
+	default:
+		BSWAP_STL_PORT_GROUP_TABLE(&blkp->u.PortGroupTable);
+		ix = blkp->block;
+		CopyPortGroupBlock(&nodep->switchp->PortGroupElements[ix*NUM_PGT_ELEMENTS_BLOCK],
+			blkp->u.PortGroupTable.PgtBlock,
+			(MIN(swreqp->pgSize - (ix*NUM_PGT_ELEMENTS_BLOCK), (int)NUM_PGT_ELEMENTS_BLOCK)) * sizeof(STL_PORTMASK));
+		break;
+	}
+}
+
+static void FdbBlockCallback(void *context, FSTATUS status);
+
+/* issue the switch's next block using blkp.  Blocks which cannot be
+ * submitted are reported as failed and the following block is tried.
+ */
+static void FdbIssueBlock(FdbSwitchReq_t *swreqp, FdbBlockReq_t *blkp)
+{
+	FSTATUS status;
+	uint32 attr;
+	uint32 modifier;
+	uint32 length;
+
+	while (FdbNextBlock(swreqp, blkp)) {
+		switch (blkp->kind) {
+		case FDB_BLOCK_LFT:
+			attr = STL_MCLASS_ATTRIB_ID_LINEAR_FWD_TABLE;
+			modifier = 0x01000000 + blkp->block;
+			length = sizeof(STL_LINEAR_FORWARDING_TABLE);
+			break;
+		case FDB_BLOCK_MFT:
+			attr = STL_MCLASS_ATTRIB_ID_MCAST_FWD_TABLE;
+			modifier = (0x1<<24) | (0x3 & blkp->position)<<22 | (blkp->block & 0xfffff);
+			length = sizeof(STL_MULTICAST_FORWARDING_TABLE);
+			break;
+		case FDB_BLOCK_PGFT:
+			attr = STL_MCLASS_ATTRIB_ID_PORT_GROUP_FWD_TABLE;
+			modifier = 0x01000000 + blkp->block;
+			length = sizeof(STL_PORT_GROUP_FORWARDING_TABLE);
+			break;
+		case FDB_BLOCK_PGT:
+		default:
+			attr = STL_MCLASS_ATTRIB_ID_PORT_GROUP_TABLE;
+			modifier = 0x01000000 + blkp->block;
+			length = sizeof(STL_PORT_GROUP_TABLE);
+			break;
+		}
+		memset(&blkp->u, 0, sizeof(blkp->u));
+		status = MadPipeSmaSubmit(swreqp->ctxp->pipep, swreqp->lid, 0, NULL,
+						MMTHD_GET, attr, modifier, (uint8_t *)&blkp->u, length,
+						FdbBlockCallback, blkp);
+		if (status == FSUCCESS) {
+			swreqp->outstanding++;
+			return;
+		}
+		FdbBlockFailed(blkp, status);
+	}
+}
+
+static void FdbSwitchDone(FdbSwitchReq_t *swreqp)
+{
+	FdbContext_t *ctxp = swreqp->ctxp;
+
+	if (swreqp->failures)
+		ctxp->failedSwitches++;
+	ctxp->doneSwitches++;
+	if (ctxp->doneSwitches%PROGRESS_FREQ == 0)
+		if (! ctxp->quiet) ProgressPrint(FALSE, "Processed %6d of %6d Switches...", ctxp->doneSwitches, ctxp->numSwitches);
+}
+
+/* start fetching from the next switch which has blocks to fetch,
+ * leaves the slot idle when there are no more switches
+ */
+static void FdbStartSwitch(FdbSwitchReq_t *swreqp)
+{
+	FdbContext_t *ctxp = swreqp->ctxp;
+	int i;
+
+	while (ctxp->nextSwitch < ctxp->numSwitches) {
+		NodeData *nodep = ctxp->switches[ctxp->nextSwitch++];
+		STL_SWITCHINFO_RECORD *pSwitchInfo = nodep->pSwitchInfo;
+
+		swreqp->nodep = nodep;
+		swreqp->lid = pSwitchInfo->RID.LID;
+		swreqp->linearFDBSize = pSwitchInfo->SwitchInfoData.LinearFDBTop+1;
+		swreqp->multicastFDBSize = ComputeMulticastFDBSize(&pSwitchInfo->SwitchInfoData);
+		swreqp->maxPosition = (nodep->NodeInfo.NumPorts) / STL_PORT_MASK_WIDTH;
+		MemoryClear(swreqp->limit, sizeof(swreqp->limit));
+		if (pSwitchInfo->SwitchInfoData.RoutingMode.Enabled == STL_ROUTE_LINEAR)
+			swreqp->limit[FDB_BLOCK_LFT] = ROUNDUP(swreqp->linearFDBSize,MAX_LFT_ELEMENTS_BLOCK)/MAX_LFT_ELEMENTS_BLOCK;
+		swreqp->limit[FDB_BLOCK_MFT] = ROUNDUP(swreqp->multicastFDBSize,STL_NUM_MFT_ELEMENTS_BLOCK)/STL_NUM_MFT_ELEMENTS_BLOCK;
+		if (pSwitchInfo->SwitchInfoData.AdaptiveRouting.s.Enable) {
+			swreqp->pgFDBSize = MIN(pSwitchInfo->SwitchInfoData.LinearFDBTop+1,
+								pSwitchInfo->SwitchInfoData.PortGroupFDBCap ?
+									pSwitchInfo->SwitchInfoData.PortGroupFDBCap :
+									DEFAULT_MAX_PGFT_LID+1);
+			swreqp->limit[FDB_BLOCK_PGFT] = ROUNDUP(swreqp->pgFDBSize, NUM_PGFT_ELEMENTS_BLOCK)/NUM_PGFT_ELEMENTS_BLOCK;
+			swreqp->pgSize = pSwitchInfo->SwitchInfoData.PortGroupTop;
+			swreqp->limit[FDB_BLOCK_PGT] = ROUNDUP(swreqp->pgSize, NUM_PGT_ELEMENTS_BLOCK)/NUM_PGT_ELEMENTS_BLOCK;
+		}
+		swreqp->kind = FDB_BLOCK_LFT;
+		swreqp->block = 0;
+		swreqp->position = 0;
+		swreqp->outstanding = 0;
+		swreqp->failures = 0;
+		for (i=0; i < FDB_SWITCH_WINDOW; i++) {
+			swreqp->blocks[i].swreqp = swreqp;
+			FdbIssueBlock(swreqp, &swreqp->blocks[i]);
+		}
+		if (swreqp->outstanding)
+			return;
+		FdbSwitchDone(swreqp);
+	}
+	swreqp->nodep = NULL;
+}
+
+/* called by MadPipeWait as each block completes.  Reuses the block's slot
+ * for the switch's next block, or moves on to the next switch once all of
+ * this switch's blocks are done.
+ */
+static void FdbBlockCallback(void *context, FSTATUS status)
+{
+	FdbBlockReq_t *blkp = (FdbBlockReq_t *)context;
+	FdbSwitchReq_t *swreqp = blkp->swreqp;
+
+	swreqp->outstanding--;
+	if (status == FSUCCESS)
+		FdbBlockDone(blkp);
+	else
+		FdbBlockFailed(blkp, status);
+	FdbIssueBlock(swreqp, blkp);
+	if (! swreqp->outstanding) {
+		FdbSwitchDone(swreqp);
+		FdbStartSwitch(swreqp);
+	}
+}
+
+/* query all forwarding DBs on switch nodes in fabric directly from SMA.
+ * Blocks are pipelined through a MadPipe_t, up to FDB_SWITCH_WINDOW per
+ * switch and FDB_WINDOW in total, with FDB_ACTIVE_SWITCHES switches in
+ * progress at once.
  */
 static FSTATUS GetAllFDBsDirect(struct omgt_port *port, FabricData_t *fabricp, Point *focus, int quiet)
 {
 	FSTATUS	status = FSUCCESS;
-	int ix, ix_node;
-	unsigned block, position;
+	int ix_node;
+	int i;
+	FdbContext_t *ctxp;
 
 	cl_map_item_t *p;
 
-	STL_LINEAR_FORWARDING_TABLE		linearFDB;
-	STL_MULTICAST_FORWARDING_TABLE	multicastFDB;
-	STL_PORT_GROUP_TABLE			pgt;
-	STL_PORT_GROUP_FORWARDING_TABLE	pgFDB;
-
 	uint32	linearFDBSize; // Size increased in STL
 	uint32	multicastFDBSize;
-	uint32	pgSize;
-	uint32	pgFDBSize;
 
 	int num_nodes = cl_qmap_count(&fabricp->AllNodes);
 
 	if (! quiet) ProgressPrint(TRUE, "Getting All FDB Tables...");
+	ctxp = (FdbContext_t *)MemoryAllocate2AndClear(sizeof(FdbContext_t), IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! ctxp) {
+		fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
+		return FINSUFFICIENT_MEMORY;
+	}
+	ctxp->quiet = quiet;
+	if (num_nodes) {
+		ctxp->switches = (NodeData **)MemoryAllocate2AndClear(sizeof(NodeData *)*num_nodes, IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+		if (! ctxp->switches) {
+			fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
+			status = FINSUFFICIENT_MEMORY;
+			goto done;
+		}
+	}
+
+	// pass 1: allocate SwitchData and select the switches to fetch from
 	for ( p=cl_qmap_head(&fabricp->AllNodes), ix_node = 0; p != cl_qmap_end(&fabricp->AllNodes);
 			p = cl_qmap_next(p), ix_node++ )
 	{
@@ -4328,106 +4912,52 @@ static FSTATUS GetAllFDBsDirect(struct omgt_port *port, FabricData_t *fabricp, P
 
 		// Process switch nodes
 		if (nodep->NodeInfo.NodeType == STL_NODE_SW) {
-			STL_LID lid = nodep->pSwitchInfo->RID.LID;
-			uint32_t limit;
-
 			linearFDBSize = nodep->pSwitchInfo->SwitchInfoData.LinearFDBTop+1;
 			multicastFDBSize = ComputeMulticastFDBSize(&nodep->pSwitchInfo->SwitchInfoData);
- 			limit = ROUNDUP(linearFDBSize,MAX_LFT_ELEMENTS_BLOCK)/MAX_LFT_ELEMENTS_BLOCK;
 
 			// Add LinearFDB and MulticastFDB data to SwitchData
 			status = NodeDataAllocateSwitchData( fabricp, nodep, linearFDBSize,
 				multicastFDBSize);
 			if (status != FSUCCESS)
 				break;
-
-			if (nodep->pSwitchInfo->SwitchInfoData.RoutingMode.Enabled == STL_ROUTE_LINEAR) {
-				for (ix = 0; ix < limit; ix++) {
-					status = SmaGetLinearFDBTable(port, lid, 0, NULL, ix, &linearFDB);
-					if (status != FSUCCESS)
-					{
-						fprintf(stderr, "%*sSMA Get(LFT %u) Failed to LID 0x%x Node 0x%016"PRIx64" Name: %.*s: %s\n", 0, "", ix, lid,
-							nodep->NodeInfo.NodeGUID,
-							STL_NODE_DESCRIPTION_ARRAY_SIZE,
-							(char*)nodep->NodeDesc.NodeString, iba_fstatus_msg(status));
-					} else {
-						CopyLinearFDBBlock( &nodep->switchp->LinearFDB[ix],
-							linearFDB.LftBlock,
-							MIN(linearFDBSize - ix, (int)MAX_LFT_ELEMENTS_BLOCK));
-					}
-				}
-			}
-
-			int maxPosition = (nodep->NodeInfo.NumPorts) / STL_PORT_MASK_WIDTH; 
-			for (ix = 0, block=0; ix < multicastFDBSize; ix += STL_NUM_MFT_ELEMENTS_BLOCK, block++) {
-				for (position=0; position <= maxPosition; position++) {
-					status = SmaGetMulticastFDBTable(port, lid, 0, NULL, block, position, &multicastFDB);
-					if (status != FSUCCESS)
-					{
-						fprintf(stderr, "%*sSMA Get(MFT %u %u) Failed to LID 0x%08x Node 0x%016"PRIx64" Name: %.*s: %s\n", 0, "", block, position, lid,
-							nodep->NodeInfo.NodeGUID,
-							STL_NODE_DESCRIPTION_ARRAY_SIZE,
-							(char*)nodep->NodeDesc.NodeString, iba_fstatus_msg(status));
-					} else {
-						CopyMulticastFDBBlock( nodep,
-							GetMulticastFDBEntry(nodep, block * STL_NUM_MFT_ELEMENTS_BLOCK, position),
-							multicastFDB.MftBlock, MIN(multicastFDBSize-ix,STL_NUM_MFT_ELEMENTS_BLOCK));
-					}
-				}
-			}
-
-			if (nodep->pSwitchInfo->SwitchInfoData.AdaptiveRouting.s.Enable) {
-				// Query Port Group FDB records
-				pgFDBSize = MIN(nodep->pSwitchInfo->SwitchInfoData.LinearFDBTop+1,
-								nodep->pSwitchInfo->SwitchInfoData.PortGroupFDBCap ?
-									nodep->pSwitchInfo->SwitchInfoData.PortGroupFDBCap :
-									DEFAULT_MAX_PGFT_LID+1);
-
-				limit = ROUNDUP(pgFDBSize, NUM_PGFT_ELEMENTS_BLOCK)/NUM_PGFT_ELEMENTS_BLOCK;
-				for (ix = 0; ix < limit; ix++) {
-					status = SmaGetPortGroupFDBTable(port, lid, 0, NULL, ix, &pgFDB);
-					if (status != FSUCCESS)
-					{
-						fprintf(stderr, "%*sSMA Get(PortGroupFDB %u) Failed to LID 0x%x Node 0x%016"PRIx64" Name: %.*s: %s\n", 0, "", ix, lid,
-							nodep->NodeInfo.NodeGUID,
-							STL_NODE_DESCRIPTION_ARRAY_SIZE,
-							(char*)nodep->NodeDesc.NodeString, iba_fstatus_msg(status));
-					} else {
-						CopyPortGroupFDBBlock(&nodep->switchp->PortGroupFDB[ix],
-							pgFDB.PgftBlock,
-							MIN(pgFDBSize - ix, (int)NUM_PGFT_ELEMENTS_BLOCK));
-					}
-				}
-
-				pgSize = nodep->pSwitchInfo->SwitchInfoData.PortGroupTop;
-				limit = ROUNDUP(pgSize, NUM_PGT_ELEMENTS_BLOCK)/NUM_PGT_ELEMENTS_BLOCK;
-				for (ix = 0; ix < limit; ix++) {
-					status = SmaGetPortGroupTable(port, lid, 0, NULL, ix, &pgt);
-					if (status != FSUCCESS)
-					{
-						fprintf(stderr, "%*sSMA Get(PortGroupTable %u) Failed to LID 0x%x Node 0x%016"PRIx64" Name: %.*s: %s\n", 0, "", ix, lid,
-							nodep->NodeInfo.NodeGUID,
-							STL_NODE_DESCRIPTION_ARRAY_SIZE,
-							(char*)nodep->NodeDesc.NodeString, iba_fstatus_msg(status));
-					} else {
-						CopyPortGroupBlock(&nodep->switchp->PortGroupElements[ix*NUM_PGT_ELEMENTS_BLOCK],
-							pgt.PgtBlock,
-							(MIN(pgSize - (ix*NUM_PGT_ELEMENTS_BLOCK), (int)NUM_PGT_ELEMENTS_BLOCK)) * sizeof(STL_PORTMASK));
-					}
-				}
-			}
-
-
-
-
+			ctxp->switches[ctxp->numSwitches++] = nodep;
 		}	// End of if (nodep->NodeInfo.NodeType == STL_NODE_SW
 
 	}	// End of for ( p=cl_qmap_head(&fabricp->AllNodes)
 
+	// pass 2: fetch every block of every selected switch, switches which
+	// were allocated before any allocation failure are still fetched
+	// port may be a simulated SA's, a simulated SMA does not need it
+	if (g_FdbSmaTransport)
+		ctxp->pipep = MadPipeCreateTransport(NULL, g_FdbSmaTransport, FDB_WINDOW);
+	else
+		ctxp->pipep = MadPipeCreate(port, FDB_WINDOW);
+	if (! ctxp->pipep) {
+		fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
+		status = FINSUFFICIENT_MEMORY;
+		goto done;
+	}
+	for (i=0; i < FDB_ACTIVE_SWITCHES; i++) {
+		ctxp->active[i].ctxp = ctxp;
+		FdbStartSwitch(&ctxp->active[i]);
+	}
+	(void)MadPipeWait(ctxp->pipep);
+	MadPipeDestroy(ctxp->pipep);
+
+	// A block which cannot be fetched is reported but does not fail the
+	// call, so one bad switch does not lose the routes of the whole fabric.
+	if (ctxp->failedSwitches)
+		fprintf(stderr, "%s: Unable to get all FDB blocks from %u of %u switches\n",
+			g_Top_cmdname, ctxp->failedSwitches, ctxp->numSwitches);
+
 	fabricp->flags |= FF_ROUTES;
 
 	if (! quiet) ProgressPrint(TRUE, "Done Getting All FDB Tables");
 
+done:
+	if (ctxp->switches)
+		MemoryDeallocate(ctxp->switches);
+	MemoryDeallocate(ctxp);
 	return (status);
 
 }	// End of GetAllFDBsDirect()
@@ -4439,18 +4969,17 @@ FSTATUS GetAllFDBs(EUI64 portGuid, FabricData_t *fabricp, Point *focus, int quie
 	struct omgt_port *omgt_port_session = NULL;
 	FSTATUS fstatus = FSUCCESS;
 
-	fstatus = omgt_open_port_by_guid(&omgt_port_session, portGuid, NULL);
+	fstatus = g_SweepSa.open(&omgt_port_session, portGuid, fabricp->ms_timeout);
 	if (fstatus != FSUCCESS) {
 		fprintf(stderr, "%s: Unable to open fabric interface.\n",
 				g_Top_cmdname);
 	} else {
-		omgt_set_timeout(omgt_port_session, fabricp->ms_timeout);
 		if (fabricp->flags & FF_SMADIRECT) {
 			fstatus = GetAllFDBsDirect(omgt_port_session, fabricp, focus, quiet);
 		} else {
 			fstatus = GetAllFDBsSA(omgt_port_session, fabricp, focus, quiet);
 		}
-		omgt_close_port(omgt_port_session);
+		g_SweepSa.close(omgt_port_session);
 	}
 	return fstatus;
 }	// End of GetAllFDBs
@@ -4627,11 +5156,122 @@ FSTATUS InitSweepVerbose(FILE *verbose_file)
 		return FSUCCESS;
 }
 
+typedef FSTATUS (SweepPhaseFunc)(struct omgt_port *port, EUI64 portGuid,
+						FabricData_t *fabricp, SweepFlags_t flags, int quiet);
+
+static FSTATUS SweepMasterSMData(struct omgt_port *port, EUI64 portGuid,
+						FabricData_t *fabricp, SweepFlags_t flags, int quiet)
+{
+	FSTATUS fstatus;
+
+	// get QLogic master SM data if available
+	fstatus = GetMasterSMData(port, portGuid, fabricp, flags, quiet);
+	return (fstatus == FUNAVAILABLE) ? FSUCCESS : fstatus;
+}
+
+static FSTATUS SweepLinks(struct omgt_port *port, EUI64 portGuid,
+						FabricData_t *fabricp, SweepFlags_t flags, int quiet)
+{
+	return GetAllLinks(port, portGuid, fabricp, quiet);
+}
+
+static FSTATUS SweepCables(struct omgt_port *port, EUI64 portGuid,
+						FabricData_t *fabricp, SweepFlags_t flags, int quiet)
+{
+	return GetAllCables(port, portGuid, fabricp, quiet);
+}
+
+static FSTATUS SweepSMs(struct omgt_port *port, EUI64 portGuid,
+						FabricData_t *fabricp, SweepFlags_t flags, int quiet)
+{
+	if (! (flags & SWEEP_SM))
+		return FSUCCESS;
+	return GetAllSMs(port, portGuid, fabricp, quiet);
+}
+
+static FSTATUS SweepVFs(struct omgt_port *port, EUI64 portGuid,
+						FabricData_t *fabricp, SweepFlags_t flags, int quiet)
+{
+	return GetAllVFs(port, portGuid, fabricp, quiet);
+}
+
+typedef enum {
+	SWEEP_PHASE_MASTERSM,
+	SWEEP_PHASE_NODES,
+	SWEEP_PHASE_LINKS,
+	SWEEP_PHASE_CABLES,
+	SWEEP_PHASE_SMS,
+	SWEEP_PHASE_VFS,
+	SWEEP_PHASE_COUNT
+} SweepPhaseId_t;
+
+#define SWEEP_PHASE_BIT(id) (1 << (id))
+
+// phases in an order they could be done one at a time, in which case
+// this is also the order their progress output appears in
+static const struct {
+	SweepPhaseFunc *func;
+	uint32 deps;		// SWEEP_PHASE_BIT of phases which must be done first
+} g_SweepPhases[SWEEP_PHASE_COUNT] = {
+	{ SweepMasterSMData, 0 },
+	{ GetAllNodes, 0 },
+	{ SweepLinks, SWEEP_PHASE_BIT(SWEEP_PHASE_NODES) },
+	{ SweepCables, SWEEP_PHASE_BIT(SWEEP_PHASE_NODES) },
+	{ SweepSMs, SWEEP_PHASE_BIT(SWEEP_PHASE_NODES) },
+	{ SweepVFs, 0 },
+};
+
+typedef struct SweepPhasesContext_s {
+	EUI64 portGuid;
+	FabricData_t *fabricp;
+	SweepFlags_t flags;
+	int quiet;
+	uint32 started;		// SWEEP_PHASE_BIT of phases started
+	uint32 done;		// SWEEP_PHASE_BIT of phases completed
+	FSTATUS status[SWEEP_PHASE_COUNT];
+	boolean failed;		// a phase failed, start no more phases
+} SweepPhasesContext_t;
+
+static void SweepPhasesWork(struct omgt_port *port, void *context)
+{
+	SweepPhasesContext_t *ctxp = (SweepPhasesContext_t *)context;
+
+	while (! ctxp->failed) {
+		uint32 pending = 0;
+		int id;
+
+		for (id=0; id < SWEEP_PHASE_COUNT; id++) {
+			if (ctxp->started & SWEEP_PHASE_BIT(id))
+				continue;
+			if ((g_SweepPhases[id].deps & ctxp->done) == g_SweepPhases[id].deps)
+				break;
+			pending |= SWEEP_PHASE_BIT(id);
+		}
+		if (id < SWEEP_PHASE_COUNT) {
+			ctxp->started |= SWEEP_PHASE_BIT(id);
+			ctxp->status[id] = (*g_SweepPhases[id].func)(port, ctxp->portGuid,
+								ctxp->fabricp, ctxp->flags, ctxp->quiet);
+			ctxp->done |= SWEEP_PHASE_BIT(id);
+			if (ctxp->status[id] != FSUCCESS)
+				ctxp->failed = TRUE;
+			pthread_cond_broadcast(&g_SweepPhaseDone);
+		} else if (pending) {
+			// phases are listed in dependency order, so a thread working
+			// alone always finds one ready and never waits here
+			pthread_cond_wait(&g_SweepPhaseDone, &g_SweepLock);
+		} else {
+			break;
+		}
+	}
+}
+
 // only FF_LIDARRAY fflag is used, others ignored
 FSTATUS Sweep(EUI64 portGuid, FabricData_t *fabricp, FabricFlags_t fflags,  SweepFlags_t flags, int quiet, int ms_timeout)
 {
 	FSTATUS fstatus;
 	struct omgt_port *omgt_port_session = NULL;
+	SweepPhasesContext_t context;
+	int id;
 
 	if (FSUCCESS != InitFabricData(fabricp, fflags)) {
 		fprintf(stderr, "%s: Unable to initialize fabric storage area\n",
@@ -4639,38 +5279,452 @@ FSTATUS Sweep(EUI64 portGuid, FabricData_t *fabricp, FabricFlags_t fflags,  Swee
 		return FERROR;
 	}
 	fabricp->ms_timeout = ms_timeout;
-	fstatus = omgt_open_port_by_guid(&omgt_port_session, portGuid, NULL);
+	fstatus = g_SweepSa.open(&omgt_port_session, portGuid, fabricp->ms_timeout);
 	if (fstatus != FSUCCESS) {
 		fprintf(stderr, "%s: Unable to open fabric interface.\n",
 					   	g_Top_cmdname);
 		return fstatus;
 	}
-	omgt_set_timeout(omgt_port_session, fabricp->ms_timeout);
 	time(&fabricp->time);
 #ifdef IB_STACK_OPENIB
 //	omgt_mad_refresh_pkey_glob();
 #endif
-	// get QLogic master SM data if available
-	if ( (FSUCCESS != (fstatus = GetMasterSMData(omgt_port_session, portGuid, fabricp, flags, quiet))) &&
-			(FUNAVAILABLE != fstatus) )
-		goto done;
+	// get the data from the SA, phases are run concurrently once the phases
+	// they depend on are done.  At most 4 phases can be ready at once
+	memset(&context, 0, sizeof(context));
+	context.portGuid = portGuid;
+	context.fabricp = fabricp;
+	context.flags = flags;
+	context.quiet = quiet;
+	SweepRunWorkers(omgt_port_session, portGuid, fabricp, 4,
+					SweepPhasesWork, &context);
+
+	// report the first failure in phase order
+	fstatus = FSUCCESS;
+	for (id=0; id < SWEEP_PHASE_COUNT; id++) {
+		if ((context.done & SWEEP_PHASE_BIT(id)) && context.status[id] != FSUCCESS) {
+			fstatus = context.status[id];
+			break;
+		}
+	}
+	g_SweepSa.close(omgt_port_session);
+	return fstatus;
+}
 
-	// get the data from the SA
-	if (FSUCCESS != (fstatus = GetAllNodes(omgt_port_session, portGuid, fabricp, flags, quiet)))
-		goto done;
-	if (FSUCCESS != (fstatus = GetAllLinks(omgt_port_session, portGuid, fabricp, quiet)))
-		goto done;
-	if (FSUCCESS != (fstatus = GetAllCables(omgt_port_session, portGuid, fabricp, quiet)))
-		goto done;
-	if (flags & SWEEP_SM) {
-		if (FSUCCESS != (fstatus = GetAllSMs(omgt_port_session, portGuid, fabricp, quiet)))
-			goto done;
+/* ------------------------------------------------------------------------- */
+/* Incremental refresh
+ *
+ * SweepRefresh brings the FabricData_t from a previous Sweep or snapshot up
+ * to date without sweeping every node again.  The NodeRecords,
+ * PortInfoRecords and LinkRecords for the whole fabric are fetched with one
+ * bulk SA query each and compared with the fabric in memory.  Only nodes
+ * which are new, or whose NodeRecord or PortInfo differ, are queried one by
+ * one the way Sweep queries every node.  Changed nodes are removed and added
+ * again, then links are removed and added to match the LinkRecords.
+ */
+
+// a node present in the NodeRecords
+typedef struct RefreshNode_s {
+	cl_map_item_t	GuidEntry;		// key is NodeGUID
+	NodeData		*nodep;			// node in fabric, NULL if new
+	uint32			numPorts;		// active ports in PortInfoRecords
+	boolean			changed;		// node must be queried again
+} RefreshNode_t;
+
+// a LID in the NodeRecords, one per NodeRecord
+typedef struct RefreshLid_s {
+	cl_map_item_t	LidEntry;		// key is LID
+	RefreshNode_t	*rnodep;
+} RefreshLid_t;
+
+/* query all records of the given type.  Returns NULL after reporting a
+ * failure, caller must free results with SweepFreeQueryResults
+ */
+static PQUERY_RESULT_VALUES SweepQueryAllRecords(struct omgt_port *port,
+					QUERY_RESULT_TYPE outputType, const char *name)
+{
+	OMGT_QUERY query;
+	FSTATUS status;
+	PQUERY_RESULT_VALUES pQueryResults = NULL;
+
+	memset(&query, 0, sizeof(query));	// initialize reserved fields
+	query.InputType 	= InputTypeNoInput;
+	query.OutputType 	= outputType;
+
+	DBGPRINT("Query: Input=%s, Output=%s\n",
+				   		iba_sd_query_input_type_msg(query.InputType),
+					   	iba_sd_query_result_type_msg(query.OutputType));
+
+	// this call is synchronous
+	status = SweepQuerySa(port, &query, &pQueryResults);
+	if (! pQueryResults)
+	{
+		fprintf(stderr, "%*sSA %sRecord query Failed: %s\n", 0, "", name, iba_fstatus_msg(status));
+		return NULL;
+	} else if (pQueryResults->Status != FSUCCESS) {
+		fprintf(stderr, "%*sSA %sRecord query Failed: %s MadStatus 0x%x: %s\n", 0, "",
+				name, iba_fstatus_msg(pQueryResults->Status),
+			   	pQueryResults->MadStatus, iba_sd_mad_status_msg(pQueryResults->MadStatus));
+		SweepFreeQueryResults(pQueryResults);
+		return NULL;
 	}
-	if (FSUCCESS != (fstatus = GetAllVFs(omgt_port_session, portGuid, fabricp, quiet)))
-		goto done;
+	DBGPRINT("MadStatus 0x%x: %s\n", pQueryResults->MadStatus,
+				   				iba_sd_mad_status_msg(pQueryResults->MadStatus));
+	DBGPRINT("%d Bytes Returned\n", pQueryResults->ResultDataSize);
+	return pQueryResults;
+}
+
+/* compare the NodeRecord fields a snapshot preserves */
+static boolean RefreshNodeRecordChanged(NodeData *nodep, STL_NODE_RECORD *pNodeRecord)
+{
+	STL_NODE_INFO *pNodeInfo = &pNodeRecord->NodeInfo;
+	PortData *portp;
+
+	if (nodep->NodeInfo.NodeType != pNodeInfo->NodeType
+		|| nodep->NodeInfo.NumPorts != pNodeInfo->NumPorts
+		|| nodep->NodeInfo.SystemImageGUID != pNodeInfo->SystemImageGUID
+		|| nodep->NodeInfo.DeviceID != pNodeInfo->DeviceID
+		|| nodep->NodeInfo.Revision != pNodeInfo->Revision
+		|| nodep->NodeInfo.u1.s.VendorID != pNodeInfo->u1.s.VendorID
+		|| nodep->NodeInfo.PartitionCap != pNodeInfo->PartitionCap
+		|| 0 != strncmp((char*)nodep->NodeDesc.NodeString,
+						(char*)pNodeRecord->NodeDesc.NodeString,
+						STL_NODE_DESCRIPTION_ARRAY_SIZE))
+		return TRUE;
+	// the port this record describes must still have the same guid and LID
+	portp = FindNodePort(nodep, (pNodeInfo->NodeType == STL_NODE_SW)
+									? 0 : pNodeInfo->u1.s.LocalPortNum);
+	return (! portp || portp->PortGUID != pNodeInfo->PortGUID
+			|| portp->EndPortLID != pNodeRecord->RID.LID);
+}
+
+/* compare the PortInfo fields which describe the port's identity and link.
+ * Fields which change on their own, such as the violation counters,
+ * are ignored so they don't make every node look changed.
+ */
+static boolean RefreshPortInfoChanged(STL_PORT_INFO *pOld, STL_PORT_INFO *pNew)
+{
+	return (pOld->LID != pNew->LID
+		|| pOld->s1.LMC != pNew->s1.LMC
+		|| pOld->PortStates.s.PortState != pNew->PortStates.s.PortState
+		|| pOld->PortStates.s.PortPhysicalState != pNew->PortStates.s.PortPhysicalState
+		|| pOld->LinkSpeed.Active != pNew->LinkSpeed.Active
+		|| pOld->LinkWidth.Active != pNew->LinkWidth.Active
+		|| pOld->LinkWidthDowngrade.TxActive != pNew->LinkWidthDowngrade.TxActive
+		|| pOld->LinkWidthDowngrade.RxActive != pNew->LinkWidthDowngrade.RxActive
+		|| pOld->MTU.Cap != pNew->MTU.Cap
+		|| pOld->NeighborNodeGUID != pNew->NeighborNodeGUID
+		|| pOld->NeighborPortNum != pNew->NeighborPortNum);
+}
+
+/* FabricDataRemoveLink clears the rate of both ports, but Sweep sets the
+ * rate of every port whether or not it is linked
+ */
+static boolean RefreshRemoveLink(FabricData_t *fabricp, PortData *portp)
+{
+	PortData *neighbor = portp->neighbor;
+
+	if (FSUCCESS != FabricDataRemoveLink(fabricp, portp))
+		return FALSE;
+	portp->rate = StlLinkSpeedWidthToStaticRate(portp->PortInfo.LinkSpeed.Active,
+									portp->PortInfo.LinkWidth.Active);
+	neighbor->rate = StlLinkSpeedWidthToStaticRate(neighbor->PortInfo.LinkSpeed.Active,
+									neighbor->PortInfo.LinkWidth.Active);
+	return TRUE;
+}
+
+/* unlink and free a node, returns number of links removed */
+static uint32 RefreshRemoveNode(FabricData_t *fabricp, NodeData *nodep)
+{
+	cl_map_item_t *q;
+	uint32 links = 0;
+
+	for (q=cl_qmap_head(&nodep->Ports); q != cl_qmap_end(&nodep->Ports); q = cl_qmap_next(q)) {
+		PortData *portp = PARENT_STRUCT(q, PortData, NodePortsEntry);
+
+		if (portp->neighbor && RefreshRemoveLink(fabricp, portp))
+			links++;
+	}
+	NodeDataFree(fabricp, nodep);
+	return links;
+}
+
+/* point multicast members and edge switches at the refreshed ports */
+static void RefreshMCGroupPorts(FabricData_t *fabricp)
+{
+	LIST_ITEM *p, *q;
+
+	for (p=QListHead(&fabricp->AllMcGroups); p != NULL; p = QListNext(&fabricp->AllMcGroups, p)) {
+		McGroupData *mcgroupp = (McGroupData *)QListObj(p);
+
+		for (q=QListHead(&mcgroupp->AllMcGroupMembers); q != NULL; q = QListNext(&mcgroupp->AllMcGroupMembers, q)) {
+			McMemberData *mcmemberp = (McMemberData *)QListObj(q);
+
+			mcmemberp->pPort = FindPortGuid(fabricp, mcmemberp->MemberInfo.RID.PortGID.AsReg64s.L);
+		}
+		for (q=QListHead(&mcgroupp->EdgeSwitchesInGroup); q != NULL; q = QListNext(&mcgroupp->EdgeSwitchesInGroup, q)) {
+			McEdgeSwitchData *mcsw = (McEdgeSwitchData *)QListObj(q);
+
+			mcsw->pPort = FindPortGuid(fabricp, mcsw->NodeGUID);
+		}
+	}
+}
+
+// only SA records are compared, so fabrics swept with FF_SMADIRECT or
+// FF_DOWNPORTINFO must be swept again in full
+FSTATUS SweepRefresh(EUI64 portGuid, FabricData_t *fabricp, SweepFlags_t flags, int quiet, int ms_timeout)
+{
+	FSTATUS fstatus;
+	struct omgt_port *omgt_port_session = NULL;
+	PQUERY_RESULT_VALUES pNodeResults = NULL;
+	PQUERY_RESULT_VALUES pPortResults = NULL;
+	PQUERY_RESULT_VALUES pLinkResults = NULL;
+	STL_NODE_RECORD_RESULTS *pNodeRecords;
+	STL_NODE_RECORD_RESULTS *pQueryNodeRecords = NULL;
+	RefreshNode_t *rnodes = NULL;
+	RefreshLid_t *rlids = NULL;
+	cl_map_item_t *rlinks = NULL;
+	cl_qmap_t guidMap, lidMap, linkMap;
+	cl_map_item_t *mi;
+	LIST_ITEM *p;
+	uint32 i, numPortRecords = 0, numLinkRecords = 0, numQuery = 0;
+	uint32 nodesAdded = 0, nodesRemoved = 0, nodesChanged = 0;
+	uint32 linksAdded = 0, linksRemoved = 0;
+	boolean listsRemoved = FALSE;	// lists must be rebuilt before return
+
+	if (fabricp->flags & (FF_SMADIRECT|FF_DOWNPORTINFO)) {
+		fprintf(stderr, "%s: Incremental refresh requires SA data, a full sweep is needed\n",
+						g_Top_cmdname);
+		return FINVALID_OPERATION;
+	}
+	fabricp->ms_timeout = ms_timeout;
+	fstatus = g_SweepSa.open(&omgt_port_session, portGuid, fabricp->ms_timeout);
+	if (fstatus != FSUCCESS) {
+		fprintf(stderr, "%s: Unable to open fabric interface.\n",
+					   	g_Top_cmdname);
+		return fstatus;
+	}
+	time(&fabricp->time);
+
+	if (! quiet) ProgressPrint(TRUE, "Getting All Node, PortInfo and Link Records...");
+	pNodeResults = SweepQueryAllRecords(omgt_port_session, OutputTypeStlNodeRecord, "Node");
+	if (! pNodeResults)
+		goto fail;
+	if (pNodeResults->ResultDataSize == 0) {
+		// don't empty the fabric because the SA had nothing to report
+		fprintf(stderr, "%*sNo Node Records Returned\n", 0, "");
+		goto fail;
+	}
+	pPortResults = SweepQueryAllRecords(omgt_port_session, OutputTypeStlPortInfoRecord, "PortInfo");
+	if (! pPortResults)
+		goto fail;
+	if (pPortResults->ResultDataSize)
+		numPortRecords = ((STL_PORTINFO_RECORD_RESULTS*)pPortResults->QueryResult)->NumPortInfoRecords;
+	pLinkResults = SweepQueryAllRecords(omgt_port_session, OutputTypeStlLinkRecord, "Link");
+	if (! pLinkResults)
+		goto fail;
+	if (pLinkResults->ResultDataSize)
+		numLinkRecords = ((STL_LINK_RECORD_RESULTS*)pLinkResults->QueryResult)->NumLinkRecords;
+
+	// find nodes which are new or changed
+	pNodeRecords = (STL_NODE_RECORD_RESULTS*)pNodeResults->QueryResult;
+	rnodes = (RefreshNode_t *)MemoryAllocate2AndClear(sizeof(RefreshNode_t)*pNodeRecords->NumNodeRecords, IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	rlids = (RefreshLid_t *)MemoryAllocate2AndClear(sizeof(RefreshLid_t)*pNodeRecords->NumNodeRecords, IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! rnodes || ! rlids) {
+		fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
+		goto fail;
+	}
+	cl_qmap_init(&guidMap, NULL);
+	cl_qmap_init(&lidMap, NULL);
+	for (i=0; i < pNodeRecords->NumNodeRecords; i++) {
+		STL_NODE_RECORD *pNodeRecord = &pNodeRecords->NodeRecords[i];
+		RefreshNode_t *rnodep = &rnodes[i];
+
+		// we get 1 NodeRecord per port on a node
+		mi = cl_qmap_insert(&guidMap, pNodeRecord->NodeInfo.NodeGUID, &rnodep->GuidEntry);
+		if (mi != &rnodep->GuidEntry)
+			rnodep = PARENT_STRUCT(mi, RefreshNode_t, GuidEntry);
+		else
+			rnodep->nodep = FindNodeGuid(fabricp, pNodeRecord->NodeInfo.NodeGUID);
+		rlids[i].rnodep = rnodep;
+		cl_qmap_insert(&lidMap, pNodeRecord->RID.LID, &rlids[i].LidEntry);
+		if (rnodep->nodep && ! rnodep->changed)
+			rnodep->changed = RefreshNodeRecordChanged(rnodep->nodep, pNodeRecord);
+	}
+	for (i=0; i < numPortRecords; i++) {
+		STL_PORTINFO_RECORD *pPortInfoRecord = &((STL_PORTINFO_RECORD_RESULTS*)pPortResults->QueryResult)->PortInfoRecords[i];
+		RefreshNode_t *rnodep;
+		PortData *portp;
+
+		// Sweep skips down ports
+		if (pPortInfoRecord->PortInfo.PortStates.s.PortState == IB_PORT_DOWN)
+			continue;
+		mi = cl_qmap_get(&lidMap, pPortInfoRecord->RID.EndPortLID);
+		if (mi == cl_qmap_end(&lidMap))
+			continue;
+		rnodep = PARENT_STRUCT(mi, RefreshLid_t, LidEntry)->rnodep;
+		rnodep->numPorts++;
+		if (! rnodep->nodep || rnodep->changed)
+			continue;
+		portp = FindNodePort(rnodep->nodep,
+					(rnodep->nodep->NodeInfo.NodeType == STL_NODE_SW)
+						? pPortInfoRecord->RID.PortNum
+						: pPortInfoRecord->PortInfo.LocalPortNum);
+		if (! portp || RefreshPortInfoChanged(&portp->PortInfo, &pPortInfoRecord->PortInfo))
+			rnodep->changed = TRUE;
+	}
+	for (mi=cl_qmap_head(&guidMap); mi != cl_qmap_end(&guidMap); mi = cl_qmap_next(mi)) {
+		RefreshNode_t *rnodep = PARENT_STRUCT(mi, RefreshNode_t, GuidEntry);
+
+		// a port which went down
+		if (rnodep->nodep && ! rnodep->changed
+			&& rnodep->numPorts != cl_qmap_count(&rnodep->nodep->Ports))
+			rnodep->changed = TRUE;
+	}
+
+	// lists built from AllNodes are rebuilt once nodes are patched, SMs
+	// refer to ports and are queried again below
+	SMDataFreeAll(fabricp);
+	QListRemoveAll(&fabricp->AllFIs);
+	QListRemoveAll(&fabricp->AllSWs);
+	QListRemoveAll(&fabricp->AllIOUs);
+	QListRemoveAll(&fabricp->AllPorts);
+	listsRemoved = TRUE;
+	// PortGuidIndex is rebuilt from AllPorts when next needed, NodeDataFree
+	// keeps the rebuilt NodeGuidIndex current as nodes are removed
+	FabricDataFreeGuidIndexes(fabricp);
+	(void)FabricDataBuildNodeGuidIndex(fabricp);
+
+	// remove nodes which are gone or changed
+	for (mi=cl_qmap_head(&fabricp->AllNodes); mi != cl_qmap_end(&fabricp->AllNodes); ) {
+		NodeData *nodep = PARENT_STRUCT(mi, NodeData, AllNodesEntry);
+		cl_map_item_t *gi = cl_qmap_get(&guidMap, nodep->NodeInfo.NodeGUID);
+
+		mi = cl_qmap_next(mi);
+		if (gi == cl_qmap_end(&guidMap)) {
+			linksRemoved += RefreshRemoveNode(fabricp, nodep);
+			nodesRemoved++;
+		} else if (PARENT_STRUCT(gi, RefreshNode_t, GuidEntry)->changed) {
+			linksRemoved += RefreshRemoveNode(fabricp, nodep);
+			nodesChanged++;
+		}
+	}
+
+	// query the new and changed nodes the way Sweep does
+	for (i=0; i < pNodeRecords->NumNodeRecords; i++) {
+		if (! rlids[i].rnodep->nodep || rlids[i].rnodep->changed)
+			numQuery++;
+	}
+	if (numQuery) {
+		pQueryNodeRecords = (STL_NODE_RECORD_RESULTS *)MemoryAllocate2AndClear(
+					sizeof(STL_NODE_RECORD_RESULTS) + sizeof(STL_NODE_RECORD)*numQuery,
+					IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+		if (! pQueryNodeRecords) {
+			fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
+			goto fail;
+		}
+		for (i=0; i < pNodeRecords->NumNodeRecords; i++) {
+			RefreshNode_t *rnodep = rlids[i].rnodep;
+
+			if (rnodep->nodep && ! rnodep->changed)
+				continue;
+			if (! rnodep->nodep && &rnodes[i] == rnodep)
+				nodesAdded++;
+			pQueryNodeRecords->NodeRecords[pQueryNodeRecords->NumNodeRecords++] = pNodeRecords->NodeRecords[i];
+		}
+		if (! quiet) ProgressPrint(TRUE, "Getting %u New or Changed Nodes...", nodesAdded+nodesChanged);
+		fstatus = SweepNodeRecords(omgt_port_session, portGuid, fabricp, flags, quiet, pQueryNodeRecords);
+		if (fstatus != FSUCCESS)
+			goto fail;
+	}
+	BuildFabricDataLists(fabricp);
+	listsRemoved = FALSE;
+
+	// patch links to match the LinkRecords, which list each link both ways
+	if (numLinkRecords) {
+		rlinks = (cl_map_item_t *)MemoryAllocate2AndClear(sizeof(cl_map_item_t)*2*numLinkRecords, IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+		if (! rlinks) {
+			fprintf(stderr, "%s: Unable to allocate memory\n", g_Top_cmdname);
+			goto fail;
+		}
+	}
+	cl_qmap_init(&linkMap, NULL);
+	for (i=0; i < numLinkRecords; i++) {
+		STL_LINK_RECORD *pLinkRecord = &((STL_LINK_RECORD_RESULTS*)pLinkResults->QueryResult)->LinkRecords[i];
+		PortData *p1, *p2;
+
+		p1 = FindLidPort(fabricp, pLinkRecord->RID.FromLID, pLinkRecord->RID.FromPort);
+		p2 = FindLidPort(fabricp, pLinkRecord->ToLID, pLinkRecord->ToPort);
+		if (! p1 || ! p2) {
+			DBGPRINT("Skipping LinkRecord for unknown port: LID 0x%x Port %u to LID 0x%x Port %u\n",
+				pLinkRecord->RID.FromLID, pLinkRecord->RID.FromPort,
+				pLinkRecord->ToLID, pLinkRecord->ToPort);
+			continue;
+		}
+		// key is the PortData itself
+		cl_qmap_insert(&linkMap, (uint64)(uintptr_t)p1, &rlinks[2*i]);
+		cl_qmap_insert(&linkMap, (uint64)(uintptr_t)p2, &rlinks[2*i+1]);
+		if (p1->neighbor == p2 && p2->neighbor == p1)
+			continue;
+		if (p1->neighbor && RefreshRemoveLink(fabricp, p1))
+			linksRemoved++;
+		if (p2->neighbor && RefreshRemoveLink(fabricp, p2))
+			linksRemoved++;
+		if (FSUCCESS == FabricDataAddLink(fabricp, p1, p2))
+			linksAdded++;
+	}
+	for (p=QListHead(&fabricp->AllPorts); p != NULL; p = QListNext(&fabricp->AllPorts, p)) {
+		PortData *portp = (PortData *)QListObj(p);
+
+		if (portp->neighbor
+			&& cl_qmap_get(&linkMap, (uint64)(uintptr_t)portp) == cl_qmap_end(&linkMap)
+			&& RefreshRemoveLink(fabricp, portp))
+			linksRemoved++;
+	}
+	if (nodesAdded || nodesRemoved || nodesChanged)
+		RefreshMCGroupPorts(fabricp);
+	if (! quiet) ProgressPrint(TRUE, "Nodes: %u added, %u removed, %u changed  Links: %u added, %u removed",
+					nodesAdded, nodesRemoved, nodesChanged, linksAdded, linksRemoved);
+
+	// these are a few bulk queries, so simply get them again
+	fstatus = SweepMasterSMData(omgt_port_session, portGuid, fabricp, flags, quiet);
+	if (fstatus == FSUCCESS)
+		fstatus = GetAllCables(omgt_port_session, portGuid, fabricp, quiet);
+	if (fstatus == FSUCCESS)
+		fstatus = SweepSMs(omgt_port_session, portGuid, fabricp, flags, quiet);
+	if (fstatus == FSUCCESS) {
+		VFDataFreeAll(fabricp);
+		QListRemoveAll(&fabricp->AllVFs);
+		fstatus = GetAllVFs(omgt_port_session, portGuid, fabricp, quiet);
+	}
+
 done:
-	omgt_close_port(omgt_port_session);
+	if (pQueryNodeRecords)
+		MemoryDeallocate(pQueryNodeRecords);
+	if (rlinks)
+		MemoryDeallocate(rlinks);
+	if (rlids)
+		MemoryDeallocate(rlids);
+	if (rnodes)
+		MemoryDeallocate(rnodes);
+	if (pLinkResults)
+		SweepFreeQueryResults(pLinkResults);
+	if (pPortResults)
+		SweepFreeQueryResults(pPortResults);
+	if (pNodeResults)
+		SweepFreeQueryResults(pNodeResults);
+	g_SweepSa.close(omgt_port_session);
 	return fstatus;
+
+fail:
+	fstatus = FERROR;
+	// leave the nodes patched so far consistent, the caller may still
+	// report on the fabric or refresh it again
+	if (listsRemoved)
+		BuildFabricDataLists(fabricp);
+	if (nodesAdded || nodesRemoved || nodesChanged)
+		RefreshMCGroupPorts(fabricp);
+	goto done;
 }
 
 /* Get all quarantined node records.
@@ -132,7 +132,7 @@ typedef struct PortData_s {
 	QOSData		*pQOS;				// optional QOS
 	STL_PKEY_ELEMENT	*pPartitionTable;	// optional Partition Table
 
-	union {
+	union PortAnalysisData_u {
 		struct {
 			uint32		downlinkBasePaths;
 			uint32		uplinkBasePaths;
@@ -146,6 +146,7 @@ typedef struct PortData_s {
 			uint32		xmitAllPaths;
 		} routes;			// for TabulateRoutes of any topology
 	} analysisData;	// per port holding space for transient analysis data
+	uint32		analysisIndex;	// index of port in per-thread analysis tallies
 	STL_BUFFER_CONTROL_TABLE *pBufCtrlTable;
 	// 128 table entries allocate when needed
 	STL_HFI_CONGESTION_CONTROL_TABLE_ENTRY *pCongestionControlTableEntries;
@@ -314,6 +315,16 @@ typedef struct SwitchData_s {
 	uint32	PortGroupFDBSize;
 	STL_PORT_GROUP_FORWARDING_TABLE	*PortGroupFDB;
 
+	/**
+		Compiled route table, PortData indexed by PortNum.
+
+		Built by FabricDataCompileRouteTables and freed whenever a port
+		is added to or removed from the switch.  NULL when not compiled,
+		in which case route walks fall back to FindNodePort.
+	*/
+	uint32	PortsByNumSize;
+	PortData **PortsByNum;
+
 } SwitchData;
 
 /*
@@ -343,6 +354,7 @@ typedef struct NodeData_s {
 									// mask is zeroed
 	SwitchData		*switchp;		// optional Switch specific data
 	struct ExpectedNode_s *enodep;	// if supplied in topology input
+	struct NodeData_s *NodeNameNext;	// FabricData.NodeNameIndex chain
 	void *context;					// application specific field
 	uint8	PmaAvoid:1;				// node PMA has instability
 	uint8	PmaAvoidClassPortInfo:1;	// node has instability in ClassPortInfo
@@ -503,11 +515,21 @@ typedef struct clVertixDataDistance_s {
    clVertixData_t  *vertixp;
 } clVertixDataDistance_t; 
 
+// sparse form of the dependency graph used to find credit loops, cycles
+// are searched for only within a strongly connected component (SCC)
 typedef struct clDijkstraDistancesAndRoutes_s {
-    uint32          **distances;
-    uint32          **routes;
-    uint32          nRows;
-    uint32          nCols;
+    uint32          nVertices;      // number of vertex ids in graph
+    uint32          *adjStart;      // index of first sink in adj, per vertex
+    uint32          *adj;           // sink vertex ids of all in-use arcs
+    uint32          *scc;           // SCC each vertex belongs to
+    uint32          numScc;         // number of SCCs which contain a cycle
+    // scratch space for a single shortest cycle search
+    uint32          *dist;          // distance from search source
+    uint32          *pred;          // previous vertex on shortest route
+    uint32          *mark;          // search generation dist/pred are valid for
+    uint32          *queue;         // breadth first search queue
+    uint32          *path;          // vertices of shortest cycle found
+    uint32          generation;
 } clDijkstraDistancesAndRoutes_t;
 
 /**
@@ -572,6 +594,9 @@ typedef enum {
 	FF_BUFCTRLTABLE		=0x000000800,	// BufferControlData collected
 	FF_DOWNPORTINFO		=0x000001000,	// Get PortInfo for Down switch ports
 	FF_CABLELOWPAGE		=0x000004000,	//Get Lower memory of Cable Info
+	FF_ARENA			=0x000008000,	// NodeData, PortData and per port tables
+										// come from FabricData.Arena and are
+										// only freed by DestroyFabricData
 } FabricFlags_t;
 
 // Handling for LIDs up to 24 bits
@@ -587,6 +612,50 @@ typedef struct TopLidMap_s {
 	PortData **LidBlocks[TOPLM_BLOCKS];
 } TopLidMap_t;
 
+// slab of memory in a FabricArena_t, data follows this header
+typedef struct FabricArenaSlab_s {
+	struct FabricArenaSlab_s *next;
+	uint64 size;			// bytes of data following header
+} FabricArenaSlab_t;
+
+// FabricDataAllocate size classes, larger objects are individually allocated
+#define FABRIC_POOL_CLASS_SIZE 32
+#define FABRIC_POOL_CLASSES 128
+
+// slabs holding NodeData, PortData and per port tables.
+// With FF_ARENA this is a bump allocator and allocations are never
+// individually freed.  Otherwise objects are carved from the slabs in
+// FABRIC_POOL_CLASS_SIZE multiples and freed objects are kept on a free
+// list per size class for reuse.  Either way the slabs are released as
+// a whole by DestroyFabricData
+typedef struct FabricArena_s {
+	FabricArenaSlab_t *slabs;	// most recently allocated first
+	uint8 *next;			// next free byte in slabs
+	uint64 remaining;		// bytes available at next
+	void *freeList[FABRIC_POOL_CLASSES];	// not used with FF_ARENA
+} FabricArena_t;
+
+// hash of AllNodes by NodeDesc, each chain is sorted by NodeGUID
+typedef struct NodeNameIndex_s {
+	NodeData **Buckets;		// NULL if index not built
+	uint32 Size;			// number of Buckets, power of 2
+	uint32 Count;			// number of nodes in index
+} NodeNameIndex_t;
+
+// open addressing hash of fabric objects by GUID, linear probing
+typedef struct GuidIndexEntry_s {
+	EUI64 guid;				// 0 for an empty slot
+	void *objp;
+} GuidIndexEntry_t;
+
+typedef struct GuidIndex_s {
+	GuidIndexEntry_t *Entries;	// NULL if index not built
+	uint32 Size;			// number of Entries, power of 2
+	uint32 Count;			// number of GUIDs in index
+	uint32 Duplicates;		// objects not added, their GUID was indexed
+	LIST_ITEM *Last;		// PortGuidIndex: last AllPorts entry indexed
+} GuidIndex_t;
+
 typedef struct FabricData_s {
 	time_t	time;			// when fabric data was obtained from a real fabric
 	FabricFlags_t	flags;	// what data is available in FabricData
@@ -638,6 +707,23 @@ typedef struct FabricData_s {
 	//topology input data optimized for search
 	cl_qmap_t  ExpectedNodeGuidMap; //all expected FIs/SWs mapped by NodeGuid
 
+	// one allocation holding all pPortCounters filled in by GetAllPortCounters
+	STL_PORT_COUNTERS_DATA *PortCountersSlab;
+	uint32 PortCountersSlabCount;
+
+	// holds NodeData, PortData and per port tables
+	FabricArena_t Arena;
+
+	// AllNodes indexed by NodeDesc, maintained by FabricDataAddNode
+	// and NodeDataFree once built
+	NodeNameIndex_t NodeNameIndex;
+	// AllNodes indexed by NodeGUID, maintained like NodeNameIndex
+	GuidIndex_t NodeGuidIndex;
+	// AllPorts indexed by PortGUID, extended by FindPortGuid as ports are
+	// appended to AllPorts.  Code which removes ports from AllPorts must
+	// call PortGuidIndexRemove first or free the index
+	GuidIndex_t PortGuidIndex;
+
 	void *context;				// application specific field
 	int ms_timeout;
 } FabricData_t;
@@ -719,6 +805,23 @@ typedef enum {
 	POINT_ELINK_TYPE_LINK_LIST,
 } PointElinkType;
 
+/* set of object pointers kept alongside a list Point so that membership
+ * tests don't need to walk the DLIST.  Open addressing, Size is a power of 2
+ */
+typedef struct PointSet_s {
+	void		**Buckets;
+	uint32		Size;
+	uint32		Count;		/* distinct objects in set */
+} PointSet_t;
+
+/* sets for a fabric list Point, built once the list is long enough for
+ * a linear search to matter and then maintained by the append routines
+ */
+typedef struct PointFabricSet_s {
+	PointSet_t	Objects;	/* ports, nodes or iocs in the list */
+	PointSet_t	Nodes;		/* nodes of listed ports, iocs or node pairs */
+	PointSet_t	Systems;	/* systems of all the listed objects */
+} PointFabricSet_t;
 
 typedef struct Point_s {
 
@@ -738,6 +841,7 @@ typedef struct Point_s {
 		DLIST		iocList;
 		NodePairList_t		nodePairList;
 	} u;
+	PointFabricSet_t	*FabricSet;	/* NULL if list is short or not a list */
 
 	/* ExpectedNode(s) matched in topology file */
 	PointEnodeType	EnodeType;	/* if POINT_ENODE_TYPE_NONE, u2 undefined */
@@ -745,6 +849,7 @@ typedef struct Point_s {
 		ExpectedNode	*enodep;
 		DLIST			enodeList;
 	} u2;
+	PointSet_t		*EnodeSet;	/* NULL if list is short or not a list */
 
 	/* ExpectedSM(s) matched in topology file */
 	PointEsmType	EsmType;	/* if POINT_ESM_TYPE_NONE, u3 undefined */
@@ -752,6 +857,7 @@ typedef struct Point_s {
 		ExpectedSM	*esmp;
 		DLIST		esmList;
 	} u3;
+	PointSet_t	*EsmSet;	/* NULL if list is short or not a list */
 
 	/* ExpectedLink(s) matched in topology file */
 	PointElinkType	ElinkType;	/* if POINT_ELINK_TYPE_NONE, u4 undefined */
@@ -759,6 +865,7 @@ typedef struct Point_s {
 		ExpectedLink	*elinkp;
 		DLIST			elinkList;
 	} u4;
+	PointSet_t		*ElinkSet;	/* NULL if list is short or not a list */
 } Point;
 
 #if !defined(VXWORKS) || defined(BUILD_DMC)
@@ -847,6 +954,8 @@ extern boolean isVFMember(PortData *portp, VFData_t *pVFData);
 extern uint32 CountInitializedPorts(FabricData_t *fabricp, NodeData *nodep);
 extern FSTATUS NodeDataAllocateSwitchData(FabricData_t *fabricp, NodeData *nodep,
 				uint32 LinearFDBSize, uint32 MulticastFDBSize);
+extern void NodeDataFreeRouteTable(NodeData *nodep);
+extern FSTATUS FabricDataCompileRouteTables(FabricData_t *fabricp);
 extern FSTATUS NodeDataAllocateFDB(FabricData_t *fabricp, NodeData *nodep,
                 uint32 LinearFDBSize);
 extern FSTATUS SwitchDataAllocateQOS(SwitchData *sw);
@@ -891,6 +1000,49 @@ extern void PortDataFreeCableInfoData(FabricData_t *fabricp, PortData *portp);
 /// @param fabricp optional, can be NULL
 extern FSTATUS PortDataAllocateCableInfoData(FabricData_t *fabricp, PortData *portp);
 
+/// @param fabricp optional, can be NULL
+/// if NULL, pPortCounters must not be part of fabricp->PortCountersSlab
+extern void PortDataFreePortCounters(FabricData_t *fabricp, PortData *portp);
+/// allocate fabricp->PortCountersSlab to hold count entries for pPortCounters
+extern FSTATUS FabricDataAllocatePortCountersSlab(FabricData_t *fabricp, uint32 count);
+
+/// build fabricp->NodeNameIndex from AllNodes
+extern FSTATUS FabricDataBuildNodeNameIndex(FabricData_t *fabricp);
+extern void FabricDataFreeNodeNameIndex(FabricData_t *fabricp);
+/// add/remove node in NodeNameIndex, noop if index not built.
+/// Callers changing NodeDesc of a node in AllNodes must remove it first
+extern void NodeNameIndexAdd(FabricData_t *fabricp, NodeData *nodep);
+extern void NodeNameIndexRemove(FabricData_t *fabricp, NodeData *nodep);
+/// chain of nodes which could have NodeDesc name, in NodeGUID order.
+/// caller must compare NodeDesc and check NodeNameIndex.Buckets is non-NULL
+extern NodeData *NodeNameIndexChain(FabricData_t *fabricp, const char *name);
+
+/// build fabricp->NodeGuidIndex from AllNodes
+extern FSTATUS FabricDataBuildNodeGuidIndex(FabricData_t *fabricp);
+/// free NodeGuidIndex and PortGuidIndex
+extern void FabricDataFreeGuidIndexes(FabricData_t *fabricp);
+/// add/remove node in NodeGuidIndex, noop if index not built
+extern void NodeGuidIndexAdd(FabricData_t *fabricp, NodeData *nodep);
+extern void NodeGuidIndexRemove(FabricData_t *fabricp, NodeData *nodep);
+/// add any AllPorts entries not yet in PortGuidIndex.
+/// on failure the index is freed and searches must scan AllPorts
+extern FSTATUS PortGuidIndexUpdate(FabricData_t *fabricp);
+/// remove port from PortGuidIndex, must be called before portp is removed
+/// from AllPorts.  noop if index not built
+extern void PortGuidIndexRemove(FabricData_t *fabricp, PortData *portp);
+/// object with the given non-zero guid, caller must check Entries is non-NULL
+extern void *GuidIndexFind(const GuidIndex_t *indexp, EUI64 guid);
+
+/// allocate zeroed memory for a NodeData, PortData or per port table
+/// @param fabricp optional, can be NULL, memory is in fabricp->Arena unless
+///		NULL or the object is too large for a pool size class
+extern void *FabricDataAllocate(FabricData_t *fabricp, uint32 size);
+/// free memory from FabricDataAllocate, noop with FF_ARENA
+/// @param fabricp optional, can be NULL if fabric does not have FF_ARENA,
+///		pool memory freed with a NULL fabricp is only released by
+///		DestroyFabricData
+extern void FabricDataDeallocate(FabricData_t *fabricp, void *p);
+
 /// @param fabricp optional, can be NULL
 extern void PortDataFreeCongestionControlTableEntries(FabricData_t *fabricp, PortData *portp);
 /// @param fabricp optional, can be NULL
@@ -966,6 +1118,7 @@ extern FSTATUS CLFabricDataDestroy(FabricData_t *fabricp, void *context);
 extern void CLGraphDataFree(clGraphData_t *graphp, void *context);
 extern FSTATUS CLDijkstraFindDistancesAndRoutes(clGraphData_t *graphp, clDijkstraDistancesAndRoutes_t *respData, int verbose);
 extern void CLDijkstraFreeDistancesAndRoutes(clDijkstraDistancesAndRoutes_t *drp);
+extern uint32 CLDijkstraFindShortestCycle(clDijkstraDistancesAndRoutes_t *drp, uint32 src);
 
 // search routines (Topology/search.c)
 // For functions which generate Points, indicate what is needed
@@ -998,6 +1151,7 @@ extern FSTATUS FindNodeGuidPoint(FabricData_t *fabricp, EUI64 guid, Point *pPoin
 extern FSTATUS FindNodeNamePoint(FabricData_t* fabricp, char *name, Point *pPoint, uint8 find_flag, int silent);
 extern FSTATUS FindNodeNamePatPoint(FabricData_t* fabricp, char *pattern, Point *pPoint, uint8 find_flag);
 extern FSTATUS FindNodeNamePatPointUncompress(FabricData_t *fabricp, char *pattern, Point *pPoint, uint8 find_flag);
+extern FSTATUS FindNodeNamePatListPoint(FabricData_t *fabricp, char **patterns, uint32 count, Point *pPoint, uint8 find_flag);
 
 extern FSTATUS FindNodePatPairs(FabricData_t *fabricp, char *pattern, NodePairList_t *nodePatPairs, uint8 find_flag, uint8 side);
 extern FSTATUS FindNodeDetailsPatPoint(FabricData_t* fabricp, const char* pattern, Point *pPoint, uint8 find_flag);
@@ -1097,6 +1251,39 @@ extern FSTATUS DmGetServiceEntries(struct omgt_port *port, IB_PATH_RECORD *pathp
 							uint8 first, uint8 last, IOC_SERVICE *pIocServices);
 #endif
 
+// pipelined MAD engine (from Topology/mad.c)
+// Keeps many SMA, PMA and DM requests outstanding on one port.  Requests are
+// queued by the MadPipe*Submit functions and issued by MadPipeWait.
+struct omgt_mad_addr;
+typedef struct MadPipe_s MadPipe_t;
+
+// transport used by a MadPipe_t, MADs are in wire format.
+// recv returns FSUCCESS for a response, FTIMEOUT or FREJECT along with the
+// original request when the transport gave up on a request, or FNOT_DONE
+// when nothing arrived within timeout_ms.
+typedef struct MadPipeTransport_s {
+	FSTATUS (*send)(void *context, uint8_t *mad, size_t size,
+					struct omgt_mad_addr *addr, int timeout_ms);
+	FSTATUS (*recv)(void *context, uint8_t *mad, size_t *size, int timeout_ms);
+	void *context;
+} MadPipeTransport_t;
+
+// called by MadPipeWait as each request completes, after all retries
+typedef void (MadPipeCallback)(void *context, FSTATUS status);
+
+extern MadPipe_t *MadPipeCreate(struct omgt_port *port, uint32 window);
+extern MadPipe_t *MadPipeCreateTransport(struct omgt_port *port, const MadPipeTransport_t *transport, uint32 window);
+extern void MadPipeDestroy(MadPipe_t *pipep);
+extern FSTATUS MadPipeWait(MadPipe_t *pipep);
+extern FSTATUS MadPipeSmaSubmit(MadPipe_t *pipep, STL_LID dlid, STL_LID slid, uint8_t* path, uint8_t method, uint32_t attr, uint32_t modifier, uint8_t* buffer, uint32_t bufferLength, MadPipeCallback *callback, void *context);
+extern FSTATUS MadPipePmSubmit(MadPipe_t *pipep, PortData *portp, uint8 method, uint32 attr, uint32 modifier, STL_PERF_MAD *req, STL_PERF_MAD *resp, MadPipeCallback *callback, void *context);
+extern FSTATUS MadPipePmGetPortStatus(MadPipe_t *pipep, PortData *portp, uint8 portNum, STL_PORT_STATUS_RSP *pPortStatus, MadPipeCallback *callback, void *context);
+extern FSTATUS MadPipePmGetClassPortInfo(MadPipe_t *pipep, PortData *portp, MadPipeCallback *callback, void *context);
+extern FSTATUS MadPipePaGetPortCounters(MadPipe_t *pipep, STL_PA_IMAGE_ID_DATA imageId, STL_LID lid, uint8 portNum, uint32 user_cntrs, STL_PORT_COUNTERS_DATA *pPortCounters, MadPipeCallback *callback, void *context);
+#if !defined(VXWORKS) || defined(BUILD_DMC)
+extern FSTATUS MadPipeDmSubmit(MadPipe_t *pipep, IB_PATH_RECORD *pathp, uint32 attr, uint32 modifier, DM_MAD *mad, MadPipeCallback *callback, void *context);
+#endif
+
 // POINT routines (from Topology/point.c)
 extern void PointInit(Point *point);
 extern boolean PointIsInInit(Point *point);
@@ -1200,11 +1387,47 @@ typedef int (*ParseCompleteFn)(struct IXmlParserState * state, void * object, vo
 void SetPortDataComplete(ParseCompleteFn fn);
 
 /**
-	only FF_LIDARRAY flag is used, others set based on file read
+	only FF_LIDARRAY and FF_ARENA flags are used, others set based on file read
 	@param allocFull When true, adjust allocated memory for linear and multicast forwarding tables to their cap values after reading in all data.
 */
 #ifndef __VXWORKS__
 extern FSTATUS Xml2ParseSnapshot(const char *input_file, int quiet, FabricData_t *fabricp, FabricFlags_t flags, boolean allocFull);
+
+/**
+	Called by Xml2ParseSnapshotStream as each Node is parsed, before any
+	Links.  Return TRUE to keep the node in the fabric, FALSE to free it.
+*/
+typedef boolean (SnapshotNodeFunc_t)(FabricData_t *fabricp, NodeData *nodep, void *context);
+/**
+	Called by Xml2ParseSnapshotStream for each Link, including links to
+	nodes which were not kept.  Return TRUE to build the link if both its
+	nodes were kept.
+*/
+typedef boolean (SnapshotLinkFunc_t)(FabricData_t *fabricp, EUI64 fromGuid, uint8 fromPort, EUI64 toGuid, uint8 toPort, void *context);
+
+/**
+	parse a snapshot keeping only the nodes node_func asks for, so memory
+	is bounded by the largest node plus the kept nodes.  Links between kept
+	nodes are built, SMs, multicast members and VFs are skipped.
+	only FF_LIDARRAY flag is used, others set based on file read
+	@param link_func optional, may be NULL to build all links between kept
+		nodes
+*/
+extern FSTATUS Xml2ParseSnapshotStream(const char *input_file, int quiet, FabricData_t *fabricp, FabricFlags_t flags, SnapshotNodeFunc_t *node_func, SnapshotLinkFunc_t *link_func, void *context);
+/**
+	Called by Xml2ParseSnapshotLinks for each port parsed.  Return TRUE to
+	keep the link on the port.
+*/
+typedef boolean (SnapshotPortFunc_t)(PortData *portp, void *context);
+/**
+	parse a snapshot keeping only the links with a port port_func selects,
+	and the nodes on them.  Links follow all the Nodes in a snapshot, so
+	the input is streamed twice and can't be stdin.
+	only FF_LIDARRAY flag is used, others set based on file read
+	@param linksp returns the number of links in the snapshot, each was
+		checked for a port port_func selected
+*/
+extern FSTATUS Xml2ParseSnapshotLinks(const char *input_file, int quiet, FabricData_t *fabricp, FabricFlags_t flags, SnapshotPortFunc_t *port_func, void *context, uint32 *linksp);
 #else
 extern FSTATUS Xml2ParseSnapshot(const char *input_file, int quiet, FabricData_t *fabricp, FabricFlags_t flags, boolean allocFull, XML_Memory_Handling_Suite* memsuite);
 #endif
@@ -1266,6 +1489,31 @@ typedef enum {
 } SweepFlags_t;
 
 extern FSTATUS Sweep(EUI64 portGuid, FabricData_t *fabricp, FabricFlags_t fflags, SweepFlags_t flags, int quiet, int ms_timeout);
+// update a fabric from a previous Sweep or Xml2ParseSnapshot to match the
+// live fabric, only new or changed nodes are queried individually.
+// Must be called before Xml2ParseTopology.  Routes, stats and VL tables
+// are kept for unchanged nodes and are absent for new or changed nodes.
+// On failure the fabric stays consistent but only partly refreshed, it may
+// lack nodes, links, SMs and VFs until a later SweepRefresh succeeds.
+extern FSTATUS SweepRefresh(EUI64 portGuid, FabricData_t *fabricp, SweepFlags_t flags, int quiet, int ms_timeout);
+
+// SA access used by Sweep.  Sweep overlaps independent phases and the per
+// node queries on worker threads, each of which opens its own port.
+// query and free have the semantics of omgt_query_sa and
+// omgt_free_query_result_buffer, query may be called concurrently.
+typedef struct SweepSaTransport_s {
+	FSTATUS (*open)(struct omgt_port **port, EUI64 portGuid, int ms_timeout);
+	void (*close)(struct omgt_port *port);
+	FSTATUS (*query)(struct omgt_port *port, OMGT_QUERY *query,
+						PQUERY_RESULT_VALUES *ppQueryResults);
+	void (*free)(PQUERY_RESULT_VALUES pQueryResults);
+} SweepSaTransport_t;
+
+/// replace the SA transport used by Sweep and GetAllFDBs, such as with a
+/// simulated SA for timing tests.  NULL restores the opamgt transport
+extern void SetSweepSaTransport(const SweepSaTransport_t *transport);
+/// limit threads used by each level of Sweep parallelism, 1 sweeps serially
+extern void SetSweepThreads(uint32 threads);
 
 //extern FSTATUS GetPathToPort(EUI64 portGuid, PortData *portp, uint16 pkey);
 extern FSTATUS GetPaths(struct omgt_port *port, PortData *portp1, PortData *portp2,
@@ -1276,6 +1524,9 @@ extern FSTATUS GetAllPortCounters(EUI64 portGuid, IB_GID localGid, FabricData_t
 			   	Point *focus, boolean limitstats, boolean quiet, uint32 begin, uint32 end);
 extern FSTATUS GetAllFDBs( EUI64 portGuid, FabricData_t *fabricp, Point *focus,
 				int quiet );
+/// replace the SMA transport used by GetAllFDBs with FF_SMADIRECT, such as
+/// with a simulated SMA for timing tests.  NULL restores the opamgt transport
+extern void SetFdbSmaTransport(const MadPipeTransport_t *transport);
 extern FSTATUS GetAllPortVLInfo(EUI64 portGuid, FabricData_t *fabricp, Point *focus, int quieti, int *use_scsc);
 extern PQUERY_RESULT_VALUES GetAllQuarantinedNodes(struct omgt_port *port, FabricData_t *fabricp,
 													Point *focus, int quiet);
@@ -0,0 +1,447 @@
+/* BEGIN_ICS_COPYRIGHT7 ****************************************
+
+Copyright (c) 2015-2020, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+** END_ICS_COPYRIGHT7   ****************************************/
+
+/* [ICS VERSION STRING: unknown] */
+
+#include <getopt.h>
+#include "topology_test.h"
+
+/* shortest credit loop cycles of random small dependency graphs.  The
+ * sparse search of CLDijkstraFindDistancesAndRoutes, CLDijkstraFindShortestCycle
+ * and CLDijkstraFindCycles is compared with the dense all pairs Dijkstra
+ * they replaced, which is kept below as the reference.  The reference
+ * differs from the old code in three places, where it did not do what the
+ * Python it was ported from did:
+ *	- todo is popped in distance order, the old code popped in vertex id
+ *	  order as it dropped todo.sort(vertex_distance_compare)
+ *	- whole rows of distances and routes are kept, the old code copied
+ *	  only nCols bytes of each
+ *	- a vertex with no route back to itself has an infinite self distance,
+ *	  the old code left it 0 and so counted a cycle of length 0
+ * The length of the shortest cycle through each vertex must match.  Where
+ * several shortest cycles tie, the two searches may list different
+ * vertices; such ties are counted and the cycle checked to be real.
+ */
+#define CYCLE_TEST_MAX_DEGREE	3
+
+typedef struct CycleTestReport_s {
+	ValidateCreditLoopRoutesContext_t cl;	// must be first, passed as context
+	uint32			numCycles;
+	uint32			*start;			// first vertex of each cycle
+	uint32			*length;		// length of each cycle
+	uint32			*first;			// index in steps of each cycle's vertices
+	uint32			numSteps;
+	uint32			*steps;			// vertices of all cycles
+	uint32			maxSteps;
+} CycleTestReport_t;
+
+static uint32 CycleTestRandom(uint32 *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return (*seed >> 16) & 0x7fff;
+}
+
+/* random graph of n vertices, about 1 in 10 unused (RefCount 0, as left by
+ * CLGraphDataPrune) and some arcs not in use (-1 in Outbound).  Arc ids are
+ * sparse as after pruning, self arcs are rare.
+ */
+static FSTATUS CycleTestBuildGraph(clGraphData_t *graphp, clConnData_t *connp,
+				uint32 n, uint32 *seed)
+{
+	uint32 i, j, k, sink, arcId = 0;
+	clVertixData_t *v;
+	clArcData_t *arcp;
+
+	MemoryClear(graphp, sizeof(*graphp));
+	cl_qmap_init(&graphp->Arcs, NULL);
+	cl_qmap_init(&graphp->map_arc_key_to_arc, NULL);
+	cl_qmap_init(&graphp->map_conn_to_vertex_conn, NULL);
+	graphp->Vertices = MemoryAllocate2AndClear(n * sizeof(clVertixData_t *),
+				IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! graphp->Vertices)
+		return FINSUFFICIENT_MEMORY;
+	graphp->NumVertices = graphp->VerticesLength = n;
+	for (i=0; i < n; i++) {
+		v = MemoryAllocate2AndClear(sizeof(*v), IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+		if (! v)
+			return FINSUFFICIENT_MEMORY;
+		graphp->Vertices[i] = v;
+		v->Id = i;
+		v->Connection = connp;
+		v->RefCount = (CycleTestRandom(seed) % 10) != 0;
+		graphp->NumActiveVertices += v->RefCount;
+	}
+	for (i=0; i < n; i++) {
+		v = graphp->Vertices[i];
+		if (! v->RefCount)
+			continue;
+		v->OutboundLength = CYCLE_TEST_MAX_DEGREE + 1;
+		v->Outbound = MemoryAllocate2AndClear(v->OutboundLength * sizeof(int),
+				IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+		if (! v->Outbound)
+			return FINSUFFICIENT_MEMORY;
+		for (j=CycleTestRandom(seed) % (CYCLE_TEST_MAX_DEGREE + 1); j > 0; j--) {
+			sink = CycleTestRandom(seed) % n;
+			if (! graphp->Vertices[sink]->RefCount
+				|| (sink == i && CycleTestRandom(seed) % 8))
+				continue;
+			for (k=0; k < v->OutboundCount; k++) {
+				if (v->Outbound[k] >= 0
+					&& PARENT_STRUCT(cl_qmap_get(&graphp->Arcs, v->Outbound[k]),
+							clArcData_t, AllArcIdsEntry)->Sink == sink)
+					break;
+			}
+			if (k < v->OutboundCount)
+				continue;
+			arcId += 1 + CycleTestRandom(seed) % 3;
+			if (CycleTestRandom(seed) % 8 == 0) {
+				v->Outbound[v->OutboundCount++] = -1;
+				continue;
+			}
+			arcp = MemoryAllocate2AndClear(sizeof(*arcp), IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+			if (! arcp)
+				return FINSUFFICIENT_MEMORY;
+			arcp->Id = arcId;
+			arcp->Source = arcp->u1.s.Source = i;
+			arcp->Sink = arcp->u1.s.Sink = sink;
+			cl_qmap_insert(&graphp->Arcs, arcId, &arcp->AllArcIdsEntry);
+			v->Outbound[v->OutboundCount++] = arcId;
+			v->OutboundInuseCount++;
+			graphp->Vertices[sink]->InboundInuseCount++;
+			graphp->NumArcs++;
+		}
+	}
+	return FSUCCESS;
+}
+
+static clArcData_t *CycleTestArc(clGraphData_t *graphp, int arcId)
+{
+	cl_map_item_t *mi;
+
+	if (arcId < 0)
+		return NULL;
+	mi = cl_qmap_get(&graphp->Arcs, arcId);
+	if (mi == cl_qmap_end(&graphp->Arcs))
+		return NULL;
+	return PARENT_STRUCT(mi, clArcData_t, AllArcIdsEntry);
+}
+
+static boolean CycleTestHasArc(clGraphData_t *graphp, uint32 source, uint32 sink)
+{
+	clVertixData_t *v = graphp->Vertices[source];
+	clArcData_t *arcp;
+	uint32 k;
+
+	for (k=0; k < v->OutboundCount; k++) {
+		if ((arcp = CycleTestArc(graphp, v->Outbound[k])) && arcp->Sink == sink)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* reference: dense distances[i][j] and routes[i][j], the next vertex from i
+ * on a shortest route to j, then the shortest cycle length through i as
+ * distances[i][i] and its next vertex as routes[i][i]
+ */
+static void CycleTestReference(clGraphData_t *graphp, uint32 *distances,
+				uint32 *routes, uint32 *previous, uint8 *done)
+{
+	uint32 n = graphp->VerticesLength;
+	uint32 i, j, k, current, d;
+	uint32 *dist;
+	clVertixData_t *v;
+	clArcData_t *arcp;
+
+	for (i=0; i < n; i++) {
+		if (! graphp->Vertices[i]->RefCount)
+			continue;
+		dist = &distances[i*n];
+		for (j=0; j < n; j++) {
+			dist[j] = DIJKSTRA_INFINITY;
+			done[j] = ! graphp->Vertices[j]->RefCount;
+		}
+		dist[i] = 0;
+		previous[i] = i;
+		for (;;) {
+			// todo.sort(vertex_distance_compare); current = todo.pop(0)
+			current = n;
+			for (j=0; j < n; j++) {
+				if (! done[j] && (current == n || dist[j] < dist[current]))
+					current = j;
+			}
+			if (current == n || dist[current] == DIJKSTRA_INFINITY)
+				break;
+			done[current] = 1;
+			v = graphp->Vertices[current];
+			for (k=0; k < v->OutboundCount; k++) {
+				if (! (arcp = CycleTestArc(graphp, v->Outbound[k])))
+					continue;
+				d = dist[current] + 1;
+				if (d < dist[arcp->Sink]) {
+					dist[arcp->Sink] = d;
+					previous[arcp->Sink] = current;
+				}
+			}
+		}
+		for (j=0; j < n; j++) {
+			if (dist[j] == DIJKSTRA_INFINITY)
+				continue;
+			current = j;
+			while (previous[current] != i)
+				current = previous[current];
+			routes[i*n + j] = current;
+		}
+	}
+
+	// recompute distance to self for shortest loop (instead of 0)
+	for (i=0; i < n; i++) {
+		v = graphp->Vertices[i];
+		if (! v->RefCount)
+			continue;
+		d = DIJKSTRA_INFINITY;
+		for (k=0; k < v->OutboundCount; k++) {
+			if (! (arcp = CycleTestArc(graphp, v->Outbound[k])))
+				continue;
+			if (distances[arcp->Sink*n + i] < d) {
+				d = distances[arcp->Sink*n + i] + 1;
+				routes[i*n + i] = arcp->Sink;
+			}
+		}
+		distances[i*n + i] = d;
+	}
+}
+
+static void CycleTestLinkSummary(uint32 id, const char *name, uint32 cycle,
+				uint8 header, int indent, void *context)
+{
+	CycleTestReport_t *rp = (CycleTestReport_t *)context;
+
+	rp->start[rp->numCycles] = id;
+	rp->length[rp->numCycles] = cycle;
+	rp->first[rp->numCycles] = rp->numSteps;
+	rp->numCycles++;
+}
+
+static void CycleTestLinkStepSummary(uint32 id, const char *name, uint32 step,
+				uint8 header, int indent, void *context)
+{
+	CycleTestReport_t *rp = (CycleTestReport_t *)context;
+
+	if (rp->numSteps < rp->maxSteps)
+		rp->steps[rp->numSteps++] = id;
+}
+
+static void CycleTestPathSummary(FabricData_t *fabricp, clConnData_t *connp,
+				int indent, void *context)
+{
+}
+
+/* vertices of a cycle must be joined by arcs, in order and back to the
+ * first
+ */
+static boolean CycleTestIsCycle(clGraphData_t *graphp, const uint32 *path,
+				uint32 length)
+{
+	uint32 k;
+
+	for (k=0; k < length; k++) {
+		if (! CycleTestHasArc(graphp, path[k], path[(k+1) % length]))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* compare one graph, returns number of mismatches */
+static uint32 CycleTestCompare(FabricData_t *fabricp, clGraphData_t *graphp,
+				uint32 *distances, uint32 *routes, uint32 *previous, uint8 *done,
+				uint32 *path, CycleTestReport_t *report, uint32 *searchesp,
+				uint32 *tiesp)
+{
+	clDijkstraDistancesAndRoutes_t dr;
+	uint32 n = graphp->VerticesLength;
+	uint32 i, j, k, c, len, bad = 0;
+
+	CycleTestReference(graphp, distances, routes, previous, done);
+	if (CLDijkstraFindDistancesAndRoutes(graphp, &dr, 0) != FSUCCESS)
+		return 1;
+
+	// shortest cycle through each vertex
+	for (i=0; i < n; i++) {
+		if (! graphp->Vertices[i]->RefCount)
+			continue;
+		(*searchesp)++;
+		len = CLDijkstraFindShortestCycle(&dr, i);
+		if (len != distances[i*n + i]) {
+			if (bad++ < 10)
+				fprintf(stderr, "cycles: vertex %u: cycle length %u, expected %u\n",
+						i, len, distances[i*n + i]);
+			continue;
+		}
+		if (len == DIJKSTRA_INFINITY)
+			continue;
+		for (j=i, k=0; k < len; k++, j = routes[j*n + i])
+			path[k] = j;
+		if (dr.path[0] != i || ! CycleTestIsCycle(graphp, dr.path, len)) {
+			if (bad++ < 10)
+				fprintf(stderr, "cycles: vertex %u: invalid cycle\n", i);
+		} else if (memcmp(path, dr.path, len * sizeof(uint32)) != 0) {
+			(*tiesp)++;
+		}
+	}
+
+	// cycles reported, in the same order until the first tie
+	report->numCycles = report->numSteps = 0;
+	CLDijkstraFindCycles(fabricp, graphp, &dr, CycleTestLinkSummary,
+				CycleTestLinkStepSummary, CycleTestPathSummary, report);
+	CLDijkstraFreeDistancesAndRoutes(&dr);
+	MemoryClear(done, n);
+	for (c=0, i=0; i < n; i++) {
+		if (! graphp->Vertices[i]->RefCount || done[i]
+			|| distances[i*n + i] == DIJKSTRA_INFINITY)
+			continue;
+		len = distances[i*n + i];
+		for (j=i, k=0; k < len; k++, j = routes[j*n + i]) {
+			path[k] = j;
+			done[j] = 1;
+		}
+		if (c >= report->numCycles || report->start[c] != i
+			|| report->length[c] != len) {
+			if (bad++ < 10)
+				fprintf(stderr, "cycles: cycle %u: from %u of length %u, expected from %u of length %u\n",
+						c, c < report->numCycles ? report->start[c] : 0,
+						c < report->numCycles ? report->length[c] : 0, i, len);
+			break;
+		}
+		if (! CycleTestIsCycle(graphp, &report->steps[report->first[c]], len)) {
+			if (bad++ < 10)
+				fprintf(stderr, "cycles: cycle %u: invalid\n", c);
+			break;
+		}
+		c++;
+		// after a tie the vertices skipped by each search differ
+		if (memcmp(path, &report->steps[report->first[c-1]], len * sizeof(uint32)) != 0)
+			break;
+	}
+	if (i == n && c != report->numCycles) {
+		if (bad++ < 10)
+			fprintf(stderr, "cycles: %u cycles, expected %u\n", report->numCycles, c);
+	}
+	return bad;
+}
+
+int TestCycles(int argc, char **argv)
+{
+	uint32 numGraphs = 2000, maxVertices = 40, seed = 1;
+	uint32 g, n, bad = 0, vertices = 0, arcs = 0, searches = 0, ties = 0;
+	uint32 *distances = NULL, *routes = NULL, *previous = NULL, *path = NULL;
+	uint8 *done = NULL;
+	CycleTestReport_t report;
+	FabricData_t fabric;
+	clGraphData_t graph;
+	clConnData_t conn;
+	uint64 start;
+	int c;
+
+	optind = 1;
+	while (-1 != (c = getopt(argc, argv, "g:n:r:"))) {
+		switch (c) {
+		case 'g': numGraphs = atoi(optarg); break;
+		case 'n': maxVertices = atoi(optarg); break;
+		case 'r': seed = atoi(optarg); break;
+		default: return 2;
+		}
+	}
+	if (maxVertices < 2 || maxVertices > 1000) {
+		fprintf(stderr, "cycles: invalid arguments\n");
+		return 2;
+	}
+
+	MemoryClear(&report, sizeof(report));
+	report.cl.detail = 2;		// report the vertices of each cycle
+	report.cl.quiet = 1;
+	report.maxSteps = maxVertices * maxVertices;
+	MemoryClear(&fabric, sizeof(fabric));
+	cl_qmap_init(&fabric.map_guid_to_ib_device, NULL);
+	MemoryClear(&conn, sizeof(conn));
+	if (! (distances = MemoryAllocate2AndClear(maxVertices * maxVertices * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG))
+		|| ! (routes = MemoryAllocate2AndClear(maxVertices * maxVertices * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG))
+		|| ! (previous = MemoryAllocate2AndClear(maxVertices * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG))
+		|| ! (path = MemoryAllocate2AndClear(maxVertices * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG))
+		|| ! (done = MemoryAllocate2AndClear(maxVertices, IBA_MEM_FLAG_PREMPTABLE, MYTAG))
+		|| ! (report.start = MemoryAllocate2AndClear(maxVertices * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG))
+		|| ! (report.length = MemoryAllocate2AndClear(maxVertices * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG))
+		|| ! (report.first = MemoryAllocate2AndClear(maxVertices * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG))
+		|| ! (report.steps = MemoryAllocate2AndClear(report.maxSteps * sizeof(uint32), IBA_MEM_FLAG_PREMPTABLE, MYTAG))) {
+		fprintf(stderr, "cycles: Unable to allocate memory\n");
+		bad++;
+		goto done;
+	}
+
+	start = GetTimeStamp();
+	for (g=0; g < numGraphs; g++) {
+		n = 2 + CycleTestRandom(&seed) % (maxVertices - 1);
+		if (CycleTestBuildGraph(&graph, &conn, n, &seed) != FSUCCESS) {
+			fprintf(stderr, "cycles: Unable to allocate memory\n");
+			bad++;
+		} else {
+			vertices += graph.NumActiveVertices;
+			arcs += graph.NumArcs;
+			bad += CycleTestCompare(&fabric, &graph, distances, routes,
+						previous, done, path, &report, &searches, &ties);
+		}
+		CLGraphDataFree(&graph, &report.cl);
+		if (bad >= 10)
+			break;
+	}
+	printf("cycles: %u graphs, %u vertices, %u arcs: %.3f s, %u cycle searches, %u ties listing other vertices\n",
+			g, vertices, arcs, (double)(GetTimeStamp() - start)/1000000,
+			searches, ties);
+
+done:
+	if (distances)
+		MemoryDeallocate(distances);
+	if (routes)
+		MemoryDeallocate(routes);
+	if (previous)
+		MemoryDeallocate(previous);
+	if (path)
+		MemoryDeallocate(path);
+	if (done)
+		MemoryDeallocate(done);
+	if (report.start)
+		MemoryDeallocate(report.start);
+	if (report.length)
+		MemoryDeallocate(report.length);
+	if (report.first)
+		MemoryDeallocate(report.first);
+	if (report.steps)
+		MemoryDeallocate(report.steps);
+	printf("cycles: %s\n", bad ? "FAILED" : "PASSED");
+	return bad ? 1 : 0;
+}
@@ -0,0 +1,129 @@
+/* BEGIN_ICS_COPYRIGHT7 ****************************************
+
+Copyright (c) 2015-2020, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+** END_ICS_COPYRIGHT7   ****************************************/
+
+/* [ICS VERSION STRING: unknown] */
+
+#include <unistd.h>
+#include "topology_test.h"
+
+static uint32 FakeMadRandom(FakeMad_t *fakep)
+{
+	fakep->seed = fakep->seed * 1103515245 + 12345;
+	return (fakep->seed >> 16) & 0x7fff;
+}
+
+static FSTATUS FakeMadSend(void *context, uint8_t *mad, size_t size,
+				struct omgt_mad_addr *addr, int timeout_ms)
+{
+	FakeMad_t *fakep = (FakeMad_t *)context;
+	FakeMadPending_t *p;
+	uint64 delay = fakep->latency_us;
+
+	if (fakep->numPending >= fakep->capacity)
+		return FINSUFFICIENT_RESOURCES;
+	if (size > sizeof(p->mad))
+		return FINVALID_PARAMETER;
+	if (fakep->jitter_us)
+		delay += FakeMadRandom(fakep) % fakep->jitter_us;
+	p = &fakep->pending[fakep->numPending++];
+	if (fakep->numPending > fakep->maxPending)
+		fakep->maxPending = fakep->numPending;
+	p->at = GetTimeStamp() + delay;
+	p->drop = (FakeMadRandom(fakep) % 100) < fakep->drop_pct;
+	p->size = size;
+	p->addr = *addr;
+	memcpy(p->mad, mad, size);
+	fakep->sent++;
+	return FSUCCESS;
+}
+
+/* deliver the pending MAD due first, waiting up to timeout_ms for it */
+static FSTATUS FakeMadRecv(void *context, uint8_t *mad, size_t *size,
+				int timeout_ms)
+{
+	FakeMad_t *fakep = (FakeMad_t *)context;
+	FakeMadPending_t *p;
+	uint64 now;
+	uint32 i, first = 0;
+
+	if (! fakep->numPending)
+		return FNOT_DONE;
+	for (i=1; i < fakep->numPending; i++) {
+		if (fakep->pending[i].at < fakep->pending[first].at)
+			first = i;
+	}
+	p = &fakep->pending[first];
+	now = GetTimeStamp();
+	if (p->at > now) {
+		if (p->at - now > (uint64)timeout_ms*1000) {
+			usleep(timeout_ms*1000);
+			return FNOT_DONE;
+		}
+		usleep((useconds_t)(p->at - now));
+	}
+	memcpy(mad, p->mad, p->size);
+	*size = p->size;
+	if (p->drop || (*fakep->responder)(fakep->context, mad, size, &p->addr)
+					!= FSUCCESS) {
+		// return the original request, as umad does for a send timeout
+		memcpy(mad, p->mad, p->size);
+		*size = p->size;
+		fakep->dropped++;
+		*p = fakep->pending[--fakep->numPending];
+		return FTIMEOUT;
+	}
+	*p = fakep->pending[--fakep->numPending];
+	return FSUCCESS;
+}
+
+FSTATUS FakeMadInit(FakeMad_t *fakep, uint32 capacity,
+				FakeMadResponder *responder, void *context)
+{
+	MemoryClear(fakep, sizeof(*fakep));
+	fakep->pending = (FakeMadPending_t *)MemoryAllocate2AndClear(
+						sizeof(FakeMadPending_t)*capacity,
+						IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! fakep->pending)
+		return FINSUFFICIENT_MEMORY;
+	fakep->capacity = capacity;
+	fakep->responder = responder;
+	fakep->context = context;
+	fakep->seed = 1;
+	fakep->transport.send = FakeMadSend;
+	fakep->transport.recv = FakeMadRecv;
+	fakep->transport.context = fakep;
+	return FSUCCESS;
+}
+
+void FakeMadDestroy(FakeMad_t *fakep)
+{
+	if (fakep->pending)
+		MemoryDeallocate(fakep->pending);
+	fakep->pending = NULL;
+}
@@ -0,0 +1,82 @@
+/* BEGIN_ICS_COPYRIGHT7 ****************************************
+
+Copyright (c) 2015-2020, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+** END_ICS_COPYRIGHT7   ****************************************/
+
+/* [ICS VERSION STRING: unknown] */
+
+#ifndef _FAKE_MAD_H
+#define _FAKE_MAD_H
+
+#include <topology.h>
+#include <opamgt_priv.h>
+
+/* Loopback MadPipeTransport_t for tests.  Each request sent is answered by a
+ * responder after latency_us plus a random part of jitter_us, so responses
+ * come back out of order.  drop_pct of the requests are lost and reported
+ * to the MadPipe_t as FTIMEOUT, as umad does when the send times out.
+ */
+
+/* turn the request in mad (wire format) into its response in place and set
+ * *size to the response length.  Any status other than FSUCCESS leaves the
+ * request unanswered.
+ */
+typedef FSTATUS (FakeMadResponder)(void *context, uint8_t *mad, size_t *size,
+								struct omgt_mad_addr *addr);
+
+typedef struct FakeMadPending_s {
+	uint64			at;				// GetTimeStamp() when delivered
+	uint8			drop;
+	size_t			size;
+	struct omgt_mad_addr addr;
+	uint8_t			mad[STL_MAD_BLOCK_SIZE];
+} FakeMadPending_t;
+
+typedef struct FakeMad_s {
+	MadPipeTransport_t transport;	// for MadPipeCreateTransport
+	uint32			latency_us;
+	uint32			jitter_us;
+	uint32			drop_pct;
+	FakeMadResponder *responder;
+	void			*context;
+	uint32			seed;			// jitter and drop sequence
+
+	uint64			sent;			// statistics
+	uint64			dropped;
+	uint32			maxPending;
+
+	uint32			numPending;
+	uint32			capacity;
+	FakeMadPending_t *pending;
+} FakeMad_t;
+
+/* capacity bounds the MADs in flight, like a umad send queue */
+extern FSTATUS FakeMadInit(FakeMad_t *fakep, uint32 capacity,
+				FakeMadResponder *responder, void *context);
+extern void FakeMadDestroy(FakeMad_t *fakep);
+
+#endif /* _FAKE_MAD_H */
@@ -0,0 +1,445 @@
+/* BEGIN_ICS_COPYRIGHT7 ****************************************
+
+Copyright (c) 2015-2020, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+** END_ICS_COPYRIGHT7   ****************************************/
+
+/* [ICS VERSION STRING: unknown] */
+
+#include <unistd.h>
+#include "topology_test.h"
+#include "fake_sa.h"
+
+static FakeSa_t *g_FakeSa;
+
+FakeSaNode_t *FakeSaAddNode(FakeSa_t *fakep, uint32 index, boolean isSwitch,
+				uint8 numPorts)
+{
+	FakeSaNode_t *nodep;
+	uint8 p;
+
+	if (index >= fakep->numNodes || numPorts > FAKE_SA_MAX_PORTS
+			|| fakep->nodes[index].present)
+		return NULL;
+	nodep = &fakep->nodes[index];
+	MemoryClear(nodep, sizeof(*nodep));
+	nodep->present = 1;
+	nodep->isSwitch = isSwitch;
+	nodep->numPorts = numPorts;
+	nodep->guid = (isSwitch ? 0x0011750100000000ULL : 0x0011750200000000ULL)
+					+ index;
+	nodep->lid = index + 1;
+	if (isSwitch)
+		snprintf(nodep->desc, sizeof(nodep->desc), "switch%u", index);
+	else
+		snprintf(nodep->desc, sizeof(nodep->desc), "node%u hfi1_0", index);
+	for (p=0; p <= FAKE_SA_MAX_PORTS; p++) {
+		nodep->ports[p].peer = -1;
+		nodep->ports[p].speed = STL_LINK_SPEED_25G;
+	}
+	return nodep;
+}
+
+void FakeSaLink(FakeSa_t *fakep, uint32 node1, uint8 port1,
+				uint32 node2, uint8 port2)
+{
+	fakep->nodes[node1].ports[port1].peer = node2;
+	fakep->nodes[node1].ports[port1].peerPort = port2;
+	fakep->nodes[node2].ports[port2].peer = node1;
+	fakep->nodes[node2].ports[port2].peerPort = port1;
+}
+
+void FakeSaUnlink(FakeSa_t *fakep, uint32 node, uint8 port)
+{
+	FakeSaPort_t *portp = &fakep->nodes[node].ports[port];
+
+	if (portp->peer >= 0)
+		fakep->nodes[portp->peer].ports[portp->peerPort].peer = -1;
+	portp->peer = -1;
+}
+
+FSTATUS FakeSaBuildFabric(FakeSa_t *fakep, uint32 numSwitches,
+				uint32 fisPerSwitch, uint32 maxNodes)
+{
+	uint32 numNodes = numSwitches * (1 + fisPerSwitch);
+	uint32 s, f, fi;
+
+	MemoryClear(fakep, sizeof(*fakep));
+	if (! numSwitches || fisPerSwitch + 2 > FAKE_SA_MAX_PORTS)
+		return FINVALID_PARAMETER;
+	fakep->numNodes = MAX(numNodes, maxNodes);
+	fakep->nodes = (FakeSaNode_t *)MemoryAllocate2AndClear(
+						sizeof(FakeSaNode_t)*fakep->numNodes,
+						IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! fakep->nodes)
+		return FINSUFFICIENT_MEMORY;
+	// FIs on ports 1 to fisPerSwitch, ring on the next two ports
+	for (s=0; s < numSwitches; s++)
+		(void)FakeSaAddNode(fakep, s, TRUE, fisPerSwitch + 2);
+	for (s=0; s < numSwitches; s++) {
+		if (numSwitches > 1)
+			FakeSaLink(fakep, s, fisPerSwitch+1, (s+1) % numSwitches,
+						fisPerSwitch+2);
+		for (f=0; f < fisPerSwitch; f++) {
+			fi = numSwitches + s*fisPerSwitch + f;
+			(void)FakeSaAddNode(fakep, fi, FALSE, 1);
+			FakeSaLink(fakep, fi, 1, s, f+1);
+		}
+	}
+	return FSUCCESS;
+}
+
+void FakeSaDestroy(FakeSa_t *fakep)
+{
+	if (fakep->nodes)
+		MemoryDeallocate(fakep->nodes);
+	fakep->nodes = NULL;
+	fakep->numNodes = 0;
+}
+
+/* switch port 0 is always up, other ports are up when cabled */
+static boolean FakeSaPortActive(FakeSaNode_t *nodep, uint8 port)
+{
+	return (nodep->isSwitch && port == 0) || nodep->ports[port].peer >= 0;
+}
+
+static void FakeSaFillPortInfo(FakeSa_t *fakep, FakeSaNode_t *nodep, uint8 port,
+				STL_PORTINFO_RECORD *pRecord)
+{
+	FakeSaPort_t *portp = &nodep->ports[port];
+	boolean active = FakeSaPortActive(nodep, port);
+
+	MemoryClear(pRecord, sizeof(*pRecord));
+	pRecord->RID.EndPortLID = nodep->lid;
+	pRecord->RID.PortNum = nodep->isSwitch ? port : 0;
+	pRecord->PortInfo.LID = nodep->lid;
+	pRecord->PortInfo.LocalPortNum = port;
+	pRecord->PortInfo.PortStates.s.PortState = active ? IB_PORT_ACTIVE : IB_PORT_DOWN;
+	pRecord->PortInfo.PortStates.s.PortPhysicalState = active
+				? IB_PORT_PHYS_LINKUP : IB_PORT_PHYS_POLLING;
+	pRecord->PortInfo.LinkSpeed.Active = portp->speed;
+	pRecord->PortInfo.LinkWidth.Active = STL_LINK_WIDTH_4X;
+	if (portp->peer >= 0) {
+		pRecord->PortInfo.NeighborNodeGUID = fakep->nodes[portp->peer].guid;
+		pRecord->PortInfo.NeighborPortNum = portp->peerPort;
+	}
+}
+
+static FakeSaNode_t *FakeSaFindLid(FakeSa_t *fakep, STL_LID lid)
+{
+	if (! lid || lid > fakep->numNodes || ! fakep->nodes[lid-1].present)
+		return NULL;
+	return &fakep->nodes[lid-1];
+}
+
+static PQUERY_RESULT_VALUES FakeSaAllocResult(size_t size)
+{
+	PQUERY_RESULT_VALUES pResult;
+
+	pResult = (PQUERY_RESULT_VALUES)MemoryAllocate2AndClear(
+					sizeof(*pResult) + size, IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! pResult)
+		return NULL;
+	pResult->Status = FSUCCESS;
+	pResult->MadStatus = MAD_STATUS_SUCCESS;
+	pResult->ResultDataSize = size;
+	return pResult;
+}
+
+static FSTATUS FakeSaOpen(struct omgt_port **port, EUI64 portGuid, int ms_timeout)
+{
+	// never passed to opamgt, Sweep only hands it back to FakeSaQuery
+	*port = (struct omgt_port *)g_FakeSa;
+	return FSUCCESS;
+}
+
+static void FakeSaClose(struct omgt_port *port)
+{
+}
+
+static void FakeSaFree(PQUERY_RESULT_VALUES pQueryResults)
+{
+	MemoryDeallocate(pQueryResults);
+}
+
+static FSTATUS FakeSaQuery(struct omgt_port *port, OMGT_QUERY *query,
+				PQUERY_RESULT_VALUES *ppQueryResults)
+{
+	FakeSa_t *fakep = (FakeSa_t *)port;
+	PQUERY_RESULT_VALUES pResult = NULL;
+	FakeSaNode_t *nodep;
+	STL_LID lid;
+	uint32 i, first = 0, last = fakep->numNodes, count = 0;
+	uint8 p;
+
+	i = AtomicIncrement(&fakep->queries);
+	if (fakep->latency_us)
+		usleep(fakep->latency_us);
+	if (fakep->failFrom && i >= fakep->failFrom) {
+		*ppQueryResults = NULL;
+		return FTIMEOUT;
+	}
+	if (query->InputType == InputTypeLid) {
+		AtomicIncrementVoid(&fakep->lidQueries);
+		if (query->OutputType == OutputTypeStlSwitchInfoRecord)
+			lid = query->InputValue.SwitchInfoRecord.Lid;
+		else
+			lid = query->InputValue.PortInfoRecord.Lid;
+		// a query for one LID only visits that node
+		nodep = FakeSaFindLid(fakep, lid);
+		first = nodep ? lid-1 : 0;
+		last = nodep ? lid : 0;
+	} else if (query->InputType != InputTypeNoInput) {
+		*ppQueryResults = FakeSaAllocResult(sizeof(uint32));
+		return *ppQueryResults ? FSUCCESS : FINSUFFICIENT_MEMORY;
+	}
+
+	switch (query->OutputType) {
+	case OutputTypeStlNodeRecord:
+	{
+		STL_NODE_RECORD_RESULTS *pNodes;
+
+		for (i=first; i < last; i++)
+			count += fakep->nodes[i].present;
+		pResult = FakeSaAllocResult(sizeof(*pNodes)
+								+ count*sizeof(STL_NODE_RECORD));
+		if (! pResult)
+			break;
+		pNodes = (STL_NODE_RECORD_RESULTS *)pResult->QueryResult;
+		count = 0;
+		for (i=first; i < last; i++) {
+			FakeSaNode_t *np = &fakep->nodes[i];
+			STL_NODE_RECORD *pRecord;
+
+			if (! np->present)
+				continue;
+			pRecord = &pNodes->NodeRecords[count++];
+			pRecord->RID.LID = np->lid;
+			pRecord->NodeInfo.NodeType = np->isSwitch ? STL_NODE_SW : STL_NODE_FI;
+			pRecord->NodeInfo.NumPorts = np->numPorts;
+			pRecord->NodeInfo.NodeGUID = np->guid;
+			pRecord->NodeInfo.PortGUID = np->guid;
+			pRecord->NodeInfo.SystemImageGUID = np->guid;
+			pRecord->NodeInfo.u1.s.LocalPortNum = np->isSwitch ? 0 : 1;
+			memcpy(pRecord->NodeDesc.NodeString, np->desc,
+					sizeof(pRecord->NodeDesc.NodeString));
+		}
+		pNodes->NumNodeRecords = count;
+		break;
+	}
+	case OutputTypeStlPortInfoRecord:
+	{
+		STL_PORTINFO_RECORD_RESULTS *pPorts;
+
+		for (i=first; i < last; i++) {
+			FakeSaNode_t *np = &fakep->nodes[i];
+
+			if (np->present)
+				count += np->numPorts + (np->isSwitch ? 1 : 0);
+		}
+		pResult = FakeSaAllocResult(sizeof(*pPorts)
+								+ count*sizeof(STL_PORTINFO_RECORD));
+		if (! pResult)
+			break;
+		pPorts = (STL_PORTINFO_RECORD_RESULTS *)pResult->QueryResult;
+		count = 0;
+		for (i=first; i < last; i++) {
+			FakeSaNode_t *np = &fakep->nodes[i];
+
+			if (! np->present)
+				continue;
+			for (p = np->isSwitch ? 0 : 1; p <= np->numPorts; p++)
+				FakeSaFillPortInfo(fakep, np, p, &pPorts->PortInfoRecords[count++]);
+		}
+		pPorts->NumPortInfoRecords = count;
+		break;
+	}
+	case OutputTypeStlSwitchInfoRecord:
+	{
+		STL_SWITCHINFO_RECORD_RESULTS *pSwitches;
+
+		for (i=first; i < last; i++)
+			count += fakep->nodes[i].present && fakep->nodes[i].isSwitch;
+		pResult = FakeSaAllocResult(sizeof(*pSwitches)
+								+ count*sizeof(STL_SWITCHINFO_RECORD));
+		if (! pResult)
+			break;
+		pSwitches = (STL_SWITCHINFO_RECORD_RESULTS *)pResult->QueryResult;
+		count = 0;
+		for (i=first; i < last; i++) {
+			FakeSaNode_t *np = &fakep->nodes[i];
+			STL_SWITCHINFO_RECORD *pRecord;
+
+			if (! np->present || ! np->isSwitch)
+				continue;
+			pRecord = &pSwitches->SwitchInfoRecords[count++];
+			pRecord->RID.LID = np->lid;
+			pRecord->SwitchInfoData.LinearFDBTop = fakep->lftTop ? fakep->lftTop
+													: fakep->numNodes;
+			pRecord->SwitchInfoData.LinearFDBCap = pRecord->SwitchInfoData.LinearFDBTop + 1;
+			pRecord->SwitchInfoData.RoutingMode.Enabled = STL_ROUTE_LINEAR;
+			if (fakep->mftSize) {
+				pRecord->SwitchInfoData.MulticastFDBCap = fakep->mftSize;
+				pRecord->SwitchInfoData.MulticastFDBTop = STL_LID_MULTICAST_BEGIN + fakep->mftSize - 1;
+			}
+			if (fakep->portGroups) {
+				pRecord->SwitchInfoData.AdaptiveRouting.s.Enable = 1;
+				pRecord->SwitchInfoData.PortGroupCap = fakep->portGroups;
+				pRecord->SwitchInfoData.PortGroupTop = fakep->portGroups;
+			}
+		}
+		pSwitches->NumSwitchInfoRecords = count;
+		break;
+	}
+	case OutputTypeStlLinkRecord:
+	{
+		STL_LINK_RECORD_RESULTS *pLinks;
+
+		for (i=first; i < last; i++) {
+			FakeSaNode_t *np = &fakep->nodes[i];
+
+			if (! np->present)
+				continue;
+			for (p=1; p <= np->numPorts; p++)
+				count += (np->ports[p].peer >= 0);
+		}
+		pResult = FakeSaAllocResult(sizeof(*pLinks)
+								+ count*sizeof(STL_LINK_RECORD));
+		if (! pResult)
+			break;
+		pLinks = (STL_LINK_RECORD_RESULTS *)pResult->QueryResult;
+		count = 0;
+		for (i=first; i < last; i++) {
+			FakeSaNode_t *np = &fakep->nodes[i];
+
+			if (! np->present)
+				continue;
+			for (p=1; p <= np->numPorts; p++) {
+				STL_LINK_RECORD *pRecord;
+
+				if (np->ports[p].peer < 0)
+					continue;
+				pRecord = &pLinks->LinkRecords[count++];
+				pRecord->RID.FromLID = np->lid;
+				pRecord->RID.FromPort = p;
+				pRecord->ToLID = fakep->nodes[np->ports[p].peer].lid;
+				pRecord->ToPort = np->ports[p].peerPort;
+			}
+		}
+		pLinks->NumLinkRecords = count;
+		break;
+	}
+	case OutputTypeStlVfInfoRecord:
+	{
+		STL_VFINFO_RECORD_RESULTS *pVfs;
+
+		// an SM always has the Default vFabric
+		pResult = FakeSaAllocResult(sizeof(*pVfs) + sizeof(STL_VFINFO_RECORD));
+		if (! pResult)
+			break;
+		pVfs = (STL_VFINFO_RECORD_RESULTS *)pResult->QueryResult;
+		pVfs->VfInfoRecords[0].pKey = STL_DEFAULT_APP_PKEY;
+		StringCopy((char *)pVfs->VfInfoRecords[0].vfName, "Default",
+					sizeof(pVfs->VfInfoRecords[0].vfName));
+		pVfs->NumVfInfoRecords = 1;
+		break;
+	}
+	default:
+		// every *_RECORD_RESULTS starts with its record count
+		pResult = FakeSaAllocResult(sizeof(uint32));
+		break;
+	}
+	*ppQueryResults = pResult;
+	return pResult ? FSUCCESS : FINSUFFICIENT_MEMORY;
+}
+
+static const SweepSaTransport_t g_FakeSaTransport = {
+	FakeSaOpen, FakeSaClose, FakeSaQuery, FakeSaFree
+};
+
+void FakeSaInstall(FakeSa_t *fakep)
+{
+	g_FakeSa = fakep;
+	SetSweepSaTransport(fakep ? &g_FakeSaTransport : NULL);
+}
+
+uint32 FakeSaCheckFabric(FakeSa_t *fakep, FabricData_t *fabricp)
+{
+	uint32 i, nodes = 0, bad = 0;
+	uint8 p;
+
+	for (i=0; i < fakep->numNodes; i++) {
+		FakeSaNode_t *np = &fakep->nodes[i];
+		NodeData *nodep;
+
+		if (! np->present)
+			continue;
+		nodes++;
+		nodep = FindNodeGuid(fabricp, np->guid);
+		if (! nodep) {
+			if (bad++ < 10)
+				fprintf(stderr, "%s: missing\n", np->desc);
+			continue;
+		}
+		if (strncmp((char *)nodep->NodeDesc.NodeString, np->desc,
+					sizeof(np->desc)) != 0
+				|| nodep->NodeInfo.NumPorts != np->numPorts) {
+			if (bad++ < 10)
+				fprintf(stderr, "%s: NodeDesc or NumPorts differs\n", np->desc);
+		}
+		for (p = np->isSwitch ? 0 : 1; p <= np->numPorts; p++) {
+			PortData *portp = FindNodePort(nodep, p);
+			FakeSaPort_t *fp = &np->ports[p];
+
+			if (! FakeSaPortActive(np, p)) {
+				// down ports are omitted
+				if (portp && bad++ < 10)
+					fprintf(stderr, "%s port %u: unexpected\n", np->desc, p);
+				continue;
+			}
+			if (! portp || portp->EndPortLID != np->lid
+					|| portp->PortInfo.LinkSpeed.Active != fp->speed) {
+				if (bad++ < 10)
+					fprintf(stderr, "%s port %u: missing or differs\n", np->desc, p);
+				continue;
+			}
+			if (fp->peer < 0 ? portp->neighbor != NULL
+					: (! portp->neighbor
+						|| portp->neighbor->nodep->NodeInfo.NodeGUID
+								!= fakep->nodes[fp->peer].guid
+						|| portp->neighbor->PortNum != fp->peerPort)) {
+				if (bad++ < 10)
+					fprintf(stderr, "%s port %u: wrong neighbor\n", np->desc, p);
+			}
+		}
+	}
+	if (cl_qmap_count(&fabricp->AllNodes) != nodes) {
+		if (bad++ < 10)
+			fprintf(stderr, "fabric has %u nodes, expected %u\n",
+				(unsigned)cl_qmap_count(&fabricp->AllNodes), nodes);
+	}
+	return bad;
+}
@@ -0,0 +1,93 @@
+/* BEGIN_ICS_COPYRIGHT7 ****************************************
+
+Copyright (c) 2015-2020, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+** END_ICS_COPYRIGHT7   ****************************************/
+
+/* [ICS VERSION STRING: unknown] */
+
+#ifndef _FAKE_SA_H
+#define _FAKE_SA_H
+
+#include <topology.h>
+
+/* Simulated SA for Sweep, SweepRefresh and GetAllFDBs, installed with
+ * SetSweepSaTransport.  It answers NodeRecord, PortInfoRecord,
+ * SwitchInfoRecord and LinkRecord queries from a model fabric and
+ * VfInfoRecord with the Default vFabric, every other query gets an empty
+ * result.  Each query takes latency_us.  Setting failFrom makes that query
+ * and all after it fail, as when the SA goes away.
+ * The transport has no context, so only one FakeSa_t may be installed.
+ */
+#define FAKE_SA_MAX_PORTS	64
+
+typedef struct FakeSaPort_s {
+	int32			peer;			// index of neighbor node, -1 if none
+	uint8			peerPort;
+	uint8			speed;			// STL_LINK_SPEED_*
+} FakeSaPort_t;
+
+typedef struct FakeSaNode_s {
+	uint8			present;
+	uint8			isSwitch;
+	uint8			numPorts;
+	EUI64			guid;
+	STL_LID			lid;
+	char			desc[STL_NODE_DESCRIPTION_ARRAY_SIZE];
+	FakeSaPort_t	ports[FAKE_SA_MAX_PORTS+1];	// index is port number
+} FakeSaNode_t;
+
+typedef struct FakeSa_s {
+	uint32			numNodes;		// nodes allocated, some may be absent
+	FakeSaNode_t	*nodes;
+	uint32			latency_us;
+	uint32			failFrom;		// 1st failing query counted in queries, 0 none
+	uint32			lftTop;			// SwitchInfo LinearFDBTop, 0 for the top LID
+	uint32			mftSize;		// multicast LIDs in each MFT, 0 for none
+	uint8			portGroups;		// PortGroupTop, non-zero enables adaptive routing
+
+	ATOMIC_UINT		queries;		// statistics
+	ATOMIC_UINT		lidQueries;		// queries for a single LID
+} FakeSa_t;
+
+/* numSwitches switches in a ring, each with fisPerSwitch FIs.
+ * maxNodes leaves room for FakeSaAddNode.
+ */
+extern FSTATUS FakeSaBuildFabric(FakeSa_t *fakep, uint32 numSwitches,
+				uint32 fisPerSwitch, uint32 maxNodes);
+extern void FakeSaDestroy(FakeSa_t *fakep);
+/* add a node at index, returns NULL if index is in use or out of range */
+extern FakeSaNode_t *FakeSaAddNode(FakeSa_t *fakep, uint32 index,
+				boolean isSwitch, uint8 numPorts);
+extern void FakeSaLink(FakeSa_t *fakep, uint32 node1, uint8 port1,
+				uint32 node2, uint8 port2);
+extern void FakeSaUnlink(FakeSa_t *fakep, uint32 node, uint8 port);
+/* NULL restores the opamgt transport */
+extern void FakeSaInstall(FakeSa_t *fakep);
+/* compare a swept fabric with the model, returns number of differences */
+extern uint32 FakeSaCheckFabric(FakeSa_t *fakep, FabricData_t *fabricp);
+
+#endif /* _FAKE_SA_H */
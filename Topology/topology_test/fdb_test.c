@@ -0,0 +1,482 @@
+/* BEGIN_ICS_COPYRIGHT7 ****************************************
+
+Copyright (c) 2015-2020, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+** END_ICS_COPYRIGHT7   ****************************************/
+
+/* [ICS VERSION STRING: unknown] */
+
+#include <getopt.h>
+#include <unistd.h>
+#include "topology_test.h"
+#include "fake_sa.h"
+
+/* GetAllFDBs with FF_SMADIRECT against a simulated SMA, on a fabric swept
+ * from the simulated SA.  The pipelined fetch, with responses reordered and
+ * lost, must produce the same LFT, MFT, PGFT and PGT as the serial loop
+ * GetAllFDBsDirect used before, which is kept below as the reference.
+ * With a dead switch only that switch may be reported and its tables left
+ * as allocated.
+ */
+typedef struct FdbTestSma_s {
+	STL_LID			deadLid;		// never answers, 0 for none
+} FdbTestSma_t;
+
+/* content the fake SMA returns for a block of any FDB attribute */
+static void FillBlock(STL_LID lid, uint32 attr, uint32 modifier, uint8 *data,
+				uint32 length)
+{
+	uint32 i, h = lid*2654435761u ^ attr*40503u ^ modifier*2246822519u;
+
+	for (i=0; i < length; i++) {
+		h = h*1103515245 + 12345;
+		data[i] = (uint8)(h >> 16);
+	}
+}
+
+static FSTATUS FdbSmaResponder(void *context, uint8_t *mad, size_t *size,
+				struct omgt_mad_addr *addr)
+{
+	FdbTestSma_t *smap = (FdbTestSma_t *)context;
+	STL_SMP *smp = (STL_SMP *)mad;
+	uint32 length;
+
+	if (addr->lid == smap->deadLid)
+		return FNOT_DONE;
+	STL_BSWAP_SMP_HEADER(smp);
+	switch (smp->common.AttributeID) {
+	case STL_MCLASS_ATTRIB_ID_LINEAR_FWD_TABLE:
+		length = sizeof(STL_LINEAR_FORWARDING_TABLE);
+		break;
+	case STL_MCLASS_ATTRIB_ID_MCAST_FWD_TABLE:
+		length = sizeof(STL_MULTICAST_FORWARDING_TABLE);
+		break;
+	case STL_MCLASS_ATTRIB_ID_PORT_GROUP_FWD_TABLE:
+		length = sizeof(STL_PORT_GROUP_FORWARDING_TABLE);
+		break;
+	case STL_MCLASS_ATTRIB_ID_PORT_GROUP_TABLE:
+		length = sizeof(STL_PORT_GROUP_TABLE);
+		break;
+	default:
+		return FERROR;
+	}
+	smp->common.mr.AsReg8 = MMTHD_GET_RESP;
+	FillBlock(addr->lid, smp->common.AttributeID, smp->common.AttributeModifier,
+				stl_get_smp_data(smp), length);
+	*size = stl_get_smp_header_size(smp) + length;
+	STL_BSWAP_SMP_HEADER(smp);
+	return FSUCCESS;
+}
+
+static void FdbTestCallback(void *context, FSTATUS status)
+{
+	*(FSTATUS *)context = status;
+}
+
+/* one blocking SMA Get, as the SmaGet* calls of the serial loop */
+static FSTATUS FdbSerialGet(MadPipe_t *pipep, STL_LID lid, uint32 attr,
+				uint32 modifier, void *buffer, uint32 length)
+{
+	FSTATUS status;
+
+	memset(buffer, 0, length);
+	status = MadPipeSmaSubmit(pipep, lid, 0, NULL, MMTHD_GET, attr, modifier,
+						(uint8_t *)buffer, length, FdbTestCallback, &status);
+	if (status == FSUCCESS)
+		(void)MadPipeWait(pipep);
+	return status;
+}
+
+/* the serial GetAllFDBsDirect loop, one block MAD outstanding at a time */
+static FSTATUS FdbSerialFetch(MadPipe_t *pipep, FabricData_t *fabricp)
+{
+	cl_map_item_t *p;
+	uint32 ix, block, position, limit;
+	STL_LINEAR_FORWARDING_TABLE		linearFDB;
+	STL_MULTICAST_FORWARDING_TABLE	multicastFDB;
+	STL_PORT_GROUP_TABLE			pgt;
+	STL_PORT_GROUP_FORWARDING_TABLE	pgFDB;
+	FSTATUS status;
+
+	for (p=cl_qmap_head(&fabricp->AllNodes); p != cl_qmap_end(&fabricp->AllNodes); p = cl_qmap_next(p)) {
+		NodeData *nodep = PARENT_STRUCT(p, NodeData, AllNodesEntry);
+		STL_SWITCH_INFO *pSwitchInfo;
+		uint32 linearFDBSize, multicastFDBSize, pgFDBSize, pgSize;
+		uint32 maxPosition;
+		STL_LID lid;
+
+		if (nodep->NodeInfo.NodeType != STL_NODE_SW)
+			continue;
+		pSwitchInfo = &nodep->pSwitchInfo->SwitchInfoData;
+		lid = nodep->pSwitchInfo->RID.LID;
+		linearFDBSize = pSwitchInfo->LinearFDBTop+1;
+		multicastFDBSize = ComputeMulticastFDBSize(pSwitchInfo);
+		status = NodeDataAllocateSwitchData(fabricp, nodep, linearFDBSize,
+						multicastFDBSize);
+		if (status != FSUCCESS)
+			return status;
+
+		limit = ROUNDUP(linearFDBSize,MAX_LFT_ELEMENTS_BLOCK)/MAX_LFT_ELEMENTS_BLOCK;
+		if (pSwitchInfo->RoutingMode.Enabled == STL_ROUTE_LINEAR) {
+			for (ix = 0; ix < limit; ix++) {
+				if (FdbSerialGet(pipep, lid, STL_MCLASS_ATTRIB_ID_LINEAR_FWD_TABLE,
+						0x01000000 + ix, &linearFDB, sizeof(linearFDB)) != FSUCCESS)
+					continue;
+				BSWAP_STL_LINEAR_FORWARDING_TABLE(&linearFDB);
+				memcpy(&nodep->switchp->LinearFDB[ix], linearFDB.LftBlock,
+						MIN(linearFDBSize - ix, (int)MAX_LFT_ELEMENTS_BLOCK));
+			}
+		}
+
+		maxPosition = nodep->NodeInfo.NumPorts / STL_PORT_MASK_WIDTH;
+		for (ix = 0, block=0; ix < multicastFDBSize; ix += STL_NUM_MFT_ELEMENTS_BLOCK, block++) {
+			for (position=0; position <= maxPosition; position++) {
+				if (FdbSerialGet(pipep, lid, STL_MCLASS_ATTRIB_ID_MCAST_FWD_TABLE,
+						(0x1<<24) | (0x3 & position)<<22 | (block & 0xfffff),
+						&multicastFDB, sizeof(multicastFDB)) != FSUCCESS)
+					continue;
+				BSWAP_STL_MULTICAST_FORWARDING_TABLE(&multicastFDB);
+				memcpy(GetMulticastFDBEntry(nodep, block * STL_NUM_MFT_ELEMENTS_BLOCK, position),
+						multicastFDB.MftBlock,
+						MIN(multicastFDBSize-ix,STL_NUM_MFT_ELEMENTS_BLOCK) * sizeof(STL_PORTMASK));
+			}
+		}
+
+		if (pSwitchInfo->AdaptiveRouting.s.Enable) {
+			pgFDBSize = MIN(pSwitchInfo->LinearFDBTop+1,
+							pSwitchInfo->PortGroupFDBCap ?
+								pSwitchInfo->PortGroupFDBCap :
+								DEFAULT_MAX_PGFT_LID+1);
+			limit = ROUNDUP(pgFDBSize, NUM_PGFT_ELEMENTS_BLOCK)/NUM_PGFT_ELEMENTS_BLOCK;
+			for (ix = 0; ix < limit; ix++) {
+				if (FdbSerialGet(pipep, lid, STL_MCLASS_ATTRIB_ID_PORT_GROUP_FWD_TABLE,
+						0x01000000 + ix, &pgFDB, sizeof(pgFDB)) != FSUCCESS)
+					continue;
+				BSWAP_STL_PORT_GROUP_FORWARDING_TABLE(&pgFDB);
+				memcpy(&nodep->switchp->PortGroupFDB[ix], pgFDB.PgftBlock,
+						MIN(pgFDBSize - ix, (int)NUM_PGFT_ELEMENTS_BLOCK));
+			}
+
+			pgSize = pSwitchInfo->PortGroupTop;
+			limit = ROUNDUP(pgSize, NUM_PGT_ELEMENTS_BLOCK)/NUM_PGT_ELEMENTS_BLOCK;
+			for (ix = 0; ix < limit; ix++) {
+				if (FdbSerialGet(pipep, lid, STL_MCLASS_ATTRIB_ID_PORT_GROUP_TABLE,
+						0x01000000 + ix, &pgt, sizeof(pgt)) != FSUCCESS)
+					continue;
+				BSWAP_STL_PORT_GROUP_TABLE(&pgt);
+				memcpy(&nodep->switchp->PortGroupElements[ix*NUM_PGT_ELEMENTS_BLOCK],
+						pgt.PgtBlock,
+						(MIN(pgSize - (ix*NUM_PGT_ELEMENTS_BLOCK), (int)NUM_PGT_ELEMENTS_BLOCK)) * sizeof(STL_PORTMASK));
+			}
+		}
+	}
+	fabricp->flags |= FF_ROUTES;
+	return FSUCCESS;
+}
+
+static FSTATUS FdbSweep(FabricData_t *fabricp)
+{
+	FSTATUS status;
+
+	status = Sweep(1, fabricp, FF_NONE, SWEEP_ALL, 1, 1000);
+	if (status != FSUCCESS) {
+		fprintf(stderr, "fdb: Sweep failed: %s\n", iba_fstatus_msg(status));
+		return status;
+	}
+	fabricp->flags |= FF_SMADIRECT;
+	return FSUCCESS;
+}
+
+/* GetAllFDBs with stderr captured in *errp, returns seconds taken */
+static double FdbPipelinedFetch(FabricData_t *fabricp, FILE **errp)
+{
+	uint64 start;
+	FSTATUS status;
+	int fd = dup(2);
+
+	fflush(stderr);
+	*errp = tmpfile();
+	if (! *errp || fd < 0) {
+		fprintf(stderr, "fdb: Unable to capture stderr\n");
+		return -1;
+	}
+	dup2(fileno(*errp), 2);
+	start = GetTimeStamp();
+	status = GetAllFDBs(1, fabricp, NULL, 1);
+	fflush(stderr);
+	dup2(fd, 2);
+	close(fd);
+	rewind(*errp);
+	if (status != FSUCCESS || ! (fabricp->flags & FF_ROUTES)) {
+		fprintf(stderr, "fdb: GetAllFDBs failed: %s\n", iba_fstatus_msg(status));
+		return -1;
+	}
+	return (double)(GetTimeStamp() - start)/1000000;
+}
+
+static boolean FdbTableDiffers(const void *a, const void *b, size_t size)
+{
+	if (! a || ! b)
+		return a != b;
+	return memcmp(a, b, size) != 0;
+}
+
+/* compare the tables of one switch, returns the name of one which
+ * differs or NULL.  MulticastFDBSize is MulticastFDBTop+1, mftEntries is
+ * the size of each MulticastFDB
+ */
+static const char *FdbCompareSwitch(SwitchData *s1, SwitchData *s2, uint32 mftEntries)
+{
+	int i;
+
+	if (s1->LinearFDBSize != s2->LinearFDBSize
+		|| FdbTableDiffers(s1->LinearFDB, s2->LinearFDB,
+					ROUNDUP(s1->LinearFDBSize, MAX_LFT_ELEMENTS_BLOCK)))
+		return "LFT";
+	for (i=0; i < STL_NUM_MFT_POSITIONS_MASK; i++) {
+		if (s1->MulticastFDBSize != s2->MulticastFDBSize
+			|| FdbTableDiffers(s1->MulticastFDB[i], s2->MulticastFDB[i],
+					mftEntries * sizeof(STL_PORTMASK)))
+			return "MFT";
+	}
+	if (s1->PortGroupFDBSize != s2->PortGroupFDBSize
+		|| FdbTableDiffers(s1->PortGroupFDB, s2->PortGroupFDB,
+					ROUNDUP(s1->PortGroupFDBSize, NUM_PGFT_ELEMENTS_BLOCK)))
+		return "PGFT";
+	if (s1->PortGroupSize != s2->PortGroupSize
+		|| FdbTableDiffers(s1->PortGroupElements, s2->PortGroupElements,
+					s1->PortGroupSize * sizeof(STL_PORTMASK)))
+		return "PGT";
+	return NULL;
+}
+
+/* compare every switch's tables with the reference, the dead switch's with
+ * freshly allocated tables.  Returns number of differing switches.
+ */
+static uint32 FdbCompare(FabricData_t *ref, FabricData_t *fabricp, STL_LID deadLid)
+{
+	cl_map_item_t *p;
+	uint32 bad = 0;
+
+	for (p=cl_qmap_head(&ref->AllNodes); p != cl_qmap_end(&ref->AllNodes); p = cl_qmap_next(p)) {
+		NodeData *refp = PARENT_STRUCT(p, NodeData, AllNodesEntry);
+		NodeData *nodep;
+		SwitchData *expected;
+		const char *table;
+
+		if (refp->NodeInfo.NodeType != STL_NODE_SW)
+			continue;
+		nodep = FindNodeGuid(fabricp, refp->NodeInfo.NodeGUID);
+		if (! nodep || ! nodep->switchp || ! refp->switchp) {
+			if (bad++ < 10)
+				fprintf(stderr, "fdb: %.*s: no tables\n", STL_NODE_DESCRIPTION_ARRAY_SIZE,
+						(char *)refp->NodeDesc.NodeString);
+			continue;
+		}
+		expected = refp->switchp;
+		if (nodep->pSwitchInfo->RID.LID == deadLid) {
+			// the reference is done with this switch, reallocate it empty
+			if (NodeDataAllocateSwitchData(ref, refp, refp->switchp->LinearFDBSize,
+						refp->switchp->MulticastFDBSize) != FSUCCESS) {
+				bad++;
+				continue;
+			}
+			expected = refp->switchp;
+		}
+		table = FdbCompareSwitch(expected, nodep->switchp,
+					MIN(ComputeMulticastFDBSize(&refp->pSwitchInfo->SwitchInfoData),
+						refp->pSwitchInfo->SwitchInfoData.MulticastFDBCap));
+		if (table) {
+			if (bad++ < 10)
+				fprintf(stderr, "fdb: %.*s: %s differs\n", STL_NODE_DESCRIPTION_ARRAY_SIZE,
+						(char *)refp->NodeDesc.NodeString, table);
+		}
+	}
+	return bad;
+}
+
+/* count the per block failures GetAllFDBs reported for deadLid and for
+ * any other LID, and its summary of failed switches
+ */
+static void FdbCountErrors(FILE *err, STL_LID deadLid, uint32 *deadp,
+				uint32 *otherp, uint32 *failedSwitchesp)
+{
+	char line[512];
+	char dead[32];
+	unsigned failed;
+
+	*deadp = *otherp = *failedSwitchesp = 0;
+	if (! err)
+		return;
+	while (fgets(line, sizeof(line), err)) {
+		if (strstr(line, "Unable to get all FDB blocks from ")
+			&& sscanf(strstr(line, "from ") + 5, "%u", &failed) == 1) {
+			*failedSwitchesp = failed;
+			continue;
+		}
+		if (! strstr(line, "SMA Get("))
+			continue;
+		// MFT failures print the LID in 8 digits
+		snprintf(dead, sizeof(dead), "to LID 0x%x ", deadLid);
+		if (strstr(line, dead)) {
+			(*deadp)++;
+			continue;
+		}
+		snprintf(dead, sizeof(dead), "to LID 0x%08x ", deadLid);
+		if (strstr(line, dead))
+			(*deadp)++;
+		else
+			(*otherp)++;
+	}
+}
+
+int TestFdb(int argc, char **argv)
+{
+	uint32 numSwitches = 16, fisPerSwitch = 62, window = 64;
+	uint32 latency = 100, jitter = 400, drop = 2;
+	uint32 lftTop = 0xbfff, mftSize = 256, portGroups = 64;
+	FabricData_t ref, fabric;
+	FakeSa_t fakeSa;
+	FakeMad_t fakeMad;
+	FdbTestSma_t sma;
+	MadPipe_t *pipep;
+	FILE *err = NULL;
+	uint32 bad = 0, dead, other, failedSwitches;
+	double serial, pipelined;
+	uint64 start;
+	int c;
+
+	optind = 1;
+	while (-1 != (c = getopt(argc, argv, "s:f:L:l:j:d:"))) {
+		switch (c) {
+		case 's': numSwitches = atoi(optarg); break;
+		case 'f': fisPerSwitch = atoi(optarg); break;
+		case 'L': lftTop = strtoul(optarg, NULL, 0); break;
+		case 'l': latency = atoi(optarg); break;
+		case 'j': jitter = atoi(optarg); break;
+		case 'd': drop = atoi(optarg); break;
+		default: return 2;
+		}
+	}
+	if (numSwitches < 2 || drop >= 100
+		|| FakeSaBuildFabric(&fakeSa, numSwitches, fisPerSwitch, 0) != FSUCCESS) {
+		fprintf(stderr, "fdb: invalid arguments\n");
+		return 2;
+	}
+	fakeSa.lftTop = lftTop;
+	fakeSa.mftSize = mftSize;
+	fakeSa.portGroups = portGroups;
+	FakeSaInstall(&fakeSa);
+	MemoryClear(&sma, sizeof(sma));
+	if (FakeMadInit(&fakeMad, window*3, FdbSmaResponder, &sma) != FSUCCESS) {
+		fprintf(stderr, "fdb: Unable to allocate memory\n");
+		FakeSaInstall(NULL);
+		FakeSaDestroy(&fakeSa);
+		return 1;
+	}
+	SetFdbSmaTransport(&fakeMad.transport);
+
+	// reference: serial, responses in order and none lost
+	if (FdbSweep(&ref) != FSUCCESS) {
+		bad++;
+		goto cleanup;
+	}
+	fakeMad.latency_us = latency;
+	start = GetTimeStamp();
+	pipep = MadPipeCreateTransport(NULL, &fakeMad.transport, 1);
+	if (! pipep || FdbSerialFetch(pipep, &ref) != FSUCCESS) {
+		fprintf(stderr, "fdb: serial fetch failed\n");
+		if (pipep)
+			MadPipeDestroy(pipep);
+		DestroyFabricData(&ref);
+		bad++;
+		goto cleanup;
+	}
+	MadPipeDestroy(pipep);
+	serial = (double)(GetTimeStamp() - start)/1000000;
+	printf("fdb: %u switches, LID space 0x%x, serial: %.3f s, %"PRIu64" MADs\n",
+			numSwitches, lftTop+1, serial, fakeMad.sent);
+
+	// pipelined, responses reordered by jitter and some lost
+	fakeMad.sent = fakeMad.dropped = 0;
+	fakeMad.maxPending = 0;
+	fakeMad.jitter_us = jitter;
+	fakeMad.drop_pct = drop;
+	if (FdbSweep(&fabric) != FSUCCESS) {
+		bad++;
+		goto destroyref;
+	}
+	pipelined = FdbPipelinedFetch(&fabric, &err);
+	if (pipelined < 0)
+		bad++;
+	else
+		bad += FdbCompare(&ref, &fabric, 0);
+	FdbCountErrors(err, 0, &dead, &other, &failedSwitches);
+	if (other || failedSwitches) {
+		fprintf(stderr, "fdb: %u blocks of %u switches reported failed\n",
+				other, failedSwitches);
+		bad++;
+	}
+	if (err)
+		fclose(err);
+	printf("fdb: pipelined: %.3f s, %"PRIu64" MADs, %"PRIu64" lost, max in flight %u\n",
+			pipelined, fakeMad.sent, fakeMad.dropped, fakeMad.maxPending);
+	DestroyFabricData(&fabric);
+
+	// pipelined with a dead switch, only it is reported
+	sma.deadLid = 2;
+	fakeMad.sent = fakeMad.dropped = 0;
+	if (FdbSweep(&fabric) != FSUCCESS) {
+		bad++;
+		goto destroyref;
+	}
+	pipelined = FdbPipelinedFetch(&fabric, &err);
+	if (pipelined < 0)
+		bad++;
+	else
+		bad += FdbCompare(&ref, &fabric, sma.deadLid);
+	FdbCountErrors(err, sma.deadLid, &dead, &other, &failedSwitches);
+	if (! dead || other || failedSwitches != 1) {
+		fprintf(stderr, "fdb: dead switch: %u of its blocks and %u others reported, %u switches failed\n",
+				dead, other, failedSwitches);
+		bad++;
+	}
+	if (err)
+		fclose(err);
+	printf("fdb: dead switch LID 0x%x: %.3f s, %u blocks reported failed\n",
+			sma.deadLid, pipelined, dead);
+	DestroyFabricData(&fabric);
+
+destroyref:
+	DestroyFabricData(&ref);
+cleanup:
+	SetFdbSmaTransport(NULL);
+	FakeMadDestroy(&fakeMad);
+	FakeSaInstall(NULL);
+	FakeSaDestroy(&fakeSa);
+	printf("fdb: %s\n", bad ? "FAILED" : "PASSED");
+	return bad ? 1 : 0;
+}
@@ -0,0 +1,223 @@
+/* BEGIN_ICS_COPYRIGHT7 ****************************************
+
+Copyright (c) 2015-2020, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+** END_ICS_COPYRIGHT7   ****************************************/
+
+/* [ICS VERSION STRING: unknown] */
+
+#include <getopt.h>
+#include "topology_test.h"
+
+/* SMA Get(LinearFDB) of every block of every LID through a MadPipe_t on the
+ * fake transport.  A few LIDs misbehave so error handling is covered too.
+ */
+#define DEAD_LID	2		// never answers
+#define SHORT_LID	3		// response truncated
+#define WRONG_LID	4		// response for another attribute
+
+typedef struct MadPipeTestReq_s {
+	STL_LID			lid;
+	uint32			block;
+	uint32			calls;
+	FSTATUS			status;
+	STL_LINEAR_FORWARDING_TABLE data;
+} MadPipeTestReq_t;
+
+/* content the fake SMA returns for a block */
+static void FillBlock(STL_LID lid, uint32 block, uint8 *data, uint32 length)
+{
+	uint32 i, h = lid*2654435761u ^ block*40503u;
+
+	for (i=0; i < length; i++) {
+		h = h*1103515245 + 12345;
+		data[i] = (uint8)(h >> 16);
+	}
+}
+
+static FSTATUS SmaResponder(void *context, uint8_t *mad, size_t *size,
+				struct omgt_mad_addr *addr)
+{
+	STL_SMP *smp = (STL_SMP *)mad;
+
+	if (addr->lid == DEAD_LID)
+		return FNOT_DONE;
+	STL_BSWAP_SMP_HEADER(smp);
+	smp->common.mr.AsReg8 = MMTHD_GET_RESP;
+	FillBlock(addr->lid, smp->common.AttributeModifier & 0xffffff,
+				stl_get_smp_data(smp), sizeof(STL_LINEAR_FORWARDING_TABLE));
+	*size = stl_get_smp_header_size(smp) + sizeof(STL_LINEAR_FORWARDING_TABLE);
+	if (addr->lid == SHORT_LID)
+		*size -= 8;
+	if (addr->lid == WRONG_LID)
+		smp->common.AttributeID = STL_MCLASS_ATTRIB_ID_PORT_GROUP_TABLE;
+	STL_BSWAP_SMP_HEADER(smp);
+	return FSUCCESS;
+}
+
+static void MadPipeTestCallback(void *context, FSTATUS status)
+{
+	MadPipeTestReq_t *reqp = (MadPipeTestReq_t *)context;
+
+	reqp->calls++;
+	reqp->status = status;
+}
+
+/* issue every request with up to window outstanding, returns seconds taken */
+static double RunMadPipe(FakeMad_t *fakep, MadPipeTestReq_t *reqs,
+				uint32 count, uint32 window)
+{
+	MadPipe_t *pipep;
+	uint64 start;
+	uint32 i;
+	FSTATUS status;
+
+	pipep = MadPipeCreateTransport(NULL, &fakep->transport, window);
+	if (! pipep) {
+		fprintf(stderr, "madpipe: Unable to create MadPipe\n");
+		return -1;
+	}
+	start = GetTimeStamp();
+	for (i=0; i < count; i++) {
+		MemoryClear(&reqs[i].data, sizeof(reqs[i].data));
+		reqs[i].calls = 0;
+		reqs[i].status = FSUCCESS;
+		status = MadPipeSmaSubmit(pipep, reqs[i].lid, 0, NULL, MMTHD_GET,
+						STL_MCLASS_ATTRIB_ID_LINEAR_FWD_TABLE,
+						0x01000000 + reqs[i].block, (uint8_t *)&reqs[i].data,
+						sizeof(reqs[i].data), MadPipeTestCallback, &reqs[i]);
+		if (status != FSUCCESS)
+			MadPipeTestCallback(&reqs[i], status);
+	}
+	(void)MadPipeWait(pipep);
+	MadPipeDestroy(pipep);
+	return (double)(GetTimeStamp() - start)/1000000;
+}
+
+/* every request must complete exactly once, with the fake's data or the
+ * failure its LID was set up for.  Returns number of bad requests.
+ */
+static uint32 CheckMadPipe(MadPipeTestReq_t *reqs, uint32 count)
+{
+	STL_LINEAR_FORWARDING_TABLE expected;
+	uint32 i, bad = 0;
+
+	for (i=0; i < count; i++) {
+		MadPipeTestReq_t *reqp = &reqs[i];
+		boolean ok;
+
+		switch (reqp->lid) {
+		case DEAD_LID:
+			ok = (reqp->status == FTIMEOUT);
+			break;
+		case SHORT_LID:
+		case WRONG_LID:
+			ok = (reqp->status == FERROR);
+			break;
+		default:
+			FillBlock(reqp->lid, reqp->block, (uint8 *)&expected,
+						sizeof(expected));
+			ok = (reqp->status == FSUCCESS
+					&& memcmp(&expected, &reqp->data, sizeof(expected)) == 0);
+			break;
+		}
+		if (reqp->calls != 1 || ! ok) {
+			if (bad++ < 10)
+				fprintf(stderr, "madpipe: LID 0x%x block %u: %u callbacks, status %s\n",
+						reqp->lid, reqp->block, reqp->calls,
+						iba_fstatus_msg(reqp->status));
+		}
+	}
+	return bad;
+}
+
+int TestMadPipe(int argc, char **argv)
+{
+	uint32 numLids = 256, numBlocks = 16, window = 64;
+	uint32 latency = 200, jitter = 400, drop = 5;
+	MadPipeTestReq_t *reqs;
+	FakeMad_t fake;
+	uint32 count, i, bad;
+	double pipelined, serial;
+	int c;
+
+	optind = 1;
+	while (-1 != (c = getopt(argc, argv, "n:b:w:l:j:d:"))) {
+		switch (c) {
+		case 'n': numLids = atoi(optarg); break;
+		case 'b': numBlocks = atoi(optarg); break;
+		case 'w': window = atoi(optarg); break;
+		case 'l': latency = atoi(optarg); break;
+		case 'j': jitter = atoi(optarg); break;
+		case 'd': drop = atoi(optarg); break;
+		default: return 2;
+		}
+	}
+	if (! numLids || ! numBlocks || ! window || drop >= 100) {
+		fprintf(stderr, "madpipe: invalid arguments\n");
+		return 2;
+	}
+	count = numLids * numBlocks;
+	reqs = (MadPipeTestReq_t *)MemoryAllocate2AndClear(
+					sizeof(MadPipeTestReq_t)*count, IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! reqs) {
+		fprintf(stderr, "madpipe: Unable to allocate memory\n");
+		return 1;
+	}
+	for (i=0; i < count; i++) {
+		reqs[i].lid = 1 + i / numBlocks;
+		reqs[i].block = i % numBlocks;
+	}
+	// retries can leave a stale attempt in flight beside its replacement
+	if (FakeMadInit(&fake, window*2, SmaResponder, NULL) != FSUCCESS) {
+		MemoryDeallocate(reqs);
+		fprintf(stderr, "madpipe: Unable to allocate memory\n");
+		return 1;
+	}
+	fake.latency_us = latency;
+	fake.jitter_us = jitter;
+	fake.drop_pct = drop;
+
+	pipelined = RunMadPipe(&fake, reqs, count, window);
+	bad = CheckMadPipe(reqs, count);
+	printf("madpipe: %u requests, window %u: %.3f s, %"PRIu64" MADs, %"PRIu64" lost, max in flight %u\n",
+			count, window, pipelined, fake.sent, fake.dropped, fake.maxPending);
+
+	fake.sent = fake.dropped = 0;
+	serial = RunMadPipe(&fake, reqs, count, 1);
+	bad += CheckMadPipe(reqs, count);
+	printf("madpipe: %u requests, window 1: %.3f s, %"PRIu64" MADs, %"PRIu64" lost\n",
+			count, serial, fake.sent, fake.dropped);
+
+	FakeMadDestroy(&fake);
+	MemoryDeallocate(reqs);
+	if (pipelined < 0 || serial < 0 || bad) {
+		printf("madpipe: FAILED, %u bad requests\n", bad);
+		return 1;
+	}
+	printf("madpipe: PASSED\n");
+	return 0;
+}
@@ -0,0 +1,268 @@
+/* BEGIN_ICS_COPYRIGHT7 ****************************************
+
+Copyright (c) 2015-2020, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+** END_ICS_COPYRIGHT7   ****************************************/
+
+/* [ICS VERSION STRING: unknown] */
+
+
+#include <getopt.h>
+#include "topology_test.h"
+
+/* Direct PMA counter collection as done by GetAllPortCounters, through a
+ * MadPipe_t on the fake transport.  Each switch's PMA is at port 0, is
+ * asked for its ClassPortInfo once and then PortStatus for every port.
+ */
+typedef struct PmaTestReq_s {
+	PortData		*pmaPortp;
+	uint8			portNum;
+	uint32			calls;
+	FSTATUS			status;
+	STL_PORT_STATUS_RSP PortStatus;
+} PmaTestReq_t;
+
+/* counter value the fake PMA reports for a port */
+static uint64 CounterValue(STL_LID lid, uint8 portNum, uint32 counter)
+{
+	return ((uint64)lid << 32) | ((uint64)portNum << 8) | counter;
+}
+
+static FSTATUS PmaResponder(void *context, uint8_t *mad, size_t *size,
+				struct omgt_mad_addr *addr)
+{
+	STL_PERF_MAD *pmad = (STL_PERF_MAD *)mad;
+
+	BSWAP_MAD_HEADER((MAD*)pmad);
+	if (pmad->common.MgmtClass != MCLASS_PERF
+		|| pmad->common.mr.AsReg8 != MMTHD_GET)
+		return FERROR;
+	switch (pmad->common.AttributeID) {
+	case STL_PM_ATTRIB_ID_CLASS_PORTINFO:
+		{
+			STL_CLASS_PORT_INFO *classp = (STL_CLASS_PORT_INFO *)pmad->PerfData;
+
+			MemoryClear(classp, sizeof(*classp));
+			classp->BaseVersion = STL_BASE_VERSION;
+			classp->ClassVersion = STL_PM_CLASS_VERSION;
+			BSWAP_STL_CLASS_PORT_INFO(classp);
+			*size = sizeof(MAD_COMMON) + sizeof(*classp);
+		}
+		break;
+	case STL_PM_ATTRIB_ID_PORT_STATUS:
+		{
+			STL_PORT_STATUS_REQ req = *(STL_PORT_STATUS_REQ *)pmad->PerfData;
+			STL_PORT_STATUS_RSP *rsp = (STL_PORT_STATUS_RSP *)pmad->PerfData;
+			uint32 mask, vls = 0;
+
+			BSWAP_STL_PORT_STATUS_REQ(&req);
+			// one VLs entry per bit in VLSelectMask, the 1st is in *rsp
+			for (mask = req.VLSelectMask; mask; mask >>= 1)
+				vls += (mask & 1);
+			vls = vls ? vls-1 : 0;
+			MemoryClear(rsp, sizeof(*rsp) + vls*sizeof(rsp->VLs[0]));
+			rsp->PortNumber = req.PortNumber;
+			rsp->VLSelectMask = req.VLSelectMask;
+			rsp->PortXmitData = CounterValue(addr->lid, req.PortNumber, 1);
+			rsp->PortRcvData = CounterValue(addr->lid, req.PortNumber, 2);
+			rsp->PortXmitPkts = CounterValue(addr->lid, req.PortNumber, 3);
+			rsp->PortRcvPkts = CounterValue(addr->lid, req.PortNumber, 4);
+			rsp->LinkDowned = addr->lid;
+			BSWAP_STL_PORT_STATUS_RSP(rsp);
+			*size = sizeof(MAD_COMMON) + sizeof(*rsp) + vls*sizeof(rsp->VLs[0]);
+		}
+		break;
+	default:
+		return FERROR;
+	}
+	pmad->common.mr.AsReg8 = MMTHD_GET_RESP;
+	BSWAP_MAD_HEADER((MAD*)pmad);
+	return FSUCCESS;
+}
+
+static void PmaTestCallback(void *context, FSTATUS status)
+{
+	PmaTestReq_t *reqp = (PmaTestReq_t *)context;
+
+	reqp->calls++;
+	reqp->status = status;
+}
+
+/* issue every request with up to window outstanding, returns seconds taken */
+static double RunPma(FakeMad_t *fakep, PmaTestReq_t *reqs, uint32 count,
+				uint32 window)
+{
+	MadPipe_t *pipep;
+	uint64 start;
+	uint32 i;
+	FSTATUS status;
+
+	pipep = MadPipeCreateTransport(NULL, &fakep->transport, window);
+	if (! pipep) {
+		fprintf(stderr, "pma: Unable to create MadPipe\n");
+		return -1;
+	}
+	start = GetTimeStamp();
+	for (i=0; i < count; i++) {
+		PmaTestReq_t *reqp = &reqs[i];
+
+		MemoryClear(&reqp->PortStatus, sizeof(reqp->PortStatus));
+		reqp->calls = 0;
+		reqp->status = FSUCCESS;
+		if (! i || reqs[i-1].pmaPortp != reqp->pmaPortp) {
+			reqp->pmaPortp->PmaGotClassPortInfo = 0;
+			(void)MadPipePmGetClassPortInfo(pipep, reqp->pmaPortp, NULL, NULL);
+		}
+		status = MadPipePmGetPortStatus(pipep, reqp->pmaPortp, reqp->portNum,
+						&reqp->PortStatus, PmaTestCallback, reqp);
+		if (status != FSUCCESS)
+			PmaTestCallback(reqp, status);
+	}
+	(void)MadPipeWait(pipep);
+	MadPipeDestroy(pipep);
+	return (double)(GetTimeStamp() - start)/1000000;
+}
+
+/* every request must complete exactly once with the fake's counters and
+ * every PMA must have its ClassPortInfo.  Returns number of bad requests.
+ */
+static uint32 CheckPma(PmaTestReq_t *reqs, uint32 count)
+{
+	uint32 i, bad = 0;
+
+	for (i=0; i < count; i++) {
+		PmaTestReq_t *reqp = &reqs[i];
+		STL_LID lid = reqp->pmaPortp->pathp->DLID;
+		STL_PORT_STATUS_RSP *rsp = &reqp->PortStatus;
+
+		if (reqp->calls != 1 || reqp->status != FSUCCESS
+			|| ! reqp->pmaPortp->PmaGotClassPortInfo
+			|| rsp->PortNumber != reqp->portNum
+			|| rsp->PortXmitData != CounterValue(lid, reqp->portNum, 1)
+			|| rsp->PortRcvData != CounterValue(lid, reqp->portNum, 2)
+			|| rsp->PortXmitPkts != CounterValue(lid, reqp->portNum, 3)
+			|| rsp->PortRcvPkts != CounterValue(lid, reqp->portNum, 4)
+			|| rsp->LinkDowned != lid) {
+			if (bad++ < 10)
+				fprintf(stderr, "pma: LID 0x%x port %u: %u callbacks, status %s\n",
+						lid, reqp->portNum, reqp->calls,
+						iba_fstatus_msg(reqp->status));
+		}
+	}
+	return bad;
+}
+
+int TestPma(int argc, char **argv)
+{
+	uint32 numSwitches = 64, numPorts = 48, window = 32;
+	uint32 latency = 200, jitter = 400, drop = 2;
+	NodeData *nodes = NULL;
+	PortData *ports = NULL;
+	IB_PATH_RECORD *paths = NULL;
+	PmaTestReq_t *reqs = NULL;
+	FakeMad_t fake;
+	uint32 count, i, bad;
+	double pipelined, serial;
+	int c;
+
+	optind = 1;
+	while (-1 != (c = getopt(argc, argv, "s:p:w:l:j:d:"))) {
+		switch (c) {
+		case 's': numSwitches = atoi(optarg); break;
+		case 'p': numPorts = atoi(optarg); break;
+		case 'w': window = atoi(optarg); break;
+		case 'l': latency = atoi(optarg); break;
+		case 'j': jitter = atoi(optarg); break;
+		case 'd': drop = atoi(optarg); break;
+		default: return 2;
+		}
+	}
+	if (! numSwitches || ! numPorts || numPorts > 255 || ! window || drop >= 100) {
+		fprintf(stderr, "pma: invalid arguments\n");
+		return 2;
+	}
+	count = numSwitches * numPorts;
+	nodes = (NodeData *)MemoryAllocate2AndClear(sizeof(NodeData)*numSwitches,
+					IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	ports = (PortData *)MemoryAllocate2AndClear(sizeof(PortData)*numSwitches,
+					IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	paths = (IB_PATH_RECORD *)MemoryAllocate2AndClear(sizeof(IB_PATH_RECORD)*numSwitches,
+					IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	reqs = (PmaTestReq_t *)MemoryAllocate2AndClear(sizeof(PmaTestReq_t)*count,
+					IBA_MEM_FLAG_PREMPTABLE, MYTAG);
+	if (! nodes || ! ports || ! paths || ! reqs
+		|| FakeMadInit(&fake, window*3, PmaResponder, NULL) != FSUCCESS) {
+		fprintf(stderr, "pma: Unable to allocate memory\n");
+		bad = 1;
+		goto done;
+	}
+	for (i=0; i < numSwitches; i++) {
+		nodes[i].NodeInfo.NodeType = STL_NODE_SW;
+		nodes[i].NodeInfo.NodeGUID = 0x0011750100000000ull + i;
+		ports[i].nodep = &nodes[i];
+		ports[i].pathp = &paths[i];
+		paths[i].DLID = i + 1;
+		paths[i].P_Key = 0xffff;
+	}
+	for (i=0; i < count; i++) {
+		reqs[i].pmaPortp = &ports[i / numPorts];
+		reqs[i].portNum = 1 + i % numPorts;
+	}
+	fake.latency_us = latency;
+	fake.jitter_us = jitter;
+	fake.drop_pct = drop;
+
+	pipelined = RunPma(&fake, reqs, count, window);
+	bad = CheckPma(reqs, count);
+	printf("pma: %u ports on %u switches, window %u: %.3f s, %"PRIu64" MADs, %"PRIu64" lost, max in flight %u\n",
+			count, numSwitches, window, pipelined, fake.sent, fake.dropped,
+			fake.maxPending);
+
+	fake.sent = fake.dropped = 0;
+	serial = RunPma(&fake, reqs, count, 1);
+	bad += CheckPma(reqs, count);
+	printf("pma: %u ports on %u switches, window 1: %.3f s, %"PRIu64" MADs, %"PRIu64" lost\n",
+			count, numSwitches, serial, fake.sent, fake.dropped);
+
+	FakeMadDestroy(&fake);
+	if (pipelined < 0 || serial < 0)
+		bad++;
+done:
+	if (reqs)
+		MemoryDeallocate(reqs);
+	if (paths)
+		MemoryDeallocate(paths);
+	if (ports)
+		MemoryDeallocate(ports);
+	if (nodes)
+		MemoryDeallocate(nodes);
+	if (bad) {
+		printf("pma: FAILED, %u bad requests\n", bad);
+		return 1;
+	}
+	printf("pma: PASSED\n");
+	return 0;
+}
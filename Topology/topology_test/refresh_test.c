@@ -0,0 +1,214 @@
+/* BEGIN_ICS_COPYRIGHT7 ****************************************
+
+Copyright (c) 2015-2020, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+** END_ICS_COPYRIGHT7   ****************************************/
+
+/* [ICS VERSION STRING: unknown] */
+
+
+#include <getopt.h>
+#include "topology_test.h"
+#include "fake_sa.h"
+
+/* SweepRefresh of a swept fabric after the simulated SA's model changes.
+ * A refresh must reproduce the model while querying only the changed
+ * nodes.  A refresh which fails part way must leave the FabricData_t
+ * consistent, and a later refresh must recover.
+ */
+
+/* the lists built from AllNodes and the links must agree with AllNodes.
+ * Returns number of inconsistencies.
+ */
+static uint32 CheckFabricLists(FabricData_t *fabricp)
+{
+	cl_map_item_t *p, *q;
+	LIST_ITEM *l;
+	uint32 ports = 0, bad = 0;
+
+	for (p=cl_qmap_head(&fabricp->AllNodes); p != cl_qmap_end(&fabricp->AllNodes); p = cl_qmap_next(p)) {
+		NodeData *nodep = PARENT_STRUCT(p, NodeData, AllNodesEntry);
+
+		for (q=cl_qmap_head(&nodep->Ports); q != cl_qmap_end(&nodep->Ports); q = cl_qmap_next(q)) {
+			PortData *portp = PARENT_STRUCT(q, PortData, NodePortsEntry);
+
+			ports++;
+			if (portp->neighbor
+				&& (portp->neighbor->neighbor != portp
+					|| FindNodeGuid(fabricp, portp->neighbor->nodep->NodeInfo.NodeGUID)
+							!= portp->neighbor->nodep)) {
+				if (bad++ < 10)
+					fprintf(stderr, "refresh: %.*s port %u: stale neighbor\n",
+						STL_NODE_DESCRIPTION_ARRAY_SIZE,
+						(char *)nodep->NodeDesc.NodeString, portp->PortNum);
+			}
+		}
+	}
+	for (l=QListHead(&fabricp->AllPorts); l != NULL; l = QListNext(&fabricp->AllPorts, l)) {
+		PortData *portp = (PortData *)QListObj(l);
+
+		if (FindNodeGuid(fabricp, portp->nodep->NodeInfo.NodeGUID) != portp->nodep) {
+			if (bad++ < 10)
+				fprintf(stderr, "refresh: AllPorts has a port of a removed node\n");
+		}
+	}
+	if (QListCount(&fabricp->AllSWs) + QListCount(&fabricp->AllFIs)
+			!= cl_qmap_count(&fabricp->AllNodes)
+		|| QListCount(&fabricp->AllPorts) != ports) {
+		if (bad++ < 10)
+			fprintf(stderr, "refresh: lists have %u nodes %u ports, fabric %u nodes %u ports\n",
+				(unsigned)(QListCount(&fabricp->AllSWs) + QListCount(&fabricp->AllFIs)),
+				(unsigned)QListCount(&fabricp->AllPorts),
+				(unsigned)cl_qmap_count(&fabricp->AllNodes), ports);
+	}
+	return bad;
+}
+
+/* replace FIs, slow a link down and drop a ring link.  Returns number of
+ * nodes the SA reports as new or changed.
+ */
+static uint32 ChangeModel(FakeSa_t *fakep, uint32 numSwitches,
+				uint32 fisPerSwitch, uint32 round)
+{
+	uint32 s = round % numSwitches;
+	uint32 fi = numSwitches + s*fisPerSwitch;
+	uint32 spare = numSwitches*(1 + fisPerSwitch) + round;
+
+	// FI on port 1 of switch s is replaced by a new FI
+	FakeSaUnlink(fakep, fi, 1);
+	fakep->nodes[fi].present = 0;
+	(void)FakeSaAddNode(fakep, spare, FALSE, 1);
+	FakeSaLink(fakep, spare, 1, s, 1);
+	// the next FI's link trains at a lower speed
+	fakep->nodes[fi+1].ports[1].speed = STL_LINK_SPEED_12_5G;
+	fakep->nodes[s].ports[2].speed = STL_LINK_SPEED_12_5G;
+	// ring link to the next switch goes down
+	FakeSaUnlink(fakep, s, fisPerSwitch+1);
+	// s and its new FI, the slowed FI and the next switch
+	return 4;
+}
+
+int TestRefresh(int argc, char **argv)
+{
+	uint32 numSwitches = 16, fisPerSwitch = 8, threads = 8, latency = 100;
+	uint32 bad = 0, changed, sweepQueries, queries, lidQueries;
+	FabricData_t fabric;
+	FakeSa_t fake;
+	FSTATUS status;
+	uint64 start;
+	int c;
+
+	optind = 1;
+	while (-1 != (c = getopt(argc, argv, "s:f:t:l:"))) {
+		switch (c) {
+		case 's': numSwitches = atoi(optarg); break;
+		case 'f': fisPerSwitch = atoi(optarg); break;
+		case 't': threads = atoi(optarg); break;
+		case 'l': latency = atoi(optarg); break;
+		default: return 2;
+		}
+	}
+	// each round replaces an FI, ring links need at least 3 switches
+	if (numSwitches < 3 || fisPerSwitch < 2
+		|| FakeSaBuildFabric(&fake, numSwitches, fisPerSwitch,
+				numSwitches*(1 + fisPerSwitch) + 2) != FSUCCESS) {
+		fprintf(stderr, "refresh: invalid arguments\n");
+		return 2;
+	}
+	fake.latency_us = latency;
+	FakeSaInstall(&fake);
+	SetSweepThreads(threads);
+
+	AtomicWrite(&fake.queries, 0);
+	start = GetTimeStamp();
+	status = Sweep(1, &fabric, FF_NONE, SWEEP_ALL, 1, 1000);
+	if (status != FSUCCESS) {
+		fprintf(stderr, "refresh: Sweep failed: %s\n", iba_fstatus_msg(status));
+		FakeSaInstall(NULL);
+		FakeSaDestroy(&fake);
+		printf("refresh: FAILED\n");
+		return 1;
+	}
+	sweepQueries = AtomicRead(&fake.queries);
+	printf("refresh: sweep: %.3f s, %u SA queries\n",
+			(double)(GetTimeStamp() - start)/1000000, sweepQueries);
+
+	// refresh after a change
+	changed = ChangeModel(&fake, numSwitches, fisPerSwitch, 0);
+	AtomicWrite(&fake.queries, 0);
+	AtomicWrite(&fake.lidQueries, 0);
+	start = GetTimeStamp();
+	status = SweepRefresh(1, &fabric, SWEEP_ALL, 1, 1000);
+	queries = AtomicRead(&fake.queries);
+	lidQueries = AtomicRead(&fake.lidQueries);
+	printf("refresh: %u nodes changed: %.3f s, %u SA queries, %u per LID\n",
+			changed, (double)(GetTimeStamp() - start)/1000000, queries,
+			lidQueries);
+	if (status != FSUCCESS) {
+		fprintf(stderr, "refresh: SweepRefresh failed: %s\n", iba_fstatus_msg(status));
+		bad++;
+	}
+	// only the changed nodes may be queried by LID
+	if (queries >= sweepQueries || lidQueries >= sweepQueries/2) {
+		fprintf(stderr, "refresh: refresh made %u SA queries, %u per LID, sweep made %u\n",
+				queries, lidQueries, sweepQueries);
+		bad++;
+	}
+	bad += FakeSaCheckFabric(&fake, &fabric);
+	bad += CheckFabricLists(&fabric);
+
+	// a refresh which fails once the bulk queries are done, so nodes have
+	// been removed and the lists cleared
+	(void)ChangeModel(&fake, numSwitches, fisPerSwitch, 1);
+	AtomicWrite(&fake.queries, 0);
+	fake.failFrom = 4;
+	status = SweepRefresh(1, &fabric, SWEEP_ALL, 1, 1000);
+	fake.failFrom = 0;
+	if (status == FSUCCESS) {
+		fprintf(stderr, "refresh: SweepRefresh succeeded with a failing SA\n");
+		bad++;
+	}
+	bad += CheckFabricLists(&fabric);
+
+	// and a refresh after the failure recovers
+	status = SweepRefresh(1, &fabric, SWEEP_ALL, 1, 1000);
+	if (status != FSUCCESS) {
+		fprintf(stderr, "refresh: SweepRefresh failed: %s\n", iba_fstatus_msg(status));
+		bad++;
+	}
+	bad += FakeSaCheckFabric(&fake, &fabric);
+	bad += CheckFabricLists(&fabric);
+
+	DestroyFabricData(&fabric);
+	FakeSaInstall(NULL);
+	FakeSaDestroy(&fake);
+	if (bad) {
+		printf("refresh: FAILED, %u differences\n", bad);
+		return 1;
+	}
+	printf("refresh: PASSED\n");
+	return 0;
+}
@@ -0,0 +1,254 @@
+/* BEGIN_ICS_COPYRIGHT7 ****************************************
+
+Copyright (c) 2015-2020, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+** END_ICS_COPYRIGHT7   ****************************************/
+
+/* [ICS VERSION STRING: unknown] */
+
+#include <getopt.h>
+#include <unistd.h>
+#include "topology_test.h"
+#include "fake_sa.h"
+
+/* Xml2ParseSnapshotLinks, as opareport --stream -o errors uses it, against
+ * a full Xml2ParseSnapshot of the same sample snapshot.  The sample is
+ * written by Xml2PrintSnapshot from a fabric swept from the simulated SA,
+ * with PortCounters on every port and errors on some.  The streamed fabric
+ * must hold just the links of the full parse with a port in error, with
+ * the same counters, and must count every link in the snapshot.
+ */
+static uint32 StreamTestRandom(uint32 *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return (*seed >> 16) & 0x7fff;
+}
+
+static boolean StreamTestPortErrors(PortData *portp, void *context)
+{
+	STL_PORT_COUNTERS_DATA *pPortCounters = portp->pPortCounters;
+
+	return (pPortCounters && (pPortCounters->linkErrorRecovery
+				|| pPortCounters->linkDowned || pPortCounters->portRcvErrors));
+}
+
+/* PortCounters on every port of a swept fabric, errorPct percent of ports
+ * get an error counter
+ */
+static FSTATUS StreamTestSetCounters(FabricData_t *fabricp, uint32 errorPct)
+{
+	LIST_ITEM *p;
+	uint32 seed = 1;
+
+	for (p=QListHead(&fabricp->AllPorts); p != NULL; p = QListNext(&fabricp->AllPorts, p)) {
+		PortData *portp = (PortData *)QListObj(p);
+		STL_PORT_COUNTERS_DATA *pPortCounters;
+
+		pPortCounters = (STL_PORT_COUNTERS_DATA *)FabricDataAllocate(fabricp,
+					sizeof(STL_PORT_COUNTERS_DATA));
+		if (! pPortCounters)
+			return FINSUFFICIENT_MEMORY;
+		portp->pPortCounters = pPortCounters;
+		pPortCounters->portXmitData = StreamTestRandom(&seed) * 1000;
+		pPortCounters->portRcvData = StreamTestRandom(&seed) * 1000;
+		pPortCounters->portXmitPkts = StreamTestRandom(&seed);
+		pPortCounters->portRcvPkts = StreamTestRandom(&seed);
+		pPortCounters->lq.s.linkQualityIndicator = 5;
+		if (StreamTestRandom(&seed) % 100 >= errorPct)
+			continue;
+		switch (StreamTestRandom(&seed) % 3) {
+		case 0: pPortCounters->linkErrorRecovery = 1 + StreamTestRandom(&seed); break;
+		case 1: pPortCounters->linkDowned = 1 + StreamTestRandom(&seed) % 16; break;
+		default: pPortCounters->portRcvErrors = 1 + StreamTestRandom(&seed); break;
+		}
+	}
+	fabricp->flags |= FF_STATS;
+	return FSUCCESS;
+}
+
+static boolean StreamTestSameCounters(PortData *portp1, PortData *portp2)
+{
+	if (! portp1->pPortCounters || ! portp2->pPortCounters)
+		return (portp1->pPortCounters == portp2->pPortCounters);
+	return (memcmp(portp1->pPortCounters, portp2->pPortCounters,
+				sizeof(STL_PORT_COUNTERS_DATA)) == 0);
+}
+
+/* compare the streamed fabric with the full one, returns number of
+ * mismatches
+ */
+static uint32 StreamTestCompare(FabricData_t *full, FabricData_t *streamed,
+				uint32 links, uint32 *errLinksp)
+{
+	LIST_ITEM *p;
+	cl_map_item_t *q;
+	uint32 bad = 0, errLinks = 0;
+
+	if (links != full->LinkCount) {
+		bad++;
+		fprintf(stderr, "stream: %u links streamed, expected %u\n", links, full->LinkCount);
+	}
+	for (p=QListHead(&full->AllPorts); p != NULL; p = QListNext(&full->AllPorts, p)) {
+		PortData *portp1 = (PortData *)QListObj(p);
+		PortData *portp2 = portp1->neighbor;
+		PortData *sportp1, *sportp2;
+
+		if (! portp1->from
+			|| (! StreamTestPortErrors(portp1, NULL) && ! StreamTestPortErrors(portp2, NULL)))
+			continue;
+		errLinks++;
+		sportp1 = FindNodeGuidPort(streamed, portp1->nodep->NodeInfo.NodeGUID, portp1->PortNum);
+		sportp2 = FindNodeGuidPort(streamed, portp2->nodep->NodeInfo.NodeGUID, portp2->PortNum);
+		if (! sportp1 || ! sportp2 || sportp1->neighbor != sportp2
+			|| ! StreamTestSameCounters(portp1, sportp1)
+			|| ! StreamTestSameCounters(portp2, sportp2)) {
+			if (bad++ < 10)
+				fprintf(stderr, "stream: link %.*s:%u to %.*s:%u %s\n",
+						STL_NODE_DESCRIPTION_ARRAY_SIZE,
+						(char *)portp1->nodep->NodeDesc.NodeString, portp1->PortNum,
+						STL_NODE_DESCRIPTION_ARRAY_SIZE,
+						(char *)portp2->nodep->NodeDesc.NodeString, portp2->PortNum,
+						(sportp1 && sportp1->neighbor == sportp2) ? "differs" : "missing");
+		}
+	}
+	if (streamed->LinkCount != errLinks) {
+		bad++;
+		fprintf(stderr, "stream: %u links kept, expected %u\n", streamed->LinkCount, errLinks);
+	}
+	// only nodes on the kept links
+	for (q=cl_qmap_head(&streamed->AllNodes); q != cl_qmap_end(&streamed->AllNodes); q = cl_qmap_next(q)) {
+		NodeData *nodep = PARENT_STRUCT(q, NodeData, AllNodesEntry);
+		cl_map_item_t *r;
+
+		for (r=cl_qmap_head(&nodep->Ports); r != cl_qmap_end(&nodep->Ports); r = cl_qmap_next(r)) {
+			PortData *portp = PARENT_STRUCT(r, PortData, NodePortsEntry);
+
+			if (portp->neighbor && (StreamTestPortErrors(portp, NULL)
+						|| StreamTestPortErrors(portp->neighbor, NULL)))
+				break;
+		}
+		if (r == cl_qmap_end(&nodep->Ports)) {
+			if (bad++ < 10)
+				fprintf(stderr, "stream: %.*s kept without a link in error\n",
+						STL_NODE_DESCRIPTION_ARRAY_SIZE, (char *)nodep->NodeDesc.NodeString);
+		}
+	}
+	*errLinksp = errLinks;
+	return bad;
+}
+
+int TestStream(int argc, char **argv)
+{
+	uint32 numSwitches = 16, fisPerSwitch = 32, errorPct = 2;
+	FabricData_t fabric, full, streamed;
+	SnapshotOutputInfo_t info;
+	FakeSa_t fakeSa;
+	char snapshot[] = "/tmp/topology_test_XXXXXX";
+	FILE *file;
+	int fd;
+	uint32 bad = 0, links = 0, errLinks = 0;
+	double fullTime, streamTime;
+	uint64 start;
+	FSTATUS status;
+	int c;
+
+	optind = 1;
+	while (-1 != (c = getopt(argc, argv, "s:f:e:"))) {
+		switch (c) {
+		case 's': numSwitches = atoi(optarg); break;
+		case 'f': fisPerSwitch = atoi(optarg); break;
+		case 'e': errorPct = atoi(optarg); break;
+		default: return 2;
+		}
+	}
+	if (numSwitches < 2 || errorPct > 100
+		|| FakeSaBuildFabric(&fakeSa, numSwitches, fisPerSwitch, 0) != FSUCCESS) {
+		fprintf(stderr, "stream: invalid arguments\n");
+		return 2;
+	}
+	FakeSaInstall(&fakeSa);
+
+	// write the sample snapshot
+	status = Sweep(1, &fabric, FF_NONE, SWEEP_ALL, 1, 1000);
+	if (status != FSUCCESS) {
+		fprintf(stderr, "stream: Sweep failed: %s\n", iba_fstatus_msg(status));
+		bad++;
+		goto cleanup;
+	}
+	if (StreamTestSetCounters(&fabric, errorPct) != FSUCCESS) {
+		fprintf(stderr, "stream: Unable to allocate memory\n");
+		DestroyFabricData(&fabric);
+		bad++;
+		goto cleanup;
+	}
+	if ((fd = mkstemp(snapshot)) < 0 || ! (file = fdopen(fd, "w"))) {
+		fprintf(stderr, "stream: Unable to create %s\n", snapshot);
+		if (fd >= 0)
+			close(fd);
+		DestroyFabricData(&fabric);
+		bad++;
+		goto cleanup;
+	}
+	MemoryClear(&info, sizeof(info));
+	info.fabricp = &fabric;
+	info.argc = argc;
+	info.argv = argv;
+	Xml2PrintSnapshot(file, &info);
+	fclose(file);
+	DestroyFabricData(&fabric);
+
+	start = GetTimeStamp();
+	status = Xml2ParseSnapshot(snapshot, 1, &full, FF_NONE, FALSE);
+	fullTime = (double)(GetTimeStamp() - start)/1000000;
+	if (status != FSUCCESS) {
+		fprintf(stderr, "stream: full parse failed\n");
+		bad++;
+		goto unlink;
+	}
+	start = GetTimeStamp();
+	status = Xml2ParseSnapshotLinks(snapshot, 1, &streamed, FF_NONE,
+				StreamTestPortErrors, NULL, &links);
+	streamTime = (double)(GetTimeStamp() - start)/1000000;
+	if (status != FSUCCESS) {
+		fprintf(stderr, "stream: streamed parse failed\n");
+		bad++;
+	} else {
+		bad += StreamTestCompare(&full, &streamed, links, &errLinks);
+		printf("stream: %u nodes, %u links, %u with errors: full parse %.3f s, streamed %.3f s, %u nodes kept\n",
+				(unsigned)cl_qmap_count(&full.AllNodes), full.LinkCount, errLinks,
+				fullTime, streamTime, (unsigned)cl_qmap_count(&streamed.AllNodes));
+		DestroyFabricData(&streamed);
+	}
+	DestroyFabricData(&full);
+
+unlink:
+	unlink(snapshot);
+cleanup:
+	FakeSaInstall(NULL);
+	FakeSaDestroy(&fakeSa);
+	printf("stream: %s\n", bad ? "FAILED" : "PASSED");
+	return bad ? 1 : 0;
+}
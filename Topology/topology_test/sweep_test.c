@@ -0,0 +1,98 @@
+/* BEGIN_ICS_COPYRIGHT7 ****************************************
+
+Copyright (c) 2015-2020, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+** END_ICS_COPYRIGHT7   ****************************************/
+
+/* [ICS VERSION STRING: unknown] */
+
+#include <getopt.h>
+#include "topology_test.h"
+#include "fake_sa.h"
+
+/* Sweep of a simulated SA, serially and with worker threads.  Both must
+ * reproduce the model fabric.
+ */
+static int RunSweep(FakeSa_t *fakep, uint32 threads)
+{
+	FabricData_t fabric;
+	uint64 start;
+	uint32 bad;
+	FSTATUS status;
+
+	SetSweepThreads(threads);
+	AtomicWrite(&fakep->queries, 0);
+	start = GetTimeStamp();
+	status = Sweep(1, &fabric, FF_NONE, SWEEP_ALL, 1, 1000);
+	if (status != FSUCCESS) {
+		fprintf(stderr, "sweep: Sweep failed: %s\n", iba_fstatus_msg(status));
+		return 1;
+	}
+	printf("sweep: %u threads: %.3f s, %u SA queries\n", threads,
+			(double)(GetTimeStamp() - start)/1000000,
+			AtomicRead(&fakep->queries));
+	bad = FakeSaCheckFabric(fakep, &fabric);
+	DestroyFabricData(&fabric);
+	if (bad) {
+		fprintf(stderr, "sweep: %u threads: %u differences from model\n",
+				threads, bad);
+		return 1;
+	}
+	return 0;
+}
+
+int TestSweep(int argc, char **argv)
+{
+	uint32 numSwitches = 64, fisPerSwitch = 31, threads = 8, latency = 100;
+	FakeSa_t fake;
+	int c, ret;
+
+	optind = 1;
+	while (-1 != (c = getopt(argc, argv, "s:f:t:l:"))) {
+		switch (c) {
+		case 's': numSwitches = atoi(optarg); break;
+		case 'f': fisPerSwitch = atoi(optarg); break;
+		case 't': threads = atoi(optarg); break;
+		case 'l': latency = atoi(optarg); break;
+		default: return 2;
+		}
+	}
+	if (FakeSaBuildFabric(&fake, numSwitches, fisPerSwitch, 0) != FSUCCESS) {
+		fprintf(stderr, "sweep: invalid arguments\n");
+		return 2;
+	}
+	fake.latency_us = latency;
+	FakeSaInstall(&fake);
+
+	ret = RunSweep(&fake, 1);
+	if (threads > 1)
+		ret |= RunSweep(&fake, threads);
+
+	FakeSaInstall(NULL);
+	FakeSaDestroy(&fake);
+	printf("sweep: %s\n", ret ? "FAILED" : "PASSED");
+	return ret;
+}
@@ -0,0 +1,93 @@
+/* BEGIN_ICS_COPYRIGHT7 ****************************************
+
+Copyright (c) 2015-2020, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+** END_ICS_COPYRIGHT7   ****************************************/
+
+/* [ICS VERSION STRING: unknown] */
+
+/* tests of the Topology library against simulated fabric agents */
+
+#include "topology_test.h"
+
+static struct {
+	const char *name;
+	int (*func)(int argc, char **argv);
+	const char *options;
+} Tests[] = {
+	{ "madpipe", TestMadPipe,
+		"[-n lids] [-b blocks] [-w window] [-l latency_us] [-j jitter_us] [-d drop_pct]" },
+	{ "pma", TestPma,
+		"[-s switches] [-p ports] [-w window] [-l latency_us] [-j jitter_us] [-d drop_pct]" },
+	{ "sweep", TestSweep,
+		"[-s switches] [-f fis_per_switch] [-t threads] [-l latency_us]" },
+	{ "refresh", TestRefresh,
+		"[-s switches] [-f fis_per_switch] [-t threads] [-l latency_us]" },
+	{ "fdb", TestFdb,
+		"[-s switches] [-f fis_per_switch] [-L lft_top] [-l latency_us] [-j jitter_us] [-d drop_pct]" },
+	{ "cycles", TestCycles,
+		"[-g graphs] [-n max_vertices] [-r seed]" },
+	{ "stream", TestStream,
+		"[-s switches] [-f fis_per_switch] [-e error_pct]" },
+	{ NULL }
+};
+
+static void Usage(const char *cmd)
+{
+	int i;
+
+	fprintf(stderr, "Usage: %s [test [options]]\n", cmd);
+	fprintf(stderr, "    with no test, runs every test with default options\n");
+	for (i=0; Tests[i].name; i++)
+		fprintf(stderr, "    %s %s\n", Tests[i].name, Tests[i].options);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	int i, ret = 0;
+
+	if (argc < 2) {
+		char *args[2] = { NULL, NULL };
+
+		for (i=0; Tests[i].name; i++) {
+			args[0] = (char *)Tests[i].name;
+			if (Tests[i].func(1, args))
+				ret = 1;
+		}
+		return ret;
+	}
+	for (i=0; Tests[i].name; i++) {
+		if (strcmp(argv[1], Tests[i].name) == 0) {
+			ret = Tests[i].func(argc-1, argv+1);
+			if (ret == 2)
+				Usage(argv[0]);
+			return ret;
+		}
+	}
+	Usage(argv[0]);
+	return 2;
+}
@@ -39,6 +39,11 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <unistd.h>
 #include <ctype.h>
 #define _GNU_SOURCE
+#ifndef VXWORKS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #include "ixml.h"
 #ifdef VXWORKS
@@ -73,25 +78,230 @@ IXmlInit(IXmlOutputState_t *state, FILE *file, unsigned indent,
 	state->flags = flags;
 	state->cur_indent = 0;
 	state->context = context;
+	state->buf = NULL;
+	state->buf_len = 0;
 }
 
 /****************************************************************************/
 /* XML Output */
 
+/* size of output buffer used between IXmlOutputInit and IXmlOutputDestroy */
+#define OUTPUT_BUFFSIZE	(256*1024)
+
+static const char IXmlSpaces[] = "                                                                ";
+
+// write output buffer to output file
+static void IXmlOutputFlush(IXmlOutputState_t *state)
+{
+	if (state->buf_len) {
+		(void)fwrite(state->buf, 1, state->buf_len, state->file);
+		state->buf_len = 0;
+	}
+}
+
+// output len bytes with no translation
+static void IXmlOutputWrite(IXmlOutputState_t *state, const char *data, unsigned len)
+{
+	if (! state->buf) {
+		(void)fwrite(data, 1, len, state->file);
+		return;
+	}
+	if (state->buf_len + len > OUTPUT_BUFFSIZE) {
+		IXmlOutputFlush(state);
+		if (len > OUTPUT_BUFFSIZE) {
+			(void)fwrite(data, 1, len, state->file);
+			return;
+		}
+	}
+	MemoryCopy(state->buf + state->buf_len, data, len);
+	state->buf_len += len;
+}
+
+static _inline void IXmlOutputWriteStr(IXmlOutputState_t *state, const char *str)
+{
+	IXmlOutputWrite(state, str, (unsigned)strlen(str));
+}
+
+static _inline void IXmlOutputWriteChar(IXmlOutputState_t *state, char c)
+{
+	if (state->buf && state->buf_len < OUTPUT_BUFFSIZE)
+		state->buf[state->buf_len++] = c;
+	else
+		IXmlOutputWrite(state, &c, 1);
+}
+
+// output with printf style format, used for caller supplied formats
+static void IXmlOutputWriteFmt(IXmlOutputState_t *state, const char *format, va_list args)
+{
+	va_list args2;
+	int n;
+
+	if (! state->buf) {
+		vfprintf(state->file, format, args);
+		return;
+	}
+	va_copy(args2, args);
+	n = vsnprintf(state->buf + state->buf_len, OUTPUT_BUFFSIZE - state->buf_len,
+					format, args);
+	if (n >= 0 && (unsigned)n < OUTPUT_BUFFSIZE - state->buf_len) {
+		state->buf_len += n;
+	} else {
+		IXmlOutputFlush(state);
+		if (n >= 0 && n < OUTPUT_BUFFSIZE)
+			state->buf_len = vsnprintf(state->buf, OUTPUT_BUFFSIZE, format, args2);
+		else
+			vfprintf(state->file, format, args2);
+	}
+	va_end(args2);
+}
+
+// format value in decimal at end of a buffer of 20 chars, returns start
+static char *IXmlFormatUint64(char *end, uint64 value)
+{
+	char *p = end;
+
+	do {
+		*--p = (char)('0' + value % 10);
+		value /= 10;
+	} while (value);
+	return p;
+}
+
+// format value as "0x" followed by at least digits lower case hex digits
+// at end of a buffer of 18 chars, returns start
+static char *IXmlFormatHex64(char *end, uint64 value, unsigned digits)
+{
+	char *p = end;
+
+	do {
+		*--p = "0123456789abcdef"[value & 0xf];
+		value >>= 4;
+	} while (value || (unsigned)(end - p) < digits);
+	*--p = 'x';
+	*--p = '0';
+	return p;
+}
+
+// output any pending characters needed before content on the present line
+static void IXmlOutputStartContent(IXmlOutputState_t *state)
+{
+	if (state->flags & IXML_OUTPUT_FLAG_IN_START_TAG) {
+		IXmlOutputWriteChar(state, '>');
+		state->flags &= ~IXML_OUTPUT_FLAG_IN_START_TAG;
+	}
+	state->flags &= ~IXML_OUTPUT_FLAG_START_NEED_NL;
+	state->flags |= IXML_OUTPUT_FLAG_HAD_CONTENT;	// could be content
+}
+
+// output any pending characters needed before a new line, then the indent
+static void IXmlOutputStartIndent(IXmlOutputState_t *state)
+{
+	unsigned indent;
+
+	if (state->flags & IXML_OUTPUT_FLAG_IN_START_TAG) {
+		IXmlOutputWriteChar(state, '>');
+		state->flags &= ~IXML_OUTPUT_FLAG_IN_START_TAG;
+	}
+
+	if (state->flags & IXML_OUTPUT_FLAG_START_NEED_NL) {
+		IXmlOutputWriteChar(state, '\n');
+		state->flags &= ~IXML_OUTPUT_FLAG_START_NEED_NL;
+	}
+	state->flags &= ~IXML_OUTPUT_FLAG_HAD_CONTENT;	// should not be content
+	for (indent = state->cur_indent; indent; ) {
+		unsigned n = MIN(indent, sizeof(IXmlSpaces)-1);
+		IXmlOutputWrite(state, IXmlSpaces, n);
+		indent -= n;
+	}
+}
+
+// output "<tag>value</tag>\n" on its own line
+static void IXmlOutputTagValue(IXmlOutputState_t *state, const char *tag,
+				const char *value, unsigned len)
+{
+	unsigned taglen = (unsigned)strlen(tag);
+
+	IXmlOutputStartIndent(state);
+	IXmlOutputWriteChar(state, '<');
+	IXmlOutputWrite(state, tag, taglen);
+	IXmlOutputWriteChar(state, '>');
+	IXmlOutputWrite(state, value, len);
+	IXmlOutputWrite(state, "</", 2);
+	IXmlOutputWrite(state, tag, taglen);
+	IXmlOutputWrite(state, ">\n", 2);
+}
+
+// output "<tag_Int>value</tag_Int>\n" on its own line
+static void IXmlOutputTagIntValue(IXmlOutputState_t *state, const char *tag,
+				const char *value, unsigned len)
+{
+	unsigned taglen = (unsigned)strlen(tag);
+
+	IXmlOutputStartIndent(state);
+	IXmlOutputWriteChar(state, '<');
+	IXmlOutputWrite(state, tag, taglen);
+	IXmlOutputWrite(state, "_Int>", 5);
+	IXmlOutputWrite(state, value, len);
+	IXmlOutputWrite(state, "</", 2);
+	IXmlOutputWrite(state, tag, taglen);
+	IXmlOutputWrite(state, "_Int>\n", 6);
+}
+
+static void IXmlOutputTagUint64(IXmlOutputState_t *state, const char *tag, uint64 value)
+{
+	char buf[24];
+	char *p = IXmlFormatUint64(&buf[sizeof(buf)], value);
+
+	IXmlOutputTagValue(state, tag, p, (unsigned)(&buf[sizeof(buf)] - p));
+}
+
+static void IXmlOutputTagInt64(IXmlOutputState_t *state, const char *tag, int64 value)
+{
+	char buf[24];
+	char *p = IXmlFormatUint64(&buf[sizeof(buf)],
+						value < 0 ? -(uint64)value : (uint64)value);
+
+	if (value < 0)
+		*--p = '-';
+	IXmlOutputTagValue(state, tag, p, (unsigned)(&buf[sizeof(buf)] - p));
+}
+
+static void IXmlOutputTagHex64(IXmlOutputState_t *state, const char *tag, uint64 value, unsigned digits)
+{
+	char buf[24];
+	char *p = IXmlFormatHex64(&buf[sizeof(buf)], value, digits);
+
+	IXmlOutputTagValue(state, tag, p, (unsigned)(&buf[sizeof(buf)] - p));
+}
+
 /* indent is additional indent per level */
 FSTATUS
 IXmlOutputInit(IXmlOutputState_t *state, FILE *file, unsigned indent,
 				IXmlOutputFlags_t flags, void *context)
 {
 	IXmlInit(state, file, indent, flags, context);
+	// output is buffered until IXmlOutputDestroy, unbuffered if no memory
+	state->buf = (char*)malloc(OUTPUT_BUFFSIZE);
 	IXmlOutputPrint(state, "<?xml version=\"1.0\" encoding=\"utf-8\" ?>\n");
 	state->flags &= ~IXML_OUTPUT_FLAG_HAD_CONTENT;	// should not be content
-	return (IXmlOutputFailed(state)?FERROR:FSUCCESS);
+	if (IXmlOutputFailed(state)) {
+		if (state->buf)
+			free(state->buf);
+		state->buf = NULL;
+		state->buf_len = 0;
+		return FERROR;
+	}
+	return FSUCCESS;
 }
 
 void
 IXmlOutputDestroy(IXmlOutputState_t *state)
 {
+	if (state->buf) {
+		IXmlOutputFlush(state);
+		free(state->buf);
+		state->buf = NULL;
+	}
 	state->file = NULL;	// make sure can't be used by mistake
 	state->context = NULL;	// make sure can't be used by mistake
 }
@@ -101,16 +311,10 @@ void IXmlOutputPrint(IXmlOutputState_t *state, const char *format, ...)
 {
 	va_list args;
 
-	if (state->flags & IXML_OUTPUT_FLAG_IN_START_TAG) {
-		fprintf(state->file, ">");
-		state->flags &= ~IXML_OUTPUT_FLAG_IN_START_TAG;
-	}
+	IXmlOutputStartContent(state);
 
 	va_start(args, format);
-
-	state->flags &= ~IXML_OUTPUT_FLAG_START_NEED_NL;
-	state->flags |= IXML_OUTPUT_FLAG_HAD_CONTENT;	// could be content
-	vfprintf(state->file, format, args);
+	IXmlOutputWriteFmt(state, format, args);
 	va_end(args);
 }
 
@@ -119,20 +323,10 @@ void IXmlOutputPrintIndent(IXmlOutputState_t *state, const char *format, ...)
 {
 	va_list args;
 
-	va_start(args, format);
-
-	if (state->flags & IXML_OUTPUT_FLAG_IN_START_TAG) {
-		fprintf(state->file, ">");
-		state->flags &= ~IXML_OUTPUT_FLAG_IN_START_TAG;
-	}
+	IXmlOutputStartIndent(state);
 
-	if (state->flags & IXML_OUTPUT_FLAG_START_NEED_NL) {
-		fprintf(state->file, "\n");
-		state->flags &= ~IXML_OUTPUT_FLAG_START_NEED_NL;
-	}
-	state->flags &= ~IXML_OUTPUT_FLAG_HAD_CONTENT;	// should not be content
-	fprintf(state->file, "%*s", state->cur_indent, "");
-	vfprintf(state->file, format, args);
+	va_start(args, format);
+	IXmlOutputWriteFmt(state, format, args);
 	va_end(args);
 }
 
@@ -142,7 +336,9 @@ void IXmlOutputNoop(IXmlOutputState_t *state, const char *tag, void *data)
 
 void IXmlOutputStartTag(IXmlOutputState_t *state, const char *tag)
 {
-	IXmlOutputPrintIndent(state, "<%s", tag);
+	IXmlOutputStartIndent(state);
+	IXmlOutputWriteChar(state, '<');
+	IXmlOutputWriteStr(state, tag);
 	state->flags |= IXML_OUTPUT_FLAG_IN_START_TAG;
 	state->flags |= IXML_OUTPUT_FLAG_START_NEED_NL;
 	state->flags &= ~IXML_OUTPUT_FLAG_HAD_CONTENT;	// no content yet
@@ -152,9 +348,12 @@ void IXmlOutputStartTag(IXmlOutputState_t *state, const char *tag)
 void IXmlOutputStartAttrTag(IXmlOutputState_t *state, const char *tag, void *data, IXML_FORMAT_ATTR_FUNC attr_func)
 {
 	if (attr_func) {
-		IXmlOutputPrintIndent(state, "<%s", tag);
+		IXmlOutputStartIndent(state);
+		IXmlOutputWriteChar(state, '<');
+		IXmlOutputWriteStr(state, tag);
 		(*attr_func)(state, data);
-		IXmlOutputPrint(state, ">");
+		IXmlOutputStartContent(state);
+		IXmlOutputWriteChar(state, '>');
 		// clear flags after attr_func in case attr_func calls OutputPrint
 		state->flags |= IXML_OUTPUT_FLAG_START_NEED_NL;
 		state->flags &= ~IXML_OUTPUT_FLAG_HAD_CONTENT;	// no content yet
@@ -167,7 +366,16 @@ void IXmlOutputStartAttrTag(IXmlOutputState_t *state, const char *tag, void *dat
 FSTATUS IXmlOutputAttr(IXmlOutputState_t *state, const char *attr,
 	const char *val)
 {
-	return IXmlOutputAttrFmt(state, attr, "%s", val);
+	if (!(state->flags & IXML_OUTPUT_FLAG_IN_START_TAG))
+		return FERROR;
+
+	IXmlOutputWriteChar(state, ' ');
+	IXmlOutputWriteStr(state, attr);
+	IXmlOutputWrite(state, "=\"", 2);
+	IXmlOutputWriteStr(state, val);
+	IXmlOutputWriteChar(state, '"');
+
+	return FSUCCESS;
 }
 
 FSTATUS IXmlOutputAttrFmt(IXmlOutputState_t *state, const char *attr,
@@ -180,9 +388,11 @@ FSTATUS IXmlOutputAttrFmt(IXmlOutputState_t *state, const char *attr,
 
 	va_start(args, format);
 
-	fprintf(state->file, " %s=\"", attr);
-	vfprintf(state->file, format, args);
-	fprintf(state->file, "\"");
+	IXmlOutputWriteChar(state, ' ');
+	IXmlOutputWriteStr(state, attr);
+	IXmlOutputWrite(state, "=\"", 2);
+	IXmlOutputWriteFmt(state, format, args);
+	IXmlOutputWriteChar(state, '"');
 	va_end(args);
 
 	return FSUCCESS;
@@ -201,9 +411,12 @@ void IXmlOutputEndTag(IXmlOutputState_t *state, const char *tag)
 	// or IXmlOutputPrintStr with an empty string so flags indicate intent for
 	// tag to have content
 	if (state->flags & IXML_OUTPUT_FLAG_HAD_CONTENT)
-		IXmlOutputPrint(state, "</%s>\n", tag);
+		IXmlOutputStartContent(state);
 	else
-		IXmlOutputPrintIndent(state, "</%s>\n", tag);
+		IXmlOutputStartIndent(state);
+	IXmlOutputWrite(state, "</", 2);
+	IXmlOutputWriteStr(state, tag);
+	IXmlOutputWrite(state, ">\n", 2);
 	state->flags &= ~IXML_OUTPUT_FLAG_HAD_CONTENT;	// closed tag
 }
 
@@ -228,7 +441,7 @@ void IXmlOutputEndTagWithLineno(IXmlOutputState_t *state, const char *tag, unsig
 
 void IXmlOutputHexPad8(IXmlOutputState_t *state, const char *tag, uint8 value)
 {
-	IXmlOutputPrintIndent(state, "<%s>0x%02x</%s>\n", tag, value, tag);
+	IXmlOutputTagHex64(state, tag, value, 2);
 }
 
 // only output if value != 0
@@ -240,7 +453,7 @@ void IXmlOutputOptionalHexPad8(IXmlOutputState_t *state, const char *tag, uint8
 
 void IXmlOutputHexPad16(IXmlOutputState_t *state, const char *tag, uint16 value)
 {
-	IXmlOutputPrintIndent(state, "<%s>0x%04x</%s>\n", tag, value, tag);
+	IXmlOutputTagHex64(state, tag, value, 4);
 }
 
 // only output if value != 0
@@ -252,7 +465,7 @@ void IXmlOutputOptionalHexPad16(IXmlOutputState_t *state, const char *tag, uint1
 
 void IXmlOutputHexPad32(IXmlOutputState_t *state, const char *tag, uint32 value)
 {
-	IXmlOutputPrintIndent(state, "<%s>0x%08x</%s>\n", tag, value, tag);
+	IXmlOutputTagHex64(state, tag, value, 8);
 }
 
 // only output if value != 0
@@ -264,7 +477,7 @@ void IXmlOutputOptionalHexPad32(IXmlOutputState_t *state, const char *tag, uint3
 
 void IXmlOutputHexPad64(IXmlOutputState_t *state, const char *tag, uint64 value)
 {
-	IXmlOutputPrintIndent(state, "<%s>0x%016"PRIx64"</%s>\n", tag, value, tag);
+	IXmlOutputTagHex64(state, tag, value, 16);
 }
 
 // only output if value != 0
@@ -276,7 +489,7 @@ void IXmlOutputOptionalHexPad64(IXmlOutputState_t *state, const char *tag, uint6
 
 void IXmlOutputInt(IXmlOutputState_t *state, const char *tag, int value)
 {
-	IXmlOutputPrintIndent(state, "<%s>%d</%s>\n", tag, value, tag);
+	IXmlOutputTagInt64(state, tag, value);
 }
 
 // only output if value != 0
@@ -288,7 +501,7 @@ void IXmlOutputOptionalInt(IXmlOutputState_t *state, const char *tag, int value)
 
 void IXmlOutputInt64(IXmlOutputState_t *state, const char *tag, int64 value)
 {
-	IXmlOutputPrintIndent(state, "<%s>%"PRId64"</%s>\n", tag, value, tag);
+	IXmlOutputTagInt64(state, tag, value);
 }
 
 // only output if value != 0
@@ -300,12 +513,18 @@ void IXmlOutputOptionalInt64(IXmlOutputState_t *state, const char *tag, int64 va
 
 static void IXmlOutputIntValue(IXmlOutputState_t *state, const char *tag, int value)
 {
-	IXmlOutputPrintIndent(state, "<%s_Int>%d</%s_Int>\n", tag, value, tag);
+	char buf[24];
+	char *p = IXmlFormatUint64(&buf[sizeof(buf)],
+						value < 0 ? -(uint64)(int64)value : (uint64)value);
+
+	if (value < 0)
+		*--p = '-';
+	IXmlOutputTagIntValue(state, tag, p, (unsigned)(&buf[sizeof(buf)] - p));
 }
 
 void IXmlOutputUint(IXmlOutputState_t *state, const char *tag, unsigned value)
 {
-	IXmlOutputPrintIndent(state, "<%s>%u</%s>\n", tag, value, tag);
+	IXmlOutputTagUint64(state, tag, value);
 }
 
 // only output if value != 0
@@ -317,7 +536,7 @@ void IXmlOutputOptionalUint(IXmlOutputState_t *state, const char *tag, unsigned
 
 void IXmlOutputUint64(IXmlOutputState_t *state, const char *tag, uint64 value)
 {
-	IXmlOutputPrintIndent(state, "<%s>%"PRIu64"</%s>\n", tag, value, tag);
+	IXmlOutputTagUint64(state, tag, value);
 }
 
 // only output if value != 0
@@ -329,12 +548,15 @@ void IXmlOutputOptionalUint64(IXmlOutputState_t *state, const char *tag, uint64
 
 static void IXmlOutputUintValue(IXmlOutputState_t *state, const char *tag, int value)
 {
-	IXmlOutputPrintIndent(state, "<%s_Int>%u</%s_Int>\n", tag, value, tag);
+	char buf[24];
+	char *p = IXmlFormatUint64(&buf[sizeof(buf)], (unsigned)value);
+
+	IXmlOutputTagIntValue(state, tag, p, (unsigned)(&buf[sizeof(buf)] - p));
 }
 
 void IXmlOutputHex(IXmlOutputState_t *state, const char *tag, unsigned value)
 {
-	IXmlOutputPrintIndent(state, "<%s>0x%x</%s>\n", tag, value, tag);
+	IXmlOutputTagHex64(state, tag, value, 1);
 }
 
 // only output if value != 0
@@ -346,7 +568,7 @@ void IXmlOutputOptionalHex(IXmlOutputState_t *state, const char *tag, unsigned v
 
 void IXmlOutputHex64(IXmlOutputState_t *state, const char *tag, uint64 value)
 {
-	IXmlOutputPrintIndent(state, "<%s>0x%"PRIx64"</%s>\n", tag, value, tag);
+	IXmlOutputTagHex64(state, tag, value, 1);
 }
 
 // only output if value != 0
@@ -358,20 +580,25 @@ void IXmlOutputOptionalHex64(IXmlOutputState_t *state, const char *tag, uint64 v
 
 void IXmlOutputPrintStrLen(IXmlOutputState_t *state, const char* value, int len)
 {
+	const char *run = value;	// start of characters output unchanged
+
 	state->flags &= ~IXML_OUTPUT_FLAG_START_NEED_NL;
 	state->flags |= IXML_OUTPUT_FLAG_HAD_CONTENT;	// should be content
 	/* print string taking care to translate special XML characters */
 	for (;len && *value; --len, ++value) {
+		const char *entity;
+		char buf[24];
+
 		if (*value == '&')
-			IXmlOutputPrint(state, "&amp;");
+			entity = "&amp;";
 		else if (*value == '<')
-			IXmlOutputPrint(state, "&lt;");
+			entity = "&lt;";
 		else if (*value == '>')
-			IXmlOutputPrint(state, "&gt;");
+			entity = "&gt;";
 		else if (*value == '\'')
-			IXmlOutputPrint(state, "&apos;");
+			entity = "&apos;";
 		else if (*value == '"')
-			IXmlOutputPrint(state, "&quot;");
+			entity = "&quot;";
 		else if (*value != '\n' && iscntrl(*value)) {
 			//table in asciitab.h indiciates character codes permitted in XML strings
 			//Only 3 control characters below 0x1f are permitted:
@@ -382,16 +609,31 @@ void IXmlOutputPrintStrLen(IXmlOutputState_t *state, const char* value, int len)
 				|| ((unsigned char)*value >= 0x0e
 						 && (unsigned char)*value <= 0x1f)) {
 				// characters which XML does not permit in character fields
-				IXmlOutputPrint(state, "!");
+				entity = "!";
 			} else {
-				IXmlOutputPrint(state, "&#x%x;", (unsigned)(unsigned char)*value);
+				// "&#x%x;"
+				char *p;
+				buf[sizeof(buf)-1] = '\0';
+				buf[sizeof(buf)-2] = ';';
+				p = IXmlFormatHex64(&buf[sizeof(buf)-2],
+							(unsigned)(unsigned char)*value, 1);
+				p[0] = '#';	// "0x" -> "#x"
+				*--p = '&';
+				entity = p;
 			}
 		} else if ((unsigned char)*value > 0x7f)
 			// permitted but generate 2 characters back after parsing, so omit
-			IXmlOutputPrint(state, "!");
+			entity = "!";
 		else
-			fputc((int)(unsigned)(unsigned char)*value, state->file);
+			continue;
+		if (value != run)
+			IXmlOutputWrite(state, run, (unsigned)(value - run));
+		run = value+1;
+		IXmlOutputStartContent(state);
+		IXmlOutputWriteStr(state, entity);
 	}
+	if (value != run)
+		IXmlOutputWrite(state, run, (unsigned)(value - run));
 }
 
 void IXmlOutputPrintStr(IXmlOutputState_t *state, const char* value)
@@ -408,9 +650,15 @@ void IXmlOutputPrintStrNewlineContent(IXmlOutputState_t *state, const char* valu
 
 void IXmlOutputStrLen(IXmlOutputState_t *state, const char *tag, const char* value, int len)
 {
-	IXmlOutputPrintIndent(state, "<%s>", tag);
+	IXmlOutputStartIndent(state);
+	IXmlOutputWriteChar(state, '<');
+	IXmlOutputWriteStr(state, tag);
+	IXmlOutputWriteChar(state, '>');
 	IXmlOutputPrintStrLen(state, value, len);
-	IXmlOutputPrint(state, "</%s>\n", tag);
+	IXmlOutputStartContent(state);
+	IXmlOutputWrite(state, "</", 2);
+	IXmlOutputWriteStr(state, tag);
+	IXmlOutputWrite(state, ">\n", 2);
 	state->flags &= ~IXML_OUTPUT_FLAG_HAD_CONTENT;	// should not be content
 }
 
@@ -701,7 +949,17 @@ void IXmlOutputOptionalStruct(IXmlOutputState_t *state, const char *tag, void *d
  * has some limitations and is intended for serializing/deserializing
  * structures and configuration information
  */
+#ifndef VXWORKS
+#define BUFFSIZE        (1024*1024)
+#else
 #define BUFFSIZE        8192
+#endif
+/* largest piece of a mapped file given to a single XML_Parse call */
+#define MAP_PARSE_SIZE  (1024*1024*1024)
+/* with IXML_PARSER_FLAG_RELEASE_INPUT, pages are released after each piece
+ * so the piece size also bounds the file's share of RSS
+ */
+#define MAP_RELEASE_PARSE_SIZE  (16*1024*1024)
 
 /* default callback by the parser to output errors and warnings */
 void IXmlPrintMessage(const char *message)
@@ -791,11 +1049,170 @@ static void IXmlParserPop(IXmlParserState_t *state)
 {
 	ASSERT(state->stack.sp >= 1);
 	state->stack.sp--;
+	// tags are allocated in stack order, so releasing the current tag
+	// releases the top of the tag arena
 	if (state->current.tag)
-		free(state->current.tag);
+		state->tag_arena_used = (unsigned)(state->current.tag - state->tag_arena);
 	state->current = state->stack.entries[state->stack.sp];
 }
 
+// save a copy of tag at top of the tag arena
+// as the arena grows, tags for all open elements are rebased
+static char *IXmlParserSaveTag(IXmlParserState_t *state, const char *tag)
+{
+	unsigned len = (unsigned)strlen(tag) + 1;
+	char *p;
+
+	if (state->tag_arena_used + len > state->tag_arena_size) {
+		unsigned offsets[STACK_DEPTH];
+		unsigned size = state->tag_arena_size ? state->tag_arena_size * 2 : 1024;
+		char *arena;
+		unsigned i;
+
+		while (size < state->tag_arena_used + len)
+			size *= 2;
+		// stack.entries[0] is the top level, it never has a tag
+		for (i=1; i < state->stack.sp; i++)
+			offsets[i] = (unsigned)(state->stack.entries[i].tag - state->tag_arena);
+		if (state->current.tag)
+			offsets[0] = (unsigned)(state->current.tag - state->tag_arena);
+		arena = (char*)realloc(state->tag_arena, size);
+		if (! arena)
+			return NULL;
+		for (i=1; i < state->stack.sp; i++)
+			state->stack.entries[i].tag = arena + offsets[i];
+		if (state->current.tag)
+			state->current.tag = arena + offsets[0];
+		state->tag_arena = arena;
+		state->tag_arena_size = size;
+	}
+	p = state->tag_arena + state->tag_arena_used;
+	MemoryCopy(p, tag, len);
+	state->tag_arena_used += len;
+	return p;
+}
+
+// build tag lookup index for subfields, returns FALSE if out of memory
+static boolean IXmlParserBuildFieldIndex(IXmlParserFieldIndex_t *index,
+					const IXML_FIELD *subfields)
+{
+	unsigned i, j, count;
+
+	for (count=0; subfields[count].tag; count++)
+		;
+	index->sorted = (unsigned*)malloc((count ? count : 1) * sizeof(unsigned));
+	if (! index->sorted)
+		return FALSE;
+	index->subfields = subfields;
+	index->count = count;
+	index->wildcard = count;
+	// stable insertion sort, equal tags stay in table order so the
+	// first match in the table is found first.  Tables are small and
+	// each is only sorted once per parser
+	for (i=0; i < count; i++) {
+		if (index->wildcard == count && strcmp(subfields[i].tag, "*") == 0)
+			index->wildcard = i;
+		for (j=i; j > 0
+			&& strcmp(subfields[index->sorted[j-1]].tag, subfields[i].tag) > 0;
+			j--)
+			index->sorted[j] = index->sorted[j-1];
+		index->sorted[j] = i;
+	}
+	return TRUE;
+}
+
+static unsigned IXmlParserHashSubfields(const IXML_FIELD *subfields)
+{
+	uint64 key = (uint64)(uintn)subfields;
+
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	return (unsigned)key;
+}
+
+// find or build the lookup index for subfields
+// subfields tables are expected to be static for the life of the parser
+static IXmlParserFieldIndex_t *IXmlParserGetFieldIndex(IXmlParserState_t *state,
+					const IXML_FIELD *subfields)
+{
+	IXmlParserFieldIndex_t *index;
+	unsigned mask;
+	unsigned i;
+
+	if ((state->field_index_count + 1) * 2 > state->field_index_size) {
+		unsigned size = state->field_index_size ? state->field_index_size * 2 : 32;
+		IXmlParserFieldIndex_t *table;
+
+		table = (IXmlParserFieldIndex_t*)calloc(size, sizeof(*table));
+		if (! table)
+			return NULL;
+		for (i=0; i < state->field_index_size; i++) {
+			unsigned h;
+			if (! state->field_indexes[i].subfields)
+				continue;
+			h = IXmlParserHashSubfields(state->field_indexes[i].subfields) & (size-1);
+			while (table[h].subfields)
+				h = (h+1) & (size-1);
+			table[h] = state->field_indexes[i];
+		}
+		free(state->field_indexes);
+		state->field_indexes = table;
+		state->field_index_size = size;
+	}
+	mask = state->field_index_size - 1;
+	i = IXmlParserHashSubfields(subfields) & mask;
+	while (state->field_indexes[i].subfields) {
+		if (state->field_indexes[i].subfields == subfields)
+			return &state->field_indexes[i];
+		i = (i+1) & mask;
+	}
+	index = &state->field_indexes[i];
+	if (! IXmlParserBuildFieldIndex(index, subfields))
+		return NULL;
+	state->field_index_count++;
+	return index;
+}
+
+// find first field in subfields which matches tag, either by name or "*"
+// returns NULL if no match, *indexp is index of field in subfields
+static const IXML_FIELD *IXmlParserFindField(IXmlParserState_t *state,
+					const IXML_FIELD *subfields, const char *tag, unsigned *indexp)
+{
+	IXmlParserFieldIndex_t *index = IXmlParserGetFieldIndex(state, subfields);
+	const IXML_FIELD *p;
+	unsigned lo, hi, i;
+
+	if (! index) {
+		// out of memory, fallback to linear search
+		for (i=0,p=subfields; p->tag; p++,i++) {
+			if (strcmp(tag, p->tag) == 0 || strcmp("*", p->tag) == 0) {
+				*indexp = i;
+				return p;
+			}
+		}
+		return NULL;
+	}
+	// lower bound of tag in sorted
+	lo = 0;
+	hi = index->count;
+	while (lo < hi) {
+		unsigned mid = lo + (hi - lo)/2;
+		if (strcmp(subfields[index->sorted[mid]].tag, tag) < 0)
+			lo = mid+1;
+		else
+			hi = mid;
+	}
+	i = index->wildcard;
+	if (lo < index->count && strcmp(subfields[index->sorted[lo]].tag, tag) == 0
+		&& index->sorted[lo] < i)
+		i = index->sorted[lo];
+	if (i == index->count)
+		return NULL;
+	*indexp = i;
+	return &subfields[i];
+}
+
 // peek parent object
 static void *IXmlParserPeek(IXmlParserState_t *state)
 {
@@ -1383,31 +1800,28 @@ IXmlParserRawStart(void *data, const char *el, const char **attr) {
 		return;
 	}
 	if (! state->skip && state->current.subfields) {
-		for (i=0,p=state->current.subfields; p->tag; p++,i++) {
-			if (strcmp(el, p->tag) == 0 || strcmp("*", p->tag) == 0) {
-				char *tagname;
-				if (i < 64)
-					state->current.fields_found |= ((uint64)1)<<i;
-				state->current.tags_found++;
+		p = IXmlParserFindField(state, state->current.subfields, el, &i);
+		if (p) {
+			char *tagname;
+			if (i < 64)
+				state->current.fields_found |= ((uint64)1)<<i;
+			state->current.tags_found++;
 #if DEBUG_IXML_PARSER
-				printf("tags_found=%u fields_found=0x%"PRIx64"\n", state->current.tags_found, state->current.fields_found);
+			printf("tags_found=%u fields_found=0x%"PRIx64"\n", state->current.tags_found, state->current.fields_found);
 #endif
-				tagname = strdup(el);
-				if (! tagname) {
-					IXmlParserPrintError(state, "Unable to allocate memory");
-					return;
-				}
-				IXmlParserPush(state);
-				state->current.tag = tagname;
-				state->current.field = p;
-				state->current.subfields = p->subfields;
-				state->current.fields_found = 0;
-				state->current.tags_found = 0;
-				IXmlParserStartTag(state, state->current.tag, attr);   /* rest of start handling */
-				break;
+			tagname = IXmlParserSaveTag(state, el);
+			if (! tagname) {
+				IXmlParserPrintError(state, "Unable to allocate memory");
+				return;
 			}
-		}
-		if (! (p && p->tag)) {
+			IXmlParserPush(state);
+			state->current.tag = tagname;
+			state->current.field = p;
+			state->current.subfields = p->subfields;
+			state->current.fields_found = 0;
+			state->current.tags_found = 0;
+			IXmlParserStartTag(state, state->current.tag, attr);   /* rest of start handling */
+		} else {
 			/* unknown tag, skip it and child tags */
 			if (state->flags & IXML_PARSER_FLAG_STRICT) {
 				IXmlParserPrintWarning(state, "Unexpected tag ignored: %s", el);
@@ -1520,8 +1934,79 @@ IXmlParserInit(IXmlParserState_t *state, IXmlParserFlags_t flags, const IXML_FIE
 	return FSUCCESS;
 }
 
+#ifndef VXWORKS
+/* parse a regular file by mapping it, avoids copying the whole file
+ * through stdio and expat's buffer.
+ * returns FNOT_DONE if file can't be mapped and should be read instead
+ */
+static FSTATUS IXmlParserMapFile(IXmlParserState_t *state, FILE *file)
+{
+	int fd = fileno(file);
+	struct stat statbuf;
+	off_t offset;
+	char *map;
+	size_t size;
+	size_t pos;
+	size_t released = 0;
+	size_t pagemask = (size_t)sysconf(_SC_PAGESIZE) - 1;
+	size_t piece = (state->flags & IXML_PARSER_FLAG_RELEASE_INPUT)
+						? MAP_RELEASE_PARSE_SIZE : MAP_PARSE_SIZE;
+	FSTATUS status = FSUCCESS;
+
+	if (fd < 0 || fstat(fd, &statbuf) != 0 || ! S_ISREG(statbuf.st_mode)
+		|| statbuf.st_size <= 0)
+		return FNOT_DONE;
+	// caller may have already consumed part of file
+	offset = ftello(file);
+	if (offset < 0 || offset >= statbuf.st_size)
+		return FNOT_DONE;
+	size = (size_t)statbuf.st_size;
+	map = (char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		return FNOT_DONE;
+	(void)madvise(map, size, MADV_SEQUENTIAL);
+
+	for (pos = (size_t)offset; pos < size; ) {
+		size_t len = size - pos;
+		int done;
+
+		if (len > piece)
+			len = piece;
+		done = (pos + len == size);
+		if (XML_Parse(state->parser, map + pos, (int)len, done) == XML_STATUS_ERROR) {
+			/* if IXmlParserFailed, we already output an error */
+			if (! IXmlParserFailed(state))
+				IXmlParserPrintErrorString(state);
+			status = FINVALID_STATE;
+			break;
+		}
+		pos += len;
+		// expat copies any partial token it still needs, so drop the pages
+		// parsed so far rather than let a large file accumulate in our RSS
+		if ((state->flags & IXML_PARSER_FLAG_RELEASE_INPUT)
+			&& (pos & ~pagemask) > released) {
+			(void)madvise(map + released, (pos & ~pagemask) - released, MADV_DONTNEED);
+			released = pos & ~pagemask;
+		}
+	}
+	munmap(map, size);
+	// leave file positioned as if it had been read
+	(void)fseeko(file, 0, SEEK_END);
+	return status;
+}
+#endif
+
 FSTATUS IXmlParserReadFile(IXmlParserState_t *state, FILE *file)
 {
+#ifndef VXWORKS
+	FSTATUS status;
+
+	if (fileno(file) >= 0)
+		(void)posix_fadvise(fileno(file), 0, 0, POSIX_FADV_SEQUENTIAL);
+	status = IXmlParserMapFile(state, file);
+	if (status != FNOT_DONE)
+		return status;
+#endif
 	for (;;) {
 		int n;
 		int done;
@@ -1577,9 +2062,21 @@ IXmlParserDestroy(IXmlParserState_t *state) {
 	XML_ParserFree(state->parser);
 	state->parser = NULL;	// make sure not used by mistake after destroy
 	state->context = NULL;	// make sure not used by mistake after destroy
-	if (state->current.tag)
-		free(state->current.tag);
 	state->current.tag = NULL;	// make sure not used by mistake after destroy
+	if (state->tag_arena)
+		free(state->tag_arena);
+	state->tag_arena = NULL;
+	state->tag_arena_size = state->tag_arena_used = 0;
+	if (state->field_indexes) {
+		unsigned i;
+		for (i=0; i < state->field_index_size; i++) {
+			if (state->field_indexes[i].subfields)
+				free(state->field_indexes[i].sorted);
+		}
+		free(state->field_indexes);
+	}
+	state->field_indexes = NULL;
+	state->field_index_size = state->field_index_count = 0;
 }
 
 #ifndef VXWORKS
@@ -264,6 +264,8 @@ typedef struct IXmlOutputState {
 	unsigned cur_indent;	/* level of indent */
 	int flags;
 	void *context;	/* caller supplied context */
+	char *buf;		/* output buffer, NULL if unbuffered */
+	unsigned buf_len;	/* bytes in buf not yet written to file */
 } IXmlOutputState_t;
 
 /* for use in output calls so can early exit */
@@ -360,7 +362,7 @@ extern void IXmlOutputOptionalStruct(IXmlOutputState_t *state, const char *tag,
 /* XML Parser declarations */
 /* these structures should not be directly used by callers */
 typedef struct IXmlParserStackEntry {
-	char *tag;				// locally allocated copy
+	char *tag;				// copy in parser's tag arena
 	const IXML_FIELD *field;
 	const IXML_FIELD *subfields;
 	void *object;
@@ -379,6 +381,16 @@ typedef struct IXmlParserStack {
 /* callbacks by the parser to output errors and warnings */
 typedef void (*IXmlParserPrintMessage)(const char *message);
 
+/* tag lookup index for one subfields table, built by the parser the first
+ * time it searches the table
+ */
+typedef struct IXmlParserFieldIndex {
+	const IXML_FIELD *subfields;	/* NULL if entry unused */
+	unsigned count;			/* number of fields in subfields */
+	unsigned wildcard;		/* index of first "*" field, count if none */
+	unsigned *sorted;		/* field indexes sorted by tag then index */
+} IXmlParserFieldIndex_t;
+
 typedef struct IXmlParserState {
 // TBD - later support input from a memory buffer
 	XML_Parser parser;
@@ -394,6 +406,14 @@ typedef struct IXmlParserState {
 	void *context;	/* caller supplied context */
 	IXmlParserPrintMessage printError;
 	IXmlParserPrintMessage printWarning;
+	/* hash table of field indexes, keyed by subfields pointer */
+	IXmlParserFieldIndex_t *field_indexes;
+	unsigned field_index_size;	/* power of 2 */
+	unsigned field_index_count;
+	/* tags of all open elements, allocated and freed in stack order */
+	char *tag_arena;
+	unsigned tag_arena_size;
+	unsigned tag_arena_used;
 } IXmlParserState_t;
 
 /* get access to caller supplied context for input */
@@ -406,6 +426,8 @@ typedef enum {
 	/* flags which can be passed to IXmlInit and IXmlOutputInit */
 	IXML_PARSER_FLAG_NONE = 0,
 	IXML_PARSER_FLAG_STRICT = 1,	/* provide warnings for unknown tags, etc */
+	IXML_PARSER_FLAG_RELEASE_INPUT = 2,	/* drop a mapped input file's pages */
+										/* once parsed, bounds RSS of huge files */
 } IXmlParserFlags_t;
 
 /* get parser option flags */
@@ -144,6 +144,57 @@ iba_pa_single_mad_port_counters_response_query(
     IN uint32_t          user_cntrs_flag,
     IN STL_PA_IMAGE_ID_DATA    *image_id
     );
+/**
+ *  Build a PA Get(PortCounters) request for the caller to send, allowing
+ *  the caller to keep many requests outstanding at once.
+ *  The TransactionID is left 0 for the caller to assign.
+ *
+ * @param port                  Local port to operate on.
+ * @param node_lid              Remote node LID.
+ * @param port_number           Remote port number.
+ * @param delta_flag            1 for delta counters, 0 for raw image counters.
+ * @param user_cntrs_flag       1 for running counters, 0 for image counters. (delta must be 0)
+ * @param image_id              Pointer to image ID of port counters to get.
+ * @param mad                   Buffer of at least STL_MAD_BLOCK_SIZE for the request
+ * @param mad_len               Returns length of request in mad
+ * @param addr                  Returns address of the PA
+ *
+ * @return
+ *   FSUCCESS - request built
+ *     other  - PA is not reachable from port
+ */
+FSTATUS
+iba_pa_single_mad_port_counters_build_request(
+    IN struct omgt_port  *port,
+    IN STL_LID           node_lid,
+    IN uint8_t           port_number,
+    IN uint32_t          delta_flag,
+    IN uint32_t          user_cntrs_flag,
+    IN STL_PA_IMAGE_ID_DATA    *image_id,
+    OUT uint8_t          *mad,
+    OUT size_t           *mad_len,
+    OUT struct omgt_mad_addr *addr
+    );
+/**
+ *  Process the response to a request built by
+ *  iba_pa_single_mad_port_counters_build_request.
+ *
+ * @param port                  Local port to operate on.
+ * @param mad                   Response MAD in wire format, header is swapped in place
+ * @param mad_len               Length of response
+ * @param port_counters         Returns the counters
+ *
+ * @return
+ *   FSUCCESS - port_counters filled in
+ *     other  - PA reported an error or the response is malformed
+ */
+FSTATUS
+iba_pa_single_mad_port_counters_parse_response(
+    IN struct omgt_port  *port,
+    IN uint8_t           *mad,
+    IN size_t            mad_len,
+    OUT STL_PORT_COUNTERS_DATA *port_counters
+    );
 /**
  *  Clear port statistics (counters)
  *
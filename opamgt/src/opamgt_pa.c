@@ -124,6 +124,49 @@ static const char* const pa_status_text[] =
  * Local file functions
  *******************************************************/
 
+/** 
+ *  Get the address of the PA for in-band requests.
+ * 
+ * @param port              The port from which we access the fabric.
+ * @param addr              Returns address of the PA
+ *
+ * @return 
+ *   FSUCCESS - addr filled in
+ *     other  - PA is not reachable from port
+ */
+static FSTATUS
+pa_get_addr(
+	struct omgt_port      *port,
+	struct omgt_mad_addr  *addr
+	)
+{
+	uint8_t port_state;
+
+	(void)omgt_port_get_port_state(port, &port_state);
+	if (port_state != PortStateActive) {
+		OMGT_OUTPUT_ERROR(port, "Local port not Active!\n");
+		return FINVALID_STATE;
+	}
+	if ((port->pa_service_state != OMGT_SERVICE_STATE_OPERATIONAL)
+		&& (omgt_pa_service_connect(port) != OMGT_SERVICE_STATE_OPERATIONAL)) {
+
+		OMGT_OUTPUT_ERROR(port, "Query PA failed: PA Service Not Operational: %s (%d)\n",
+			omgt_service_state_totext(port->pa_service_state), port->pa_service_state);
+		return FUNAVAILABLE;
+	}
+	memset(addr, 0, sizeof(*addr));
+	addr->lid = port->primary_pm_lid;
+	addr->sl = port->primary_pm_sl;
+	addr->qpn = 1;
+	addr->qkey = QP1_WELL_KNOWN_Q_KEY;
+	addr->pkey = OMGT_DEFAULT_PKEY;
+	if (omgt_find_pkey(port, OMGT_DEFAULT_PKEY) < 0) {
+		OMGT_OUTPUT_ERROR(port, "Query PA failed: requires full management node. Status:(%u)\n", FPROTECTION);
+		return FPROTECTION;
+	}
+	return FSUCCESS;
+}
+
 /** 
  *  Send a PA query and get the result.
  * 
@@ -170,28 +213,9 @@ pa_query_common(
 
 	/* If port is In-Band, set up addr */
 	if (!port->is_oob_enabled) {
-		uint8_t port_state;
-		(void)omgt_port_get_port_state(port, &port_state);
-		if (port_state != PortStateActive) {
-			OMGT_OUTPUT_ERROR(port, "Local port not Active!\n");
-			return FINVALID_STATE;
-		}
-		if ((port->pa_service_state != OMGT_SERVICE_STATE_OPERATIONAL)
-			&& (omgt_pa_service_connect(port) != OMGT_SERVICE_STATE_OPERATIONAL)) {
-
-			OMGT_OUTPUT_ERROR(port, "Query PA failed: PA Service Not Operational: %s (%d)\n",
-				omgt_service_state_totext(port->pa_service_state), port->pa_service_state);
-			return FUNAVAILABLE;
-		}
-		addr.lid = port->primary_pm_lid;
-		addr.sl = port->primary_pm_sl;
-		addr.qpn = 1;
-		addr.qkey = QP1_WELL_KNOWN_Q_KEY;
-		addr.pkey = OMGT_DEFAULT_PKEY;
-		if (omgt_find_pkey(port, OMGT_DEFAULT_PKEY) < 0) {
-			OMGT_OUTPUT_ERROR(port, "Query PA failed: requires full management node. Status:(%u)\n", FPROTECTION);
-			return FPROTECTION;
-		}
+		fstatus = pa_get_addr(port, &addr);
+		if (fstatus != FSUCCESS)
+			return fstatus;
 	}
 
 	OMGT_DBGPRINT(port, "Request MAD method: 0x%x\n", method);
@@ -521,6 +545,122 @@ done:
 }
 
 
+/**
+ *  Build a PA Get(PortCounters) request for the caller to send, allowing
+ *  the caller to keep many requests outstanding at once.
+ *  The TransactionID is left 0 for the caller to assign.
+ *
+ * @param port                  Local port to operate on.
+ * @param node_lid              Remote node LID.
+ * @param port_number           Remote port number.
+ * @param delta_flag            1 for delta counters, 0 for raw image counters.
+ * @param user_cntrs_flag       1 for running counters, 0 for image counters. (delta must be 0)
+ * @param image_id              Pointer to image ID of port counters to get.
+ * @param mad                   Buffer of at least STL_MAD_BLOCK_SIZE for the request
+ * @param mad_len               Returns length of request in mad
+ * @param addr                  Returns address of the PA
+ *
+ * @return
+ *   FSUCCESS - request built
+ *     other  - PA is not reachable from port
+ */
+FSTATUS
+iba_pa_single_mad_port_counters_build_request(
+    IN struct omgt_port  *port,
+    IN STL_LID           node_lid,
+    IN uint8_t           port_number,
+    IN uint32_t          delta_flag,
+    IN uint32_t          user_cntrs_flag,
+    IN STL_PA_IMAGE_ID_DATA    *image_id,
+    OUT uint8_t          *mad,
+    OUT size_t           *mad_len,
+    OUT struct omgt_mad_addr *addr
+    )
+{
+    FSTATUS                 fstatus;
+    SA_MAD                  *send_mad = (SA_MAD *)mad;
+    STL_PORT_COUNTERS_DATA  *p;
+    struct umad_vendor_packet *pkt;
+
+    if (port == NULL || port->is_oob_enabled)
+        return FINVALID_PARAMETER;
+    fstatus = pa_get_addr(port, addr);
+    if (fstatus != FSUCCESS)
+        return fstatus;
+
+    memset(mad, 0, PA_REQ_HEADER_SIZE + sizeof(STL_PORT_COUNTERS_DATA));
+    p = (STL_PORT_COUNTERS_DATA *)send_mad->Data;
+    p->nodeLid = node_lid;
+    p->portNumber = port_number;
+    p->flags = (delta_flag ? STL_PA_PC_FLAG_DELTA : 0) |
+			   (user_cntrs_flag ? STL_PA_PC_FLAG_USER_COUNTERS : 0);
+    p->imageId.imageNumber = image_id->imageNumber;
+    p->imageId.imageOffset = image_id->imageOffset;
+	p->imageId.imageTime.absoluteTime = image_id->imageTime.absoluteTime;
+    BSWAP_STL_PA_PORT_COUNTERS(p);
+
+	MAD_SET_VERSION_INFO(send_mad, STL_BASE_VERSION, MCLASS_VFI_PM, STL_PA_CLASS_VERSION);
+	MAD_SET_METHOD_TYPE(send_mad, STL_PA_CMD_GET);
+	MAD_SET_ATTRIB_ID(send_mad, STL_PA_ATTRID_GET_PORT_CTRS);
+	MAD_SET_ATTRIB_MOD(send_mad, 0);
+	MAD_SET_TRANSACTION_ID(send_mad, 0);
+
+	BSWAP_SA_HDR(&send_mad->SaHdr);
+	BSWAP_MAD_HEADER((MAD *)&send_mad->common);
+
+	/* Add OUI to MAD after BSWAP */
+	pkt = (struct umad_vendor_packet *)send_mad;
+	memcpy(&pkt->oui, ib_truescale_oui, 3);
+
+	*mad_len = PA_REQ_HEADER_SIZE + sizeof(STL_PORT_COUNTERS_DATA);
+	return FSUCCESS;
+}
+
+/**
+ *  Process the response to a request built by
+ *  iba_pa_single_mad_port_counters_build_request.
+ *
+ * @param port                  Local port to operate on.
+ * @param mad                   Response MAD in wire format, header is swapped in place
+ * @param mad_len               Length of response
+ * @param port_counters         Returns the counters
+ *
+ * @return
+ *   FSUCCESS - port_counters filled in
+ *     other  - PA reported an error or the response is malformed
+ */
+FSTATUS
+iba_pa_single_mad_port_counters_parse_response(
+    IN struct omgt_port  *port,
+    IN uint8_t           *mad,
+    IN size_t            mad_len,
+    OUT STL_PORT_COUNTERS_DATA *port_counters
+    )
+{
+    SA_MAD                  *rsp_mad = (SA_MAD *)mad;
+
+	if (mad_len < PA_REQ_HEADER_SIZE) {
+		OMGT_DBGPRINT(port, "Query PA: Failed to receive packet\n");
+		return FNOT_FOUND;
+	}
+	BSWAP_MAD_HEADER((MAD *)&rsp_mad->common);
+	BSWAP_SA_HDR(&rsp_mad->SaHdr);
+	if (rsp_mad->common.u.NS.Status.AsReg16 != 0) {
+		OMGT_DBGPRINT(port, "Query PA failed: Mad status is 0x%x\n",
+			rsp_mad->common.u.NS.Status.AsReg16);
+		return FERROR;
+	}
+	if (rsp_mad->SaHdr.AttributeOffset) {
+		if (port->pa_verbose)
+			OMGT_OUTPUT_ERROR(port, "Error, unexpected multiple MAD response\n");
+		return FERROR;
+	}
+	memset(port_counters, 0, sizeof(*port_counters));
+	memcpy((uint8 *)port_counters, rsp_mad->Data, min(sizeof(STL_PORT_COUNTERS_DATA), mad_len - IB_SA_DATA_OFFS));
+	BSWAP_STL_PA_PORT_COUNTERS(port_counters);
+	return FSUCCESS;
+}
+
 /**
  *  Clear port statistics (counters)
  *
@@ -39,7 +39,6 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <unistd.h>
 #include <sys/mman.h>
 #include <arpa/inet.h>
-#include <sched.h>
 #include <opasadb_debug.h>
 #include "opasadb_path_private.h"
 
@@ -74,21 +73,63 @@ op_ppath_allocate_writer(void)
 	return p;
 }
 
+/*
+ * Returns the number of slots in the GID index for a table of ps paths:
+ * the smallest power of 2 that is at least twice the number of records.
+ */
 static uint32
-gid_hash(IB_GID_NO *gid)
+gid_index_slots(uint32 ps)
 {
-    uint32 hash=0;
-    int i;
+	uint32 slots = 16;
 
-    for (i=0; i<16;i++) {
-        hash += gid->Raw[i];
-    }
+	while (slots < 2*(ps+1))
+		slots <<= 1;
+	return slots;
+}
 
-    return hash & HASH_TABLE_MASK;
+/*
+ * Folds one 64-bit word into the hash, multiply-xorshift style.
+ */
+static __inline__ uint64
+gid_hash_mix(uint64 hash, uint64 word)
+{
+	hash ^= word;
+	hash *= 0x9e3779b97f4a7c15ULL;
+	return hash ^ (hash >> 29);
 }
 
-#define GID_HASH(g) (gid_hash(g))
-#define LID_HASH(i) ((ntohs((uint32)(i)) & HASH_TABLE_MASK))
+/*
+ * Hashes a (virtual fabric, SGID, DGID) triple for the GID index.
+ * The low bits select the first slot to probe, the upper 32 bits
+ * become the slot tag. The GIDs are hashed in network byte order;
+ * the value never leaves the host.
+ */
+static uint64
+gid_hash(uint32 vfab_id, IB_GID_NO *sgid, IB_GID_NO *dgid)
+{
+	uint64 hash = vfab_id;
+
+	hash = gid_hash_mix(hash, sgid->Type.Global.SubnetPrefix);
+	hash = gid_hash_mix(hash, sgid->Type.Global.InterfaceID);
+	hash = gid_hash_mix(hash, dgid->Type.Global.SubnetPrefix);
+	hash = gid_hash_mix(hash, dgid->Type.Global.InterfaceID);
+
+	// Final avalanche so every input bit reaches the low (slot) bits.
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+
+	return hash;
+}
+
+/*
+ * Hashes a (virtual fabric, DLID) pair for the LID chain heads.
+ */
+static __inline__ uint32
+lid_hash(uint32 vfab_id, uint16 dlid)
+{
+	return (uint32)(gid_hash_mix(vfab_id, dlid) >> 32);
+}
 
 static void 
 close_and_unlink_tables(op_ppath_reader_t *r)
@@ -99,16 +140,23 @@ close_and_unlink_tables(op_ppath_reader_t *r)
 	char path_table_name[SHM_NAME_LENGTH];
 
 	_DBG_FUNC_ENTRY;
+	if (!r->tables) {
+		/* Never connected, so there is nothing to unlink. */
+		op_ppath_close_reader(r);
+		_DBG_FUNC_EXIT;
+		return;
+	}
+
 	/* The call to op_ppath_close_reader() will unmapped the shared table
 	   and therefore we can't refer to it anymore. Copy the table names
 	   here for unlinking */
-	strncpy(port_table_name, r->shared_table->port_table_name, SHM_NAME_LENGTH -1);
+	strncpy(port_table_name, r->tables->port_table_name, SHM_NAME_LENGTH -1);
 	port_table_name[SHM_NAME_LENGTH - 1] = '\0';
-	strncpy(subnet_table_name, r->shared_table->subnet_table_name, SHM_NAME_LENGTH -1);
+	strncpy(subnet_table_name, r->tables->subnet_table_name, SHM_NAME_LENGTH -1);
 	subnet_table_name[SHM_NAME_LENGTH - 1] = '\0';
-	strncpy(vfab_table_name, r->shared_table->vfab_table_name, SHM_NAME_LENGTH -1);
+	strncpy(vfab_table_name, r->tables->vfab_table_name, SHM_NAME_LENGTH -1);
 	vfab_table_name[SHM_NAME_LENGTH - 1] = '\0';
-	strncpy(path_table_name, r->shared_table->path_table_name, SHM_NAME_LENGTH -1);
+	strncpy(path_table_name, r->tables->path_table_name, SHM_NAME_LENGTH -1);
 	path_table_name[SHM_NAME_LENGTH - 1] = '\0';
 
 	op_ppath_close_reader(r);
@@ -126,13 +174,35 @@ close_and_unlink_tables(op_ppath_reader_t *r)
 	_DBG_FUNC_EXIT;
 }
 
+/*
+ * Unlinks the tables named by a retired generation record, except for
+ * any it shares with either of the generations in keep1 and keep2.
+ */
+static void
+unlink_generation(op_ppath_generation_t *old, op_ppath_generation_t *keep1,
+				  op_ppath_generation_t *keep2)
+{
+#define UNLINK_RETIRED(n) \
+	if (old->n[0] && strcmp(old->n, keep1->n) && strcmp(old->n, keep2->n)) \
+		shm_unlink(old->n);
+
+	UNLINK_RETIRED(port_table_name);
+	UNLINK_RETIRED(subnet_table_name);
+	UNLINK_RETIRED(vfab_table_name);
+	UNLINK_RETIRED(path_table_name);
+
+#undef UNLINK_RETIRED
+}
+
 void
 op_ppath_close_reader(op_ppath_reader_t *r)
 {
 	_DBG_FUNC_ENTRY;
 
 	if (r->path_table && r->path_table != MAP_FAILED) {
-		munmap(r->path_table,r->path_table->size);
+		munmap(r->path_table,
+			   r->path_table->size +
+			   r->path_table->index_size);
 		r->path_table=NULL;
 	}
 	if (r->port_table && r->port_table != MAP_FAILED) {
@@ -173,13 +243,28 @@ op_ppath_close_reader(op_ppath_reader_t *r)
 void
 op_ppath_close_writer(op_ppath_writer_t *w)
 {
+	op_ppath_shared_table_t *shared = w->published.shared_table;
+
 	_DBG_FUNC_ENTRY;
 
+	// The previous generation may still have tables of its own.
+	if (shared && shared != MAP_FAILED && w->unpublished.tables)
+		unlink_generation(&(shared->gen[(shared->generation + 1) & 1]),
+						  &(shared->gen[shared->generation & 1]),
+						  w->unpublished.tables);
+
 	close_and_unlink_tables(&w->published);
 	close_and_unlink_tables(&w->unpublished);
+	w->published.tables = NULL;
 
-	if (w->unpublished.shared_table) {
-		free(w->unpublished.shared_table);
+	if (w->unpublished.tables) {
+		free(w->unpublished.tables);
+		w->unpublished.tables = NULL;
+	}
+
+	if (w->sid_work) {
+		free(w->sid_work);
+		w->sid_work = NULL;
 	}
 
 	_DBG_FUNC_EXIT;
@@ -273,47 +358,47 @@ open_ppath_table(op_ppath_reader_t *r, int table, int rw, unsigned c, unsigned c
 
 	switch (table) {
 		case PORT_TABLE:
-			name = r->shared_table->port_table_name; 
+			name = r->tables->port_table_name; 
 			size1 = PORT_TABLE_SIZE(c); 
 			size2 = 0;
 			if (rw & O_CREAT) {
-				BUMP_COUNT(r->shared_table->port_update_count);
+				BUMP_COUNT(r->tables->port_update_count);
 				sprintf(name, 
 					SHM_TABLE_NAME PORT_TABLE_NAME "%06u", 
-					(unsigned int)r->shared_table->port_update_count);
+					(unsigned int)r->tables->port_update_count);
 			}
 			break;
 		case PATH_TABLE:
-			name = r->shared_table->path_table_name; 
+			name = r->tables->path_table_name; 
 			size1 = PATH_TABLE_SIZE(c);
-			size2 = 0;
+			size2 = PATH_INDEX_SIZE(gid_index_slots(c));
 			if (rw & O_CREAT) {
-				BUMP_COUNT(r->shared_table->path_update_count);
+				BUMP_COUNT(r->tables->path_update_count);
 				sprintf(name, 
 					SHM_TABLE_NAME PATH_TABLE_NAME "%06u", 
-					(unsigned int)r->shared_table->path_update_count);
+					(unsigned int)r->tables->path_update_count);
 			}
 			break;
 		case VFAB_TABLE:
-			name = r->shared_table->vfab_table_name; 
+			name = r->tables->vfab_table_name; 
 			size1 = VFAB_TABLE_SIZE(c);
 			size2 = 0;
 			if (rw & O_CREAT) {
-				BUMP_COUNT(r->shared_table->vfab_update_count);
+				BUMP_COUNT(r->tables->vfab_update_count);
 				sprintf(name, 
 					SHM_TABLE_NAME VFAB_TABLE_NAME "%06u", 
-					(unsigned int)r->shared_table->vfab_update_count);
+					(unsigned int)r->tables->vfab_update_count);
 			}
 			break;
 		case SUBNET_TABLE:
-			name = r->shared_table->subnet_table_name; 
+			name = r->tables->subnet_table_name; 
 			size1 = SUBNET_TABLE_SIZE(c);
 			size2 = SID_TABLE_SIZE(c2);
 			if (rw & O_CREAT) {
-				BUMP_COUNT(r->shared_table->subnet_update_count);
+				BUMP_COUNT(r->tables->subnet_update_count);
 				sprintf(name, 
 					SHM_TABLE_NAME SUBNET_TABLE_NAME "%06u", 
-					(unsigned int)r->shared_table->subnet_update_count);
+					(unsigned int)r->tables->subnet_update_count);
 			}
 			break;
 		default:
@@ -332,6 +417,10 @@ open_ppath_table(op_ppath_reader_t *r, int table, int rw, unsigned c, unsigned c
 		size2 = 0;
 	}
 
+	// Never re-use an existing object; a reader could still have it mapped.
+	if (rw & O_CREAT)
+		shm_unlink(name);
+
 	fd = shm_open(name, rw, 0644);
 	if (fd < 0) {
 		_DBG_ERROR("Failed to open %s\n",name);
@@ -354,9 +443,9 @@ open_ppath_table(op_ppath_reader_t *r, int table, int rw, unsigned c, unsigned c
 
 	if (rw & O_CREAT) {
 		/*
-		 * clear the table & set the maximum lengths.
+		 * The object is new, so ftruncate has already cleared
+		 * the table. Set the maximum lengths.
 		 */
-		memset((char*)h,0,size1+size2);
 		h->s1 = size1; 
 		h->s2 = size2;
 	} else {
@@ -374,17 +463,27 @@ open_ppath_table(op_ppath_reader_t *r, int table, int rw, unsigned c, unsigned c
 	// There are definitely times when OOP would be a big win.
 	switch (table) {
 		case PORT_TABLE:
-			r->old_port_update_count = r->shared_table->port_update_count;
+			r->old_port_update_count = r->tables->port_update_count;
 			r->port_table = (op_ppath_port_table_t*)h;
 			r->port_fd = fd;
+			memset(r->guid_port_index, 0, sizeof(r->guid_port_index));
+			memset(r->lid_port_index, 0, sizeof(r->lid_port_index));
 			break;
 		case PATH_TABLE:
-			r->old_path_update_count = r->shared_table->path_update_count;
+			r->old_path_update_count = r->tables->path_update_count;
+			// The GID index and the LID chain heads are appended to
+			// the end of the path table.
 			r->path_table = (op_ppath_table_t*)h;
+			if (rw & O_CREAT)
+				r->path_table->index_slots = gid_index_slots(c);
+			r->gid_index = (op_ppath_gid_slot_t*)(((char*)h)+(h->s1));
+			r->gid_index_mask = r->path_table->index_slots - 1;
+			r->lid_heads = (uint32*)(r->gid_index + r->path_table->index_slots);
+			r->lid_heads_mask = r->path_table->index_slots/2 - 1;
 			r->path_fd = fd;
 			break;
 		case VFAB_TABLE:
-			r->old_vfab_update_count = r->shared_table->vfab_update_count;
+			r->old_vfab_update_count = r->tables->vfab_update_count;
 			r->vfab_table = (op_ppath_vfab_table_t*)h;
 			r->vfab_fd = fd;
 			break;
@@ -393,8 +492,12 @@ open_ppath_table(op_ppath_reader_t *r, int table, int rw, unsigned c, unsigned c
 			// The sid table is appended to the end of the subnet table.
 			r->subnet_table = (op_ppath_subnet_table_t*)h;
 			r->sid_table = (op_ppath_sid_record_t*)(((char*)h)+(h->s1));
+			if (rw & O_CREAT) r->subnet_table->max_sids = c2;
+			// The ranges follow the sid records.
+			r->sid_ranges = (op_ppath_sid_range_t*)
+				(r->sid_table + r->subnet_table->max_sids + 1);
 			r->subnet_fd = fd;
-			r->old_subnet_update_count = r->shared_table->subnet_update_count;
+			r->old_subnet_update_count = r->tables->subnet_update_count;
 			break;
 	}
 	_DBG_FUNC_EXIT;
@@ -422,8 +525,12 @@ close_ppath_table(op_ppath_reader_t *r, int table)
 	switch(table) {
 		case PATH_TABLE:
 			if (r->path_table && r->path_table != MAP_FAILED) {
-				munmap(r->path_table,r->path_table->size);
+				munmap(r->path_table,
+			   r->path_table->size +
+			   r->path_table->index_size);
 				r->path_table=NULL;
+				r->gid_index=NULL;
+				r->lid_heads=NULL;
 			}
 			if (r->path_fd>0) { close(r->path_fd); r->path_fd=0; }
 			break;
@@ -501,6 +608,11 @@ connect_shared_table(op_ppath_reader_t *r)
 		_DBG_ERROR("Unable to open shared memory table.\n");
 	} else if (r->shared_table->abi_version != OPA_SA_DB_PATH_TABLE_VERSION) {
 		_DBG_ERROR("Incorrect ABI version.\n");
+		munmap(r->shared_table, sizeof(op_ppath_shared_table_t));
+		r->shared_table = NULL;
+		close(r->shared_fd);
+		r->shared_fd = 0;
+		err = EPROTO;
 	}
 	_DBG_FUNC_EXIT;
 	return err;
@@ -548,41 +660,114 @@ op_ppath_create_writer(op_ppath_writer_t *w)
 	if (err) goto error;
 
 
+	w->published.tables = &(w->published.shared_table->gen[w->published.shared_table->generation & 1]);
+
 	/*
-	 * The "unpublished" table isn't shared, so we allocate local memory. 
+	 * The "unpublished" generation isn't shared, so we allocate local memory. 
 	 * In this case, the shared_fd is 0, which can be used to differentiate 
 	 * "unpublished" from "published" table. 
 	 */
-	w->unpublished.shared_table = malloc(sizeof(op_ppath_shared_table_t));
-	if (!(w->unpublished.shared_table)) {
+	w->unpublished.tables = malloc(sizeof(op_ppath_generation_t));
+	if (!(w->unpublished.tables)) {
 		err = ENOMEM;
 		disconnect_shared_table(&(w->published));
+		w->published.tables = NULL;
+		w->published.shared_fd = 0;
 		goto error;
 	}
 
-	memset(w->unpublished.shared_table,0,sizeof(op_ppath_shared_table_t));
-
 	/* We do this to ensure that when we open writeable tables,
 	 * they will have an update count greater than the currently
 	 * published tables. (If we did not find currently published
 	 * tables, then we're just copying zeros.)
 	 */
-	w->unpublished.shared_table->port_update_count = w->published.shared_table->port_update_count;
-	w->unpublished.shared_table->subnet_update_count = w->published.shared_table->subnet_update_count;
-	w->unpublished.shared_table->vfab_update_count = w->published.shared_table->vfab_update_count;
-	w->unpublished.shared_table->path_update_count = w->published.shared_table->path_update_count;
+	*(w->unpublished.tables) = *(w->published.tables);
 	
 error:
 	_DBG_FUNC_EXIT;
 	return err;
 }
 
+/*
+ * These functions check to see if the update count of the named table has been changed.
+ *
+ * Returns true if a re-open is needed.
+ */
+static inline int validate_port_table(op_ppath_reader_t *r) { return (!r->port_table || r->old_port_update_count != r->tables->port_update_count); }
+static inline int validate_path_table(op_ppath_reader_t *r) { return (!r->path_table || r->old_path_update_count != r->tables->path_update_count); }
+static inline int validate_vfab_table(op_ppath_reader_t *r) { return (!r->vfab_table || r->old_vfab_update_count != r->tables->vfab_update_count); }
+static inline int validate_subnet_table(op_ppath_reader_t *r) { return (!r->subnet_table || r->old_subnet_update_count != r->tables->subnet_update_count); }
+
+static inline uint32 read_generation(op_ppath_reader_t *r) { return *(volatile uint32 *)&(r->shared_table->generation); }
+
+/*
+ * Re-opens any table whose update count in r->tables has changed since
+ * we last opened it.
+ */
+static int
+refresh_ppath_tables(op_ppath_reader_t *r)
+{
+	int err = 0;
+
+	if (validate_port_table(r)) {
+		_DBG_DEBUG("Reloading the port table.\n");
+		err = reopen_ppath_table(r, PORT_TABLE, O_RDONLY, 0, 0);
+		if (err) return err;
+	}
+	if (validate_subnet_table(r)) {
+		_DBG_DEBUG("Reloading the subnet table.\n");
+		err = reopen_ppath_table(r, SUBNET_TABLE, O_RDONLY, 0, 0);
+		if (err) return err;
+	}
+	if (validate_vfab_table(r)) {
+		_DBG_DEBUG("Reloading the fabric table.\n");
+		err = reopen_ppath_table(r, VFAB_TABLE, O_RDONLY, 0, 0);
+		if (err) return err;
+	}
+	if (validate_path_table(r)) {
+		_DBG_DEBUG("Reloading the path table.\n");
+		err = reopen_ppath_table(r, PATH_TABLE, O_RDONLY, 0, 0);
+	}
+	return err;
+}
+
+/*
+ * Switches the reader over to the tables of the current generation.
+ *
+ * If the writer publishes twice while we are reading the generation 
+ * record, the record may be rewritten under us (or the tables it names
+ * unlinked), so we start over with the newer generation.
+ */
+static int
+refresh_generation(op_ppath_reader_t *r)
+{
+	int err = 0;
+	int retries = 0;
+	uint32 generation;
+
+	do {
+		generation = read_generation(r);
+		__sync_synchronize();
+
+		r->tables = &(r->shared_table->gen[generation & 1]);
+		err = refresh_ppath_tables(r);
+
+		__sync_synchronize();
+		if (read_generation(r) == generation) {
+			if (!err) r->old_generation = generation;
+			return err;
+		}
+		_DBG_DEBUG("Publish raced with the reload, retrying.\n");
+	} while (++retries <= MAX_RETRIES);
+
+	return err ? err : EAGAIN;
+}
+
 /*
  * Opens the shared memory segments for read-only access.
  *
- * Note that if any of the opens fails, it closes everything
- * and tries again, up to MAX_RETRIES times, on the assumption
- * that the failure indicates a collision with discovery.
+ * Note that if a publish collides with the opens, they are retried 
+ * with the newer generation, up to MAX_RETRIES times.
  */ 
 int 
 op_ppath_create_reader(op_ppath_reader_t *r)
@@ -593,24 +778,13 @@ op_ppath_create_reader(op_ppath_reader_t *r)
 
 	memset(r, 0, sizeof(op_ppath_reader_t));
 
-	do {
-		err = connect_shared_table(r);
-		if (err) continue;
-	
-		err = open_ppath_table(r, PORT_TABLE, O_RDONLY, 0, 0);
-		if (err) { op_ppath_close_reader(r); continue; }
-
-		err = open_ppath_table(r, PATH_TABLE, O_RDONLY, 0, 0);
-		if (err) { op_ppath_close_reader(r); continue; }
-	
-		err = open_ppath_table(r, SUBNET_TABLE, O_RDONLY, 0, 0);
-		if (err) { op_ppath_close_reader(r); continue; }
+	err = connect_shared_table(r);
+	if (err) goto error;
 
-		err = open_ppath_table(r, VFAB_TABLE, O_RDONLY, 0, 0);
-		if (err) { op_ppath_close_reader(r); continue; }
-		
-	} while (0);
+	err = refresh_generation(r);
+	if (err) op_ppath_close_reader(r);
 
+error:
 	_DBG_FUNC_EXIT;
 	return err;
 }
@@ -619,7 +793,8 @@ op_ppath_create_reader(op_ppath_reader_t *r)
 /*
  * Each of the following functions create a new, unpublished, table.
  * If there is an existing table, it is closed an unmapped
- * before the new one is created.
+ * before the new one is created. (If it was published, it remains
+ * available to readers.)
  */
 int 
 op_ppath_initialize_ports(op_ppath_writer_t *w, unsigned max_ports)
@@ -634,6 +809,7 @@ op_ppath_initialize_ports(op_ppath_writer_t *w, unsigned max_ports)
 	w->max_ports = max_ports;
 
 	err = open_ppath_table(r, PORT_TABLE, O_RDWR | O_CREAT, max_ports, 0);
+	w->sealed &= ~(1 << PORT_TABLE);
 
 
 	_DBG_FUNC_EXIT;
@@ -653,6 +829,7 @@ op_ppath_initialize_vfabrics(op_ppath_writer_t *w, unsigned max_vfabs)
 	w->max_vfabs = max_vfabs;
 
 	err = open_ppath_table(r, VFAB_TABLE, O_RDWR | O_CREAT, max_vfabs, 0);
+	w->sealed &= ~(1 << VFAB_TABLE);
 
 	_DBG_FUNC_EXIT;
 	return err;
@@ -671,6 +848,7 @@ op_ppath_initialize_paths(op_ppath_writer_t *w, unsigned max_paths)
 	w->max_paths = max_paths;
 
 	err = open_ppath_table(r, PATH_TABLE, O_RDWR | O_CREAT, max_paths, 0);
+	w->sealed &= ~(1 << PATH_TABLE);
 
 	_DBG_FUNC_EXIT;
 	return err;
@@ -693,7 +871,18 @@ op_ppath_initialize_subnets(op_ppath_writer_t *w, unsigned max_subnets, unsigned
 
 	w->max_subnets = max_subnets; w->max_sids = max_sids;
 
+	if (w->sid_work) free(w->sid_work);
+	w->sid_work = malloc(3 * (max_sids + 1) * sizeof(op_ppath_sid_range_t));
+	if (!w->sid_work) {
+		errno = ENOMEM;
+		err = ENOMEM;
+		goto error;
+	}
+	w->sid_ranges_dirty = 0;
+	w->last_subnet = 0;
+
 	err = open_ppath_table(r, SUBNET_TABLE, O_RDWR | O_CREAT, max_subnets, max_sids);
+	w->sealed &= ~(1 << SUBNET_TABLE);
 
 error:
 	_DBG_FUNC_EXIT;
@@ -702,7 +891,8 @@ error:
 
 /*
  * The next several functions each add an item to an unpublished table.
- * Returns 0 on success, ENOMEM if the table is full.
+ * Returns 0 on success, ENOMEM if the table is full, or EROFS if the
+ * table has been published since it was last initialized.
  */
 int 
 op_ppath_add_subnet(op_ppath_writer_t *w, uint64 prefix)
@@ -716,6 +906,12 @@ op_ppath_add_subnet(op_ppath_writer_t *w, uint64 prefix)
 		goto error;
 	}
 
+	if (w->sealed & (1 << SUBNET_TABLE)) {
+		_DBG_WARN("Trying to add to a published subnet table.\n");
+		errno = EROFS;
+		goto error;
+	}
+
 	if (r->subnet_table->subnet_count >= w->max_subnets) {
 		errno = ENOMEM;
 		goto error;
@@ -724,6 +920,10 @@ op_ppath_add_subnet(op_ppath_writer_t *w, uint64 prefix)
 	r->subnet_table->subnet_count++;
 	r->subnet_table->subnet[r->subnet_table->subnet_count].source_prefix = prefix;
 	r->subnet_table->subnet[r->subnet_table->subnet_count].first_sid = 0;
+	r->subnet_table->subnet[r->subnet_table->subnet_count].zero_sid = 0;
+	r->subnet_table->subnet[r->subnet_table->subnet_count].default_sid = 0;
+	r->subnet_table->subnet[r->subnet_table->subnet_count].first_range = 0;
+	r->subnet_table->subnet[r->subnet_table->subnet_count].range_count = 0;
 	r->subnet_table->subnet[r->subnet_table->subnet_count].reserved = 0;
 	
 	_DBG_FUNC_EXIT;
@@ -749,6 +949,12 @@ op_ppath_add_port(op_ppath_writer_t *w, op_ppath_port_record_t port)
 		goto error;
 	}
 
+	if (w->sealed & (1 << PORT_TABLE)) {
+		_DBG_WARN("Trying to add to a published port table.\n");
+		err = EROFS;
+		goto error;
+	}
+
 	if (r->port_table->count >= w->max_ports) {
 		err = ENOMEM;
 		goto error;
@@ -798,6 +1004,12 @@ op_ppath_add_sid(op_ppath_writer_t *w,
 		goto error;
 	}
 
+	if (w->sealed & (1 << SUBNET_TABLE)) {
+		_DBG_WARN("Trying to add to a published subnet table.\n");
+		errno = EROFS;
+		goto error;
+	}
+
 	if (r->subnet_table->sid_count >= w->max_sids) {
 		errno = ENOMEM;
 		goto error;
@@ -840,6 +1052,15 @@ op_ppath_add_sid(op_ppath_writer_t *w,
 	r->sid_table[n].next = r->subnet_table->subnet[subnet_id].first_sid;
 	r->subnet_table->subnet[subnet_id].first_sid = n;
 
+	// The sid matches the empty SID. The first such record on the list
+	// answers queries without a SID, the last one answers unmatched ones.
+	if (ntoh64(lower_sid) == 0) {
+		r->subnet_table->subnet[subnet_id].zero_sid = n;
+		if (!r->subnet_table->subnet[subnet_id].default_sid)
+			r->subnet_table->subnet[subnet_id].default_sid = n;
+	}
+	w->sid_ranges_dirty = 1;
+
 	_DBG_FUNC_EXIT;
 	return 0;
 
@@ -849,6 +1070,183 @@ error:
 	return err;
 }
 
+static int
+cmp_range_lower(const void *a, const void *b)
+{
+	const op_ppath_sid_range_t *x = a, *y = b;
+	return (x->lower_sid > y->lower_sid) - (x->lower_sid < y->lower_sid);
+}
+
+static int
+cmp_range_upper(const void *a, const void *b)
+{
+	const op_ppath_sid_range_t *x = a, *y = b;
+	return (x->upper_sid > y->upper_sid) - (x->upper_sid < y->upper_sid);
+}
+
+/*
+ * A max heap of ranges, ordered by sid_id. Since sid records are pushed
+ * onto the front of their subnet's list, a higher sid_id wins.
+ */
+static void
+heap_push(op_ppath_sid_range_t *heap, uint32 *n, op_ppath_sid_range_t *range)
+{
+	uint32 i = (*n)++;
+
+	while (i && heap[(i-1)/2].sid_id < range->sid_id) {
+		heap[i] = heap[(i-1)/2];
+		i = (i-1)/2;
+	}
+	heap[i] = *range;
+}
+
+static void
+heap_pop(op_ppath_sid_range_t *heap, uint32 *n)
+{
+	uint32 i = 0, c;
+	op_ppath_sid_range_t last = heap[--(*n)];
+
+	while ((c = 2*i+1) < *n) {
+		if (c+1 < *n && heap[c+1].sid_id > heap[c].sid_id) c++;
+		if (heap[c].sid_id <= last.sid_id) break;
+		heap[i] = heap[c];
+		i = c;
+	}
+	heap[i] = last;
+}
+
+/*
+ * Flattens the sid list of one subnet into disjoint, sorted ranges,
+ * appended to the end of the range table. Sweeps the boundaries of the
+ * sid ranges in order, keeping the ranges that cover the current SID
+ * in a heap. Ranges that have ended are only dropped when they reach
+ * the top of the heap.
+ */
+static void
+build_sid_ranges(op_ppath_writer_t *w, op_ppath_subnet_record_t *subnet)
+{
+	op_ppath_reader_t *r = &(w->unpublished);
+	op_ppath_sid_range_t *starts = w->sid_work;
+	op_ppath_sid_range_t *ends = starts + w->max_sids + 1;
+	op_ppath_sid_range_t *heap = ends + w->max_sids + 1;
+	op_ppath_sid_range_t *out;
+	uint32 count = 0, s = 0, e = 0, heap_count = 0;
+	uint32 i;
+	uint64 sid;
+
+	for (i = subnet->first_sid; i; i = r->sid_table[i].next) {
+		uint64 ho_lower_sid = ntoh64(r->sid_table[i].lower_sid);
+		uint64 ho_upper_sid = ntoh64(r->sid_table[i].upper_sid);
+
+		// An upper sid of zero means an exact match.
+		if (ho_upper_sid == 0) ho_upper_sid = ho_lower_sid;
+		if (ho_lower_sid == 0 || ho_upper_sid < ho_lower_sid) continue;
+
+		starts[count].lower_sid = ho_lower_sid;
+		starts[count].upper_sid = ho_upper_sid;
+		starts[count].sid_id = i;
+		starts[count].reserved = 0;
+		count++;
+	}
+
+	subnet->first_range = r->subnet_table->range_count;
+	subnet->range_count = 0;
+	if (!count) return;
+
+	memcpy(ends, starts, count * sizeof(op_ppath_sid_range_t));
+	qsort(starts, count, sizeof(op_ppath_sid_range_t), cmp_range_lower);
+	qsort(ends, count, sizeof(op_ppath_sid_range_t), cmp_range_upper);
+
+	out = &(r->sid_ranges[subnet->first_range]);
+	sid = starts[0].lower_sid;
+	for (;;) {
+		uint64 next = 0;
+		int more = 0;
+
+		while (s < count && starts[s].lower_sid == sid)
+			heap_push(heap, &heap_count, &starts[s++]);
+		while (e < count && ends[e].upper_sid < sid)
+			e++;
+		while (heap_count && heap[0].upper_sid < sid)
+			heap_pop(heap, &heap_count);
+
+		// The next boundary is the next start, or the SID after an end.
+		if (s < count) {
+			next = starts[s].lower_sid;
+			more = 1;
+		}
+		if (e < count && ends[e].upper_sid != ~0ULL &&
+			(!more || ends[e].upper_sid + 1 < next)) {
+			next = ends[e].upper_sid + 1;
+			more = 1;
+		}
+
+		if (heap_count) {
+			uint64 upper = more ? next - 1 : ~0ULL;
+			if (subnet->range_count &&
+				out[subnet->range_count-1].sid_id == heap[0].sid_id &&
+				out[subnet->range_count-1].upper_sid + 1 == sid) {
+				out[subnet->range_count-1].upper_sid = upper;
+			} else {
+				out[subnet->range_count].lower_sid = sid;
+				out[subnet->range_count].upper_sid = upper;
+				out[subnet->range_count].sid_id = heap[0].sid_id;
+				out[subnet->range_count].reserved = 0;
+				subnet->range_count++;
+			}
+		}
+
+		if (!more) break;
+		sid = next;
+	}
+
+	r->subnet_table->range_count += subnet->range_count;
+}
+
+/*
+ * Rebuilds the range table after sid records have been added.
+ */
+static void
+build_all_sid_ranges(op_ppath_writer_t *w)
+{
+	op_ppath_reader_t *r = &(w->unpublished);
+	uint32 i;
+
+	r->subnet_table->range_count = 0;
+	for (i=1; i <= r->subnet_table->subnet_count; i++)
+		build_sid_ranges(w, &(r->subnet_table->subnet[i]));
+
+	w->sid_ranges_dirty = 0;
+}
+
+/*
+ * Returns the sid record matching a (host order) SID in the subnet, or 
+ * 0 if there is none. Binary searches for the first range that does not
+ * end below the SID.
+ */
+static uint32
+match_sid(op_ppath_sid_range_t *ranges, op_ppath_subnet_record_t *subnet, 
+		  uint64 ho_sid)
+{
+	op_ppath_sid_range_t *range = &(ranges[subnet->first_range]);
+	uint32 lo = 0, hi = subnet->range_count;
+
+	if (ho_sid == 0) return subnet->zero_sid;
+
+	while (lo < hi) {
+		uint32 mid = lo + (hi - lo) / 2;
+		if (range[mid].upper_sid < ho_sid)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo < subnet->range_count && range[lo].lower_sid <= ho_sid)
+		return range[lo].sid_id;
+
+	return 0;
+}
+
 /*
  * Adds a virtual fabric to the unpublished vfab table.
  *
@@ -871,6 +1269,12 @@ int op_ppath_add_vfab(op_ppath_writer_t *w,
 		goto error;
 	}
 
+	if (w->sealed & (1 << VFAB_TABLE)) {
+		_DBG_WARN("Trying to add to a published vfab table.\n");
+		errno = EROFS;
+		goto error;
+	}
+
 	if (r->vfab_table->count >= w->max_vfabs) {
 		errno = ENOMEM;
 		goto error;
@@ -906,12 +1310,11 @@ int op_ppath_add_path(op_ppath_writer_t *w, IB_PATH_RECORD_NO *record)
 	
 	uint64 ho_sid;
 
-	uint32 lid_hash;
-	uint32 guid_hash;
+	uint64 guid_hash;
+	uint32 slot;
 
 	op_ppath_reader_t *r = &(w->unpublished);
 	op_ppath_subnet_record_t *subnet;
-	op_ppath_vfab_record_t *vfab;
 	op_ppath_sid_record_t *sid;
 	op_ppath_record_t *path;
 
@@ -922,43 +1325,36 @@ int op_ppath_add_path(op_ppath_writer_t *w, IB_PATH_RECORD_NO *record)
 		goto error;
 	}
 
-	for (i=1; i <= r->subnet_table->subnet_count; i++) {
-		if (r->subnet_table->subnet[i].source_prefix == record->SGID.Type.Global.SubnetPrefix)
-			break;
-	}
-	if (i > r->subnet_table->subnet_count) {
-		_DBG_WARN("Trying to add a path without a matching subnet.\n");
-		errno = EINVAL;
+	if (w->sealed & (1 << PATH_TABLE)) {
+		_DBG_WARN("Trying to add to a published path table.\n");
+		errno = EROFS;
 		goto error;
 	}
 
-	subnet = &(r->subnet_table->subnet[i]);
-
-	ho_sid = ntoh64(record->ServiceID);
-	i = subnet->first_sid;
-	while (i) {
-		uint64 ho_lower_sid;
-		uint64 ho_upper_sid;
+	// Paths tend to arrive grouped by subnet.
+	i = w->last_subnet;
+	if (!i || i > r->subnet_table->subnet_count ||
+		r->subnet_table->subnet[i].source_prefix != record->SGID.Type.Global.SubnetPrefix) {
+		for (i=1; i <= r->subnet_table->subnet_count; i++) {
+			if (r->subnet_table->subnet[i].source_prefix == record->SGID.Type.Global.SubnetPrefix)
+				break;
+		}
+		if (i > r->subnet_table->subnet_count) {
+			_DBG_WARN("Trying to add a path without a matching subnet.\n");
+			errno = EINVAL;
+			goto error;
+		}
+		w->last_subnet = i;
+	}
 
-		sid = &(r->sid_table[i]);
-		ho_lower_sid = ntoh64(sid->lower_sid);
-		ho_upper_sid = ntoh64(sid->upper_sid);
+	subnet = &(r->subnet_table->subnet[i]);
 
-		if (ho_lower_sid == 0 && ho_sid == 0) {
-			// Adding with a blank sid. Add to the default.
-			break;
-		} else if (ho_upper_sid == 0 && ho_sid == ho_lower_sid) {
-			// Exact match.
-			break;
-		} else if (ho_lower_sid != 0 && 
-				   ho_sid >= ho_lower_sid && 
-				   ho_sid <= ho_upper_sid) {
-			// Matches range.
-			break;
-		}
+	if (w->sid_ranges_dirty)
+		build_all_sid_ranges(w);
 
-		i = sid->next;
-	}
+	ho_sid = ntoh64(record->ServiceID);
+	i = match_sid(r->sid_ranges, subnet, ho_sid);
+	sid = &(r->sid_table[i]);
 
 	if (!i) {
 		_DBG_WARN("Trying to add a path without a matching virtual fabric.\n");
@@ -966,8 +1362,6 @@ int op_ppath_add_path(op_ppath_writer_t *w, IB_PATH_RECORD_NO *record)
 		goto error;
 	}
 
-	vfab = &(r->vfab_table->vfab[sid->vfab_id]);
-
 	if (r->path_table->count >= w->max_paths) {
 		errno = ENOMEM;
 		goto error;
@@ -977,16 +1371,23 @@ int op_ppath_add_path(op_ppath_writer_t *w, IB_PATH_RECORD_NO *record)
 	i = ++r->path_table->count;
 	r->path_table->table[i].path=(*record);
 	r->path_table->table[i].flags=1;
+	r->path_table->table[i].vfab_id=sid->vfab_id;
 	path = &(r->path_table->table[i]);
 	
-	guid_hash = GID_HASH(&(record->DGID));
-	lid_hash = LID_HASH(record->DLID);
-
-	path->next_lid = vfab->first_dlid[lid_hash];
-	path->next_guid = vfab->first_dguid[guid_hash];
-
-	vfab->first_dlid[lid_hash] = i;
-	vfab->first_dguid[guid_hash] = i;
+	slot = lid_hash(sid->vfab_id, record->DLID) & r->lid_heads_mask;
+	path->next_lid = r->lid_heads[slot];
+	r->lid_heads[slot] = i;
+
+	// Linear probe for a free slot. The index is at least twice the
+	// size of the path table, so there is always one.
+	guid_hash = gid_hash(sid->vfab_id, &(record->SGID), &(record->DGID));
+	slot = (uint32)guid_hash & r->gid_index_mask;
+	while (r->gid_index[slot].path)
+		slot = (slot + 1) & r->gid_index_mask;
+
+	r->gid_index[slot].vfab_id = sid->vfab_id;
+	r->gid_index[slot].tag = (uint32)(guid_hash >> 32);
+	r->gid_index[slot].path = i;
 	
 	_DBG_FUNC_EXIT;
 	return 0;
@@ -1000,48 +1401,43 @@ void
 op_ppath_publish(op_ppath_writer_t *w)
 {
 	_DBG_FUNC_ENTRY;
-	op_ppath_shared_table_t *published = w->published.shared_table;
-	op_ppath_shared_table_t *unpublished = w->unpublished.shared_table;
+	op_ppath_shared_table_t *shared = w->published.shared_table;
+	op_ppath_generation_t *published = w->published.tables;
+	op_ppath_generation_t *unpublished = w->unpublished.tables;
+	uint32 next = shared->generation + 1;
+	op_ppath_generation_t *slot = &(shared->gen[next & 1]);
 
-	if (published->port_update_count != unpublished->port_update_count) {
+	if (published->port_update_count != unpublished->port_update_count)
 		_DBG_INFO("Publishing updated port table.\n");
-		close_ppath_table(&w->published, PORT_TABLE);
-		shm_unlink(published->port_table_name);
-		strcpy(published->port_table_name,
-				unpublished->port_table_name);
-	}
-	if (published->subnet_update_count != unpublished->subnet_update_count) {
+	if (published->subnet_update_count != unpublished->subnet_update_count)
 		_DBG_INFO("Publishing updated subnet table.\n");
-		close_ppath_table(&w->published, SUBNET_TABLE);
-		shm_unlink(published->subnet_table_name);
-		strcpy(published->subnet_table_name,
-				unpublished->subnet_table_name);
-	}
-	if (published->vfab_update_count != unpublished->vfab_update_count) {
+	if (published->vfab_update_count != unpublished->vfab_update_count)
 		_DBG_INFO("Publishing updated vfab table.\n");
-		close_ppath_table(&w->published, VFAB_TABLE);
-		shm_unlink(published->vfab_table_name);
-		strcpy(published->vfab_table_name,
-				unpublished->vfab_table_name);
-	}
-	if (published->path_update_count != unpublished->path_update_count) {
+	if (published->path_update_count != unpublished->path_update_count)
 		_DBG_INFO("Publishing updated path table.\n");
-		close_ppath_table(&w->published, PATH_TABLE);
-		shm_unlink(published->path_table_name);
-		strcpy(published->path_table_name,
-				unpublished->path_table_name);
-	}
+
+	if (w->sid_ranges_dirty && !(w->sealed & (1 << SUBNET_TABLE)))
+		build_all_sid_ranges(w);
+
+	/*
+	 * The slot we are about to fill names the generation before the 
+	 * current one. Clients have had a full publish cycle to move off
+	 * of it, so its tables can go, except for any that are still in use.
+	 */
+	unlink_generation(slot, published, unpublished);
+	*slot = *unpublished;
 
 	/* 
-	 * We do these last to try to minimize the risk that a client
- 	 * will see the update before it has finished. Updating the names
-	 * without updating the counters is safe, because active clients
-	 * only look at the counts for changes.
+	 * The generation record must be complete before a client can 
+	 * see the new generation. After this store, every table named by
+	 * the new generation is read-only.
 	 */
-	published->port_update_count = unpublished->port_update_count;
-	published->subnet_update_count = unpublished->subnet_update_count;
-	published->vfab_update_count = unpublished->vfab_update_count;
-	published->path_update_count = unpublished->path_update_count;
+	__sync_synchronize();
+	shared->generation = next;
+
+	w->published.tables = slot;
+	w->sealed = (1 << PORT_TABLE) | (1 << PATH_TABLE) |
+				(1 << SUBNET_TABLE) | (1 << VFAB_TABLE);
 
 	_DBG_FUNC_EXIT;
 }
@@ -1096,14 +1492,50 @@ cmp_rec(uint64 mask, IB_PATH_RECORD_NO *a, IB_PATH_RECORD_NO *b)
 #endif
 
 /*
- * These functions check to see if the update count of the named table has been changed.
+ * Looks up the port table index of a source port, first in the reader's
+ * direct-mapped cache and then by scanning the table.
  *
- * Returns true if a re-open is needed.
+ * Returns 0 if there is no matching port.
  */
-static inline int validate_port_table(op_ppath_reader_t *r) { return (r->old_port_update_count != r->shared_table->port_update_count); }
-static inline int validate_path_table(op_ppath_reader_t *r) { return (r->old_path_update_count != r->shared_table->path_update_count); }
-static inline int validate_vfab_table(op_ppath_reader_t *r) { return (r->old_vfab_update_count != r->shared_table->vfab_update_count); }
-static inline int validate_subnet_table(op_ppath_reader_t *r) { return (r->old_subnet_update_count != r->shared_table->subnet_update_count); }
+static uint32
+find_port_by_guid(op_ppath_reader_t *r, uint64 guid)
+{
+	uint32 slot = (uint32)(gid_hash_mix(0, guid) >> 40) & PORT_INDEX_MASK;
+	uint32 p = r->guid_port_index[slot];
+
+	if (p && p <= r->port_table->count &&
+		r->port_table->port[p].source_guid == guid)
+		return p;
+
+	for (p=1;p<=r->port_table->count;p++) {
+		if (r->port_table->port[p].source_guid == guid) {
+			r->guid_port_index[slot] = p;
+			return p;
+		}
+	}
+	return 0;
+}
+
+static uint32
+find_port_by_lid(op_ppath_reader_t *r, char *hfi_name, uint16 lid)
+{
+	uint32 slot = lid & PORT_INDEX_MASK;
+	uint32 p = r->lid_port_index[slot];
+
+	if (p && p <= r->port_table->count &&
+		r->port_table->port[p].base_lid == (lid & lmc_mask[r->port_table->port[p].lmc]) &&
+		!strcmp(r->port_table->port[p].hfi_name,hfi_name))
+		return p;
+
+	for (p=1;p<=r->port_table->count;p++) {
+		uint16_t base_lid = lid & lmc_mask[r->port_table->port[p].lmc];
+		if (r->port_table->port[p].base_lid == base_lid && !strcmp(r->port_table->port[p].hfi_name,hfi_name)) {
+			r->lid_port_index[slot] = p;
+			return p;
+		}
+	}
+	return 0;
+}
 
 int op_ppath_find_path(op_ppath_reader_t *r, 
 					   char *hfi_name,
@@ -1113,14 +1545,13 @@ int op_ppath_find_path(op_ppath_reader_t *r,
 					   IB_PATH_RECORD_NO *result)
 {
 	int err=0;
-	int retries;
 	int gidquery = 0;
 	int valid = 0;
 	uint32 p;
 	op_ppath_port_record_t *port_record;
 	op_ppath_sid_record_t *sid_record;
-	op_ppath_vfab_record_t *vfab;
 	op_ppath_record_t *path_record = NULL;
+	uint32 vfab_id;
 	uint64 ho_sid;
 
 
@@ -1156,215 +1587,150 @@ int op_ppath_find_path(op_ppath_reader_t *r,
 	}
 
 	memset(result,0,sizeof(IB_PATH_RECORD_NO));
-	retries = 0;
-	do {
-		// Yield the processor so that, if an update is underway,
-		// it will have a chance to finish before we try to read the tables.
-		sched_yield(); 
-	
-		retries++;
-		
-		err=0;
-
-		// Find the correct port. If the port table changed,
-		// begin the query over again.
-		if (validate_port_table(r)) {
-			_DBG_DEBUG("Reloading the port table.\n");
-			err = reopen_ppath_table(r, PORT_TABLE, O_RDONLY, 0, 0);
-			if (err) goto error;
-			continue; // NOTE THE CONTINUE!
-		}
 
-		if (mask & IB_PATH_RECORD_COMP_SGID) {
-			_DBG_DEBUG("Identifying port by source gid.\n");
-			for (p=1;p<=r->port_table->count;p++) {
-				if (r->port_table->port[p].source_guid == query->SGID.Type.Global.InterfaceID)
-					break;
-			}
-		} else if (hfi_name && hfi_name[0] !=0) {
-			uint16_t lid = ntohs(query->SLID);
-			_DBG_DEBUG("Identifying port by hfi and source lid.\n");
-			for (p=1;p<=r->port_table->count;p++) {
-				uint16_t base_lid = lid & lmc_mask[r->port_table->port[p].lmc];
-				if (r->port_table->port[p].base_lid == base_lid && !strcmp(r->port_table->port[p].hfi_name,hfi_name))
-					break;
+	// Switch to the tables of the latest generation. Published tables
+	// never change, so once they are open the query needs no locking
+	// and never has to be repeated.
+	if (read_generation(r) != r->old_generation) {
+		err = refresh_generation(r);
+		if (err) goto error;
+	}
+
+	// Find the correct port.
+	if (mask & IB_PATH_RECORD_COMP_SGID) {
+		_DBG_DEBUG("Identifying port by source gid.\n");
+		p = find_port_by_guid(r, query->SGID.Type.Global.InterfaceID);
+	} else if (hfi_name && hfi_name[0] !=0) {
+		_DBG_DEBUG("Identifying port by hfi and source lid.\n");
+		p = find_port_by_lid(r, hfi_name, ntohs(query->SLID));
+	} else {
+		_DBG_INFO("Attempt to query a path without specifying HFI + Port or source gid.\n");
+		err = EINVAL;
+		goto error;
+	}
+
+	if (!p) {
+		_DBG_INFO("Could not find a matching port.\n");
+		err = EINVAL;
+		goto error;
+	}
+
+	port_record = &(r->port_table->port[p]);
+
+	if (mask & IB_PATH_RECORD_COMP_PKEY) {
+		// verify that the pkey is valid for this port.
+		_DBG_DEBUG("Validating the pkey against the port.\n");
+		for (p=0; p<PKEY_TABLE_LENGTH && port_record->pkey[p] != 0; p++) {
+			if ((query->P_Key&0x0080) && 
+				(port_record->pkey[p] == query->P_Key)) {
+				/* Looking for a full-membership path. */
+				break;
+			} else if ((port_record->pkey[p]&0xff7f) == query->P_Key) { 
+				/* Looking for a limited membership path. */
+				break;
 			}
-		} else {
-			_DBG_INFO("Attempt to query a path without specifying HFI + Port or source gid.\n");
+		}
+		if (p >= PKEY_TABLE_LENGTH || port_record->pkey[p] == 0) {
+			_DBG_INFO("Port is not a member of the specified partition.\n");
 			err = EINVAL;
 			goto error;
 		}
-
-		if (p>r->port_table->count) {
-			_DBG_INFO("Could not find a matching port.\n");
+	} 
+
+	p=port_record->subnet_id;
+
+	if (mask & IB_PATH_RECORD_COMP_PKEY) {
+		// Match the pkey to a virtual fabric.
+		_DBG_DEBUG("Using the pkey to identify the virtual fabric.\n");
+		for (p=1; p<=r->vfab_table->count; p++) {
+			// The VFab may or may not have the membership bit set.
+			// This is not a bug.
+			if ((r->vfab_table->vfab[p].source_prefix == 
+					port_record->source_prefix) &&
+				(r->vfab_table->vfab[p].pkey & 0xff7f) ==
+					(query->P_Key & 0xff7f) )
+				break;
+		}
+		if (p > r->vfab_table->count) {
+			_DBG_INFO("Could not find a matching pkey.\n");
 			err = EINVAL;
 			goto error;
 		}
-
-		port_record = &(r->port_table->port[p]);
-
-		if (mask & IB_PATH_RECORD_COMP_PKEY) {
-			// verify that the pkey is valid for this port.
-			_DBG_DEBUG("Validating the pkey against the port.\n");
-			for (p=0; p<PKEY_TABLE_LENGTH && port_record->pkey[p] != 0; p++) {
-				if ((query->P_Key&0x0080) && 
-					(port_record->pkey[p] == query->P_Key)) {
-					/* Looking for a full-membership path. */
-					break;
-				} else if ((port_record->pkey[p]&0xff7f) == query->P_Key) { 
-					/* Looking for a limited membership path. */
-					break;
-				}
-			}
-			if (p >= PKEY_TABLE_LENGTH || port_record->pkey[p] == 0) {
-				_DBG_INFO("Port is not a member of the specified partition.\n");
-				err = EINVAL;
-				goto error;
-			}
-		} 
-
-		// Validate the subnet table. If the table is invalid, re-open it, 
-		// then retry the whole query.
-		p=port_record->subnet_id;
-		if (validate_subnet_table(r)) {
-			_DBG_DEBUG("Reloading the subnet table.\n");
-			err = reopen_ppath_table(r, SUBNET_TABLE, O_RDONLY, 0, 0);
-			if (err) goto error;
-			continue; // NOTE THE CONTINUE!
+	} else {
+		op_ppath_subnet_record_t *subnet = &(r->subnet_table->subnet[p]);
+
+		// Find the sid. If we can't find it, fall back
+		// to the default.
+		p = match_sid(r->sid_ranges, subnet, ho_sid);
+		if (!p) {
+			// Didn't find a good match, use the default.
+			p = subnet->default_sid;
 		}
-
-		// Validate the vfabric. 
-		if (validate_vfab_table(r)) {
-			_DBG_DEBUG("Reloading the fabric table.\n");
-			err = reopen_ppath_table(r, VFAB_TABLE, O_RDONLY, 0, 0);
-			if (err) goto error;
-			continue; // NOTE THE CONTINUE!
+		sid_record = &(r->sid_table[p]);
+		if (!p) {
+			_DBG_INFO("Failed to match query to any sid.\n");
+			err = EINVAL;
+			goto error;
 		}
 
-		if (mask & IB_PATH_RECORD_COMP_PKEY) {
-			// Match the pkey to a virtual fabric.
-			_DBG_DEBUG("Using the pkey to identify the virtual fabric.\n");
-			for (p=1; p<=r->vfab_table->count; p++) {
-				// The VFab may or may not have the membership bit set.
-				// This is not a bug.
-				if ((r->vfab_table->vfab[p].source_prefix == 
-						port_record->source_prefix) &&
-					(r->vfab_table->vfab[p].pkey & 0xff7f) ==
-						(query->P_Key & 0xff7f) )
-					break;
-			}
-			if (p > r->vfab_table->count) {
-				_DBG_INFO("Could not find a matching pkey.\n");
-				err = EINVAL;
-				goto error;
-			}
-		} else {
-			uint32 def_sid = 0;
-			// Find the sid. As before, if we can't find it
-			// re-try the whole query.
-			p = r->subnet_table->subnet[p].first_sid;
-			while (p) {
-				uint64 ho_lower_sid;
-				uint64 ho_upper_sid;
-				sid_record = &(r->sid_table[p]);
-				ho_lower_sid = ntoh64(sid_record->lower_sid);
-				ho_upper_sid = ntoh64(sid_record->upper_sid);
-
-				// Flag the default vfab when we find it.
-				if (ho_lower_sid == 0) def_sid = p;
-
-				if (ho_lower_sid == 0 && ho_sid == 0) {
-					// Queried with a blank sid. Return the default.
-					break;
-				} else if (ho_upper_sid == 0 && ho_sid == ho_lower_sid) {
-					// Exact match.
-					break;
-				} else if (ho_lower_sid != 0 && 
-						   ho_sid >= ho_lower_sid && 
-						   ho_sid <= ho_upper_sid) {
+		p=sid_record->vfab_id;
+	}
+
+	vfab_id = p;
+
+	if (gidquery) {
+		uint64 hash = gid_hash(vfab_id, &(query->SGID), &(query->DGID));
+		uint32 tag = (uint32)(hash >> 32);
+		uint32 slot = (uint32)hash & r->gid_index_mask;
+		op_ppath_gid_slot_t *s;
+
+		// Probe until we hit an empty slot. Only slots whose tag
+		// and vfab both match need the full record compare.
+		while ((s = &(r->gid_index[slot]))->path) {
+			if (s->tag == tag && s->vfab_id == vfab_id) {
+				path_record = &(r->path_table->table[s->path]);
+				if (!memcmp((void*)&(query->SGID), 
+						(void*)&(path_record->path.SGID), 
+						sizeof(IB_GID_NO)) &&
+					!memcmp((void*)&(query->DGID), 
+						(void*)&(path_record->path.DGID), 
+						sizeof(IB_GID_NO)) &&
+					((!(mask & IB_PATH_RECORD_COMP_PKEY)) || 
+						((path_record->path.P_Key&0xff7f) == (query->P_Key&0xff7f)))) {
+					_DBG_DEBUG("gid match found.\n");
+					valid = 1;
 					break;
 				}
-				p = sid_record->next;
-			}
-			if (!p) {
-				// Didn't find a good match, use the default.
-				p = def_sid;
-				sid_record = &(r->sid_table[p]);
-			}
-			if (!p) {
-				_DBG_INFO("Failed to match query to any sid.\n");
-				err = EINVAL;
-				goto error;
 			}
-
-			p=sid_record->vfab_id;
-		}
-
-		vfab = &(r->vfab_table->vfab[p]);
-
-		if (validate_path_table(r)) {
-			_DBG_DEBUG("Reloading the path table.\n");
-			err = reopen_ppath_table(r, PATH_TABLE, O_RDONLY, 0, 0);
-			continue; // NOTE THE CONTINUE!
+			slot = (slot + 1) & r->gid_index_mask;
 		}
-
-		// what's the first path to look at?
-		if (gidquery) {
-			p = vfab->first_dguid[GID_HASH(&(query->DGID))];
-		} else {
-			p = vfab->first_dlid[LID_HASH(query->DLID)];
-		}
-
+	} else {
 		// At this point, we should be looking at a short list of paths.
-		// These paths will be on the correct subnet and vfabric,
-		// so we only check the lids. If we get out of this while loop
-		// with a hit, break out of the outer while loop, too.
+		// These paths will be on the correct subnet, so we only check
+		// the vfabric and the lids.
+		p = r->lid_heads[lid_hash(vfab_id, query->DLID) & r->lid_heads_mask];
 		while (p) {
 			path_record = &(r->path_table->table[p]);
 
 			/*
-			 * These if statements are hairy, so here's the logic:
-			 *
-			 * If we are doing a gidquery and the gids match and 
-			 * EITHER the pkey matches OR we are not doing pkey queries
-			 * then we have a match.
-			 * 
-			 * else, if we are NOT doing a gidquery and the LIDs match and
-			 * EITHER the pkey matches OR we are not doing pkey queries
-			 * then we have a match.
+			 * If the vfabric and LIDs match and EITHER the pkey matches 
+			 * OR we are not doing pkey queries then we have a match.
 			 */
-			if (gidquery && 
-				!memcmp((void*)&(query->SGID), 
-					   (void*)&(path_record->path.SGID), 
-					   sizeof(IB_GID_NO)) &&
-				!memcmp((void*)&(query->DGID), 
-					   (void*)&(path_record->path.DGID), 
-					   sizeof(IB_GID_NO)) &&
-        		((!(mask & IB_PATH_RECORD_COMP_PKEY)) || 
-					((path_record->path.P_Key&0xff7f) == (query->P_Key&0xff7f)))) {
-				_DBG_DEBUG("gid match found.\n");
-				valid = 1;
-				break;
-			} else if (!gidquery && 
+			if (path_record->vfab_id == vfab_id &&
 				query->SLID == path_record->path.SLID && 
 				query->DLID == path_record->path.DLID &&
-        		((!(mask & IB_PATH_RECORD_COMP_PKEY)) || 
+				((!(mask & IB_PATH_RECORD_COMP_PKEY)) || 
 					((path_record->path.P_Key&0xff7f) == (query->P_Key&0xff7f)))) {
 				_DBG_DEBUG("lid match found.\n");
 				valid = 1;
 				break;
 			}
-			if (gidquery) {
-				p = path_record->next_guid;
-			} else {
-				p = path_record->next_lid;
-			}
+			p = path_record->next_lid;
 		}
-		
-		// One last sanity check.
-		if (valid && path_record->flags ==0) valid = 0;
-
-	} while (!valid && (retries <= MAX_RETRIES));
+	}
+	
+	// One last sanity check.
+	if (valid && path_record->flags ==0) valid = 0;
 
 	if (valid) {
 		*result = path_record->path;
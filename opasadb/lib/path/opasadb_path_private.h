@@ -32,7 +32,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #if !defined(_OPA_SA_DB_PATH_PRIVATE_H)
 
 #define _OPA_SA_DB_PATH_PRIVATE_H
-#define OPA_SA_DB_PATH_TABLE_VERSION 3
+#define OPA_SA_DB_PATH_TABLE_VERSION 6
 
 #include <linux/types.h>
 #include <iba/ibt.h>
@@ -84,54 +84,70 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define PORT_TABLE_NAME "_PORT_"
 #define PATH_TABLE_NAME "_PATH_"
 
-// Must be a power of 2 and (HASH_TABLE_MASK-1), respectively.
-//#define HASH_TABLE_SIZE 16384
-//#define HASH_TABLE_MASK 16383
-// These are for developer testing only.
-#define HASH_TABLE_SIZE 4096
-#define HASH_TABLE_MASK 4095
-
 // How many times to retry a path query before giving up.
 #define MAX_RETRIES 5
 
+// Size of the reader's direct-mapped source port caches. Must be a power of 2.
+#define PORT_INDEX_SIZE 64
+#define PORT_INDEX_MASK (PORT_INDEX_SIZE-1)
+
 /*
- * op_ppath_shared_table_t
+ * op_ppath_generation_t
  *
- * abi_version		- used to detect collisions between different versions
  * XX_update_count	- allows clients to detect when the published data has
  *					  changed.
  * XX_table_name	- the name of the shared memory object containing
  *					  the named table.
  *
+ * One published set of tables. Tables that were not re-initialized 
+ * between two publishes are shared by both generations.
+ */
+typedef struct {
+	uint32 	port_update_count;
+	uint32 	subnet_update_count;
+	uint32 	vfab_update_count;
+	uint32 	path_update_count;
+
+	char	port_table_name[SHM_NAME_LENGTH];
+	char	subnet_table_name[SHM_NAME_LENGTH];
+	char	vfab_table_name[SHM_NAME_LENGTH];
+	char	path_table_name[SHM_NAME_LENGTH];
+} op_ppath_generation_t;
+
+/*
+ * op_ppath_shared_table_t
+ *
+ * abi_version		- used to detect collisions between different versions
+ * generation		- the current generation. gen[generation & 1] names
+ *					  the published tables.
+ * gen				- double buffer of generation records.
+ *
  * The shared memory model is designed to be lockless. This is done via
  * a "publish" model. The tables named in this structure are "published"
  * and will never change. They can, however, be replaced by new versions.
- * When that happens, the update_count is incremented. Clients cache
- * a copy of the update_count in local memory. When they notice that the
- * published number no longer matches their cached value, they close and
- * re-open the shared memory tables, allowing them to access the new
- * versions.
  *
- * In this way, even if the update count changes in the middle of a query,
- * the client can detect it an repeat the query.
+ * The writer builds each new generation into fresh shared memory objects,
+ * fills in the generation record that is not in use and then increments 
+ * generation, which flips readers over to the new set of tables in one 
+ * store. Clients cache the generation in local memory. When they notice 
+ * that it has changed, they re-open whichever tables have a new 
+ * update_count. Because published tables are never written, a client 
+ * that has the tables of one generation open always sees a consistent 
+ * snapshot, even if the writer publishes again in the middle of a query.
+ *
+ * The objects of a replaced generation are not unlinked until the 
+ * generation after next is published, so clients have a full publish 
+ * cycle to move over.
  * 
  * Note that an update_count of 0 has a special meaning - it means no data
  * has been published yet.
  */
 typedef struct {
 	uint32 	abi_version;
-
-	uint32 	port_update_count;
-	uint32 	subnet_update_count;
-	uint32 	vfab_update_count;
-	uint32 	path_update_count;
-
+	uint32 	generation;
 	uint64 	reserved;
 
-	char	port_table_name[SHM_NAME_LENGTH];
-	char	subnet_table_name[SHM_NAME_LENGTH];
-	char	vfab_table_name[SHM_NAME_LENGTH];
-	char	path_table_name[SHM_NAME_LENGTH];
+	op_ppath_generation_t gen[2];
 } op_ppath_shared_table_t;
 
 /* 
@@ -173,6 +189,10 @@ typedef struct {
 typedef struct {
 	uint64	source_prefix;
 	uint32	first_sid;
+	uint32	zero_sid;		// sid record for queries without a SID.
+	uint32	default_sid;	// sid record used when no range matches.
+	uint32	first_range;	// this subnet's slice of the range table.
+	uint32	range_count;
 	uint32	reserved;
 } op_ppath_subnet_record_t;
 
@@ -183,16 +203,37 @@ typedef struct {
 	uint32	next;
 } op_ppath_sid_record_t;
 
+/*
+ * The sid records of each subnet form a list, and the first record on
+ * the list that matches a SID wins. For lookups, that list is flattened
+ * into a sorted array of disjoint ranges, each naming the sid record
+ * that wins over it, which can be binary searched. Unlike the sid
+ * records, the ranges are in host byte order.
+ *
+ * Records with a lower_sid of 0 only match queries without a SID, so
+ * they are not in the range table. (See zero_sid and default_sid.)
+ */
+typedef struct {
+	uint64	lower_sid;
+	uint64	upper_sid;
+	uint32	sid_id;
+	uint32	reserved;
+} op_ppath_sid_range_t;
+
 typedef struct {
 	uint32	subnet_size;
 	uint32	sid_size;
 	uint32	subnet_count;
 	uint32	sid_count;
+	uint32	max_sids;
+	uint32	range_count;
 	op_ppath_subnet_record_t subnet[];
-	// op_ppath_sid_record_t sid[];
+	// op_ppath_sid_record_t sid[max_sids+1];
+	// op_ppath_sid_range_t range[2*max_sids+1];
 } op_ppath_subnet_table_t;
 
-#define SID_TABLE_SIZE(ss) (sizeof(op_ppath_sid_record_t)*(ss+1))
+// n sid records split the SID space into at most 2n-1 ranges.
+#define SID_TABLE_SIZE(ss) (sizeof(op_ppath_sid_record_t)*(ss+1) + sizeof(op_ppath_sid_range_t)*(2*(ss)+1))
 #define SUBNET_TABLE_SIZE(fs) (sizeof(op_ppath_subnet_table_t)+sizeof(op_ppath_subnet_record_t)*(fs+1))
 
 typedef struct {
@@ -200,8 +241,6 @@ typedef struct {
 	uint64	source_prefix;
 	uint16	pkey;
 	uint16	sl;
-	uint32	first_dlid[HASH_TABLE_SIZE];
-	uint32	first_dguid[HASH_TABLE_SIZE];
 } op_ppath_vfab_record_t;
 	
 typedef struct {
@@ -217,21 +256,42 @@ typedef struct {
 typedef struct {
 	IB_PATH_RECORD_NO 	path;
 	uint32				flags; // if 0, this record is unused. 
-	uint32				reserved;
-	uint32 				next_guid; 	
+	uint32				vfab_id;
 	uint32				next_lid;  	
 } __attribute__((packed)) op_ppath_record_t;
 
+/*
+ * GID lookups go through an open-addressed index appended to the end
+ * of the path table (in the same way the sid table follows the subnet
+ * table). Each slot names a path record, the virtual fabric it was
+ * sorted into and the upper 32 bits of its hash, so most probes are
+ * resolved without touching the path record itself. A path of 0 marks
+ * an empty slot. The index is sized to at least twice the number of
+ * paths, so it can never fill and probe sequences stay short.
+ *
+ * LID lookups use chains through next_lid. The chain heads, hashed by
+ * virtual fabric and DLID, follow the GID index. There are index_slots/2
+ * of them. Keeping all of the indexes in the path table means that
+ * adding paths never writes to any other table.
+ */
+typedef struct {
+	uint32				path;
+	uint32				vfab_id;
+	uint32				tag;
+} op_ppath_gid_slot_t;
 
 typedef struct {
 	uint32				size; 
-	uint32				reserved;
+	uint32				index_size;
 	uint32				count; 
-	uint32				reserved2;
+	uint32				index_slots;
 	op_ppath_record_t	table[];
+	// op_ppath_gid_slot_t gid_index[index_slots];
+	// uint32 lid_heads[index_slots/2];
 } __attribute__((packed)) op_ppath_table_t;
 
 #define PATH_TABLE_SIZE(ps) (sizeof(op_ppath_table_t)+sizeof(op_ppath_record_t)*(ps+1))
+#define PATH_INDEX_SIZE(slots) (sizeof(op_ppath_gid_slot_t)*(slots)+sizeof(uint32)*((slots)/2))
 
 
 /*
@@ -242,11 +302,17 @@ typedef struct {
 
 typedef struct {
 	op_ppath_shared_table_t *shared_table; 
+	op_ppath_generation_t	*tables; // The generation record in use.
 	op_ppath_port_table_t	*port_table;   
 	op_ppath_subnet_table_t	*subnet_table;
 	op_ppath_vfab_table_t	*vfab_table;     
 	op_ppath_sid_record_t	*sid_table; // Actually points into port_table mem.
+	op_ppath_sid_range_t	*sid_ranges; // Ditto.
 	op_ppath_table_t		*path_table;   
+	op_ppath_gid_slot_t		*gid_index; // Actually points into path_table mem.
+	uint32					*lid_heads; // Ditto.
+	uint32					gid_index_mask;
+	uint32					lid_heads_mask;
 
 	// file descriptors for mmapped data.
 	int						shared_fd; 	 
@@ -256,10 +322,17 @@ typedef struct {
 	int						path_fd;
 
 	// Compared with the versions in shared_table to detect updates.
+	uint32					old_generation;
 	uint32 					old_port_update_count;
 	uint32 					old_subnet_update_count;
 	uint32 					old_vfab_update_count;
 	uint32 					old_path_update_count;
+
+	// Direct-mapped caches of port table indexes, keyed by source GUID
+	// and by source LID. Entries are checked against the port table on
+	// use and cleared whenever the port table is re-opened.
+	uint32					guid_port_index[PORT_INDEX_SIZE];
+	uint32					lid_port_index[PORT_INDEX_SIZE];
 } op_ppath_reader_t;
 
 /*
@@ -329,6 +402,21 @@ typedef struct {
 	uint32				max_subnets;
 	uint32				max_vfabs;
 	uint32 				max_paths;  
+
+	/*
+	 * Tables that have been published and not re-initialized since.
+	 * Published tables are read-only. (Bitmask of 1<<table type.)
+	 */
+	uint32				sealed;
+
+	// Set when sid records have been added since the ranges were built.
+	int					sid_ranges_dirty;
+
+	// Scratch space for rebuilding the ranges. (3*(max_sids+1) entries.)
+	op_ppath_sid_range_t	*sid_work;
+
+	// The subnet of the last path added.
+	uint32				last_subnet;
 } op_ppath_writer_t;
 
 
@@ -33,6 +33,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdlib.h>
 #include <signal.h>
 #include <string.h>
+#include <time.h>
+#include <errno.h>
 #include <linux/types.h>
 #include <endian.h>
 #include <getopt.h>
@@ -40,27 +42,42 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <opasadb_debug.h>
 #include <arpa/inet.h>
 #include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include "dumppath.h"
 
 #define SLEEPTIME 1
 #define QUERIESPERPASS 100000
 #define DEFAULTPASSES 10
 
-#define MAXPATHS 32768
+#define INITIALPATHS 32768
 #define MAXPKEYS 32
 
 #define HFINAME "qib0"
 #define PORTNO  1
 
-static IB_PATH_RECORD_NO record[MAXPATHS];
+static IB_PATH_RECORD_NO *record;
 static uint16 pkey[MAXPKEYS];
-static int numrecs, numkeys;
+static int numrecs, maxrecs, numkeys;
 
 static char hfi_name[64] = HFINAME;
 static uint16 port_no = PORTNO;
 
 static int done=0;
 
+/* Stress mode fabric: every source port has a path to every destination */
+#define STRESS_PREFIX	0xfe80000000000000ULL
+#define STRESS_GUID		0x0011750101000001ULL
+#define STRESS_PORTS	16
+#define STRESS_BATCH	1000	// queries between checks of the clock
+
+static int stress_readers = 4;
+static int stress_secs = 3;
+static int stress_churn = 500;	// usecs between publishes, 0 for none
+static int stress_lid = 0;		// query by LIDs instead of GIDs
+static unsigned stress_dests = 2000;
+static int stress_paths_only = 0;	// republish only the path table
+
 static uint64_t build_comp_mask(IB_PATH_RECORD_NO path)
 {
     uint64_t mask = 0;
@@ -180,14 +197,33 @@ static int load_records(char *fname)
 	numrecs = 0;
 
 	do {
+		if (numrecs >= maxrecs) {
+			int n = maxrecs ? maxrecs * 2 : INITIALPATHS;
+			IB_PATH_RECORD_NO *p = realloc(record, n * sizeof(IB_PATH_RECORD_NO));
+			if (!p) {
+				_DBG_ERROR("No memory for %d records.\n", n);
+				break;
+			}
+			record = p;
+			maxrecs = n;
+		}
 		if (readrecord(f,&record[numrecs])) break;
 		numrecs++;
-	} while (numrecs < MAXPATHS);
+	} while (1);
 	fclose(f);
 
 	return numrecs;
 }
 
+static double elapsed(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) + 
+		   (now.tv_nsec - start->tv_nsec) / 1000000000.0;
+}
+
 static int find_pkeys(void)
 {
 	int i;
@@ -315,13 +351,16 @@ int server(char *fname, int n)
 	}
 	
 	for(pass = 0; pass < n && !done; pass++) {
+		struct timespec start;
+		double insert_time;
 
 		if (pass>0) my_sleep(SLEEPTIME);
 
 		_DBG_NOTICE("Pass %d: Inserting records.\n", pass);
+		clock_gettime(CLOCK_MONOTONIC, &start);
 
 		_DBG_NOTICE("Creating the path table.\n");
-		err = op_ppath_initialize_paths(&w, MAXPATHS);
+		err = op_ppath_initialize_paths(&w, numrecs);
 		if (err) {
 			_DBG_ERROR( "Failed to create path table: %s\n",
 					strerror(err));
@@ -335,9 +374,14 @@ int server(char *fname, int n)
 				goto error;
 			}
 		}
+		insert_time = elapsed(&start);
 		_DBG_NOTICE("Done inserting records.\n");
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
 		op_ppath_publish(&w);
 
+		printf("Pass %d: Inserted %d records in %.3f s, published in %.3f s.\n",
+			   pass, numrecs, insert_time, elapsed(&start));
 	} 
 
 	printf("Press 'q' to close and delete the shared tables.\n");
@@ -476,6 +520,232 @@ client_exit:
 	return ret;
 }
 
+static uint64 stress_source_guid(unsigned sp)
+{
+	return STRESS_GUID + sp*0x10000;
+}
+
+static uint16 stress_source_lid(unsigned sp)
+{
+	return 4 + sp*4;
+}
+
+/*
+ * Every record carries the generation that wrote it in TClass and a
+ * checksum of that and its destination in Preference, so a reader can
+ * tell a record torn between two publishes from a good one.
+ */
+static uint8 stress_checksum(unsigned d, unsigned gen)
+{
+	return (d*31 + gen*17) & 0xff;
+}
+
+/*
+ * Builds and publishes the tables, as dsap does when the fabric changes.
+ * After the first generation, stress_paths_only keeps the subnet, vfabric
+ * and port tables and rebuilds just the path table.
+ */
+static int stress_publish(op_ppath_writer_t *w, unsigned gen)
+{
+	op_ppath_port_record_t port;
+	IB_PATH_RECORD_NO rec;
+	unsigned sp, d;
+	int err;
+
+	if (stress_paths_only && gen)
+		goto paths;
+
+	if ((err = op_ppath_initialize_subnets(w, 1, 1))
+		|| (err = op_ppath_initialize_ports(w, STRESS_PORTS))
+		|| (err = op_ppath_initialize_vfabrics(w, 1))
+		|| (err = op_ppath_add_subnet(w, hton64(STRESS_PREFIX)))
+		|| (err = op_ppath_add_vfab(w, "Default", hton64(STRESS_PREFIX),
+									htons(0xffff), 0))
+		|| (err = op_ppath_add_sid(w, hton64(STRESS_PREFIX), 0, 0, "Default"))) {
+		_DBG_ERROR("Failed to create tables: %s\n", strerror(abs(err)));
+		return err;
+	}
+
+	for (sp = 0; sp < STRESS_PORTS; sp++) {
+		memset(&port, 0, sizeof(port));
+		strcpy(port.hfi_name, hfi_name);
+		port.port = port_no;
+		port.base_lid = stress_source_lid(sp);
+		port.lmc = 2;
+		port.source_prefix = hton64(STRESS_PREFIX);
+		port.source_guid = hton64(stress_source_guid(sp));
+		port.pkey[0] = htons(0xffff);
+		if ((err = op_ppath_add_port(w, port))) {
+			_DBG_ERROR("Failed to add port: %s\n", strerror(abs(err)));
+			return err;
+		}
+	}
+
+paths:
+	if ((err = op_ppath_initialize_paths(w, stress_dests * STRESS_PORTS))) {
+		_DBG_ERROR("Failed to create path table: %s\n", strerror(abs(err)));
+		return err;
+	}
+	for (sp = 0; sp < STRESS_PORTS; sp++) {
+		for (d = 0; d < stress_dests; d++) {
+			memset(&rec, 0, sizeof(rec));
+			rec.SGID.Type.Global.SubnetPrefix = hton64(STRESS_PREFIX);
+			rec.SGID.Type.Global.InterfaceID = hton64(stress_source_guid(sp));
+			rec.DGID.Type.Global.SubnetPrefix = hton64(STRESS_PREFIX);
+			rec.DGID.Type.Global.InterfaceID = hton64(STRESS_GUID + 1 + d);
+			rec.SLID = htons(stress_source_lid(sp));
+			rec.DLID = htons(1 + d);
+			rec.P_Key = htons(0xffff);
+			rec.TClass = gen & 0xff;
+			rec.Preference = stress_checksum(d, gen);
+			if ((err = op_ppath_add_path(w, &rec))) {
+				_DBG_ERROR("Failed to add path: %s\n", strerror(abs(err)));
+				return err;
+			}
+		}
+	}
+
+	op_ppath_publish(w);
+	return 0;
+}
+
+/*
+ * Queries random paths until stress_secs have passed and reports the
+ * rate and the worst single query. Runs in its own process.
+ */
+static int stress_reader(int id)
+{
+	op_ppath_reader_t r;
+	IB_PATH_RECORD_NO query, result;
+	unsigned long lookups = 0, misses = 0, wrong = 0;
+	unsigned i = id * 7919;
+	double secs, worst = 0;
+	struct timespec start, qstart;
+	int k, err;
+
+	err = op_ppath_create_reader(&r);
+	if (err) {
+		_DBG_ERROR("Failed to access shared memory tables: %s\n",
+				strerror(err));
+		return -1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	do {
+		for (k = 0; k < STRESS_BATCH; k++, i++) {
+			unsigned d = (i * 2654435761u) % stress_dests;
+			unsigned sp = i % STRESS_PORTS;
+			double t;
+
+			memset(&query, 0, sizeof(query));
+			if (stress_lid) {
+				query.SLID = htons(stress_source_lid(sp));
+				query.DLID = htons(1 + d);
+			} else {
+				query.SGID.Type.Global.SubnetPrefix = hton64(STRESS_PREFIX);
+				query.SGID.Type.Global.InterfaceID = hton64(stress_source_guid(sp));
+				query.DGID.Type.Global.SubnetPrefix = hton64(STRESS_PREFIX);
+				query.DGID.Type.Global.InterfaceID = hton64(STRESS_GUID + 1 + d);
+			}
+
+			clock_gettime(CLOCK_MONOTONIC, &qstart);
+			err = op_ppath_find_path(&r, hfi_name, port_no,
+									 build_comp_mask(query), &query, &result);
+			t = elapsed(&qstart);
+			if (t > worst)
+				worst = t;
+
+			lookups++;
+			if (err) {
+				if (misses++ < 5)
+					_DBG_ERROR("Reader %d: op_ppath_find_path() failed: %s\n",
+							id, strerror(err));
+			} else if (ntohs(result.DLID) != 1 + d
+					|| ntohs(result.SLID) != stress_source_lid(sp)
+					|| result.Preference != stress_checksum(d, result.TClass)) {
+				if (wrong++ < 5)
+					fprint_path_record(stderr, "Wrong record",
+									(op_path_rec_t *)&result);
+			}
+		}
+		secs = elapsed(&start);
+	} while (!done && secs < stress_secs);
+
+	printf("Reader %d: %lu lookups, %.0f/s, %lu misses, %lu wrong, "
+		   "worst %.3f ms.\n", id, lookups, lookups / secs, misses, wrong,
+		   worst * 1000);
+	fflush(stdout);
+	op_ppath_close_reader(&r);
+	return (misses || wrong) ? -1 : 0;
+}
+
+/*
+ * Contention test: forks reader processes which query the tables while
+ * this process republishes them every stress_churn usecs.
+ */
+int stress(void)
+{
+	op_ppath_writer_t w;
+	struct timespec start, pstart;
+	double publish_time = 0;
+	int i, err, status, publishes = 0, ret = 0;
+	unsigned gen = 0;
+
+	printf("Stress: %d readers, %u paths by %s, %d s, %s.\n",
+		   stress_readers, stress_dests * STRESS_PORTS,
+		   stress_lid ? "LID" : "GID", stress_secs,
+		   !stress_churn ? "no writer activity" :
+		   stress_paths_only ? "republishing paths" : "republishing");
+	fflush(stdout);	// or every reader repeats it
+
+	err = op_ppath_create_writer(&w);
+	if (err) {
+		_DBG_ERROR("Failed to create shared memory table: %s\n",
+				strerror(err));
+		return err;
+	}
+	if (stress_publish(&w, gen++)) {
+		ret = -1;
+		goto error;
+	}
+
+	for (i = 0; i < stress_readers; i++) {
+		pid_t pid = fork();
+
+		if (pid == 0)
+			exit(stress_reader(i) ? 1 : 0);
+		if (pid < 0) {
+			_DBG_ERROR("Failed to start reader: %s\n", strerror(errno));
+			ret = -1;
+			break;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while (stress_churn && !done && elapsed(&start) < stress_secs) {
+		clock_gettime(CLOCK_MONOTONIC, &pstart);
+		if (stress_publish(&w, gen++)) {
+			ret = -1;
+			break;
+		}
+		publish_time += elapsed(&pstart);
+		publishes++;
+		usleep(stress_churn);
+	}
+
+	while (wait(&status) > 0) {
+		if (!WIFEXITED(status) || WEXITSTATUS(status))
+			ret = -1;
+	}
+	printf("Stress: %d publishes, %.3f s each. %s\n", publishes,
+		   publishes ? publish_time / publishes : 0,
+		   ret ? "FAILED" : "PASSED");
+
+error:
+	op_ppath_close_writer(&w);
+	return ret;
+}
+
 int dump(char *fname)
 {
 	op_ppath_reader_t r;
@@ -498,15 +768,16 @@ int dump(char *fname)
 
 	fprintf(f,"Shared Table:\n");
 	fprintf(f,"\tABI Version: %u\n", r.shared_table->abi_version);
-	fprintf(f,"\tSubnet Name: %s\n", r.shared_table->subnet_table_name);
+	fprintf(f,"\tGeneration: %u\n", r.shared_table->generation);
+	fprintf(f,"\tSubnet Name: %s\n", r.tables->subnet_table_name);
 	fprintf(f,"\tSubnet Update Count: %u\n", 
-			r.shared_table->subnet_update_count);
-	fprintf(f,"\tPort Name: %s\n", r.shared_table->port_table_name);
-	fprintf(f,"\tPort Update Count: %u\n", r.shared_table->port_update_count);
-	fprintf(f,"\tVFab Name: %s\n", r.shared_table->vfab_table_name);
-	fprintf(f,"\tVFab Update Count: %u\n", r.shared_table->vfab_update_count);
-	fprintf(f,"\tPath Name: %s\n", r.shared_table->path_table_name);
-	fprintf(f,"Path Update Count: %u\n", r.shared_table->path_update_count);
+			r.tables->subnet_update_count);
+	fprintf(f,"\tPort Name: %s\n", r.tables->port_table_name);
+	fprintf(f,"\tPort Update Count: %u\n", r.tables->port_update_count);
+	fprintf(f,"\tVFab Name: %s\n", r.tables->vfab_table_name);
+	fprintf(f,"\tVFab Update Count: %u\n", r.tables->vfab_update_count);
+	fprintf(f,"\tPath Name: %s\n", r.tables->path_table_name);
+	fprintf(f,"Path Update Count: %u\n", r.tables->path_update_count);
 
 	fprintf(f,"\n\nSubnet Table:\n");
 	fprintf(f,"\tSubnet Size: %u\n", r.subnet_table->subnet_size);
@@ -519,6 +790,14 @@ int dump(char *fname)
 				hton64(r.subnet_table->subnet[i].source_prefix));
 		fprintf(f,"\t\tFirst SID: %u\n",
 				r.subnet_table->subnet[i].first_sid);
+		fprintf(f,"\t\tZero SID: %u\n",
+				r.subnet_table->subnet[i].zero_sid);
+		fprintf(f,"\t\tDefault SID: %u\n",
+				r.subnet_table->subnet[i].default_sid);
+		fprintf(f,"\t\tFirst Range: %u\n",
+				r.subnet_table->subnet[i].first_range);
+		fprintf(f,"\t\tRange Count: %u\n",
+				r.subnet_table->subnet[i].range_count);
 	}
 	for (i = 1; i <= r.subnet_table->sid_count ; i++) {
 		fprintf(f,"\tSID[%u]:\n",i);
@@ -530,6 +809,13 @@ int dump(char *fname)
 		fprintf(f,"\t\tNext: %u\n",
 				r.sid_table[i].next);
 	}
+	fprintf(f,"\tRange Count: %u\n", r.subnet_table->range_count);
+	for (i = 0; i < r.subnet_table->range_count ; i++) {
+		fprintf(f,"\tRange[%u]: 0x%016lx - 0x%016lx SID %u\n", i,
+				r.sid_ranges[i].lower_sid,
+				r.sid_ranges[i].upper_sid,
+				r.sid_ranges[i].sid_id);
+	}
 
 	fprintf(f,"\n\nPort Table:\n");
 	fprintf(f,"\tSize: %u\n", r.port_table->size);
@@ -558,7 +844,6 @@ int dump(char *fname)
 	fprintf(f,"\tSize: %u\n", r.vfab_table->size);
 	fprintf(f,"\tCount: %u\n", r.vfab_table->count);
 	for (i = 1; i <= r.vfab_table->count ; i++) {
-		int j;
 		fprintf(f,"\tVFab[%u]: %s\n", i, 
 				r.vfab_table->vfab[i].vfab_name);
 		fprintf(f,"\t\tPrefix: 0x%16lx\n",
@@ -567,18 +852,6 @@ int dump(char *fname)
 				hton16(r.vfab_table->vfab[i].pkey));
 		fprintf(f,"\t\tService Level: 0x%04x\n",
 				hton16(r.vfab_table->vfab[i].sl));
-
-		fprintf(f,"\n\t\tDLID Hash Table:\n");
-		for (j=0;j<HASH_TABLE_SIZE; j++) {
-			fprintf(f,"\t\t\tRecord[%u] = %u\n",
-					j,r.vfab_table->vfab[i].first_dlid[j]);
-		}
-
-		fprintf(f,"\n\t\tDGUID Hash Table:\n");
-		for (j=0;j<HASH_TABLE_SIZE; j++) {
-			fprintf(f,"\t\t\tRecord[%u] = %u\n",
-					j,r.vfab_table->vfab[i].first_dguid[j]);
-		}
 		
 	}
 
@@ -587,13 +860,29 @@ int dump(char *fname)
 	fprintf(f,"\tCount: %u\n", r.path_table->count);
 	for (i=1; i<= r.path_table->count; i++) {
 		char s[128];
-		sprintf(s,"Record[%u] (%s) Lid->%u, Guid->%u",i, 
+		sprintf(s,"Record[%u] (%s) VFab %u, Lid->%u",i, 
 				r.path_table->table[i].flags?"Used":"Unused",
-				r.path_table->table[i].next_lid,  
-				r.path_table->table[i].next_guid);
+				r.path_table->table[i].vfab_id,
+				r.path_table->table[i].next_lid);
 		fprint_path_record(f,s,(op_path_rec_t*)&(r.path_table->table[i].path));
 	}
 
+	fprintf(f,"\n\nGID Index\n");
+	fprintf(f,"\tSlots: %u\n", r.path_table->index_slots);
+	for (i=0; i< r.path_table->index_slots; i++) {
+		if (!r.gid_index[i].path) continue;
+		fprintf(f,"\tSlot[%u] = %u (VFab %u, Tag 0x%08x)\n", i,
+				r.gid_index[i].path, r.gid_index[i].vfab_id,
+				r.gid_index[i].tag);
+	}
+
+	fprintf(f,"\n\nLID Chain Heads\n");
+	fprintf(f,"\tSlots: %u\n", r.path_table->index_slots/2);
+	for (i=0; i< r.path_table->index_slots/2; i++) {
+		if (!r.lid_heads[i]) continue;
+		fprintf(f,"\tSlot[%u] = %u\n", i, r.lid_heads[i]);
+	}
+
 	op_ppath_close_reader(&r);
 	fclose(f);
 	return 0;
@@ -612,7 +901,7 @@ int main(int argc, char *argv[])
 	do {
 		int c;
 
-		static char *short_options = "sdcf:n:v:";
+		static char *short_options = "sdctf:n:v:r:T:w:lD:P";
 		static struct option long_options[] = {
 			{.name = "server",.has_arg = 0,.val = 's'},
 			{.name = "client",.has_arg = 0,.val = 'c'},
@@ -622,6 +911,13 @@ int main(int argc, char *argv[])
 			{.name = "hfi",.has_arg = 1,.val = 'H'},
 			{.name = "port",.has_arg = 1,.val = 'p'},
 			{.name = "verbose",.has_arg = 1,.val = 'v'},
+			{.name = "stress",.has_arg = 0,.val = 't'},
+			{.name = "readers",.has_arg = 1,.val = 'r'},
+			{.name = "time",.has_arg = 1,.val = 'T'},
+			{.name = "churn",.has_arg = 1,.val = 'w'},
+			{.name = "lid",.has_arg = 0,.val = 'l'},
+			{.name = "dests",.has_arg = 1,.val = 'D'},
+			{.name = "paths",.has_arg = 0,.val = 'P'},
 			{0}
 		};
 
@@ -634,6 +930,13 @@ int main(int argc, char *argv[])
 			"the default hfi. (Defaults to "HFINAME".)",
 			"the default port. (Defaults to 1.)",
 			"the level of logging to do.",
+			"Stress mode: readers in separate processes query while the tables are republished",
+			"in stress mode, the number of reader processes. (Defaults to 4.)",
+			"in stress mode, the seconds to run. (Defaults to 3.)",
+			"in stress mode, usecs between publishes, 0 for none. (Defaults to 500.)",
+			"in stress mode, query by LIDs instead of GIDs",
+			"in stress mode, destinations per source port. (Defaults to 2000.)",
+			"in stress mode, republish only the path table",
 			NULL
 		};
 
@@ -654,8 +957,27 @@ int main(int argc, char *argv[])
 		case 'c':
 		case 'd':
 		case 's':
+		case 't':
 			mode = c;
 			break;
+		case 'r':
+			stress_readers = strtol(optarg, NULL, 0);
+			break;
+		case 'T':
+			stress_secs = strtol(optarg, NULL, 0);
+			break;
+		case 'w':
+			stress_churn = strtol(optarg, NULL, 0);
+			break;
+		case 'l':
+			stress_lid = 1;
+			break;
+		case 'D':
+			stress_dests = strtoul(optarg, NULL, 0);
+			break;
+		case 'P':
+			stress_paths_only = 1;
+			break;
 		case 'v':
 			debug = strtol(optarg,NULL,0);
 			break;
@@ -681,7 +1003,7 @@ int main(int argc, char *argv[])
 
 	op_log_set_level(debug);
 
-	if (filename[0]==0) {
+	if (filename[0]==0 && mode != 't') {
 		_DBG_ERROR("You must provide a filename.\n");
 		return -1;
 	}
@@ -689,6 +1011,8 @@ int main(int argc, char *argv[])
 	signal(SIGINT, my_sig);
 
 	switch (mode) {
+		case 't':
+			return stress() ? 1 : 0;
 		case 'c':	
 			client(filename,n);
 			break;
@@ -61,15 +61,16 @@ dump(FILE *f)
 
 	fprintf(f,"Shared Table:\n");
 	fprintf(f,"\tABI Version: %u\n", r.shared_table->abi_version);
-	fprintf(f,"\tSubnet Name: %s\n", r.shared_table->subnet_table_name);
+	fprintf(f,"\tGeneration: %u\n", r.shared_table->generation);
+	fprintf(f,"\tSubnet Name: %s\n", r.tables->subnet_table_name);
 	fprintf(f,"\tSubnet Update Count: %u\n", 
-			r.shared_table->subnet_update_count);
-	fprintf(f,"\tPort Name: %s\n", r.shared_table->port_table_name);
-	fprintf(f,"\tPort Update Count: %u\n", r.shared_table->port_update_count);
-	fprintf(f,"\tVFab Name: %s\n", r.shared_table->vfab_table_name);
-	fprintf(f,"\tVFab Update Count: %u\n", r.shared_table->vfab_update_count);
-	fprintf(f,"\tPath Name: %s\n", r.shared_table->path_table_name);
-	fprintf(f,"\tPath Update Count: %u\n", r.shared_table->path_update_count);
+			r.tables->subnet_update_count);
+	fprintf(f,"\tPort Name: %s\n", r.tables->port_table_name);
+	fprintf(f,"\tPort Update Count: %u\n", r.tables->port_update_count);
+	fprintf(f,"\tVFab Name: %s\n", r.tables->vfab_table_name);
+	fprintf(f,"\tVFab Update Count: %u\n", r.tables->vfab_update_count);
+	fprintf(f,"\tPath Name: %s\n", r.tables->path_table_name);
+	fprintf(f,"\tPath Update Count: %u\n", r.tables->path_update_count);
 
 	fprintf(f,"\n\nSubnet Table:\n");
 	fprintf(f,"\tSubnet Size: %u\n", r.subnet_table->subnet_size);
@@ -82,6 +83,14 @@ dump(FILE *f)
 				hton64(r.subnet_table->subnet[i].source_prefix));
 		fprintf(f,"\t\tFirst SID: %u\n",
 				r.subnet_table->subnet[i].first_sid);
+		fprintf(f,"\t\tZero SID: %u\n",
+				r.subnet_table->subnet[i].zero_sid);
+		fprintf(f,"\t\tDefault SID: %u\n",
+				r.subnet_table->subnet[i].default_sid);
+		fprintf(f,"\t\tFirst Range: %u\n",
+				r.subnet_table->subnet[i].first_range);
+		fprintf(f,"\t\tRange Count: %u\n",
+				r.subnet_table->subnet[i].range_count);
 	}
 	for (i = 1; i <= r.subnet_table->sid_count ; i++) {
 		fprintf(f,"\tSID[%u]:\n",i);
@@ -93,6 +102,13 @@ dump(FILE *f)
 		fprintf(f,"\t\tNext: %u\n",
 				r.sid_table[i].next);
 	}
+	fprintf(f,"\tRange Count: %u\n", r.subnet_table->range_count);
+	for (i = 0; i < r.subnet_table->range_count ; i++) {
+		fprintf(f,"\tRange[%u]: 0x%016lx - 0x%016lx SID %u\n", i,
+				r.sid_ranges[i].lower_sid,
+				r.sid_ranges[i].upper_sid,
+				r.sid_ranges[i].sid_id);
+	}
 
 	fprintf(f,"\n\nPort Table:\n");
 	fprintf(f,"\tSize: %u\n", r.port_table->size);
@@ -121,7 +137,6 @@ dump(FILE *f)
 	fprintf(f,"\tSize: %u\n", r.vfab_table->size);
 	fprintf(f,"\tCount: %u\n", r.vfab_table->count);
 	for (i = 1; i <= r.vfab_table->count ; i++) {
-		int j;
 		op_ppath_vfab_record_t *vf = &r.vfab_table->vfab[i];
 		fprintf(f,"\tVFab[%u]: %s\n", i, 
 				vf->vfab_name);
@@ -131,17 +146,6 @@ dump(FILE *f)
 				hton16(vf->pkey));
 		fprintf(f,"\t\tService Level: 0x%04x\n",
 				hton16(vf->sl));
-
-		fprintf(f,"\n\t\tDLID Hash Table:\n");
-		for (j=0;j<HASH_TABLE_SIZE; j++) {
-			fprintf(f,"\t\t\tRecord[%u] = %u\n",
-					j,vf->first_dlid[j]);
-		}
-		fprintf(f,"\n\t\tDGUID Hash Table:\n");
-		for (j=0;j<HASH_TABLE_SIZE; j++) {
-			fprintf(f,"\t\t\tRecord[%u] = %u\n",
-					j,vf->first_dguid[j]);
-		}
 		
 	}
 
@@ -150,13 +154,29 @@ dump(FILE *f)
 	fprintf(f,"\tCount: %u\n", r.path_table->count);
 	for (i=1; i<= r.path_table->count; i++) {
 		char s[128];
-		sprintf(s,"Record[%u] (%s) Lid->%u, Guid->%u",i, 
+		sprintf(s,"Record[%u] (%s) VFab %u, Lid->%u",i, 
 				r.path_table->table[i].flags?"Used":"Unused",
-				r.path_table->table[i].next_lid,  
-				r.path_table->table[i].next_guid);
+				r.path_table->table[i].vfab_id,
+				r.path_table->table[i].next_lid);
 		fprint_path_record(f,s,(op_path_rec_t*)&(r.path_table->table[i].path));
 	}
 
+	fprintf(f,"\n\nGID Index\n");
+	fprintf(f,"\tSlots: %u\n", r.path_table->index_slots);
+	for (i=0; i< r.path_table->index_slots; i++) {
+		if (!r.gid_index[i].path) continue;
+		fprintf(f,"\tSlot[%u] = %u (VFab %u, Tag 0x%08x)\n", i,
+				r.gid_index[i].path, r.gid_index[i].vfab_id,
+				r.gid_index[i].tag);
+	}
+
+	fprintf(f,"\n\nLID Chain Heads\n");
+	fprintf(f,"\tSlots: %u\n", r.path_table->index_slots/2);
+	for (i=0; i< r.path_table->index_slots/2; i++) {
+		if (!r.lid_heads[i]) continue;
+		fprintf(f,"\tSlot[%u] = %u\n", i, r.lid_heads[i]);
+	}
+
 	op_ppath_close_reader(&r);
 	return 0;
 }